@@ -0,0 +1,13 @@
+import { MigrationInterface, QueryRunner } from 'typeorm';
+
+export class NfcCardSunCounter1750328235900 implements MigrationInterface {
+  name = 'NfcCardSunCounter1750328235900';
+
+  public async up(queryRunner: QueryRunner): Promise<void> {
+    await queryRunner.query(`ALTER TABLE "nfc_card" ADD "sunCounter" integer`);
+  }
+
+  public async down(queryRunner: QueryRunner): Promise<void> {
+    await queryRunner.query(`ALTER TABLE "nfc_card" DROP COLUMN "sunCounter"`);
+  }
+}
@@ -27,3 +27,4 @@ export * from './1749676524250-revoked-token-fix';
 export * from './1750328235897-users-external-identifier';
 export * from './1750328235898-add-email-change-fields';
 export * from './1750328235899-seed-email-change-template';
+export * from './1750328235900-nfc-card-sun-counter';
@@ -3,3 +3,5 @@ import { FabReader } from '@fabaccess/database-entities';
 export class ReaderUpdatedEvent {
   constructor(public readonly reader: FabReader) {}
 }
+
+export class NFCCardsChangedEvent {}
@@ -8,6 +8,7 @@ import { FabReaderNfcCardsController } from './card.controller';
 import 'sqlite3';
 import '@nestjs/common';
 import { WebSocketEventService } from './modules/websockets/websocket-event.service';
+import { OfflineAuthService } from './modules/websockets/offline-auth.service';
 import { EventEmitterModule } from '@nestjs/event-emitter';
 import { FabReader, NFCCard } from '@fabaccess/database-entities';
 import { UsersAndAuthModule } from '../users-and-auth/users-and-auth.module';
@@ -22,7 +23,7 @@ import { ResourceUsageModule } from '../resources/usage/resourceUsage.module';
     ResourcesModule,
     ResourceUsageModule,
   ],
-  providers: [FabreaderService, WebsocketService, FabreaderGateway, WebSocketEventService],
+  providers: [FabreaderService, WebsocketService, FabreaderGateway, WebSocketEventService, OfflineAuthService],
   controllers: [FabReaderController, FabReaderNfcCardsController],
 })
 export class FabReaderModule {}
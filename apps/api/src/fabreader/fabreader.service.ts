@@ -1,11 +1,11 @@
 import { Inject, Injectable, Logger } from '@nestjs/common';
 import { subtle } from 'crypto';
 import { NFCCard, FabReader } from '@fabaccess/database-entities';
-import { DeleteResult, FindManyOptions, Repository } from 'typeorm';
+import { DeleteResult, FindManyOptions, LessThan, Repository } from 'typeorm';
 import { InjectRepository } from '@nestjs/typeorm';
 import { nanoid } from 'nanoid';
 import { securelyHashToken } from './modules/websockets/websocket.utils';
-import { ReaderUpdatedEvent } from './events';
+import { NFCCardsChangedEvent, ReaderUpdatedEvent } from './events';
 import { EventEmitter2 } from '@nestjs/event-emitter';
 
 @Injectable()
@@ -46,11 +46,33 @@ export class FabreaderService {
   }
 
   public async createNFCCard(data: Omit<NFCCard, 'id' | 'createdAt' | 'updatedAt'>): Promise<NFCCard> {
-    return await this.nfcCardRepository.save(data);
+    const card = await this.nfcCardRepository.save(data);
+    this.eventEmitter.emit('nfc-cards.changed', new NFCCardsChangedEvent());
+    return card;
+  }
+
+  /**
+   * Called once SDM mirrors SUN messages into the card's NDEF file, taps can be verified
+   * from them from now on.
+   */
+  public async enableNFCCardSun(id: number): Promise<void> {
+    await this.nfcCardRepository.update(id, { sunCounter: -1 });
+  }
+
+  /**
+   * Records the counter of a verified SUN message. False if the card already sent this or a
+   * higher counter, i.e. the message was replayed. The check and the update are one query, so
+   * two readers can't both accept the same message.
+   */
+  public async acceptNFCCardSunCounter(id: number, counter: number): Promise<boolean> {
+    const result = await this.nfcCardRepository.update({ id, sunCounter: LessThan(counter) }, { sunCounter: counter });
+    return result.affected === 1;
   }
 
   public async deleteNFCCard(id: number): Promise<DeleteResult> {
-    return await this.nfcCardRepository.delete(id);
+    const result = await this.nfcCardRepository.delete(id);
+    this.eventEmitter.emit('nfc-cards.changed', new NFCCardsChangedEvent());
+    return result;
   }
 
   public async createNewReader(): Promise<{ reader: FabReader; token: string }> {
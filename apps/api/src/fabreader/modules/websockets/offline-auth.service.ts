@@ -0,0 +1,171 @@
+import { Inject, Injectable, Logger } from '@nestjs/common';
+import { Interval } from '@nestjs/schedule';
+import { FabReader, NFCCard, User } from '@fabaccess/database-entities';
+import { FabreaderService } from '../../fabreader.service';
+import { UsersService } from '../../../users-and-auth/users/users.service';
+import { ResourceUsageService } from '../../../resources/usage/resourceUsage.service';
+import { AuthenticatedWebSocket, FabreaderEvent, FabreaderEventType } from './websocket.types';
+import { WebsocketService } from './websocket.service';
+import { buildOfflineAuthUpdate, hashCardUID, OFFLINE_AUTH_MAX_ENTRIES, offlineAuthVersion } from './offline-auth';
+
+/**
+ * Cards, their users and who may control which resource, loaded once for every reader
+ * synced together.
+ */
+export interface OfflineAuthSources {
+  cards: NFCCard[];
+  users: Map<number, User>;
+  controllers: Map<number, Promise<Set<number>>>; // By resource id
+}
+
+/**
+ * Keeps the offline authorization set of every reader current. The set holds the cards whose
+ * users may control one of the reader's resources, the reader decides taps with it once the
+ * server was unreachable for a while.
+ */
+@Injectable()
+export class OfflineAuthService {
+  private static readonly REMEMBERED_SETS = 16;
+
+  // Catches changes that don't emit an event, e.g. deleted resources
+  private static readonly RESYNC_INTERVAL_MS = 15 * 60 * 1000;
+
+  private readonly logger = new Logger(OfflineAuthService.name);
+
+  // Recently sent sets by version, deltas are computed against them
+  private readonly sets = new Map<number, string[]>();
+
+  @Inject(FabreaderService)
+  private readonly fabreaderService: FabreaderService;
+
+  @Inject(UsersService)
+  private readonly usersService: UsersService;
+
+  @Inject(ResourceUsageService)
+  private readonly resourceUsageService: ResourceUsageService;
+
+  @Inject(WebsocketService)
+  private readonly websocketService: WebsocketService;
+
+  /**
+   * Sends the reader what changed since the version it reported, or the whole set if that
+   * version is unknown. Readers that did not report a version have no offline mode.
+   */
+  public async sync(socket: AuthenticatedWebSocket, full = false, sources?: OfflineAuthSources): Promise<void> {
+    if (!socket.reader || !socket.offlineAuth) {
+      return;
+    }
+
+    const hashes = await this.authorizedCardHashes(socket.reader, sources ?? (await this.loadSources()));
+    const version = offlineAuthVersion(hashes);
+    if (!full && socket.offlineAuth.version === version) {
+      return;
+    }
+
+    const baseHashes = full ? undefined : this.sets.get(socket.offlineAuth.version);
+    const base = baseHashes ? { version: socket.offlineAuth.version, hashes: baseHashes } : undefined;
+    this.remember(version, hashes);
+
+    const updates = buildOfflineAuthUpdate(version, hashes, base);
+    this.logger.debug(
+      `Sending offline set ${version} with ${hashes.length} cards to reader ${socket.reader.id} in ${updates.length} messages` +
+        (base ? ` as delta from ${base.version}.` : '.')
+    );
+
+    socket.offlineAuth.pending = { version, full: !base };
+    for (const payload of updates) {
+      socket.sendMessage(new FabreaderEvent(FabreaderEventType.OFFLINE_AUTH_UPDATE, payload));
+    }
+  }
+
+  public async syncAll(sockets: Iterable<AuthenticatedWebSocket>): Promise<void> {
+    const sources = await this.loadSources();
+    for (const socket of sockets) {
+      await this.sync(socket, false, sources);
+    }
+  }
+
+  @Interval(OfflineAuthService.RESYNC_INTERVAL_MS)
+  public async resync(): Promise<void> {
+    await this.syncAll(this.websocketService.sockets.values());
+  }
+
+  /**
+   * The reader answers an update with the version it ended up with. A delta it could not apply
+   * is followed by the whole set.
+   */
+  public async onUpdateResponse(socket: AuthenticatedWebSocket, payload: { version: number; count: number }) {
+    if (!socket.offlineAuth) {
+      return;
+    }
+
+    const pending = socket.offlineAuth.pending;
+    socket.offlineAuth.version = payload.version;
+    socket.offlineAuth.pending = undefined;
+
+    if (!pending || payload.version === pending.version) {
+      this.logger.debug(`Reader ${socket.reader?.id} has offline set ${payload.version} with ${payload.count} cards.`);
+      return;
+    }
+
+    if (pending.full) {
+      this.logger.warn(`Reader ${socket.reader?.id} did not accept offline set ${pending.version}, keeping ${payload.version}.`);
+      return;
+    }
+
+    this.logger.debug(`Reader ${socket.reader?.id} could not apply the offline set delta, sending the whole set.`);
+    await this.sync(socket, true);
+  }
+
+  private async loadSources(): Promise<OfflineAuthSources> {
+    const cards = await this.fabreaderService.getAllNFCCards();
+    const userIds = Array.from(new Set(cards.map((card) => card.userId)));
+    const users = new Map((await this.usersService.findAllByIds(userIds)).map((user) => [user.id, user]));
+    return { cards, users, controllers: new Map() };
+  }
+
+  private async authorizedCardHashes(reader: FabReader, sources: OfflineAuthSources): Promise<string[]> {
+    const controllers = new Set<number>();
+    for (const resourceId of reader.hasAccessToResourceIds ?? []) {
+      if (!sources.controllers.has(resourceId)) {
+        sources.controllers.set(resourceId, this.resourceUsageService.getUserIdsThatCanControlResource(resourceId));
+      }
+      for (const userId of await sources.controllers.get(resourceId)) {
+        controllers.add(userId);
+      }
+    }
+
+    const hasResources = (reader.hasAccessToResourceIds ?? []).length > 0;
+    const hashes = new Set<string>();
+    for (const card of sources.cards) {
+      // Cards of deleted users are skipped
+      const user = sources.users.get(card.userId);
+      if (!user) {
+        continue;
+      }
+
+      if (controllers.has(user.id) || (hasResources && user.systemPermissions?.canManageResources)) {
+        hashes.add(hashCardUID(card.uid));
+      }
+    }
+
+    const sorted = Array.from(hashes).sort();
+    if (sorted.length > OFFLINE_AUTH_MAX_ENTRIES) {
+      this.logger.warn(
+        `Reader ${reader.id} has ${sorted.length} authorized cards, its offline set only holds ${OFFLINE_AUTH_MAX_ENTRIES}.`
+      );
+      return sorted.slice(0, OFFLINE_AUTH_MAX_ENTRIES);
+    }
+    return sorted;
+  }
+
+  private remember(version: number, hashes: string[]) {
+    this.sets.delete(version);
+    this.sets.set(version, hashes);
+
+    // Maps iterate in insertion order, the first key is the least recently sent set
+    if (this.sets.size > OfflineAuthService.REMEMBERED_SETS) {
+      this.sets.delete(this.sets.keys().next().value);
+    }
+  }
+}
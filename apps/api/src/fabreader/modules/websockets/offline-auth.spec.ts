@@ -0,0 +1,50 @@
+import { buildOfflineAuthUpdate, hashCardUID, OFFLINE_AUTH_CHUNK, offlineAuthVersion } from './offline-auth';
+
+describe('offline auth', () => {
+  it('hashes UIDs like the firmware', () => {
+    // Same vector as test_offline_auth.cpp
+    expect(hashCardUID('045a3b11223344')).toBe('316fbe4040b9914d');
+    expect(hashCardUID('045A3B11223344')).toBe('316fbe4040b9914d');
+  });
+
+  it('derives the version from the content', () => {
+    const hashes = [hashCardUID('01'), hashCardUID('02')].sort();
+
+    expect(offlineAuthVersion(hashes)).toBe(offlineAuthVersion([...hashes]));
+    expect(offlineAuthVersion(hashes)).not.toBe(offlineAuthVersion(hashes.slice(1)));
+    expect(offlineAuthVersion([])).not.toBe(0);
+  });
+
+  it('sends the whole set without a base', () => {
+    const hashes = ['0000000000000001', '0000000000000002'];
+
+    expect(buildOfflineAuthUpdate(5, hashes)).toEqual([
+      { baseVersion: 0, version: 5, chunk: 0, final: true, added: hashes.join(''), removed: '' },
+    ]);
+  });
+
+  it('sends an empty set as a single chunk', () => {
+    expect(buildOfflineAuthUpdate(5, [])).toEqual([
+      { baseVersion: 0, version: 5, chunk: 0, final: true, added: '', removed: '' },
+    ]);
+  });
+
+  it('sends only the difference to the base', () => {
+    const base = { version: 4, hashes: ['0000000000000001', '0000000000000002'] };
+
+    expect(buildOfflineAuthUpdate(5, ['0000000000000002', '0000000000000003'], base)).toEqual([
+      { baseVersion: 4, version: 5, chunk: 0, final: true, added: '0000000000000003', removed: '0000000000000001' },
+    ]);
+  });
+
+  it('splits large updates into chunks', () => {
+    const hashes = Array.from({ length: OFFLINE_AUTH_CHUNK + 1 }, (_, i) => i.toString(16).padStart(16, '0'));
+    const updates = buildOfflineAuthUpdate(5, hashes);
+
+    expect(updates).toHaveLength(2);
+    expect(updates.map((update) => update.chunk)).toEqual([0, 1]);
+    expect(updates.map((update) => update.final)).toEqual([false, true]);
+    expect(updates[0].added).toHaveLength(OFFLINE_AUTH_CHUNK * 16);
+    expect(updates[1].added).toBe(hashes[OFFLINE_AUTH_CHUNK]);
+  });
+});
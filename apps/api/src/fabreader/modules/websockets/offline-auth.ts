@@ -0,0 +1,77 @@
+import { createHash } from 'crypto';
+
+/** Hashes added and removed per OFFLINE_AUTH_UPDATE message, PROTOCOL_OFFLINE_AUTH_CHUNK in the firmware. */
+export const OFFLINE_AUTH_CHUNK = 64;
+
+/** Capacity of the set on the reader, OFFLINE_AUTH_MAX_ENTRIES in the firmware. */
+export const OFFLINE_AUTH_MAX_ENTRIES = 1024;
+
+// BigInt() instead of literals, the spec build targets ES2015
+const MASK = (BigInt(1) << BigInt(64)) - BigInt(1);
+const FNV_OFFSET = BigInt('0xcbf29ce484222325');
+const FNV_PRIME = BigInt('0x100000001b3');
+const MIX_1 = BigInt('0xbf58476d1ce4e5b9');
+const MIX_2 = BigInt('0x94d049bb133111eb');
+
+export interface OfflineAuthUpdatePayload {
+  baseVersion: number;
+  version: number;
+  chunk: number;
+  final: boolean;
+  added: string;
+  removed: string;
+}
+
+/**
+ * FNV-1a 64 of the UID bytes, finished with the splitmix64 mixer. Matches OfflineAuth::hashUid()
+ * in the firmware. Returns 16 hex digits.
+ */
+export function hashCardUID(uid: string): string {
+  let hash = FNV_OFFSET;
+  for (const byte of Buffer.from(uid, 'hex')) {
+    hash = ((hash ^ BigInt(byte)) * FNV_PRIME) & MASK;
+  }
+
+  hash = ((hash ^ (hash >> BigInt(30))) * MIX_1) & MASK;
+  hash = ((hash ^ (hash >> BigInt(27))) * MIX_2) & MASK;
+  hash ^= hash >> BigInt(31);
+  return hash.toString(16).padStart(16, '0');
+}
+
+/**
+ * Versions identify the content of a set, so they stay valid across server restarts. 0 is
+ * the empty set of a reader that never received one.
+ */
+export function offlineAuthVersion(sortedHashes: string[]): number {
+  const digest = createHash('sha256').update(sortedHashes.join('')).digest();
+  return digest.readUInt32BE(0) || 1;
+}
+
+/**
+ * Splits an update into messages. Without a base the reader replaces its whole set,
+ * otherwise only the difference to the base is sent.
+ */
+export function buildOfflineAuthUpdate(
+  version: number,
+  hashes: string[],
+  base?: { version: number; hashes: string[] }
+): OfflineAuthUpdatePayload[] {
+  let added = hashes;
+  let removed: string[] = [];
+  if (base) {
+    const current = new Set(base.hashes);
+    const next = new Set(hashes);
+    added = hashes.filter((hash) => !current.has(hash));
+    removed = base.hashes.filter((hash) => !next.has(hash));
+  }
+
+  const chunks = Math.max(1, Math.ceil(Math.max(added.length, removed.length) / OFFLINE_AUTH_CHUNK));
+  return Array.from({ length: chunks }, (_, chunk) => ({
+    baseVersion: base?.version ?? 0,
+    version,
+    chunk,
+    final: chunk === chunks - 1,
+    added: added.slice(chunk * OFFLINE_AUTH_CHUNK, (chunk + 1) * OFFLINE_AUTH_CHUNK).join(''),
+    removed: removed.slice(chunk * OFFLINE_AUTH_CHUNK, (chunk + 1) * OFFLINE_AUTH_CHUNK).join(''),
+  }));
+}
@@ -125,6 +125,26 @@ describe('EnrollNTAG424State', () => {
       );
     });
 
+    it('should reject cards that cannot be an NTAG424 without touching them', async () => {
+      await enrollState.onStateEnter();
+      (mockSocket.sendMessage as jest.Mock).mockClear();
+
+      await enrollState.onEvent({
+        type: FabreaderEventType.NFC_TAP,
+        payload: { cardUID: mockCardUID, cardFamily: 'MIFARE_CLASSIC', atqa: 0x0004, sak: 0x08 },
+      });
+
+      expect(mockSocket.sendMessage).toHaveBeenCalledTimes(1);
+      expect(mockSocket.sendMessage).toHaveBeenCalledWith(
+        expect.objectContaining({
+          data: expect.objectContaining({
+            type: FabreaderEventType.DISPLAY_ERROR,
+          }),
+        })
+      );
+      expect(enrollState['enrollment']?.nextExpectedEvent).toBe(FabreaderEventType.NFC_TAP);
+    });
+
     it('should ignore unexpected events', async () => {
       const initialCallCount = (mockSocket.sendMessage as jest.Mock).mock.calls.length;
 
@@ -346,6 +366,7 @@ describe('EnrollNTAG424State - Full Flow', () => {
       fabreaderService: {
         getNFCCardByUID: jest.fn(),
         createNFCCard: jest.fn().mockResolvedValue({ id: 'nfc-card-1' }),
+        enableNFCCardSun: jest.fn().mockResolvedValue(undefined),
         uint8ArrayToHexString: jest.fn(),
         generateNTAG424Key: jest.fn(),
       },
@@ -454,6 +475,83 @@ describe('EnrollNTAG424State - Full Flow', () => {
     expect(mockSocket.transitionToState).toHaveBeenCalledTimes(1);
   });
 
+  it('should set up SUN messages on cards the reader identified as NTAG424', async () => {
+    await enrollState.onStateEnter();
+    (mockServices.fabreaderService.getNFCCardByUID as jest.Mock).mockResolvedValue(null);
+
+    await enrollState.onEvent({
+      type: FabreaderEventType.NFC_TAP,
+      payload: { cardUID: mockCardUID, cardFamily: 'NTAG424' },
+    });
+    await enrollState.onResponse({
+      type: FabreaderEventType.CHANGE_KEYS,
+      payload: { successfulKeys: [0], failedKeys: [] },
+    });
+
+    (mockSocket.sendMessage as jest.Mock).mockClear();
+    await enrollState.onResponse({
+      type: FabreaderEventType.AUTHENTICATE,
+      payload: { authenticationSuccessful: true },
+    });
+
+    // The card exists before SDM is configured, it also works without SUN
+    expect(mockServices.fabreaderService.createNFCCard).toHaveBeenCalled();
+    expect(mockSocket.sendMessage).toHaveBeenCalledTimes(1);
+    const job = (mockSocket.sendMessage as jest.Mock).mock.calls[0][0].data;
+    expect(job.type).toBe(FabreaderEventType.RUN_JOB);
+    expect(job.payload.cardUID).toBe(mockCardUID);
+    expect(job.payload.steps[job.payload.steps.length - 1].type).toBe('CHANGE_FILE_SETTINGS');
+    expect(mockSocket.transitionToState).not.toHaveBeenCalled();
+
+    await enrollState.onResponse({
+      type: FabreaderEventType.RUN_JOB,
+      payload: { jobId: job.payload.jobId, cardUID: mockCardUID, success: true, steps: [] },
+    });
+
+    expect(mockServices.fabreaderService.enableNFCCardSun).toHaveBeenCalledWith('nfc-card-1');
+    expect(mockSocket.sendMessage).toHaveBeenLastCalledWith(
+      expect.objectContaining({
+        data: expect.objectContaining({
+          type: FabreaderEventType.DISPLAY_SUCCESS,
+          payload: expect.objectContaining({ message: 'Enrollment successful' }),
+        }),
+      })
+    );
+    expect(mockSocket.transitionToState).toHaveBeenCalledTimes(1);
+  });
+
+  it('should enroll the card when SUN setup fails', async () => {
+    await enrollState.onStateEnter();
+    (mockServices.fabreaderService.getNFCCardByUID as jest.Mock).mockResolvedValue(null);
+
+    await enrollState.onEvent({
+      type: FabreaderEventType.NFC_TAP,
+      payload: { cardUID: mockCardUID, cardFamily: 'NTAG424' },
+    });
+    await enrollState.onResponse({
+      type: FabreaderEventType.CHANGE_KEYS,
+      payload: { successfulKeys: [0], failedKeys: [] },
+    });
+    await enrollState.onResponse({
+      type: FabreaderEventType.AUTHENTICATE,
+      payload: { authenticationSuccessful: true },
+    });
+    const job = (mockSocket.sendMessage as jest.Mock).mock.calls.slice(-1)[0][0].data;
+
+    await enrollState.onResponse({
+      type: FabreaderEventType.RUN_JOB,
+      payload: { jobId: job.payload.jobId, success: false, error: 'Job rejected' },
+    });
+
+    expect(mockServices.fabreaderService.enableNFCCardSun).not.toHaveBeenCalled();
+    expect(mockSocket.sendMessage).toHaveBeenLastCalledWith(
+      expect.objectContaining({
+        data: expect.objectContaining({ type: FabreaderEventType.DISPLAY_SUCCESS }),
+      })
+    );
+    expect(mockSocket.transitionToState).toHaveBeenCalledTimes(1);
+  });
+
   it('should handle key change failure', async () => {
     // Reset call history
     (mockSocket.sendMessage as jest.Mock).mockClear();
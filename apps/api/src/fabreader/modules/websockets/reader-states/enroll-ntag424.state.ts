@@ -2,8 +2,15 @@ import { Logger } from '@nestjs/common';
 import { ReaderState } from './reader-state.interface';
 import { InitialReaderState } from './initial.state';
 import { User } from '@fabaccess/plugins-backend-sdk';
-import { AuthenticatedWebSocket, FabreaderEvent, FabreaderEventType, FabreaderResponse } from '../websocket.types';
+import {
+  AuthenticatedWebSocket,
+  FabreaderEvent,
+  FabreaderEventType,
+  FabreaderResponse,
+  supportsNTAG424,
+} from '../websocket.types';
 import { GatewayServices } from '../websocket.gateway';
+import { buildSunSetupSteps } from '../sun';
 
 export interface EnrollmentState {
   nextExpectedEvent: FabreaderEventType;
@@ -11,6 +18,10 @@ export interface EnrollmentState {
   data: {
     newKeys?: Record<number, string>;
     verificationToken?: Uint8Array;
+    // The reader identified an NTAG424, it gets SUN messages after the keys were changed
+    sun?: boolean;
+    nfcCardId?: number;
+    sunJobId?: number;
   };
 }
 
@@ -77,15 +88,32 @@ export class EnrollNTAG424State implements ReaderState {
       return this.onAuthenticate(responseData);
     }
 
+    if (responseData.type === FabreaderEventType.RUN_JOB) {
+      return this.onSunSetUp(responseData);
+    }
+
     this.logger.warn(`Unknown response type ${responseData.type} in state ${this.enrollment?.nextExpectedEvent}`);
   }
 
   private async onGetNfcUID(responseData: FabreaderResponse['data']): Promise<void> {
+    // Card checking stays on, the user can tap a supported card instead
+    if (!supportsNTAG424(responseData.payload)) {
+      this.logger.debug(`Cannot enroll a ${responseData.payload.cardFamily} card`);
+      this.socket.sendMessage(
+        new FabreaderEvent(FabreaderEventType.DISPLAY_ERROR, {
+          message: 'Card not supported',
+          duration: 3000,
+        })
+      );
+      return;
+    }
+
     this.socket.sendMessage(new FabreaderEvent(FabreaderEventType.DISABLE_CARD_CHECKING));
 
     const cardUID = responseData.payload.cardUID;
     // eslint-disable-next-line @typescript-eslint/no-non-null-assertion
     this.enrollment!.cardUID = cardUID;
+    this.enrollment.data.sun = responseData.payload.cardFamily === 'NTAG424';
 
     const nfcCard = await this.services.fabreaderService.getNFCCardByUID(cardUID);
 
@@ -169,6 +197,53 @@ export class EnrollNTAG424State implements ReaderState {
 
     this.logger.log(`Created NFC card ${nfcCard.id} for user ${this.userId}`);
 
+    if (this.enrollment.data.sun) {
+      return this.setUpSun(nfcCard.id);
+    }
+
+    return this.onEnrolled();
+  }
+
+  /**
+   * Lets the card mirror SUN messages, so later taps are verified without authenticating. The
+   * card is enrolled either way, without SUN it is authenticated on every tap.
+   */
+  private setUpSun(nfcCardId: number): void {
+    this.enrollment.data.nfcCardId = nfcCardId;
+    this.enrollment.data.sunJobId = Date.now() % 0x100000000;
+    this.enrollment.nextExpectedEvent = FabreaderEventType.RUN_JOB;
+
+    this.socket.sendMessage(
+      new FabreaderEvent(FabreaderEventType.RUN_JOB, {
+        jobId: this.enrollment.data.sunJobId,
+        // The reader rejects the job if the card left the field in the meantime
+        cardUID: this.enrollment.cardUID,
+        steps: buildSunSetupSteps(this.enrollment.data.newKeys[this.KEY_ZERO_MASTER]),
+      })
+    );
+  }
+
+  private async onSunSetUp(responseData: FabreaderResponse['data']): Promise<void> {
+    if (responseData.payload.jobId !== this.enrollment.data.sunJobId) {
+      this.logger.warn(`Unexpected job result ${responseData.payload.jobId}`);
+      return;
+    }
+
+    if (responseData.payload.success) {
+      await this.services.fabreaderService.enableNFCCardSun(this.enrollment.data.nfcCardId);
+      this.logger.log(`NFC card ${this.enrollment.data.nfcCardId} sends SUN messages`);
+    } else {
+      this.logger.warn(
+        `Could not set up SUN messages on NFC card ${this.enrollment.data.nfcCardId}: ${
+          responseData.payload.error ?? 'step failed'
+        }`
+      );
+    }
+
+    return this.onEnrolled();
+  }
+
+  private async onEnrolled(): Promise<void> {
     this.socket.sendMessage(
       new FabreaderEvent(FabreaderEventType.DISPLAY_SUCCESS, {
         message: 'Enrollment successful',
@@ -6,6 +6,7 @@ import { WaitForNFCTapState } from './wait-for-nfc-tap.state';
 import { GatewayServices } from '../websocket.gateway';
 import { AuthenticatedWebSocket, FabreaderEvent, FabreaderEventType, FabreaderResponse } from '../websocket.types';
 import { verifyToken } from '../websocket.utils';
+import { ReaderEncoding } from '../websocket.codec';
 
 export class InitialReaderState implements ReaderState {
   private readonly logger = new Logger(InitialReaderState.name);
@@ -101,13 +102,25 @@ export class InitialReaderState implements ReaderState {
       return this.socket.sendMessage(unauthorizedResponse);
     }
 
+    // Readers list the encodings they understand besides JSON. The response still goes out in
+    // the current encoding, the reader switches once it has seen it.
+    const encoding: ReaderEncoding = data.payload.encodings?.includes('msgpack') ? 'msgpack' : 'json';
+
     const authenticatedResponse = new FabreaderResponse(FabreaderEventType.READER_AUTHENTICATED, {
       name: reader.name,
+      encoding,
     });
     this.socket.sendMessage(authenticatedResponse);
+    this.socket.encoding = encoding;
 
     this.socket.reader = reader;
 
-    return this.onIsAuthenticated();
+    // Readers with an offline mode report the version of their offline set
+    if (typeof data.payload.offlineAuthVersion === 'number') {
+      this.socket.offlineAuth = { version: data.payload.offlineAuthVersion };
+    }
+
+    await this.onIsAuthenticated();
+    await this.services.offlineAuthService.sync(this.socket);
   }
 }
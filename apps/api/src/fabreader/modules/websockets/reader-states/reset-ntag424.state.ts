@@ -1,7 +1,13 @@
 import { Logger } from '@nestjs/common';
 import { ReaderState } from './reader-state.interface';
 import { InitialReaderState } from './initial.state';
-import { AuthenticatedWebSocket, FabreaderEvent, FabreaderEventType, FabreaderResponse } from '../websocket.types';
+import {
+  AuthenticatedWebSocket,
+  FabreaderEvent,
+  FabreaderEventType,
+  FabreaderResponse,
+  supportsNTAG424,
+} from '../websocket.types';
 import { GatewayServices } from '../websocket.gateway';
 import { NFCCard } from '@fabaccess/database-entities';
 
@@ -64,6 +70,12 @@ export class ResetNTAG424State implements ReaderState {
       return;
     }
 
+    // Same UID, but not the enrolled card, e.g. a clone with a writable UID
+    if (!supportsNTAG424(responseData.payload)) {
+      this.logger.warn(`Card ${cardUID} is a ${responseData.payload.cardFamily}, not an NTAG424, ignoring`);
+      return;
+    }
+
     // Only if the card UID matches, disable card checking
     this.socket.sendMessage(new FabreaderEvent(FabreaderEventType.DISABLE_CARD_CHECKING));
 
@@ -1,9 +1,16 @@
 import { Logger } from '@nestjs/common';
 import { GatewayServices } from '../websocket.gateway';
-import { AuthenticatedWebSocket, FabreaderEventType, FabreaderResponse } from '../websocket.types';
+import {
+  AuthenticatedWebSocket,
+  FabreaderEventType,
+  FabreaderResponse,
+  NFCTapPayload,
+  supportsNTAG424,
+} from '../websocket.types';
 import { FabreaderEvent } from '../websocket.types';
 import { ReaderState } from './reader-state.interface';
 import { NFCCard } from '@fabaccess/database-entities';
+import { verifySunMac } from '../sun';
 
 export class WaitForNFCTapState implements ReaderState {
   private readonly logger = new Logger(WaitForNFCTapState.name);
@@ -31,6 +38,7 @@ export class WaitForNFCTapState implements ReaderState {
       return this.socket.sendMessage(
         new FabreaderEvent(FabreaderEventType.ENABLE_CARD_CHECKING, {
           message: `Tap to stop`,
+          sun: true,
         })
       );
     }
@@ -38,6 +46,7 @@ export class WaitForNFCTapState implements ReaderState {
     this.socket.sendMessage(
       new FabreaderEvent(FabreaderEventType.ENABLE_CARD_CHECKING, {
         message: `Tap to start`,
+        sun: true,
       })
     );
   }
@@ -119,7 +128,12 @@ export class WaitForNFCTapState implements ReaderState {
     await this.restart();
   }
 
-  private async onNFCTap(data: FabreaderEvent<{ cardUID: string }>['data']): Promise<void> {
+  private async onNFCTap(data: FabreaderEvent<NFCTapPayload>['data']): Promise<void> {
+    if (!supportsNTAG424(data.payload)) {
+      this.logger.debug(`Card ${data.payload.cardUID} is a ${data.payload.cardFamily}, not an NTAG424`);
+      return this.onInvalidCard();
+    }
+
     this.sendDisableCardChecking('Do not remove card!');
 
     const nfcCard = await this.services.fabreaderService.getNFCCardByUID(data.payload.cardUID);
@@ -131,6 +145,10 @@ export class WaitForNFCTapState implements ReaderState {
 
     this.card = nfcCard;
 
+    if (await this.verifySun(nfcCard, data.payload)) {
+      return this.onCardVerified();
+    }
+
     this.socket.sendMessage(
       new FabreaderEvent(FabreaderEventType.AUTHENTICATE, {
         authenticationKey: nfcCard.keys[0],
@@ -139,7 +157,42 @@ export class WaitForNFCTapState implements ReaderState {
     );
   }
 
-  private async onAuthenticate(data: FabreaderEvent<{ cardUID: string }>['data']): Promise<void> {
+  /**
+   * A SUN message with a valid MAC and a counter the card never sent before proves the card
+   * like an authentication with key 0, without the round trip. Anything else falls back to
+   * authenticating.
+   */
+  private async verifySun(card: NFCCard, payload: NFCTapPayload): Promise<boolean> {
+    if (payload.sunMAC === undefined || payload.sunCounter === undefined || typeof card.sunCounter !== 'number') {
+      return false;
+    }
+
+    if (!verifySunMac(card.keys[0], payload.cardUID, payload.sunCounter, payload.sunMAC)) {
+      this.logger.warn(`Invalid SUN message from card ${payload.cardUID}, authenticating instead`);
+      return false;
+    }
+
+    if (!(await this.services.fabreaderService.acceptNFCCardSunCounter(card.id, payload.sunCounter))) {
+      this.logger.warn(
+        `Replayed SUN counter ${payload.sunCounter} from card ${payload.cardUID}, authenticating instead`
+      );
+      return false;
+    }
+
+    this.logger.debug(`Card ${payload.cardUID} verified by SUN counter ${payload.sunCounter}`);
+    return true;
+  }
+
+  private async onAuthenticate(data: FabreaderEvent<{ authenticationSuccessful: boolean }>['data']): Promise<void> {
+    if (!data.payload.authenticationSuccessful) {
+      this.logger.debug(`Authentication of NFC Card with UID ${this.card?.uid} failed`);
+      return this.onInvalidCard();
+    }
+
+    return this.onCardVerified();
+  }
+
+  private async onCardVerified(): Promise<void> {
     if (!this.card) {
       this.logger.error('No card attached to socket..');
       return;
@@ -148,7 +201,7 @@ export class WaitForNFCTapState implements ReaderState {
     const userOfNFCCard = await this.services.usersService.findOne({ id: this.card.userId });
 
     if (!userOfNFCCard) {
-      this.logger.debug(`User (of NFC Card with UID ${data.payload.cardUID}) with ID ${this.card.userId} not found`);
+      this.logger.debug(`User (of NFC Card with UID ${this.card.uid}) with ID ${this.card.userId} not found`);
       return this.onInvalidCard();
     }
 
@@ -0,0 +1,64 @@
+import { aesCmac, buildSunFileSettings, buildSunNdefFile, buildSunSetupSteps, sunMac, verifySunMac } from './sun';
+
+describe('SUN messages', () => {
+  it('computes AES-CMAC', () => {
+    // RFC 4493 examples 1, 2 and 3
+    const key = Buffer.from('2b7e151628aed2a6abf7158809cf4f3c', 'hex');
+
+    expect(aesCmac(key, Buffer.alloc(0)).toString('hex')).toBe('bb1d6929e95937287fa37d129b756746');
+    expect(aesCmac(key, Buffer.from('6bc1bee22e409f96e93d7e117393172a', 'hex')).toString('hex')).toBe(
+      '070a16b46b4d4144f79bdd9dd04a287c'
+    );
+    expect(
+      aesCmac(
+        key,
+        Buffer.from('6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411', 'hex')
+      ).toString('hex')
+    ).toBe('dfa66747de9ae63030ca32611497c827');
+  });
+
+  it('computes the SDMMAC like the card', () => {
+    // AN12196, SUN message with plain UID and counter mirror
+    const mac = sunMac(Buffer.alloc(16), Buffer.from('04de5f1eacc040', 'hex'), 0x3d);
+
+    expect(mac.toString('hex')).toBe('94eed9ee65337086');
+  });
+
+  it('verifies the MAC the reader sent', () => {
+    const key = '00'.repeat(16);
+
+    expect(verifySunMac(key, '04de5f1eacc040', 0x3d, '94eed9ee65337086')).toBe(true);
+    expect(verifySunMac(key, '04de5f1eacc040', 0x3e, '94eed9ee65337086')).toBe(false);
+    expect(verifySunMac('01'.repeat(16), '04de5f1eacc040', 0x3d, '94eed9ee65337086')).toBe(false);
+    expect(verifySunMac(key, '04de5f1eacc0', 0x3d, '94eed9ee65337086')).toBe(false);
+    expect(verifySunMac(key, '04de5f1eacc040', 0x3d, '94eed9ee6533')).toBe(false);
+  });
+
+  it('points the file settings at the placeholders of the NDEF file', () => {
+    const file = buildSunNdefFile();
+    const settings = buildSunFileSettings();
+    const offset = (index: number) => settings.readUIntLE(index, 3);
+
+    expect(file.readUInt16BE(0)).toBe(file.length - 2);
+    expect(file.subarray(offset(6), offset(6) + 14).toString()).toBe('0'.repeat(14));
+    expect(file.subarray(offset(9) - 3, offset(9)).toString()).toBe('&c=');
+    expect(file.subarray(offset(15) - 3, offset(15)).toString()).toBe('&m=');
+    expect(offset(15) + 16).toBe(file.length);
+    expect(offset(12)).toBe(offset(15));
+    expect(settings.subarray(0, 6).toString('hex')).toBe('4000e0c1ffe0');
+  });
+
+  it('writes the NDEF file in chunks the reader accepts', () => {
+    const key = 'ab'.repeat(16);
+    const steps = buildSunSetupSteps(key);
+    const writes = steps.filter((step) => step.type === 'WRITE_FILE');
+
+    expect(steps[0]).toEqual({ type: 'AUTHENTICATE', keyNumber: 0, authenticationKey: key });
+    expect(steps[steps.length - 1].type).toBe('CHANGE_FILE_SETTINGS');
+    expect(steps.length).toBeLessThanOrEqual(8);
+    expect(writes.map((step) => step.data).join('')).toBe(buildSunNdefFile().toString('hex'));
+    for (const step of writes) {
+      expect((step.data as string).length).toBeLessThanOrEqual(48);
+    }
+  });
+});
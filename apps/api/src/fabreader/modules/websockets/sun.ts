@@ -0,0 +1,166 @@
+import { createCipheriv, timingSafeEqual } from 'crypto';
+
+/**
+ * NTAG424 Secure Unique NFC (SUN) messages, see NXP AN12196. With Secure Dynamic Messaging
+ * (SDM) enabled on the NDEF file, the card mirrors its UID, its read counter and a MAC into
+ * the URI on every read. The MAC is keyed with key 0, so a tap is verified here from a single
+ * plain read on the reader instead of a three pass authentication.
+ */
+
+/** NDEF file of NTAG424 cards. */
+export const SUN_FILE_NUMBER = 2;
+
+/** File bytes per WRITE_FILE job step, NFC_JOB_MAX_DATA in the firmware. */
+const JOB_MAX_DATA = 24;
+
+const UID_LENGTH = 7;
+const COUNTER_DIGITS = 6;
+const MAC_LENGTH = 8;
+
+// Short URI record without URI prefix, the placeholders are replaced by SDM
+const URI_PREFIX = 'fabaccess://sun?u=';
+const URI_TEMPLATE =
+  URI_PREFIX + '0'.repeat(UID_LENGTH * 2) + '&c=' + '0'.repeat(COUNTER_DIGITS) + '&m=' + '0'.repeat(MAC_LENGTH * 2);
+// NLEN, record header, type length, payload length, type "U" and the URI prefix byte
+const NDEF_HEADER_LENGTH = 7;
+
+const UID_OFFSET = NDEF_HEADER_LENGTH + URI_PREFIX.length;
+const COUNTER_OFFSET = UID_OFFSET + UID_LENGTH * 2 + '&c='.length;
+const MAC_OFFSET = COUNTER_OFFSET + COUNTER_DIGITS + '&m='.length;
+
+// SesSDMFileReadMAC derivation label
+const SV2_PREFIX = Buffer.from([0x3c, 0xc3, 0x00, 0x01, 0x00, 0x80]);
+
+/**
+ * Content of the NDEF file the enrollment writes, a single short URI record.
+ */
+export function buildSunNdefFile(): Buffer {
+  const uri = Buffer.from(URI_TEMPLATE, 'ascii');
+  const recordLength = NDEF_HEADER_LENGTH - 2 + uri.length;
+
+  return Buffer.concat([
+    Buffer.from([recordLength >> 8, recordLength & 0xff, 0xd1, 0x01, uri.length + 1, 0x55, 0x00]),
+    uri,
+  ]);
+}
+
+/**
+ * ChangeFileSettings data that enables SDM on the NDEF file. Reading stays free, writing and
+ * changing the settings need key 0. The UID and the counter are mirrored in plain, the MAC
+ * over an empty input is keyed with key 0.
+ */
+export function buildSunFileSettings(): Buffer {
+  const offset = (value: number) => [value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff];
+
+  return Buffer.from([
+    0x40, // FileOption: SDM enabled, plain communication
+    0x00, // AccessRights: ReadWrite key 0, Change key 0
+    0xe0, // AccessRights: Read free, Write key 0
+    0xc1, // SDMOptions: UID mirror, SDMReadCtr mirror, ASCII encoding
+    0xff, // SDMAccessRights: RFU, no SDMReadCtr retrieval
+    0xe0, // SDMAccessRights: plain meta data, file read MAC keyed with key 0
+    ...offset(UID_OFFSET),
+    ...offset(COUNTER_OFFSET),
+    ...offset(MAC_OFFSET), // SDMMACInputOffset, the MAC covers no file data
+    ...offset(MAC_OFFSET),
+  ]);
+}
+
+/**
+ * RUN_JOB steps that turn on SUN messages, for a card whose key 0 is key. Writes the NDEF file
+ * and then enables SDM on it, which from then on needs key 0 to change.
+ */
+export function buildSunSetupSteps(key: string): Record<string, unknown>[] {
+  const file = buildSunNdefFile();
+  const writes: Record<string, unknown>[] = [];
+  for (let offset = 0; offset < file.length; offset += JOB_MAX_DATA) {
+    writes.push({
+      type: 'WRITE_FILE',
+      fileNumber: SUN_FILE_NUMBER,
+      offset,
+      data: file.subarray(offset, offset + JOB_MAX_DATA).toString('hex'),
+      commMode: 'PLAIN',
+    });
+  }
+
+  return [
+    { type: 'AUTHENTICATE', keyNumber: 0, authenticationKey: key },
+    ...writes,
+    { type: 'CHANGE_FILE_SETTINGS', fileNumber: SUN_FILE_NUMBER, data: buildSunFileSettings().toString('hex') },
+  ];
+}
+
+/**
+ * AES-128 CMAC (RFC 4493).
+ */
+export function aesCmac(key: Buffer, message: Buffer): Buffer {
+  const encrypt = (block: Buffer) => {
+    const cipher = createCipheriv('aes-128-ecb', key, null);
+    cipher.setAutoPadding(false);
+    return Buffer.concat([cipher.update(block), cipher.final()]);
+  };
+  const subkey = (value: Buffer) => {
+    const shifted = Buffer.alloc(16);
+    for (let i = 0; i < 16; i++) {
+      shifted[i] = ((value[i] << 1) | (i < 15 ? value[i + 1] >> 7 : 0)) & 0xff;
+    }
+    if (value[0] & 0x80) {
+      shifted[15] ^= 0x87;
+    }
+    return shifted;
+  };
+
+  const k1 = subkey(encrypt(Buffer.alloc(16)));
+  const k2 = subkey(k1);
+
+  const blocks = Math.max(1, Math.ceil(message.length / 16));
+  const complete = message.length > 0 && message.length % 16 === 0;
+  const last = Buffer.alloc(16);
+  message.copy(last, 0, (blocks - 1) * 16);
+  if (!complete) {
+    last[message.length - (blocks - 1) * 16] = 0x80;
+  }
+
+  let state = Buffer.alloc(16);
+  for (let block = 0; block < blocks; block++) {
+    const input = block < blocks - 1 ? message.subarray(block * 16, block * 16 + 16) : last;
+    const subkeyOfBlock = block < blocks - 1 ? undefined : complete ? k1 : k2;
+    for (let i = 0; i < 16; i++) {
+      state[i] ^= input[i] ^ (subkeyOfBlock ? subkeyOfBlock[i] : 0);
+    }
+    state = encrypt(state);
+  }
+  return state;
+}
+
+/**
+ * SDMMAC of a SUN message, the odd bytes of the CMAC over the (empty) MAC input with the
+ * session key derived from key 0, the UID and the counter.
+ */
+export function sunMac(key: Buffer, uid: Buffer, counter: number): Buffer {
+  const counterLsbFirst = Buffer.from([counter & 0xff, (counter >> 8) & 0xff, (counter >> 16) & 0xff]);
+  const sessionKey = aesCmac(key, Buffer.concat([SV2_PREFIX, uid, counterLsbFirst]));
+  const mac = aesCmac(sessionKey, Buffer.alloc(0));
+
+  return Buffer.from([1, 3, 5, 7, 9, 11, 13, 15].map((i) => mac[i]));
+}
+
+/**
+ * True if the MAC of a SUN message the reader sent with NFC_TAP is the one of the card with
+ * this key 0. Hex strings as in the payload.
+ */
+export function verifySunMac(keyHex: string, uidHex: string, counter: number, macHex: string): boolean {
+  const uid = Buffer.from(uidHex, 'hex');
+  const mac = Buffer.from(macHex, 'hex');
+  if (
+    uid.length !== UID_LENGTH ||
+    mac.length !== MAC_LENGTH ||
+    !Number.isInteger(counter) ||
+    counter < 0 ||
+    counter > 0xffffff
+  ) {
+    return false;
+  }
+
+  return timingSafeEqual(sunMac(Buffer.from(keyHex, 'hex'), uid, counter), mac);
+}
@@ -1,7 +1,11 @@
 import { Inject, Injectable, Logger } from '@nestjs/common';
 import { OnEvent } from '@nestjs/event-emitter';
 import { FabreaderGateway } from './websocket.gateway';
-import { ReaderUpdatedEvent } from '../../events';
+import { NFCCardsChangedEvent, ReaderUpdatedEvent } from '../../events';
+import { OfflineAuthService } from './offline-auth.service';
+import { WebsocketService } from './websocket.service';
+import { ResourcePermissionsChangedEvent } from '../../../resources/events/resource-permissions.events';
+import { UsersChangedEvent } from '../../../users-and-auth/users/events/users.events';
 
 @Injectable()
 export class WebSocketEventService {
@@ -10,9 +14,43 @@ export class WebSocketEventService {
   @Inject(FabreaderGateway)
   private readonly fabreaderGateway: FabreaderGateway;
 
+  @Inject(OfflineAuthService)
+  private readonly offlineAuthService: OfflineAuthService;
+
+  @Inject(WebsocketService)
+  private readonly websocketService: WebsocketService;
+
   @OnEvent('reader.updated')
   public async onReaderUpdated(event: ReaderUpdatedEvent) {
     this.logger.debug('Got reader updated event', event);
+
+    // The sockets keep the reader they authenticated with, its resources may have changed
+    const sockets = Array.from(this.websocketService.sockets.values()).filter(
+      (socket) => socket.reader?.id === event.reader.id
+    );
+    for (const socket of sockets) {
+      socket.reader = event.reader;
+    }
+
     await this.fabreaderGateway.restartReader(event.reader.id);
+    await this.offlineAuthService.syncAll(sockets);
+  }
+
+  @OnEvent('nfc-cards.changed')
+  public async onNFCCardsChanged(event: NFCCardsChangedEvent) {
+    this.logger.debug('Got NFC cards changed event', event);
+    await this.offlineAuthService.syncAll(this.websocketService.sockets.values());
+  }
+
+  @OnEvent('resource-permissions.changed')
+  public async onResourcePermissionsChanged(event: ResourcePermissionsChangedEvent) {
+    this.logger.debug('Got resource permissions changed event', event);
+    await this.offlineAuthService.syncAll(this.websocketService.sockets.values());
+  }
+
+  @OnEvent('users.changed')
+  public async onUsersChanged(event: UsersChangedEvent) {
+    this.logger.debug('Got users changed event', event);
+    await this.offlineAuthService.syncAll(this.websocketService.sockets.values());
   }
 }
@@ -0,0 +1,108 @@
+import { decodeMsgPack, encodeMsgPack, encodeReaderMessage, parseReaderMessage } from './websocket.codec';
+import { FabreaderEvent, FabreaderEventType, FabreaderResponse } from './websocket.types';
+
+describe('websocket codec', () => {
+  describe('MessagePack', () => {
+    it.each([
+      null,
+      true,
+      false,
+      0,
+      127,
+      128,
+      65535,
+      4294967295,
+      -1,
+      -32,
+      -33,
+      -129,
+      -40000,
+      1.5,
+      '',
+      'NFC_TAP',
+      'x'.repeat(40),
+      'x'.repeat(300),
+      [],
+      [1, 'two', [3]],
+      Array.from({ length: 20 }, (_, i) => i),
+      { a: 1, nested: { b: [true, null] } },
+    ])('round trips %p', (value) => {
+      expect(decodeMsgPack(encodeMsgPack(value))).toEqual(value);
+    });
+
+    it('round trips binary data', () => {
+      const bytes = Buffer.from([0x00, 0x01, 0xff]);
+      expect(decodeMsgPack(encodeMsgPack(bytes))).toEqual(bytes);
+    });
+
+    it('leaves out undefined object values', () => {
+      expect(decodeMsgPack(encodeMsgPack({ a: 1, b: undefined }))).toEqual({ a: 1 });
+    });
+
+    it('encodes small values compactly', () => {
+      expect(encodeMsgPack({ key: '1' })).toEqual(Buffer.from([0x81, 0xa3, 0x6b, 0x65, 0x79, 0xa1, 0x31]));
+    });
+
+    it('rejects truncated input', () => {
+      expect(() => decodeMsgPack(Buffer.from([0x92, 0x01]))).toThrow();
+    });
+  });
+
+  describe('parseReaderMessage', () => {
+    it('parses JSON text frames', () => {
+      expect(parseReaderMessage('{"event":"HEARTBEAT"}')).toEqual({ event: 'HEARTBEAT' });
+    });
+
+    it('parses JSON sent as a binary frame', () => {
+      expect(parseReaderMessage(Buffer.from('{"event":"HEARTBEAT"}'))).toEqual({ event: 'HEARTBEAT' });
+    });
+
+    it('turns binary fields of MessagePack frames into hex strings', () => {
+      const frame = encodeMsgPack({
+        event: 'EVENT',
+        data: { type: 'NFC_TAP', payload: { cardUID: Buffer.from([0x04, 0x5a, 0x3b]) } },
+      });
+
+      expect(parseReaderMessage(frame)).toEqual({
+        event: 'EVENT',
+        data: { type: 'NFC_TAP', payload: { cardUID: '045a3b' } },
+      });
+    });
+  });
+
+  describe('encodeReaderMessage', () => {
+    it('sends JSON by default', () => {
+      const message = new FabreaderEvent(FabreaderEventType.HIDE_TEXT, {});
+      expect(encodeReaderMessage(message)).toBe(JSON.stringify(message));
+    });
+
+    it('sends keys as binary when using MessagePack', () => {
+      const message = new FabreaderEvent(FabreaderEventType.CHANGE_KEYS, {
+        authenticationKey: '000102030405060708090a0b0c0d0e0f',
+        keys: { 1: 'ffffffffffffffffffffffffffffffff' },
+      });
+
+      const decoded = decodeMsgPack(encodeReaderMessage(message, 'msgpack') as Buffer) as {
+        data: { payload: { authenticationKey: Buffer; keys: Record<string, Buffer> } };
+      };
+
+      expect(decoded.data.payload.authenticationKey).toEqual(Buffer.from('000102030405060708090a0b0c0d0e0f', 'hex'));
+      expect(decoded.data.payload.keys['1']).toEqual(Buffer.alloc(16, 0xff));
+    });
+
+    it('keeps text fields as strings', () => {
+      const message = new FabreaderResponse(FabreaderEventType.READER_AUTHENTICATED, { name: 'cafe', encoding: 'msgpack' });
+      const decoded = decodeMsgPack(encodeReaderMessage(message, 'msgpack') as Buffer);
+
+      expect(decoded).toEqual({ event: 'RESPONSE', data: { type: 'READER_AUTHENTICATED', payload: { name: 'cafe', encoding: 'msgpack' } } });
+    });
+
+    it('round trips through parseReaderMessage', () => {
+      const message = new FabreaderEvent(FabreaderEventType.CHANGE_KEYS, {
+        authenticationKey: '000102030405060708090a0b0c0d0e0f',
+      });
+
+      expect(parseReaderMessage(encodeReaderMessage(message, 'msgpack') as Buffer)).toEqual(JSON.parse(JSON.stringify(message)));
+    });
+  });
+});
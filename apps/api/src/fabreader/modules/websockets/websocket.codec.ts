@@ -0,0 +1,283 @@
+import { FabreaderMessage } from './websocket.types';
+
+/**
+ * Wire format of a reader connection. Readers start with JSON and may offer MessagePack
+ * in their AUTHENTICATE event, see InitialReaderState.
+ */
+export type ReaderEncoding = 'json' | 'msgpack';
+
+// Hex string fields that travel as MessagePack bin, and objects whose values all do
+const BINARY_FIELDS = new Set(['authenticationKey', 'cardUID', 'data', 'added', 'removed']);
+const BINARY_MAPS = new Set(['keys', 'oldKeys']);
+const HEX_PATTERN = /^(?:[0-9a-fA-F]{2})+$/;
+
+/**
+ * Parses a frame received from a reader, used as the WsAdapter message parser. JSON frames
+ * are objects and start with '{', anything else is MessagePack. Binary fields are turned
+ * back into lowercase hex strings so reader states see the same payloads for both formats.
+ */
+export function parseReaderMessage(data: string | Buffer | ArrayBuffer | Buffer[]): { event: string; data: unknown } {
+  if (typeof data === 'string') {
+    return JSON.parse(data);
+  }
+
+  const buffer = Array.isArray(data) ? Buffer.concat(data) : Buffer.isBuffer(data) ? data : Buffer.from(data);
+  if (buffer[0] === 0x7b) {
+    return JSON.parse(buffer.toString('utf8'));
+  }
+
+  return binaryToHex(decodeMsgPack(buffer)) as { event: string; data: unknown };
+}
+
+export function encodeReaderMessage(message: FabreaderMessage, encoding: ReaderEncoding = 'json'): string | Buffer {
+  if (encoding === 'msgpack') {
+    return encodeMsgPack(hexToBinary(message));
+  }
+  return JSON.stringify(message);
+}
+
+function binaryToHex(value: unknown): unknown {
+  if (value instanceof Uint8Array) {
+    return Buffer.from(value).toString('hex');
+  }
+  if (Array.isArray(value)) {
+    return value.map(binaryToHex);
+  }
+  if (value !== null && typeof value === 'object') {
+    return Object.fromEntries(Object.entries(value).map(([key, entry]) => [key, binaryToHex(entry)]));
+  }
+  return value;
+}
+
+function hexToBinary(value: unknown, binary = false): unknown {
+  if (binary && typeof value === 'string' && HEX_PATTERN.test(value)) {
+    return Buffer.from(value, 'hex');
+  }
+  if (Array.isArray(value)) {
+    return value.map((entry) => hexToBinary(entry));
+  }
+  if (value !== null && typeof value === 'object' && !(value instanceof Uint8Array)) {
+    return Object.fromEntries(
+      Object.entries(value).map(([key, entry]) => {
+        if (BINARY_MAPS.has(key) && entry !== null && typeof entry === 'object') {
+          return [key, Object.fromEntries(Object.entries(entry).map(([k, v]) => [k, hexToBinary(v, true)]))];
+        }
+        return [key, hexToBinary(entry, BINARY_FIELDS.has(key))];
+      })
+    );
+  }
+  return value;
+}
+
+/**
+ * Minimal MessagePack encoder covering what ArduinoJson reads: nil, bool, int, float, str,
+ * bin, array and map. Like JSON.stringify, undefined object values are left out.
+ */
+export function encodeMsgPack(value: unknown): Buffer {
+  const parts: Buffer[] = [];
+  writeValue(value, parts);
+  return Buffer.concat(parts);
+}
+
+function header(type: number, length: number, bytes: number): Buffer {
+  const buffer = Buffer.alloc(1 + bytes);
+  buffer[0] = type;
+  buffer.writeUIntBE(length, 1, bytes);
+  return buffer;
+}
+
+function writeLength(parts: Buffer[], length: number, fix: number | null, fixMax: number, types: [number, number, number]) {
+  if (fix !== null && length <= fixMax) {
+    parts.push(Buffer.from([fix | length]));
+  } else if (types[0] !== 0 && length <= 0xff) {
+    parts.push(header(types[0], length, 1));
+  } else if (length <= 0xffff) {
+    parts.push(header(types[1], length, 2));
+  } else {
+    parts.push(header(types[2], length, 4));
+  }
+}
+
+function writeNumber(value: number, parts: Buffer[]) {
+  if (!Number.isInteger(value) || value > 0xffffffff || value < -0x80000000) {
+    const buffer = Buffer.alloc(9);
+    buffer[0] = 0xcb;
+    buffer.writeDoubleBE(value, 1);
+    parts.push(buffer);
+  } else if (value >= 0) {
+    if (value < 0x80) {
+      parts.push(Buffer.from([value]));
+    } else if (value <= 0xff) {
+      parts.push(header(0xcc, value, 1));
+    } else if (value <= 0xffff) {
+      parts.push(header(0xcd, value, 2));
+    } else {
+      parts.push(header(0xce, value, 4));
+    }
+  } else if (value >= -32) {
+    parts.push(Buffer.from([value & 0xff]));
+  } else {
+    const bytes = value >= -0x80 ? 1 : value >= -0x8000 ? 2 : 4;
+    const buffer = Buffer.alloc(1 + bytes);
+    buffer[0] = bytes === 1 ? 0xd0 : bytes === 2 ? 0xd1 : 0xd2;
+    buffer.writeIntBE(value, 1, bytes);
+    parts.push(buffer);
+  }
+}
+
+function writeValue(value: unknown, parts: Buffer[]) {
+  if (
+    value !== null &&
+    typeof value === 'object' &&
+    !(value instanceof Uint8Array) &&
+    typeof (value as { toJSON?: unknown }).toJSON === 'function'
+  ) {
+    value = (value as { toJSON: () => unknown }).toJSON();
+  }
+
+  if (value === null || value === undefined) {
+    parts.push(Buffer.from([0xc0]));
+  } else if (typeof value === 'boolean') {
+    parts.push(Buffer.from([value ? 0xc3 : 0xc2]));
+  } else if (typeof value === 'number') {
+    writeNumber(value, parts);
+  } else if (typeof value === 'string') {
+    const bytes = Buffer.from(value, 'utf8');
+    writeLength(parts, bytes.length, 0xa0, 31, [0xd9, 0xda, 0xdb]);
+    parts.push(bytes);
+  } else if (value instanceof Uint8Array) {
+    writeLength(parts, value.length, null, 0, [0xc4, 0xc5, 0xc6]);
+    parts.push(Buffer.from(value));
+  } else if (Array.isArray(value)) {
+    writeLength(parts, value.length, 0x90, 15, [0, 0xdc, 0xdd]);
+    value.forEach((entry) => writeValue(entry, parts));
+  } else if (typeof value === 'object') {
+    const entries = Object.entries(value).filter(([, entry]) => entry !== undefined);
+    writeLength(parts, entries.length, 0x80, 15, [0, 0xde, 0xdf]);
+    for (const [key, entry] of entries) {
+      writeValue(key, parts);
+      writeValue(entry, parts);
+    }
+  } else {
+    throw new Error(`Cannot encode ${typeof value} as MessagePack`);
+  }
+}
+
+/**
+ * Decodes a single MessagePack value. Extension types and trailing bytes are rejected.
+ */
+export function decodeMsgPack(buffer: Buffer): unknown {
+  const cursor = { offset: 0 };
+  const value = readValue(buffer, cursor);
+  if (cursor.offset !== buffer.length) {
+    throw new Error('Trailing bytes after MessagePack value');
+  }
+  return value;
+}
+
+function take(buffer: Buffer, cursor: { offset: number }, length: number): number {
+  const start = cursor.offset;
+  if (start + length > buffer.length) {
+    throw new Error('Truncated MessagePack value');
+  }
+  cursor.offset += length;
+  return start;
+}
+
+function readUInt(buffer: Buffer, cursor: { offset: number }, bytes: number): number {
+  const start = take(buffer, cursor, bytes);
+  return bytes === 8 ? Number(buffer.readBigUInt64BE(start)) : buffer.readUIntBE(start, bytes);
+}
+
+function readInt(buffer: Buffer, cursor: { offset: number }, bytes: number): number {
+  const start = take(buffer, cursor, bytes);
+  return bytes === 8 ? Number(buffer.readBigInt64BE(start)) : buffer.readIntBE(start, bytes);
+}
+
+function readString(buffer: Buffer, cursor: { offset: number }, length: number): string {
+  const start = take(buffer, cursor, length);
+  return buffer.toString('utf8', start, start + length);
+}
+
+function readBinary(buffer: Buffer, cursor: { offset: number }, length: number): Buffer {
+  const start = take(buffer, cursor, length);
+  return Buffer.from(buffer.subarray(start, start + length));
+}
+
+function readArray(buffer: Buffer, cursor: { offset: number }, length: number): unknown[] {
+  const array: unknown[] = [];
+  for (let i = 0; i < length; i++) {
+    array.push(readValue(buffer, cursor));
+  }
+  return array;
+}
+
+function readMap(buffer: Buffer, cursor: { offset: number }, length: number): Record<string, unknown> {
+  const map: Record<string, unknown> = {};
+  for (let i = 0; i < length; i++) {
+    const key = readValue(buffer, cursor);
+    map[String(key)] = readValue(buffer, cursor);
+  }
+  return map;
+}
+
+function readValue(buffer: Buffer, cursor: { offset: number }): unknown {
+  const type = buffer[take(buffer, cursor, 1)];
+
+  if (type < 0x80) return type;
+  if (type >= 0xe0) return type - 0x100;
+  if ((type & 0xf0) === 0x80) return readMap(buffer, cursor, type & 0x0f);
+  if ((type & 0xf0) === 0x90) return readArray(buffer, cursor, type & 0x0f);
+  if ((type & 0xe0) === 0xa0) return readString(buffer, cursor, type & 0x1f);
+
+  switch (type) {
+    case 0xc0:
+      return null;
+    case 0xc2:
+      return false;
+    case 0xc3:
+      return true;
+    case 0xc4:
+      return readBinary(buffer, cursor, readUInt(buffer, cursor, 1));
+    case 0xc5:
+      return readBinary(buffer, cursor, readUInt(buffer, cursor, 2));
+    case 0xc6:
+      return readBinary(buffer, cursor, readUInt(buffer, cursor, 4));
+    case 0xca:
+      return buffer.readFloatBE(take(buffer, cursor, 4));
+    case 0xcb:
+      return buffer.readDoubleBE(take(buffer, cursor, 8));
+    case 0xcc:
+      return readUInt(buffer, cursor, 1);
+    case 0xcd:
+      return readUInt(buffer, cursor, 2);
+    case 0xce:
+      return readUInt(buffer, cursor, 4);
+    case 0xcf:
+      return readUInt(buffer, cursor, 8);
+    case 0xd0:
+      return readInt(buffer, cursor, 1);
+    case 0xd1:
+      return readInt(buffer, cursor, 2);
+    case 0xd2:
+      return readInt(buffer, cursor, 4);
+    case 0xd3:
+      return readInt(buffer, cursor, 8);
+    case 0xd9:
+      return readString(buffer, cursor, readUInt(buffer, cursor, 1));
+    case 0xda:
+      return readString(buffer, cursor, readUInt(buffer, cursor, 2));
+    case 0xdb:
+      return readString(buffer, cursor, readUInt(buffer, cursor, 4));
+    case 0xdc:
+      return readArray(buffer, cursor, readUInt(buffer, cursor, 2));
+    case 0xdd:
+      return readArray(buffer, cursor, readUInt(buffer, cursor, 4));
+    case 0xde:
+      return readMap(buffer, cursor, readUInt(buffer, cursor, 2));
+    case 0xdf:
+      return readMap(buffer, cursor, readUInt(buffer, cursor, 4));
+    default:
+      throw new Error(`Unsupported MessagePack type 0x${type.toString(16)}`);
+  }
+}
@@ -12,7 +12,15 @@ import { Inject, Logger } from '@nestjs/common';
 import { WebsocketService } from './websocket.service';
 import { InitialReaderState } from './reader-states/initial.state';
 import { EnrollNTAG424State } from './reader-states/enroll-ntag424.state';
-import { AuthenticatedWebSocket, FabreaderEvent, FabreaderMessage } from './websocket.types';
+import {
+  AuthenticatedWebSocket,
+  FabreaderEvent,
+  FabreaderEventType,
+  FabreaderMessage,
+  FabreaderResponse,
+  JournalReplayPayload,
+} from './websocket.types';
+import { encodeReaderMessage } from './websocket.codec';
 import { FabreaderService } from '../../fabreader.service';
 import { nanoid } from 'nanoid';
 import { ResetNTAG424State } from './reader-states/reset-ntag424.state';
@@ -20,6 +28,7 @@ import { ReaderState } from './reader-states/reader-state.interface';
 import { UsersService } from '../../../users-and-auth/users/users.service';
 import { ResourcesService } from '../../../resources/resources.service';
 import { ResourceUsageService } from '../../../resources/usage/resourceUsage.service';
+import { OfflineAuthService } from './offline-auth.service';
 
 export interface GatewayServices {
   websocketService: WebsocketService;
@@ -27,6 +36,7 @@ export interface GatewayServices {
   resourcesService: ResourcesService;
   resourceUsageService: ResourceUsageService;
   usersService: UsersService;
+  offlineAuthService: OfflineAuthService;
 }
 
 @WebSocketGateway({ path: '/api/fabreader/websocket' })
@@ -53,6 +63,9 @@ export class FabreaderGateway implements OnGatewayConnection, OnGatewayDisconnec
   @Inject(ResourceUsageService)
   private resourceUsageService: ResourceUsageService;
 
+  @Inject(OfflineAuthService)
+  private offlineAuthService: OfflineAuthService;
+
   public async handleConnection(client: AuthenticatedWebSocket) {
     this.logger.log('Client connected via WebSocket');
 
@@ -68,7 +81,7 @@ export class FabreaderGateway implements OnGatewayConnection, OnGatewayDisconnec
 
     client.sendMessage = (message: FabreaderMessage) => {
       this.logger.debug(`Sending ${message.event} of type ${message.data.type}`, message.data.payload);
-      (client as unknown as WebSocket).send(JSON.stringify(message));
+      (client as unknown as WebSocket).send(encodeReaderMessage(message, client.encoding));
     };
 
     client.transitionToState(
@@ -78,6 +91,7 @@ export class FabreaderGateway implements OnGatewayConnection, OnGatewayDisconnec
         usersService: this.usersService,
         resourceUsageService: this.resourceUsageService,
         resourcesService: this.resourcesService,
+        offlineAuthService: this.offlineAuthService,
       })
     );
 
@@ -139,11 +153,42 @@ export class FabreaderGateway implements OnGatewayConnection, OnGatewayDisconnec
 
     await this.clientWasActive(client);
 
+    if (eventData.type === FabreaderEventType.JOURNAL_REPLAY) {
+      this.onJournalReplay(client, eventData);
+      return undefined;
+    }
+
+    // No reader state acts on removals yet, keep them from being logged as unexpected
+    if (eventData.type === FabreaderEventType.CARD_REMOVED) {
+      return undefined;
+    }
+
     await client.state.onEvent(eventData);
 
     return undefined;
   }
 
+  /**
+   * Offline events are only recorded and acknowledged. They never reach the reader state,
+   * acting on a tap from minutes ago could start a machine for someone who already left.
+   */
+  private onJournalReplay(client: AuthenticatedWebSocket, eventData: FabreaderEvent<JournalReplayPayload>['data']) {
+    if (!client.reader) {
+      this.logger.warn(`Client ${client.id} replayed its journal before authenticating, ignoring it.`);
+      return;
+    }
+
+    let acknowledged = 0;
+    for (const event of eventData.payload?.events ?? []) {
+      const when = event.age === undefined ? 'before it restarted' : `${Math.round(event.age / 1000)}s ago`;
+      const decision = event.offlineDecision ? ` and ${event.offlineDecision} it` : '';
+      this.logger.log(`Reader ${client.reader.id} recorded ${event.type} #${event.sequence} while offline${decision}, ${when}.`);
+      acknowledged = Math.max(acknowledged, event.sequence);
+    }
+
+    client.sendMessage(FabreaderResponse.fromEventData(eventData, { acknowledged }));
+  }
+
   @SubscribeMessage('RESPONSE')
   public async onResponse(
     @MessageBody() responseData: FabreaderEvent['data'],
@@ -159,6 +204,12 @@ export class FabreaderGateway implements OnGatewayConnection, OnGatewayDisconnec
 
     await this.clientWasActive(client);
 
+    // Offline set updates run next to whatever state the reader is in
+    if (responseData.type === FabreaderEventType.OFFLINE_AUTH_UPDATE) {
+      await this.offlineAuthService.onUpdateResponse(client, responseData.payload);
+      return undefined;
+    }
+
     await client.state.onResponse(responseData);
 
     return undefined;
@@ -193,6 +244,7 @@ export class FabreaderGateway implements OnGatewayConnection, OnGatewayDisconnec
         usersService: this.usersService,
         resourceUsageService: this.resourceUsageService,
         resourcesService: this.resourcesService,
+        offlineAuthService: this.offlineAuthService,
       },
       data.userId
     );
@@ -235,6 +287,7 @@ export class FabreaderGateway implements OnGatewayConnection, OnGatewayDisconnec
         usersService: this.usersService,
         resourceUsageService: this.resourceUsageService,
         resourcesService: this.resourcesService,
+        offlineAuthService: this.offlineAuthService,
       },
       nfcCard.id
     );
@@ -257,6 +310,7 @@ export class FabreaderGateway implements OnGatewayConnection, OnGatewayDisconnec
           usersService: this.usersService,
           resourceUsageService: this.resourceUsageService,
           resourcesService: this.resourcesService,
+          offlineAuthService: this.offlineAuthService,
         });
 
         await socket.transitionToState(nextState);
@@ -1,5 +1,6 @@
 import { FabReader } from '@fabaccess/database-entities';
 import { ReaderState } from './reader-states/reader-state.interface';
+import type { ReaderEncoding } from './websocket.codec';
 
 interface FabreaderMessageBaseData<TPayload = unknown> {
   auth?: {
@@ -18,12 +19,69 @@ export enum FabreaderEventType {
   HIDE_TEXT = 'HIDE_TEXT',
   KEY_PRESSED = 'KEY_PRESSED',
   NFC_TAP = 'NFC_TAP',
+  CARD_REMOVED = 'CARD_REMOVED',
   CHANGE_KEYS = 'CHANGE_KEYS',
   ENABLE_CARD_CHECKING = 'ENABLE_CARD_CHECKING',
   DISABLE_CARD_CHECKING = 'DISABLE_CARD_CHECKING',
   DISPLAY_SUCCESS = 'DISPLAY_SUCCESS',
   DISPLAY_ERROR = 'DISPLAY_ERROR',
   REAUTHENTICATE = 'REAUTHENTICATE',
+  RUN_JOB = 'RUN_JOB',
+  JOURNAL_REPLAY = 'JOURNAL_REPLAY',
+  OFFLINE_AUTH_UPDATE = 'OFFLINE_AUTH_UPDATE',
+}
+
+/**
+ * Card family a reader classified from the ATQA, SAK and ATS of a tapped card.
+ */
+export type NFCCardFamily =
+  | 'UNKNOWN'
+  | 'MIFARE_CLASSIC'
+  | 'MIFARE_ULTRALIGHT'
+  | 'ISO_DEP'
+  | 'NTAG424'
+  | 'FELICA'
+  | 'ISO14443B'
+  | 'JEWEL';
+
+/**
+ * Readers from before card classification only send the UID. atqa and sak are only set for
+ * ISO14443A cards, ats (hex, starting with its length byte) only for ISO14443-4A cards.
+ * sunCounter and sunMAC are the SUN message of the card if card checking was enabled with
+ * sun and the reader found a fresh one, see sun.ts.
+ */
+export interface NFCTapPayload {
+  cardUID: string;
+  cardFamily?: NFCCardFamily;
+  atqa?: number;
+  sak?: number;
+  ats?: string;
+  sunCounter?: number;
+  sunMAC?: string;
+}
+
+const NTAG424_CAPABLE_FAMILIES: NFCCardFamily[] = ['UNKNOWN', 'ISO_DEP', 'NTAG424'];
+
+/**
+ * False if the tapped card can't be an NTAG424, authenticating against it would only fail.
+ */
+export function supportsNTAG424(payload: NFCTapPayload): boolean {
+  return !payload.cardFamily || NTAG424_CAPABLE_FAMILIES.includes(payload.cardFamily);
+}
+
+/**
+ * Taps and key presses a reader journaled while it was offline. age is in milliseconds and
+ * missing for events from before the reader restarted.
+ */
+export interface JournalReplayPayload {
+  events: {
+    sequence: number;
+    type: FabreaderEventType;
+    age?: number;
+    cardUID?: string;
+    key?: string;
+    offlineDecision?: 'granted' | 'denied';
+  }[];
 }
 
 // eslint-disable-next-line @typescript-eslint/no-explicit-any
@@ -72,6 +130,12 @@ export interface AuthenticatedWebSocket extends Omit<WebSocket, 'send'> {
   disconnectTimeout?: NodeJS.Timeout;
   reader?: FabReader;
   state?: ReaderState;
+  encoding?: ReaderEncoding;
+  // Offline set the reader has, see OfflineAuthService. Unset for readers without offline mode.
+  offlineAuth?: {
+    version: number;
+    pending?: { version: number; full: boolean };
+  };
   transitionToState: (state: ReaderState) => Promise<void>;
   sendMessage: (message: FabreaderMessage) => void;
 }
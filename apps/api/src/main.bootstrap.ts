@@ -16,6 +16,7 @@ import { existsSync } from 'fs';
 import { createCA, createCert } from 'mkcert';
 import { join } from 'path';
 import { StorageConfigType } from './config/storage.config';
+import { parseReaderMessage } from './fabreader/modules/websockets/websocket.codec';
 
 async function generateSelfSignedCertificates(storageDir: string, domain: string) {
   const ca = await createCA({
@@ -138,7 +139,7 @@ export async function bootstrap() {
   const globalPrefix = appConfig.GLOBAL_PREFIX;
   app.setGlobalPrefix(globalPrefix);
 
-  app.useWebSocketAdapter(new WsAdapter(app));
+  app.useWebSocketAdapter(new WsAdapter(app, { messageParser: parseReaderMessage }));
 
   app.use(
     session({
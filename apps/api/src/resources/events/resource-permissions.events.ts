@@ -0,0 +1,5 @@
+/**
+ * Emitted when it changed who may control a resource: introductions, introducers or the
+ * resources of a group.
+ */
+export class ResourcePermissionsChangedEvent {}
@@ -1,13 +1,16 @@
 import { InjectRepository } from '@nestjs/typeorm';
 import { Injectable } from '@nestjs/common';
+import { EventEmitter2 } from '@nestjs/event-emitter';
 import { ResourceIntroducer } from '@fabaccess/database-entities';
 import { Repository } from 'typeorm';
+import { ResourcePermissionsChangedEvent } from '../../events/resource-permissions.events';
 
 @Injectable()
 export class ResourceGroupsIntroducersService {
   constructor(
     @InjectRepository(ResourceIntroducer)
-    private readonly resourceIntroducerRepository: Repository<ResourceIntroducer>
+    private readonly resourceIntroducerRepository: Repository<ResourceIntroducer>,
+    private readonly eventEmitter: EventEmitter2
   ) {}
 
   public async getMany(groupId: number): Promise<ResourceIntroducer[]> {
@@ -37,7 +40,9 @@ export class ResourceGroupsIntroducersService {
       user: { id: userId },
     });
 
-    return await this.resourceIntroducerRepository.save(introducer, { reload: true });
+    const savedIntroducer = await this.resourceIntroducerRepository.save(introducer, { reload: true });
+    this.eventEmitter.emit('resource-permissions.changed', new ResourcePermissionsChangedEvent());
+    return savedIntroducer;
   }
 
   public async revoke(groupId: number, userId: number): Promise<ResourceIntroducer> {
@@ -47,7 +52,9 @@ export class ResourceGroupsIntroducersService {
       return;
     }
 
-    return await this.resourceIntroducerRepository.remove(introducer);
+    const removedIntroducer = await this.resourceIntroducerRepository.remove(introducer);
+    this.eventEmitter.emit('resource-permissions.changed', new ResourcePermissionsChangedEvent());
+    return removedIntroducer;
   }
 
   public async getByResourceGroupIdAndUserId(groupId: number, userId: number): Promise<ResourceIntroducer | null> {
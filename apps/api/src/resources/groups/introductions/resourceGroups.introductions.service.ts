@@ -1,6 +1,7 @@
 import { InjectRepository } from '@nestjs/typeorm';
 
 import { Injectable } from '@nestjs/common';
+import { EventEmitter2 } from '@nestjs/event-emitter';
 import {
   IntroductionHistoryAction,
   ResourceGroup,
@@ -9,6 +10,7 @@ import {
 } from '@fabaccess/database-entities';
 import { Repository } from 'typeorm';
 import { UpdateResourceGroupIntroductionDto } from './dtos/update.request.dto';
+import { ResourcePermissionsChangedEvent } from '../../events/resource-permissions.events';
 
 @Injectable()
 export class ResourceGroupsIntroductionsService {
@@ -18,7 +20,8 @@ export class ResourceGroupsIntroductionsService {
     @InjectRepository(ResourceIntroductionHistoryItem)
     private readonly resourceIntroductionHistoryItemRepository: Repository<ResourceIntroductionHistoryItem>,
     @InjectRepository(ResourceGroup)
-    private readonly resourceGroupRepository: Repository<ResourceGroup>
+    private readonly resourceGroupRepository: Repository<ResourceGroup>,
+    private readonly eventEmitter: EventEmitter2
   ) {}
 
   private async getLastHistoryItemOfIntroduction(
@@ -67,7 +70,9 @@ export class ResourceGroupsIntroductionsService {
       comment: data?.comment,
     });
 
-    return await this.resourceIntroductionHistoryItemRepository.save(historyItem);
+    const savedHistoryItem = await this.resourceIntroductionHistoryItemRepository.save(historyItem);
+    this.eventEmitter.emit('resource-permissions.changed', new ResourcePermissionsChangedEvent());
+    return savedHistoryItem;
   }
 
   public async getManyByGroupId(groupId: number): Promise<ResourceIntroduction[]> {
@@ -1,11 +1,13 @@
 import { InjectRepository } from '@nestjs/typeorm';
 import { Injectable } from '@nestjs/common';
+import { EventEmitter2 } from '@nestjs/event-emitter';
 import { Resource, ResourceGroup } from '@fabaccess/database-entities';
 import { Repository } from 'typeorm';
 import { CreateResourceGroupDto } from './dto/createGroup.dto';
 import { UpdateResourceGroupDto } from './dto/updateGroup.dto';
 import { ResourceGroupNotFoundException } from './errors/groupNotFound.error';
 import { ResourceNotFoundException } from '../../exceptions/resource.notFound.exception';
+import { ResourcePermissionsChangedEvent } from '../events/resource-permissions.events';
 
 interface GetOneSearchOptions {
   id: number;
@@ -17,7 +19,8 @@ export class ResourceGroupsService {
     @InjectRepository(ResourceGroup)
     private readonly resourceGroupRepository: Repository<ResourceGroup>,
     @InjectRepository(Resource)
-    private readonly resourceRepository: Repository<Resource>
+    private readonly resourceRepository: Repository<Resource>,
+    private readonly eventEmitter: EventEmitter2
   ) {}
 
   public async createOne(dto: CreateResourceGroupDto): Promise<ResourceGroup> {
@@ -79,6 +82,7 @@ export class ResourceGroupsService {
 
     resourceGroup.resources.push(resource);
     await this.resourceGroupRepository.save(resourceGroup);
+    this.eventEmitter.emit('resource-permissions.changed', new ResourcePermissionsChangedEvent());
   }
 
   public async removeResource(groupId: number, resourceId: number): Promise<void> {
@@ -91,6 +95,7 @@ export class ResourceGroupsService {
 
     resourceGroup.resources = resourceGroup.resources.filter((resource) => resource.id !== resourceId);
     await this.resourceGroupRepository.save(resourceGroup);
+    this.eventEmitter.emit('resource-permissions.changed', new ResourcePermissionsChangedEvent());
   }
 
   public async deleteOne(groupId: number): Promise<void> {
@@ -98,6 +103,7 @@ export class ResourceGroupsService {
     if (result.affected === 0) {
       throw new ResourceGroupNotFoundException({ id: groupId });
     }
+    this.eventEmitter.emit('resource-permissions.changed', new ResourcePermissionsChangedEvent());
   }
 
   public async getGroupsOfResource(resourceId: number): Promise<ResourceGroup[]> {
@@ -1,13 +1,16 @@
 import { ResourceIntroducer } from '@fabaccess/database-entities';
 import { Injectable } from '@nestjs/common';
+import { EventEmitter2 } from '@nestjs/event-emitter';
 import { InjectRepository } from '@nestjs/typeorm';
 import { Repository } from 'typeorm';
+import { ResourcePermissionsChangedEvent } from '../events/resource-permissions.events';
 
 @Injectable()
 export class ResourceIntroducersService {
   constructor(
     @InjectRepository(ResourceIntroducer)
-    private readonly resourceIntroducerRepository: Repository<ResourceIntroducer>
+    private readonly resourceIntroducerRepository: Repository<ResourceIntroducer>,
+    private readonly eventEmitter: EventEmitter2
   ) {}
 
   public async getMany(resourceId: number): Promise<ResourceIntroducer[]> {
@@ -25,7 +28,9 @@ export class ResourceIntroducersService {
     }
 
     const introducer = this.resourceIntroducerRepository.create({ resourceId, userId });
-    return await this.resourceIntroducerRepository.save(introducer);
+    const savedIntroducer = await this.resourceIntroducerRepository.save(introducer);
+    this.eventEmitter.emit('resource-permissions.changed', new ResourcePermissionsChangedEvent());
+    return savedIntroducer;
   }
 
   public async revoke(resourceId: number, userId: number): Promise<void> {
@@ -35,6 +40,7 @@ export class ResourceIntroducersService {
     }
 
     await this.resourceIntroducerRepository.remove(introducer);
+    this.eventEmitter.emit('resource-permissions.changed', new ResourcePermissionsChangedEvent());
   }
 
   public async isIntroducer(resourceId: number, userId: number): Promise<boolean> {
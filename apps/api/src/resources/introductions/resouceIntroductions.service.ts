@@ -4,9 +4,11 @@ import {
   ResourceIntroductionHistoryItem,
 } from '@fabaccess/database-entities';
 import { Injectable, Logger } from '@nestjs/common';
+import { EventEmitter2 } from '@nestjs/event-emitter';
 import { InjectRepository } from '@nestjs/typeorm';
 import { Repository } from 'typeorm';
 import { UpdateResourceIntroductionDto } from './dtos/update.request.dto';
+import { ResourcePermissionsChangedEvent } from '../events/resource-permissions.events';
 
 @Injectable()
 export class ResourceIntroductionsService {
@@ -16,7 +18,8 @@ export class ResourceIntroductionsService {
     @InjectRepository(ResourceIntroduction)
     private readonly resourceIntroductionRepository: Repository<ResourceIntroduction>,
     @InjectRepository(ResourceIntroductionHistoryItem)
-    private readonly resourceIntroductionHistoryItemRepository: Repository<ResourceIntroductionHistoryItem>
+    private readonly resourceIntroductionHistoryItemRepository: Repository<ResourceIntroductionHistoryItem>,
+    private readonly eventEmitter: EventEmitter2
   ) {}
 
   private async getIntroductionOfUser(resourceId: number, userId: number): Promise<ResourceIntroduction> {
@@ -102,6 +105,7 @@ export class ResourceIntroductionsService {
 
     const savedHistoryItem = await this.resourceIntroductionHistoryItemRepository.save(historyItem);
     this.logger.debug(`Created new history item with id: ${savedHistoryItem.id}`);
+    this.eventEmitter.emit('resource-permissions.changed', new ResourcePermissionsChangedEvent());
     return savedHistoryItem;
   }
 
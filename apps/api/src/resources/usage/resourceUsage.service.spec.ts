@@ -1,7 +1,15 @@
 import { Test, TestingModule } from '@nestjs/testing';
 import { ResourceUsageService } from './resourceUsage.service';
 import { getRepositoryToken } from '@nestjs/typeorm';
-import { Resource, ResourceUsage, User } from '@fabaccess/database-entities';
+import {
+  IntroductionHistoryAction,
+  Resource,
+  ResourceGroup,
+  ResourceIntroducer,
+  ResourceIntroduction,
+  ResourceUsage,
+  User,
+} from '@fabaccess/database-entities';
 import { Repository, IsNull, SelectQueryBuilder } from 'typeorm';
 import { EventEmitter2 } from '@nestjs/event-emitter';
 import { BadRequestException } from '@nestjs/common';
@@ -54,18 +62,22 @@ describe('ResourceUsageService', () => {
   const mockResourceIntroductionService = {
     hasValidIntroduction: jest.fn(),
     canGiveIntroductions: jest.fn(),
+    getMany: jest.fn(),
   };
 
   const mockResourceIntroducersService = {
     isIntroducer: jest.fn(),
+    getMany: jest.fn(),
   };
 
   const mockResourceGroupsIntroductionsService = {
     hasValidIntroduction: jest.fn(),
+    getManyByGroupId: jest.fn(),
   };
 
   const mockResourceGroupsIntroducersService = {
     isIntroducer: jest.fn(),
+    getMany: jest.fn(),
   };
 
   const mockResourceGroupsService = {
@@ -381,4 +393,32 @@ describe('ResourceUsageService', () => {
       );
     });
   });
+
+  describe('getUserIdsThatCanControlResource', () => {
+    const introduction = (receiverUserId: number, actions: IntroductionHistoryAction[]) =>
+      ({
+        receiverUserId,
+        history: actions.map((action, index) => ({ id: index + 1, action, createdAt: new Date(1000 * index) })),
+      } as unknown as ResourceIntroduction);
+
+    it('should collect introduced users and introducers of the resource and its groups', async () => {
+      resourceIntroductionService.getMany.mockResolvedValue([
+        introduction(1, [IntroductionHistoryAction.GRANT]),
+        introduction(2, [IntroductionHistoryAction.GRANT, IntroductionHistoryAction.REVOKE]),
+        introduction(3, [IntroductionHistoryAction.REVOKE, IntroductionHistoryAction.GRANT]),
+      ]);
+      resourceIntroducersService.getMany.mockResolvedValue([{ userId: 4 } as ResourceIntroducer]);
+      resourceGroupsService.getGroupsOfResource.mockResolvedValue([{ id: 7 } as ResourceGroup]);
+      resourceGroupsIntroductionsService.getManyByGroupId.mockResolvedValue([
+        introduction(5, [IntroductionHistoryAction.GRANT]),
+      ]);
+      resourceGroupsIntroducersService.getMany.mockResolvedValue([{ userId: 6 } as ResourceIntroducer]);
+
+      const result = await service.getUserIdsThatCanControlResource(1);
+
+      expect(Array.from(result).sort()).toEqual([1, 3, 4, 5, 6]);
+      expect(resourceGroupsIntroductionsService.getManyByGroupId).toHaveBeenCalledWith(7);
+      expect(resourceGroupsIntroducersService.getMany).toHaveBeenCalledWith(7);
+    });
+  });
 });
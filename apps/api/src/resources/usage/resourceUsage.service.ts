@@ -1,7 +1,14 @@
 import { Injectable, BadRequestException, ForbiddenException, Logger } from '@nestjs/common';
 import { InjectRepository } from '@nestjs/typeorm';
 import { Repository, IsNull, FindOneOptions } from 'typeorm';
-import { Resource, ResourceUsage, User } from '@fabaccess/database-entities';
+import {
+  IntroductionHistoryAction,
+  Resource,
+  ResourceIntroduction,
+  ResourceIntroductionHistoryItem,
+  ResourceUsage,
+  User,
+} from '@fabaccess/database-entities';
 import { StartUsageSessionDto } from './dtos/startUsageSession.dto';
 import { EndUsageSessionDto } from './dtos/endUsageSession.dto';
 import { ResourceNotFoundException } from '../../exceptions/resource.notFound.exception';
@@ -69,6 +76,57 @@ export class ResourceUsageService {
     return false;
   }
 
+  /**
+   * Ids of the users that may control the resource through an introduction or as introducer,
+   * like canControllResource() but for all users at once. Users with the canManageResources
+   * system permission are not included.
+   */
+  public async getUserIdsThatCanControlResource(resourceId: number): Promise<Set<number>> {
+    const userIds = new Set<number>();
+
+    for (const introduction of await this.resourceIntroductionService.getMany(resourceId)) {
+      if (ResourceUsageService.isGranted(introduction)) {
+        userIds.add(introduction.receiverUserId);
+      }
+    }
+
+    for (const introducer of await this.resourceIntroducersService.getMany(resourceId)) {
+      userIds.add(introducer.userId);
+    }
+
+    for (const group of await this.resourceGroupsService.getGroupsOfResource(resourceId)) {
+      for (const introduction of await this.resourceGroupsIntroductionsService.getManyByGroupId(group.id)) {
+        if (ResourceUsageService.isGranted(introduction)) {
+          userIds.add(introduction.receiverUserId);
+        }
+      }
+
+      for (const introducer of await this.resourceGroupsIntroducersService.getMany(group.id)) {
+        userIds.add(introducer.userId);
+      }
+    }
+
+    return userIds;
+  }
+
+  // An introduction is valid if its latest history item granted it
+  private static isGranted(introduction: ResourceIntroduction): boolean {
+    let latest: ResourceIntroductionHistoryItem | undefined;
+    for (const item of introduction.history ?? []) {
+      if (!latest) {
+        latest = item;
+        continue;
+      }
+
+      const time = new Date(item.createdAt).getTime();
+      const latestTime = new Date(latest.createdAt).getTime();
+      if (time > latestTime || (time === latestTime && item.id > latest.id)) {
+        latest = item;
+      }
+    }
+    return latest?.action === IntroductionHistoryAction.GRANT;
+  }
+
   async startSession(resourceId: number, user: User, dto: StartUsageSessionDto): Promise<ResourceUsage> {
     this.logger.debug(`Starting session for resource ${resourceId} by user ${user.id}`, { dto });
 
@@ -0,0 +1,4 @@
+/**
+ * Emitted when a user was deleted or their system permissions changed.
+ */
+export class UsersChangedEvent {}
@@ -5,6 +5,7 @@ import { User } from '@fabaccess/database-entities';
 import { Repository, UpdateResult } from 'typeorm';
 import { BadRequestException } from '@nestjs/common';
 import { UserNotFoundException } from '../../exceptions/user.notFound.exception';
+import { EventEmitter2 } from '@nestjs/event-emitter';
 
 describe('UsersService', () => {
   let service: UsersService;
@@ -25,6 +26,10 @@ describe('UsersService', () => {
             count: jest.fn(),
           },
         },
+        {
+          provide: EventEmitter2,
+          useValue: { emit: jest.fn() },
+        },
       ],
     }).compile();
 
@@ -2,10 +2,12 @@ import { BadRequestException, Injectable, Logger } from '@nestjs/common';
 import { Repository, ILike, FindOneOptions as TypeormFindOneOptions, FindOptionsWhere, In } from 'typeorm';
 import { SystemPermissions, User } from '@fabaccess/database-entities';
 import { InjectRepository } from '@nestjs/typeorm';
+import { EventEmitter2 } from '@nestjs/event-emitter';
 import { PaginatedResponse } from '../../types/response';
 import { PaginationOptions, PaginationOptionsSchema } from '../../types/request';
 import { z } from 'zod';
 import { UserNotFoundException } from '../../exceptions/user.notFound.exception';
+import { UsersChangedEvent } from './events/users.events';
 
 const FindOneOptionsSchema = z
   .object({
@@ -40,7 +42,8 @@ export class UsersService {
 
   constructor(
     @InjectRepository(User)
-    private userRepository: Repository<User>
+    private userRepository: Repository<User>,
+    private readonly eventEmitter: EventEmitter2
   ) {}
 
   async findOne(options: FindOneOptions, relations?: string[]): Promise<User | null> {
@@ -128,6 +131,7 @@ export class UsersService {
     this.logger.debug(`Deleting user with ID: ${id}`);
     await this.userRepository.delete(id);
     this.logger.debug(`User deleted with ID: ${id}`);
+    this.eventEmitter.emit('users.changed', new UsersChangedEvent());
   }
 
   async updateOne(id: number, updates: Partial<User>): Promise<User> {
@@ -169,9 +173,23 @@ export class UsersService {
     }
 
     this.logger.debug(`User updated successfully, ID: ${id}`);
+    if (updates.systemPermissions) {
+      this.eventEmitter.emit('users.changed', new UsersChangedEvent());
+    }
     return updatedUser;
   }
 
+  /**
+   * All users with the given ids in one query, without pagination. Ids of deleted users are
+   * skipped.
+   */
+  async findAllByIds(ids: number[]): Promise<User[]> {
+    if (ids.length === 0) {
+      return [];
+    }
+    return await this.userRepository.find({ where: { id: In(ids) } });
+  }
+
   async findMany(options: PaginationOptions & { search?: string; ids?: number[] }): Promise<PaginatedResponse<User>> {
     this.logger.debug(`Finding all users with options: ${JSON.stringify(options)}`);
     const paginationOptions = PaginationOptionsSchema.parse(options);
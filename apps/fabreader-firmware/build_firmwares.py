@@ -103,6 +103,9 @@ def main():
     environments = []
     for section in config.sections():
         if section.startswith('env:'):
+            # Host test environments don't produce firmware
+            if config[section].get('platform', '').strip() == 'native':
+                continue
             env_name = section[4:]  # Remove 'env:' prefix
             environments.append(env_name)
     
@@ -23,6 +23,7 @@
 
 // I2C KeyPad configuration
 #define I2C_KEYPAD_ADDRESS 0x20
+#define PIN_KEYPAD_INT -1 // INT of the I2C expander, -1 scans periodically
 
 // LEDs
 #define PIN_LED 0
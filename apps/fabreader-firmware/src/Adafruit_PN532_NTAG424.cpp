@@ -58,6 +58,7 @@
 /**************************************************************************/
 
 #include "Adafruit_PN532_NTAG424.h"
+#include "i2c_bus.hpp"
 
 Arduino_CRC32 crc32; ///< Arduino CRC32 Class
 
@@ -78,7 +79,9 @@ byte pn532response_firmwarevers[] = {
 #define PN532DEBUGPRINT Serial ///< Fixed name for debug Serial instance
 // #define PN532DEBUGPRINT SerialUSB ///< Fixed name for debug Serial instance
 
-#define PN532_PACKBUFFSIZ 64                ///< Packet buffer size in bytes
+#define PN532_PACKBUFFSIZ 96                ///< Packet buffer size in bytes,
+                                            ///< fits a ReadSig response
+#define NTAG424_ISO_CHUNK_SIZE 54           ///< ISOUpdateBinary bytes per APDU
 byte pn532_packetbuffer[PN532_PACKBUFFSIZ]; ///< Packet buffer used in various
                                             ///< transactions
 
@@ -112,8 +115,14 @@ Adafruit_PN532::Adafruit_PN532(uint8_t clk, uint8_t miso, uint8_t mosi,
 Adafruit_PN532::Adafruit_PN532(uint8_t irq, uint8_t reset, TwoWire *theWire)
     : _irq(irq), _reset(reset)
 {
-  pinMode(_irq, INPUT);
-  pinMode(_reset, OUTPUT);
+  if (_irq != -1)
+  {
+    pinMode(_irq, INPUT);
+  }
+  if (_reset != -1)
+  {
+    pinMode(_reset, OUTPUT);
+  }
   i2c_dev = new Adafruit_I2CDevice(PN532_I2C_ADDRESS, theWire);
 }
 
@@ -172,6 +181,7 @@ bool Adafruit_PN532::begin()
   {
     // I2C initialization
     // PN532 will fail address check since its asleep, so suppress
+    I2CBusLock lock(I2C_DEVICE_NFC);
     if (!i2c_dev->begin(false))
     {
       return false;
@@ -189,6 +199,11 @@ bool Adafruit_PN532::begin()
     // no interface specified
     return false;
   }
+  if (_irq != -1)
+  {
+    // The PN532 pulls IRQ low once a response (or ACK) is ready
+    attachInterruptArg(digitalPinToInterrupt(_irq), handleIrq, this, FALLING);
+  }
   reset(); // HW reset - put in known state
   delay(10);
   wakeup(); // hey! wakeup!
@@ -360,20 +375,13 @@ uint32_t Adafruit_PN532::getFirmwareVersion(void)
 bool Adafruit_PN532::sendCommandCheckAck(uint8_t *cmd, uint8_t cmdlen,
                                          uint16_t timeout)
 {
-
-  // I2C works without using IRQ pin by polling for RDY byte
-  // seems to work best with some delays between transactions
-  uint8_t SLOWDOWN = 0;
-  if (i2c_dev)
-    SLOWDOWN = 1;
+  unsigned long started_at = micros();
 
   // write the command
   writecommand(cmd, cmdlen);
 
-  // I2C TUNING
-  delay(SLOWDOWN);
-
-  // Wait for chip to say its ready!
+  // Wait for chip to say its ready! waitready() polls at a fine granularity,
+  // so the fixed I2C settle delays are no longer needed.
   if (!waitready(timeout))
   {
     return false;
@@ -395,18 +403,203 @@ bool Adafruit_PN532::sendCommandCheckAck(uint8_t *cmd, uint8_t cmdlen,
     return false;
   }
 
-  // I2C TUNING
-  delay(SLOWDOWN);
-
   // Wait for chip to say its ready!
   if (!waitready(timeout))
   {
     return false;
   }
 
+  recordLatency(cmd[0], false, micros() - started_at);
+
   return true; // ack'd command
 }
 
+/**************************************************************************/
+/*!
+    @brief  Writes a command and returns immediately. Completion has to be
+            polled with pollCommand(), the response is fetched with
+            readResponse() once pollCommand() reports
+            PN532_TRANSPORT_RESPONSE_READY.
+
+    @param  cmd       Pointer to the command buffer
+    @param  cmdlen    The size of the command in bytes
+    @param  timeout   Milliseconds until the command is considered failed,
+                      0 waits forever (e.g. InAutoPoll)
+
+    @returns  false if another command is still in flight
+*/
+/**************************************************************************/
+bool Adafruit_PN532::startCommand(uint8_t *cmd, uint8_t cmdlen,
+                                  uint16_t timeout)
+{
+  if (_cmdState == PN532_TRANSPORT_WAIT_ACK ||
+      _cmdState == PN532_TRANSPORT_WAIT_RESPONSE)
+  {
+    return false;
+  }
+
+  _irqFired = false;
+  _cmdCode = cmd[0];
+  _cmdTimeout = timeout;
+  _cmdStartedAt = millis();
+  _cmdStartedAtUs = micros();
+
+  writecommand(cmd, cmdlen);
+
+  _cmdState = PN532_TRANSPORT_WAIT_ACK;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Advances the command submitted with startCommand() without
+            blocking. With an IRQ pin the bus is only touched once the
+            PN532 signalled readiness.
+
+    @returns  the current PN532_TRANSPORT_* state
+*/
+/**************************************************************************/
+uint8_t Adafruit_PN532::pollCommand(void)
+{
+  if (_cmdState != PN532_TRANSPORT_WAIT_ACK &&
+      _cmdState != PN532_TRANSPORT_WAIT_RESPONSE)
+  {
+    return _cmdState;
+  }
+
+  bool ready;
+  if (_irq != -1)
+  {
+    ready = _irqFired || digitalRead(_irq) == LOW;
+  }
+  else
+  {
+    ready = isready();
+  }
+
+  if (!ready)
+  {
+    if (_cmdTimeout != 0 && millis() - _cmdStartedAt > _cmdTimeout)
+    {
+#ifdef PN532DEBUG
+      PN532DEBUGPRINT.println("TIMEOUT!");
+#endif
+      _cmdState = PN532_TRANSPORT_ERROR;
+    }
+    return _cmdState;
+  }
+
+  _irqFired = false;
+
+  if (_cmdState == PN532_TRANSPORT_WAIT_ACK)
+  {
+    if (!readack())
+    {
+#ifdef PN532DEBUG
+      PN532DEBUGPRINT.println(F("No ACK frame received!"));
+#endif
+      _cmdState = PN532_TRANSPORT_ERROR;
+      return _cmdState;
+    }
+    _cmdState = PN532_TRANSPORT_WAIT_RESPONSE;
+    return _cmdState;
+  }
+
+  recordLatency(_cmdCode, true, micros() - _cmdStartedAtUs);
+  _cmdState = PN532_TRANSPORT_RESPONSE_READY;
+  return _cmdState;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the response of the command submitted with startCommand()
+            and returns the transport to idle.
+
+    @param  buff      Pointer to the buffer where data will be written
+    @param  n         Number of bytes to be read
+*/
+/**************************************************************************/
+void Adafruit_PN532::readResponse(uint8_t *buff, uint8_t n)
+{
+  readdata(buff, n);
+  _cmdState = PN532_TRANSPORT_IDLE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Aborts the command in flight. Sending an ACK frame makes the
+            PN532 drop the current command (user manual 6.2.1.3).
+*/
+/**************************************************************************/
+void Adafruit_PN532::abortCommand(void)
+{
+  if (_cmdState == PN532_TRANSPORT_WAIT_ACK ||
+      _cmdState == PN532_TRANSPORT_WAIT_RESPONSE)
+  {
+    writeack();
+  }
+  _irqFired = false;
+  _cmdState = PN532_TRANSPORT_IDLE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Prints the per-command latency of the blocking and the
+            asynchronous transport path.
+*/
+/**************************************************************************/
+void Adafruit_PN532::printLatencyStats(void)
+{
+  PN532DEBUGPRINT.println(F("[PN532] command latency (blocking | async):"));
+  for (uint8_t i = 0; i < _latencyUsed; i++)
+  {
+    const PN532_LatencySlot &slot = _latency[i];
+    PN532DEBUGPRINT.printf(
+        "  cmd 0x%02X: n=%u avg=%uus max=%uus | n=%u avg=%uus max=%uus\n",
+        slot.command, slot.blocking.count,
+        slot.blocking.count ? slot.blocking.total_us / slot.blocking.count : 0,
+        slot.blocking.max_us, slot.async.count,
+        slot.async.count ? slot.async.total_us / slot.async.count : 0,
+        slot.async.max_us);
+  }
+}
+
+void Adafruit_PN532::recordLatency(uint8_t command, bool async, uint32_t us)
+{
+  PN532_LatencySlot *slot = NULL;
+  for (uint8_t i = 0; i < _latencyUsed; i++)
+  {
+    if (_latency[i].command == command)
+    {
+      slot = &_latency[i];
+      break;
+    }
+  }
+  if (slot == NULL)
+  {
+    if (_latencyUsed >= PN532_LATENCY_SLOTS)
+    {
+      return;
+    }
+    slot = &_latency[_latencyUsed++];
+    memset(slot, 0, sizeof(*slot));
+    slot->command = command;
+  }
+
+  PN532_LatencyStat &stat = async ? slot->async : slot->blocking;
+  stat.count++;
+  stat.total_us += us;
+  if (us > stat.max_us)
+  {
+    stat.max_us = us;
+  }
+}
+
+void IRAM_ATTR Adafruit_PN532::handleIrq(void *arg)
+{
+  ((Adafruit_PN532 *)arg)->_irqFired = true;
+}
+
 /**************************************************************************/
 /*!
     @brief   Writes an 8-bit value that sets the state of the PN532's GPIO
@@ -644,15 +837,17 @@ bool Adafruit_PN532::startPassiveTargetIDDetection(uint8_t cardbaudrate)
                           with the card's UID (up to 7 bytes)
     @param  uidLength     Pointer to the variable that will hold the
                           length of the card's UID.
+    @param  info          Optional, receives ATQA, SAK and ATS
 
     @returns 1 if everything executed properly, 0 for an error
 */
 /**************************************************************************/
 bool Adafruit_PN532::readDetectedPassiveTargetID(uint8_t *uid,
-                                                 uint8_t *uidLength)
+                                                 uint8_t *uidLength,
+                                                 PN532_TargetInfo *info)
 {
-  // read data packet
-  readdata(pn532_packetbuffer, 20);
+  // read data packet, this also consumes a response of startCommand()
+  readResponse(pn532_packetbuffer, info ? PN532_PACKBUFFSIZ : 20);
   // check some basic stuff
 
   /* ISO14443A card response should be in the following format:
@@ -665,7 +860,8 @@ bool Adafruit_PN532::readDetectedPassiveTargetID(uint8_t *uid,
     b9..10          SENS_RES
     b11             SEL_RES
     b12             NFCID Length
-    b13..NFCIDLen   NFCID                                      */
+    b13..NFCIDLen   NFCID
+    ..              ATS, ISO14443-4 targets only               */
 
 #ifdef MIFAREDEBUG
   PN532DEBUGPRINT.print(F("Found "));
@@ -702,9 +898,67 @@ bool Adafruit_PN532::readDetectedPassiveTargetID(uint8_t *uid,
   PN532DEBUGPRINT.println();
 #endif
 
+  if (info)
+  {
+    // Frame length, TFI and command code precede the target data
+    uint8_t frameEnd = 5 + pn532_packetbuffer[3];
+    parseTargetInfo(pn532_packetbuffer + 9,
+                    frameEnd > 9 ? frameEnd - 9 : 0, info);
+  }
+
   return 1;
 }
 
+/**************************************************************************/
+/*!
+    @brief   Reads ATQA, SAK and ATS from the target data of an ISO14443A
+             target, as reported by InListPassiveTarget and InAutoPoll:
+             SENS_RES (2), SEL_RES (1), NFCIDLength (1), NFCID1, ATS
+
+    @param   data    Start of the target data
+    @param   length  Bytes of target data
+    @param   info    Receives the parsed fields
+*/
+/**************************************************************************/
+void Adafruit_PN532::parseTargetInfo(const uint8_t *data, uint8_t length,
+                                     PN532_TargetInfo *info)
+{
+  memset(info, 0, sizeof(PN532_TargetInfo));
+  if (length < 4)
+  {
+    return;
+  }
+
+  info->atqa = ((uint16_t)data[0] << 8) | data[1];
+  info->sak = data[2];
+
+  // TL counts itself, the ATS is cut to what fits
+  uint8_t atsOffset = 4 + data[3];
+  if (atsOffset < length && data[atsOffset] > 0)
+  {
+    uint8_t atsLength = data[atsOffset];
+    if (atsLength > length - atsOffset)
+    {
+      atsLength = length - atsOffset;
+    }
+    if (atsLength > PN532_MAX_ATS_LENGTH)
+    {
+      atsLength = PN532_MAX_ATS_LENGTH;
+    }
+    memcpy(info->ats, data + atsOffset, atsLength);
+    info->atsLength = atsLength;
+  }
+
+#ifdef MIFAREDEBUG
+  PN532DEBUGPRINT.print(F("ATQA: 0x"));
+  PN532DEBUGPRINT.print(info->atqa, HEX);
+  PN532DEBUGPRINT.print(F(" SAK: 0x"));
+  PN532DEBUGPRINT.print(info->sak, HEX);
+  PN532DEBUGPRINT.print(F(" ATS bytes: "));
+  PN532DEBUGPRINT.println(info->atsLength);
+#endif
+}
+
 /**************************************************************************/
 /*!
     @brief   Exchanges an APDU with the currently inlisted peer
@@ -890,6 +1144,271 @@ bool Adafruit_PN532::inListPassiveTarget()
   return true;
 }
 
+/**************************************************************************/
+/*!
+    @brief   Starts InAutoPoll, the PN532 then polls the field on its own
+             and only answers once a target was activated. Completion is
+             polled with pollCommand(), the result is fetched with
+             readAutoPollTarget().
+
+    @param   types     PN532_AUTOPOLL_* target types to poll for
+    @param   numTypes  Number of entries in types (1..15)
+    @param   pollNr    Number of polling rounds, PN532_AUTOPOLL_ENDLESS
+                       polls until a target shows up
+    @param   period    Pause between rounds in units of 150 ms
+
+    @return  true if the command was written
+*/
+/**************************************************************************/
+bool Adafruit_PN532::startAutoPoll(const uint8_t *types, uint8_t numTypes,
+                                   uint8_t pollNr, uint8_t period)
+{
+  if (numTypes == 0 || numTypes > PN532_AUTOPOLL_MAX_TYPES)
+  {
+    return false;
+  }
+
+  pn532_packetbuffer[0] = PN532_COMMAND_INAUTOPOLL;
+  pn532_packetbuffer[1] = pollNr;
+  pn532_packetbuffer[2] = period;
+  memcpy(pn532_packetbuffer + 3, types, numTypes);
+
+  // An endless poll has no deadline, it ends with a target or abortCommand()
+  return startCommand(pn532_packetbuffer, 3 + numTypes,
+                      pollNr == PN532_AUTOPOLL_ENDLESS ? 0 : 1000);
+}
+
+/**************************************************************************/
+/*!
+    @brief   Reads the first target reported by InAutoPoll and makes it the
+             inlisted tag for following exchanges.
+
+    @param   type       Set to the PN532_AUTOPOLL_* type of the target
+    @param   uid        Buffer for the UID (PN532_MAX_UID_LENGTH bytes),
+                        the PUPI for ISO14443B and the IDm for FeliCa
+    @param   uidLength  Set to the number of bytes written to uid
+    @param   info       Optional, receives ATQA, SAK and ATS of ISO14443A
+                        targets and is zeroed for other types
+
+    @return  true if a target was parsed
+*/
+/**************************************************************************/
+bool Adafruit_PN532::readAutoPollTarget(uint8_t *type, uint8_t *uid,
+                                        uint8_t *uidLength,
+                                        PN532_TargetInfo *info)
+{
+  readResponse(pn532_packetbuffer, PN532_PACKBUFFSIZ);
+
+  /* InAutoPoll response:
+
+    byte            Description
+    -------------   ------------------------------------------
+    b0..6           Frame header and preamble
+    b7              Targets found
+    b8              Type of the first target
+    b9              Length of the target data
+    b10             Tg
+    b11..           Target data, layout depends on the type   */
+
+  if (pn532_packetbuffer[5] != PN532_PN532TOHOST ||
+      pn532_packetbuffer[6] != PN532_RESPONSE_INAUTOPOLL ||
+      pn532_packetbuffer[7] == 0)
+  {
+    return false;
+  }
+
+  uint8_t dataLength = pn532_packetbuffer[9];
+  if (dataLength < 2 || 10 + dataLength > PN532_PACKBUFFSIZ)
+  {
+    return false;
+  }
+
+  *type = pn532_packetbuffer[8];
+  _inListedTag = pn532_packetbuffer[10];
+
+  // A fresh activation starts at the PICC level
+  ntag424_AppSelected = false;
+
+  const uint8_t *data = pn532_packetbuffer + 11;
+  uint8_t offset, length;
+
+  switch (*type)
+  {
+  case PN532_AUTOPOLL_GENERIC_106:
+  case PN532_AUTOPOLL_MIFARE:
+  case PN532_AUTOPOLL_ISO14443_4A:
+    // SENS_RES (2), SEL_RES (1), NFCIDLength (1), NFCID1
+    offset = 4;
+    length = data[3];
+    break;
+  case PN532_AUTOPOLL_GENERIC_212:
+  case PN532_AUTOPOLL_GENERIC_424:
+  case PN532_AUTOPOLL_FELICA_212:
+  case PN532_AUTOPOLL_FELICA_424:
+    // POL_RES length (1), response code (1), NFCID2t (8)
+    offset = 2;
+    length = 8;
+    break;
+  case PN532_AUTOPOLL_ISO14443B:
+  case PN532_AUTOPOLL_ISO14443_4B:
+    // ATQB starts with 0x50 followed by the PUPI (4)
+    offset = 1;
+    length = 4;
+    break;
+  case PN532_AUTOPOLL_JEWEL:
+    // SENS_RES (2), JEWELID (4)
+    offset = 2;
+    length = 4;
+    break;
+  default:
+    return false;
+  }
+
+  if (length > PN532_MAX_UID_LENGTH || 1 + offset + length > dataLength)
+  {
+    return false;
+  }
+
+  memcpy(uid, data + offset, length);
+  *uidLength = length;
+
+  if (info)
+  {
+    // Target data excludes Tg, which dataLength counts
+    bool isTypeA = *type == PN532_AUTOPOLL_GENERIC_106 ||
+                   *type == PN532_AUTOPOLL_MIFARE ||
+                   *type == PN532_AUTOPOLL_ISO14443_4A;
+    if (isTypeA)
+    {
+      parseTargetInfo(data, dataLength - 1, info);
+    }
+    else
+    {
+      memset(info, 0, sizeof(PN532_TargetInfo));
+    }
+  }
+
+#ifdef MIFAREDEBUG
+  PN532DEBUGPRINT.print(F("AutoPoll type 0x"));
+  PN532DEBUGPRINT.print(*type, HEX);
+  PN532DEBUGPRINT.print(F(" UID:"));
+  for (uint8_t i = 0; i < length; i++)
+  {
+    PN532DEBUGPRINT.print(F(" 0x"));
+    PN532DEBUGPRINT.print(uid[i], HEX);
+  }
+  PN532DEBUGPRINT.println();
+#endif
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief   Picks the presence check a detected target answers. The
+             Diagnose attention request only works for ISO-DEP targets,
+             Type 2 tags answer a READ and Mifare Classic cards, which need
+             an authentication before reading, are selected again.
+
+    @param   type   InAutoPoll target type
+    @param   sak    SEL_RES of an ISO14443A target
+
+    @return  One of the PN532_PRESENCE_* methods
+*/
+/**************************************************************************/
+uint8_t Adafruit_PN532::presenceMethod(uint8_t type, uint8_t sak)
+{
+  if (type != PN532_AUTOPOLL_GENERIC_106 && type != PN532_AUTOPOLL_MIFARE &&
+      type != PN532_AUTOPOLL_ISO14443_4A)
+  {
+    return PN532_PRESENCE_ATTENTION;
+  }
+  if (sak & 0x20)
+  {
+    return PN532_PRESENCE_ATTENTION;
+  }
+  return sak == 0x00 ? PN532_PRESENCE_READ : PN532_PRESENCE_RESELECT;
+}
+
+/**************************************************************************/
+/*!
+    @brief   Starts a card presence check of the inlisted target. Each
+             method only exchanges a few bytes with the card, which is much
+             cheaper than a new detection. Completion is polled with
+             pollCommand(), the result is read with readPresenceCheck().
+
+    @param   method    PN532_PRESENCE_* method of the card
+    @param   timeout   Milliseconds until the check is considered failed
+
+    @return  true if the command was written
+*/
+/**************************************************************************/
+bool Adafruit_PN532::startPresenceCheck(uint8_t method, uint16_t timeout)
+{
+  _presenceMethod = method;
+
+  if (method == PN532_PRESENCE_READ)
+  {
+    pn532_packetbuffer[0] = PN532_COMMAND_INDATAEXCHANGE;
+    pn532_packetbuffer[1] = 1; // Tg
+    pn532_packetbuffer[2] = MIFARE_CMD_READ;
+    pn532_packetbuffer[3] = 0; // Page
+    return startCommand(pn532_packetbuffer, 4, timeout);
+  }
+
+  if (method == PN532_PRESENCE_RESELECT)
+  {
+    pn532_packetbuffer[0] = PN532_COMMAND_INLISTPASSIVETARGET;
+    pn532_packetbuffer[1] = 1; // Max targets
+    pn532_packetbuffer[2] = PN532_MIFARE_ISO14443A;
+    return startCommand(pn532_packetbuffer, 3, timeout);
+  }
+
+  pn532_packetbuffer[0] = PN532_COMMAND_DIAGNOSE;
+  pn532_packetbuffer[1] = PN532_DIAGNOSE_ATTENTION_REQUEST;
+  return startCommand(pn532_packetbuffer, 2, timeout);
+}
+
+/**************************************************************************/
+/*!
+    @brief   Reads the result of startPresenceCheck()
+
+    @param   uid         UID of the tracked card, a reselect only counts if
+                         the same card answered
+    @param   uidLength   UID length
+
+    @return  true if the target is still in the field
+*/
+/**************************************************************************/
+bool Adafruit_PN532::readPresenceCheck(const uint8_t *uid, uint8_t uidLength)
+{
+  if (_presenceMethod == PN532_PRESENCE_RESELECT)
+  {
+    readResponse(pn532_packetbuffer, 13 + PN532_MAX_UID_LENGTH);
+
+    // b5..6 D5 4B, b7 NbTg, b8 Tg, b9..10 ATQA, b11 SAK, b12 UID length, b13.. UID
+    if (pn532_packetbuffer[5] != PN532_PN532TOHOST ||
+        pn532_packetbuffer[6] != PN532_RESPONSE_INLISTPASSIVETARGET ||
+        pn532_packetbuffer[7] != 1)
+    {
+      return false;
+    }
+    return uid == NULL ||
+           (pn532_packetbuffer[12] == uidLength &&
+            memcmp(pn532_packetbuffer + 13, uid, uidLength) == 0);
+  }
+
+  readResponse(pn532_packetbuffer, 8);
+
+  // b5..6 D5 01/41, b7 status, 0x00 means the target answered
+  uint8_t response = _presenceMethod == PN532_PRESENCE_READ
+                         ? PN532_RESPONSE_INDATAEXCHANGE
+                         : PN532_RESPONSE_DIAGNOSE;
+  return pn532_packetbuffer[5] == PN532_PN532TOHOST &&
+         pn532_packetbuffer[6] == response &&
+         (pn532_packetbuffer[7] & 0x3F) == 0x00;
+}
+
 /***** Mifare Classic Functions ******/
 
 /**************************************************************************/
@@ -1496,28 +2015,14 @@ uint8_t Adafruit_PN532::ntag424_apdu_send(
       Serial.println(padded_payload_length);
       Adafruit_PN532::PrintHexChar(payload_padded, padded_payload_length);
 #endif
-      // assemble iv
-      uint8_t iv[32];
+      // IVc = E(SesAuthENCKey, A5 5A TI CmdCtr 00..)
       uint8_t ive[16];
-      iv[0] = 0xA5;
-      iv[1] = 0x5A;
-      memcpy(iv + 2, ntag424_authresponse_TI, 4);
-      iv[6] = ntag424_Session.cmd_counter & 0xff;
-      iv[7] = (ntag424_Session.cmd_counter >> 8) & 0xff;
-      memset(iv + 7, 0, 24); // was 25
-#ifdef NTAG424DEBUG
-      Serial.println("IV-init:");
-      Adafruit_PN532::PrintHex(iv, 16);
-#endif
-      Adafruit_PN532::ntag424_encrypt(ntag424_Session.session_key_enc,
-                                      sizeof(iv), iv, ive);
+      Adafruit_PN532::ntag424_session_iv(0xA5, 0x5A, ive);
       // encrypt cmd_data using SesAuthENCKey
-      // padded_payload_length
-      // uint8_t payload_encrypted[32];
       uint8_t payload_encrypted[52];
-      Adafruit_PN532::ntag424_encrypt(ntag424_Session.session_key_enc, ive,
-                                      padded_payload_length, payload_padded,
-                                      payload_encrypted);
+      Adafruit_PN532::ntag424_session_encrypt(ive, padded_payload_length,
+                                              payload_padded,
+                                              payload_encrypted);
       memcpy(apdu + offset, payload_encrypted, padded_payload_length);
 #ifdef NTAG424DEBUG
       Serial.println("APDU Payload:");
@@ -1534,9 +2039,9 @@ uint8_t Adafruit_PN532::ntag424_apdu_send(
       Adafruit_PN532::PrintHexChar(apdu, offset);
 #endif
       // add CMAC
-      Adafruit_PN532::ntag424_MAC(
-          ntag424_Session.session_key_mac, ins, cmd_header, cmd_header_length,
-          payload_encrypted, padded_payload_length, cmac_short);
+      Adafruit_PN532::ntag424_MAC(ins, cmd_header, cmd_header_length,
+                                  payload_encrypted, padded_payload_length,
+                                  cmac_short);
       memcpy(apdu + offset, cmac_short, 8);
       offset += 8;
       apdu[offset_lc] = cmd_header_length + padded_payload_length + 8;
@@ -1547,8 +2052,7 @@ uint8_t Adafruit_PN532::ntag424_apdu_send(
     }
     else
     {
-      Adafruit_PN532::ntag424_MAC(ntag424_Session.session_key_mac, ins,
-                                  cmd_header, cmd_header_length, cmd_data,
+      Adafruit_PN532::ntag424_MAC(ins, cmd_header, cmd_header_length, cmd_data,
                                   cmd_data_length, cmac_short);
       memcpy(apdu + offset, cmac_short, 8);
       offset += 8;
@@ -1594,6 +2098,10 @@ uint8_t Adafruit_PN532::ntag424_apdu_send(
   ntag424_Session.cmd_counter += 1;
 
   uint8_t response_length = pn532_packetbuffer[3] - 3;
+  if (response_length > response_le)
+  {
+    response_length = response_le;
+  }
   memcpy(response, pn532_packetbuffer + 8, response_length);
 #ifdef NTAG424DEBUG
   PN532DEBUGPRINT.print(F("RESPONSE: "));
@@ -1636,8 +2144,8 @@ uint8_t Adafruit_PN532::ntag424_apdu_send(
 #endif
     uint8_t checkmac[8];
 
-    Adafruit_PN532::ntag424_cmac_short(ntag424_Session.session_key_mac,
-                                       checkmacin, maclength, checkmac);
+    Adafruit_PN532::ntag424_session_cmac_short(checkmacin, maclength,
+                                               checkmac);
 #ifdef NTAG424DEBUG
     PN532DEBUGPRINT.print(F("checkcmac:"));
     Adafruit_PN532::PrintHex(checkmac, 8);
@@ -1663,25 +2171,16 @@ uint8_t Adafruit_PN532::ntag424_apdu_send(
   // decrypt the response in mode.full
   if ((response_length >= 10) && (comm_mode == NTAG424_COMM_MODE_FULL))
   {
-    uint8_t ivd[32];
+    // IVr = E(SesAuthENCKey, 5A A5 TI CmdCtr 00..)
     uint8_t ivde[16];
-    ivd[0] = 0x5A;
-    ivd[1] = 0xA5;
-    memcpy(ivd + 2, ntag424_authresponse_TI, 4);
-    ivd[6] = ntag424_Session.cmd_counter & 0xff;
-    ivd[7] = (ntag424_Session.cmd_counter >> 8) & 0xff;
-    memset(ivd + 7, 0, 25);
-    // Serial.println("IV-init:");
-    // Adafruit_PN532::PrintHex(iv, 16);
-    Adafruit_PN532::ntag424_encrypt(ntag424_Session.session_key_enc,
-                                    sizeof(ivd), ivd, ivde);
+    Adafruit_PN532::ntag424_session_iv(0x5A, 0xA5, ivde);
     uint8_t *respplain = (uint8_t *)malloc(response_length - 10);
 #ifdef NTAG424DEBUG
     PN532DEBUGPRINT.println(F("Encrypted Response(pcd < picc)"));
     Adafruit_PN532::PrintHex(response, response_length - 10);
 #endif
-    Adafruit_PN532::ntag424_decrypt(ntag424_Session.session_key_enc, ivde,
-                                    response_length - 10, response, respplain);
+    Adafruit_PN532::ntag424_session_decrypt(ivde, response_length - 10,
+                                            response, respplain);
 #ifdef NTAG424DEBUG
     PN532DEBUGPRINT.println(F("Decrypted Response(pcd < picc)"));
     Adafruit_PN532::PrintHex(respplain, response_length - 10);
@@ -1943,15 +2442,14 @@ uint8_t Adafruit_PN532::ntag424_cmac(uint8_t *key, uint8_t *input,
   PN532DEBUGPRINT.print(F("cmac output: "));
   Adafruit_PN532::PrintHexChar(cmac, 16);
 #endif
-  return 1;
 exit:
   mbedtls_cipher_free(&ctx);
-  return 0;
+  return ret == 0;
 }
 
 /**************************************************************************/
 /*!
-    @brief   sign the supplied data and return the size.
+    @brief   sign the supplied data with the session mac key.
 
     @param   cmd              apducmd
     @param   cmdheader        buffer containing the commandheader
@@ -1968,15 +2466,15 @@ uint8_t Adafruit_PN532::ntag424_MAC(uint8_t *cmd, uint8_t *cmdheader,
                                     uint8_t cmddata_length,
                                     uint8_t *signature)
 {
-  return ntag424_MAC(ntag424_Session.session_key_mac, cmd, cmdheader,
-                     cmdheader_length, cmddata, cmddata_length, signature);
+  return ntag424_MAC(NULL, cmd, cmdheader, cmdheader_length, cmddata,
+                     cmddata_length, signature);
 }
 
 /**************************************************************************/
 /*!
     @brief   sign the supplied data.
 
-    @param   key              mac-key
+    @param   key              mac-key, NULL uses the session crypto contexts
     @param   cmd              apducmd
     @param   cmdheader        buffer containing the commandheader
     @param   cmdheader_length length of commandheader
@@ -2021,10 +2519,17 @@ uint8_t Adafruit_PN532::ntag424_MAC(uint8_t *key, uint8_t *cmd,
   PN532DEBUGPRINT.print(F("mesg: padded: "));
   Adafruit_PN532::PrintHexChar(mesg, msglen);
 #endif
-  Adafruit_PN532::ntag424_cmac_short(key, mesg, msglen, signature);
-  return 0;
-}
-
+  if (key == NULL)
+  {
+    Adafruit_PN532::ntag424_session_cmac_short(mesg, msglen, signature);
+  }
+  else
+  {
+    Adafruit_PN532::ntag424_cmac_short(key, mesg, msglen, signature);
+  }
+  return 0;
+}
+
 /**************************************************************************/
 /*!
     @brief   derive sessionskeys from RndA and RNDB.
@@ -2104,6 +2609,253 @@ void Adafruit_PN532::ntag424_derive_session_keys(uint8_t *key, uint8_t *RndA,
   Adafruit_PN532::PrintHexChar(ntag424_Session.session_key_enc,
                                NTAG424_SESSION_KEYSIZE);
 #endif
+
+  Adafruit_PN532::ntag424_session_crypto_init();
+}
+
+/**************************************************************************/
+/*!
+    @brief   expand the session keys once so secure messaging doesn't run a
+             key schedule and allocate a cipher context for every APDU.
+             On the ESP32 targets mbedtls_aes_* is backed by the AES
+             peripheral.
+
+    @return  true if all contexts are keyed
+*/
+/**************************************************************************/
+bool Adafruit_PN532::ntag424_session_crypto_init()
+{
+  Adafruit_PN532::ntag424_session_crypto_free();
+
+  mbedtls_aes_init(&ntag424_SessionCrypto.aes_enc);
+  mbedtls_aes_init(&ntag424_SessionCrypto.aes_dec);
+  mbedtls_cipher_init(&ntag424_SessionCrypto.cmac);
+
+  bool ok =
+      mbedtls_aes_setkey_enc(&ntag424_SessionCrypto.aes_enc,
+                             ntag424_Session.session_key_enc, 128) == 0 &&
+      mbedtls_aes_setkey_dec(&ntag424_SessionCrypto.aes_dec,
+                             ntag424_Session.session_key_enc, 128) == 0 &&
+      mbedtls_cipher_setup(
+          &ntag424_SessionCrypto.cmac,
+          mbedtls_cipher_info_from_type(MBEDTLS_CIPHER_AES_128_ECB)) == 0 &&
+      mbedtls_cipher_cmac_starts(&ntag424_SessionCrypto.cmac,
+                                 ntag424_Session.session_key_mac, 128) == 0;
+
+  if (!ok)
+  {
+#ifdef NTAG424DEBUG
+    PN532DEBUGPRINT.println(F("could not set up session crypto"));
+#endif
+    Adafruit_PN532::ntag424_session_crypto_free();
+    return false;
+  }
+
+  ntag424_SessionCrypto.ready = true;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief   release the session crypto contexts.
+*/
+/**************************************************************************/
+void Adafruit_PN532::ntag424_session_crypto_free()
+{
+  if (!ntag424_SessionCrypto.ready)
+  {
+    return;
+  }
+  mbedtls_aes_free(&ntag424_SessionCrypto.aes_enc);
+  mbedtls_aes_free(&ntag424_SessionCrypto.aes_dec);
+  mbedtls_cipher_free(&ntag424_SessionCrypto.cmac);
+  ntag424_SessionCrypto.ready = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief   calculate the secure messaging iv for the current cmd_counter.
+             E(SesAuthENCKey, label TI CmdCtr 00..) is a single ecb block.
+
+    @param   label0   0xA5 for commands, 0x5A for responses
+    @param   label1   0x5A for commands, 0xA5 for responses
+    @param   iv       outputbuffer (16 bytes)
+
+    @return
+*/
+/**************************************************************************/
+uint8_t Adafruit_PN532::ntag424_session_iv(uint8_t label0, uint8_t label1,
+                                           uint8_t *iv)
+{
+  uint8_t block[16];
+  memset(block, 0, sizeof(block));
+  block[0] = label0;
+  block[1] = label1;
+  memcpy(block + 2, ntag424_authresponse_TI, NTAG424_AUTHRESPONSE_TI_SIZE);
+  block[6] = ntag424_Session.cmd_counter & 0xff;
+  block[7] = (ntag424_Session.cmd_counter >> 8) & 0xff;
+
+  if (!ntag424_SessionCrypto.ready)
+  {
+    return Adafruit_PN532::ntag424_encrypt(ntag424_Session.session_key_enc,
+                                           sizeof(block), block, iv);
+  }
+  return mbedtls_aes_crypt_ecb(&ntag424_SessionCrypto.aes_enc,
+                               MBEDTLS_AES_ENCRYPT, block, iv) == 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief   encrypt with SesAuthENCKey, aes 128 cbc.
+
+    @param   iv     initialization vector, updated like mbedtls does
+    @param   length sizeof input, multiple of 16
+    @param   input  inputbuffer
+    @param   output outputbuffer
+
+    @return
+*/
+/**************************************************************************/
+uint8_t Adafruit_PN532::ntag424_session_encrypt(uint8_t *iv, uint8_t length,
+                                                uint8_t *input,
+                                                uint8_t *output)
+{
+  if (!ntag424_SessionCrypto.ready)
+  {
+    return Adafruit_PN532::ntag424_encrypt(ntag424_Session.session_key_enc, iv,
+                                           length, input, output);
+  }
+  return mbedtls_aes_crypt_cbc(&ntag424_SessionCrypto.aes_enc,
+                               MBEDTLS_AES_ENCRYPT, length, iv, input,
+                               output) == 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief   decrypt with SesAuthENCKey, aes 128 cbc.
+
+    @param   iv     initialization vector, updated like mbedtls does
+    @param   length sizeof input, multiple of 16
+    @param   input  inputbuffer
+    @param   output outputbuffer
+
+    @return
+*/
+/**************************************************************************/
+uint8_t Adafruit_PN532::ntag424_session_decrypt(uint8_t *iv, uint8_t length,
+                                                uint8_t *input,
+                                                uint8_t *output)
+{
+  if (!ntag424_SessionCrypto.ready)
+  {
+    return Adafruit_PN532::ntag424_decrypt(ntag424_Session.session_key_enc, iv,
+                                           length, input, output);
+  }
+  return mbedtls_aes_crypt_cbc(&ntag424_SessionCrypto.aes_dec,
+                               MBEDTLS_AES_DECRYPT, length, iv, input,
+                               output) == 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief   short cmac with SesAuthMACKey, reusing the keyed cmac context.
+
+    @param   input  inputbuffer
+    @param   length length of inputbuffer
+    @param   cmac   outputbuffer (>=8 bytes)
+
+    @return
+*/
+/**************************************************************************/
+uint8_t Adafruit_PN532::ntag424_session_cmac_short(uint8_t *input,
+                                                   uint8_t length,
+                                                   uint8_t *cmac)
+{
+  if (!ntag424_SessionCrypto.ready)
+  {
+    return Adafruit_PN532::ntag424_cmac_short(ntag424_Session.session_key_mac,
+                                              input, length, cmac);
+  }
+
+  uint8_t regularcmac[16];
+  mbedtls_cipher_cmac_reset(&ntag424_SessionCrypto.cmac);
+  mbedtls_cipher_cmac_update(&ntag424_SessionCrypto.cmac, input, length);
+  mbedtls_cipher_cmac_finish(&ntag424_SessionCrypto.cmac, regularcmac);
+
+  uint8_t c = 0;
+  for (int i = 1; i < 16; i += 2)
+  {
+    cmac[c] = regularcmac[i];
+    c++;
+  }
+  return 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief   print the crypto cost of one CommMode.Full APDU (command iv,
+             32 byte payload encryption, command mac, response mac, response
+             iv and decryption) with per call contexts and with the session
+             contexts. Uses the current session keys, no card needed.
+
+    @param   iterations   number of simulated APDUs per variant
+*/
+/**************************************************************************/
+void Adafruit_PN532::ntag424_crypto_benchmark(uint16_t iterations)
+{
+  if (iterations == 0)
+  {
+    return;
+  }
+
+  uint8_t block[16] = {0xA5, 0x5A};
+  uint8_t iv[16];
+  uint8_t payload[32] = {0};
+  uint8_t encrypted[32];
+  uint8_t mesg[48] = {0};
+  uint8_t mac[8];
+
+  unsigned long started_at = micros();
+  for (uint16_t i = 0; i < iterations; i++)
+  {
+    ntag424_encrypt(ntag424_Session.session_key_enc, sizeof(block), block, iv);
+    ntag424_encrypt(ntag424_Session.session_key_enc, iv, sizeof(payload),
+                    payload, encrypted);
+    ntag424_cmac_short(ntag424_Session.session_key_mac, mesg, sizeof(mesg),
+                       mac);
+    ntag424_cmac_short(ntag424_Session.session_key_mac, mesg, 16, mac);
+    ntag424_encrypt(ntag424_Session.session_key_enc, sizeof(block), block, iv);
+    ntag424_decrypt(ntag424_Session.session_key_enc, iv, sizeof(encrypted),
+                    encrypted, payload);
+  }
+  unsigned long per_call_us = (micros() - started_at) / iterations;
+
+  bool was_ready = ntag424_SessionCrypto.ready;
+  if (!was_ready)
+  {
+    ntag424_session_crypto_init();
+  }
+
+  started_at = micros();
+  for (uint16_t i = 0; i < iterations; i++)
+  {
+    ntag424_session_iv(0xA5, 0x5A, iv);
+    ntag424_session_encrypt(iv, sizeof(payload), payload, encrypted);
+    ntag424_session_cmac_short(mesg, sizeof(mesg), mac);
+    ntag424_session_cmac_short(mesg, 16, mac);
+    ntag424_session_iv(0x5A, 0xA5, iv);
+    ntag424_session_decrypt(iv, sizeof(encrypted), encrypted, payload);
+  }
+  unsigned long session_us = (micros() - started_at) / iterations;
+
+  if (!was_ready)
+  {
+    ntag424_session_crypto_free();
+  }
+
+  PN532DEBUGPRINT.printf(
+      "[NTAG424] crypto per APDU: per call contexts %luus, session %luus\n",
+      per_call_us, session_us);
 }
 
 /**************************************************************************/
@@ -2172,7 +2924,10 @@ uint8_t Adafruit_PN532::ntag424_rotl(uint8_t *input, uint8_t *output,
 }
 
 /*!
-    @brief   Authenticate to start encrypted or signed communication.
+    @brief   Authenticate to start encrypted or signed communication. While
+   ntag424_AppSelected is set the ISOSelectFile of the application is
+   skipped, if the card turns out to have lost the selection the
+   authentication starts over with it.
 
     @param   key      encryption key
     @param   keyno   number of key to authenticate against (0-4)
@@ -2185,60 +2940,95 @@ uint8_t Adafruit_PN532::ntag424_rotl(uint8_t *input, uint8_t *output,
 uint8_t Adafruit_PN532::ntag424_Authenticate(uint8_t *key, uint8_t keyno,
                                              uint8_t cmd)
 {
+  uint8_t result = NTAG424_AUTH_REJECTED;
+  if (ntag424_AppSelected)
+  {
+    result = Adafruit_PN532::ntag424_AuthenticateFirst(key, keyno, cmd, false);
+  }
+  // A wrong key fails after part 1, retrying would only add to the failed
+  // authentication delay of the card
+  if (result == NTAG424_AUTH_REJECTED)
+  {
+    result = Adafruit_PN532::ntag424_AuthenticateFirst(key, keyno, cmd, true);
+  }
+  ntag424_AppSelected = result != NTAG424_AUTH_REJECTED;
+  return result == NTAG424_AUTH_OK;
+}
+
+/*!
+    @brief   AuthenticateEV2First, optionally preceded by the ISOSelectFile of
+   the NTAG424 application.
+
+    @param   key      encryption key
+    @param   keyno    number of key to authenticate against (0-4)
+    @param   cmd      0x71 or 0x77
+    @param   select   send ISOSelectFile first
+
+    @return  NTAG424_AUTH_OK, NTAG424_AUTH_FAILED or NTAG424_AUTH_REJECTED if
+   the selection or part 1 failed
+*/
+/**************************************************************************/
+uint8_t Adafruit_PN532::ntag424_AuthenticateFirst(uint8_t *key, uint8_t keyno,
+                                                  uint8_t cmd, bool select)
+{
 
 #ifdef NTAG424DEBUG
   PN532DEBUGPRINT.print(F("Authenticating with key: "));
   PN532DEBUGPRINT.println((char *)key);
 #endif
 
-// 1.) IsoSelectFile
-#ifdef NTAG424DEBUG
-  PN532DEBUGPRINT.println(F("1.) ISOSelectFile"));
-#endif
-  int cmd_len = 15;
-  uint8_t cmd_select[cmd_len] = {PN532_COMMAND_INDATAEXCHANGE,
-                                 0x01,
-                                 0x00,
-                                 0xA4,
-                                 0x04,
-                                 0x00,
-                                 0x07,
-                                 0xD2,
-                                 0x76,
-                                 0x00,
-                                 0x00,
-                                 0x85,
-                                 0x01,
-                                 0x01,
-                                 0x00};
-  /* Prepare the command */
-  /* Send the command */
-  if (!sendCommandCheckAck((uint8_t *)cmd_select, cmd_len))
+  int cmd_len;
+  if (select)
   {
+    // 1.) IsoSelectFile
 #ifdef NTAG424DEBUG
-    PN532DEBUGPRINT.println(F("Failed to receive ACK for write command"));
+    PN532DEBUGPRINT.println(F("1.) ISOSelectFile"));
+#endif
+    cmd_len = 15;
+    uint8_t cmd_select[cmd_len] = {PN532_COMMAND_INDATAEXCHANGE,
+                                   0x01,
+                                   0x00,
+                                   0xA4,
+                                   0x04,
+                                   0x00,
+                                   0x07,
+                                   0xD2,
+                                   0x76,
+                                   0x00,
+                                   0x00,
+                                   0x85,
+                                   0x01,
+                                   0x01,
+                                   0x00};
+    /* Prepare the command */
+    /* Send the command */
+    if (!sendCommandCheckAck((uint8_t *)cmd_select, cmd_len))
+    {
+#ifdef NTAG424DEBUG
+      PN532DEBUGPRINT.println(F("Failed to receive ACK for write command"));
 #endif
-    return 0;
-  }
-  /* Read the response packet */
-  readdata(pn532_packetbuffer, 26);
+      return NTAG424_AUTH_REJECTED;
+    }
+    /* Read the response packet */
+    readdata(pn532_packetbuffer, 26);
 #ifdef NTAG424DEBUG
-  PN532DEBUGPRINT.print(F("CMD: "));
-  Adafruit_PN532::PrintHexChar(cmd_select, cmd_len);
-  PN532DEBUGPRINT.println(strlen((char *)cmd_select));
-  PN532DEBUGPRINT.print(F("Received: "));
-  Adafruit_PN532::PrintHexChar(pn532_packetbuffer, 26);
+    PN532DEBUGPRINT.print(F("CMD: "));
+    Adafruit_PN532::PrintHexChar(cmd_select, cmd_len);
+    PN532DEBUGPRINT.println(strlen((char *)cmd_select));
+    PN532DEBUGPRINT.print(F("Received: "));
+    Adafruit_PN532::PrintHexChar(pn532_packetbuffer, 26);
 #endif
 
-  /* If byte 8 isn't 0x00 we probably have an error, also byte 8 & 9 should be
-   * 0x9000 */
-  if (pn532_packetbuffer[7] != 0x00 || pn532_packetbuffer[8] != 0x90 ||
-      pn532_packetbuffer[9] != 0x00)
-  {
+    /* If byte 8 isn't 0x00 we probably have an error, also byte 8 & 9 should be
+     * 0x9000 */
+    if (pn532_packetbuffer[7] != 0x00 || pn532_packetbuffer[8] != 0x90 ||
+        pn532_packetbuffer[9] != 0x00)
+    {
 #ifdef NTAG424DEBUG
-    PN532DEBUGPRINT.println(F("ISOSelectFile ResultError"));
+      PN532DEBUGPRINT.println(F("ISOSelectFile ResultError"));
 #endif
-    return 0;
+      return NTAG424_AUTH_REJECTED;
+    }
   }
 
 // 2.) AuthenticateFirst part 1
@@ -2266,7 +3056,7 @@ uint8_t Adafruit_PN532::ntag424_Authenticate(uint8_t *key, uint8_t keyno,
 #ifdef NTAG424DEBUG
     PN532DEBUGPRINT.println(F("Failed to receive ACK for write command"));
 #endif
-    return 0;
+    return NTAG424_AUTH_REJECTED;
   }
   /* Read the response packet */
   readdata(pn532_packetbuffer, 26);
@@ -2285,7 +3075,7 @@ uint8_t Adafruit_PN532::ntag424_Authenticate(uint8_t *key, uint8_t keyno,
 #ifdef NTAG424DEBUG
     PN532DEBUGPRINT.println(F("AuthenticateFirst part 1 ResultError"));
 #endif
-    return 0;
+    return NTAG424_AUTH_REJECTED;
   }
 
   /*
@@ -2309,7 +3099,7 @@ uint8_t Adafruit_PN532::ntag424_Authenticate(uint8_t *key, uint8_t keyno,
   {
 #ifdef NTAG424DEBUG
     PN532DEBUGPRINT.println(F("Decryption error"));
-    return 0;
+    return NTAG424_AUTH_FAILED;
 #endif
   }
   memset(RndBRotl, 0, sizeof(RndBRotl));
@@ -2353,7 +3143,7 @@ uint8_t Adafruit_PN532::ntag424_Authenticate(uint8_t *key, uint8_t keyno,
 #ifdef NTAG424DEBUG
     PN532DEBUGPRINT.println(F("Failed to receive ACK for write command"));
 #endif
-    return 0;
+    return NTAG424_AUTH_FAILED;
   }
   /* Read the response packet */
   readdata(pn532_packetbuffer, 42);
@@ -2370,7 +3160,7 @@ uint8_t Adafruit_PN532::ntag424_Authenticate(uint8_t *key, uint8_t keyno,
     PN532DEBUGPRINT.println(F("AuthenticateFirst part 2 ResultError"));
     Adafruit_PN532::PrintHexChar(&pn532_packetbuffer[8], 2);
 #endif
-    return 0;
+    return NTAG424_AUTH_FAILED;
   }
 
   // decrypt the response
@@ -2436,7 +3226,7 @@ uint8_t Adafruit_PN532::ntag424_Authenticate(uint8_t *key, uint8_t keyno,
   */
   Adafruit_PN532::ntag424_derive_session_keys(key, RndA, RndB);
   // Return OK signal
-  return 1;
+  return NTAG424_AUTH_OK;
 }
 
 /*!
@@ -2478,15 +3268,15 @@ uint8_t Adafruit_PN532::ntag424_GetFileSettings(uint8_t fileno, uint8_t *buffer,
     @param   filesettings           buffer with encoded filesettings
     @param   filesettings_length    size of filesettings buffer
     @param   comm_mode    one off NTAG424_COMM_MODE_PLAIN, NTAG424_COMM_MODE_MAC
-   or NTAG424_COMM_MODE_FULL
+   or NTAG424_COMM_MODE_FULL, the card only accepts NTAG424_COMM_MODE_FULL
 
-    @return  length of result
+    @return  false=fail|true=success
 */
 /**************************************************************************/
-uint8_t Adafruit_PN532::ntag424_ChangeFileSettings(uint8_t fileno,
-                                                   uint8_t *filesettings,
-                                                   uint8_t filesettings_length,
-                                                   uint8_t comm_mode)
+bool Adafruit_PN532::ntag424_ChangeFileSettings(uint8_t fileno,
+                                                uint8_t *filesettings,
+                                                uint8_t filesettings_length,
+                                                uint8_t comm_mode)
 {
   uint8_t cmac_short[8];
   uint8_t cla[1] = {NTAG424_COM_CLA};
@@ -2499,8 +3289,8 @@ uint8_t Adafruit_PN532::ntag424_ChangeFileSettings(uint8_t fileno,
   uint8_t resultlength = Adafruit_PN532::ntag424_apdu_send(
       cla, ins, p1, p2, cmd_header, sizeof(cmd_header), filesettings,
       filesettings_length, 0, comm_mode, result, sizeof(result));
-  // memcpy(buffer, result, 16);
-  return resultlength;
+  return (resultlength >= 2) && (result[resultlength - 2] == 0x91) &&
+         (result[resultlength - 1] == 0x00);
 }
 
 /*!
@@ -2663,8 +3453,6 @@ uint8_t Adafruit_PN532::ntag424_GetTTStatus(uint8_t *buffer)
     @return  size of status
 */
 /**************************************************************************/
-// Attention: ReadSig crashes currently. Response exceeds
-// sizeof(pn532_packetbuffer). Maybe multiple reads?
 uint8_t Adafruit_PN532::ntag424_ReadSig(uint8_t *buffer)
 {
   uint8_t cmac_short[8];
@@ -2674,7 +3462,8 @@ uint8_t Adafruit_PN532::ntag424_ReadSig(uint8_t *buffer)
   uint8_t p2[1] = {0x0};
   uint8_t cmd_header[1] = {0x00};
   uint8_t cmd_data[1] = {0x00};
-  uint8_t result[58];
+  // 56 byte signature, 8 byte MAC, status
+  uint8_t result[80];
   uint8_t resp_size = Adafruit_PN532::ntag424_apdu_send(
       cla, ins, p1, p2, cmd_header, 0, cmd_data, 1, 0, NTAG424_COMM_MODE_MAC,
       result, sizeof(result));
@@ -2682,6 +3471,89 @@ uint8_t Adafruit_PN532::ntag424_ReadSig(uint8_t *buffer)
   return resp_size;
 }
 
+/*!
+    @brief   Send ReadData request to picc within the current session.
+
+    @param   fileno     fileno to read
+    @param   offset     offset where to start to read from
+    @param   length     number of bytes to read
+    @param   buffer     buffer for the read data (length bytes)
+    @param   comm_mode  NTAG424_COMM_MODE_PLAIN, _MAC or _FULL, has to match
+                        the file settings
+
+    @return  number of bytes read, 0 on error
+*/
+/**************************************************************************/
+uint8_t Adafruit_PN532::ntag424_ReadFile(uint8_t fileno, uint16_t offset,
+                                         uint8_t length, uint8_t *buffer,
+                                         uint8_t comm_mode)
+{
+  uint8_t cla[1] = {NTAG424_COM_CLA};
+  uint8_t ins[1] = {NTAG424_CMD_READDATA};
+  uint8_t p1[1] = {0x0};
+  uint8_t p2[1] = {0x0};
+  uint8_t cmd_header[7] = {fileno,
+                           (uint8_t)(offset & 0xff),
+                           (uint8_t)((offset >> 8) & 0xff),
+                           0x00,
+                           length,
+                           0x00,
+                           0x00};
+  uint8_t result[80];
+
+  uint8_t resp_size = Adafruit_PN532::ntag424_apdu_send(
+      cla, ins, p1, p2, cmd_header, sizeof(cmd_header), NULL, 0, 0, comm_mode,
+      result, sizeof(result));
+
+  // MAC mode keeps the response mac in front of the status
+  uint8_t trailer = comm_mode == NTAG424_COMM_MODE_MAC ? 10 : 2;
+  if ((resp_size < trailer) || (result[resp_size - 2] != 0x91) ||
+      (result[resp_size - 1] != 0x00) || (resp_size - trailer > length))
+  {
+    return 0;
+  }
+  memcpy(buffer, result, resp_size - trailer);
+  return resp_size - trailer;
+}
+
+/*!
+    @brief   Send WriteData request to picc within the current session.
+
+    @param   fileno     fileno to write
+    @param   offset     offset where to start to write
+    @param   data       data to write
+    @param   length     number of bytes to write
+    @param   comm_mode  NTAG424_COMM_MODE_PLAIN, _MAC or _FULL, has to match
+                        the file settings
+
+    @return  true on success
+*/
+/**************************************************************************/
+bool Adafruit_PN532::ntag424_WriteFile(uint8_t fileno, uint16_t offset,
+                                       const uint8_t *data, uint8_t length,
+                                       uint8_t comm_mode)
+{
+  uint8_t cla[1] = {NTAG424_COM_CLA};
+  uint8_t ins[1] = {NTAG424_CMD_WRITEDATA};
+  uint8_t p1[1] = {0x0};
+  uint8_t p2[1] = {0x0};
+  uint8_t cmd_header[7] = {fileno,
+                           (uint8_t)(offset & 0xff),
+                           (uint8_t)((offset >> 8) & 0xff),
+                           0x00,
+                           length,
+                           0x00,
+                           0x00};
+  uint8_t result[32];
+
+  uint8_t resp_size = Adafruit_PN532::ntag424_apdu_send(
+      cla, ins, p1, p2, cmd_header, sizeof(cmd_header), (uint8_t *)data,
+      length, 0, comm_mode, result, sizeof(result));
+
+  return (resp_size >= 2) && (result[resp_size - 2] == 0x91) &&
+         (result[resp_size - 1] == 0x00);
+}
+
 /*!
     @brief   Send ReadData request to picc.
 
@@ -3021,7 +3893,7 @@ bool Adafruit_PN532::ntag424_FormatNDEF()
   uint8_t p1[1] = {0x84};
   uint8_t p2[1] = {0x0};
   uint8_t cmd_header[1] = {0x00};
-  uint8_t ndefdata[PN532_PACKBUFFSIZ - 10];
+  uint8_t ndefdata[NTAG424_ISO_CHUNK_SIZE];
   uint8_t memsize = 248;
   memset(ndefdata, 0, sizeof(ndefdata));
   uint8_t result[12];
@@ -3076,7 +3948,7 @@ bool Adafruit_PN532::ntag424_ISOUpdateBinary(uint8_t *data_to_write,
   uint8_t result[12];
 
   uint8_t offset = 0;
-  uint8_t datalen = PN532_PACKBUFFSIZ - 10;
+  uint8_t datalen = NTAG424_ISO_CHUNK_SIZE;
   for (int i = 0; i < length; i += datalen)
   {
     Serial.print(i);
@@ -3104,6 +3976,10 @@ bool Adafruit_PN532::ntag424_ISOUpdateBinary(uint8_t *data_to_write,
   return true;
 }
 
+// ISO-7816-4 dedicated filename of the NTAG424 application
+static const uint8_t NTAG424_APPLICATION_DFN[7] = {0xD2, 0x76, 0x00, 0x00,
+                                                   0x85, 0x01, 0x01};
+
 /*!
     @brief   select file by fileid for the following commands.
 
@@ -3131,6 +4007,8 @@ bool Adafruit_PN532::ntag424_ISOSelectFileById(int fileid)
                                     sizeof(result)
 
   );
+  // Could have selected a file outside the application
+  ntag424_AppSelected = false;
   if ((result[0] != 0x90) || (result[1] != 0x00))
   {
     return false;
@@ -3164,48 +4042,29 @@ bool Adafruit_PN532::ntag424_ISOSelectFileByDFN(uint8_t *dfn)
                                     sizeof(result));
   if ((result[0] != 0x90) || (result[1] != 0x00))
   {
+    ntag424_AppSelected = false;
     return false;
   }
+  ntag424_AppSelected = memcmp(dfn, NTAG424_APPLICATION_DFN, 7) == 0;
   return true;
 }
 
 /*!
     @brief   read the default ISO-7816-4 dedicated file / read the tag for
-   example ndef-data.
+   example ndef-data. Returns the payload of the first NDEF record, which for
+   a short URI record starts with the URI prefix byte. Leaves the NTAG424
+   application selected.
 
-    @param   buffer     response buffer
+    @param   buffer       response buffer
+    @param   buffersize   size of buffer, longer files are not read
 
-    @return  datasize
+    @return  datasize, 0 on fail
 */
 /**************************************************************************/
-uint8_t Adafruit_PN532::ntag424_ISOReadFile(uint8_t *buffer)
+uint8_t Adafruit_PN532::ntag424_ISOReadFile(uint8_t *buffer,
+                                            uint8_t buffersize)
 {
-  // uint16_t filesize =  Adafruit_PN532::ntag424_GetFileSize(buffer);
 #ifdef NTAG424DEBUG
-  PN532DEBUGPRINT.println(F("ISOGetFileSettings"));
-#endif
-  // call getfilesettings
-  /* Prepare the command */
-  pn532_packetbuffer[0] = PN532_COMMAND_INDATAEXCHANGE;
-  pn532_packetbuffer[1] = 1; /* Card number */
-  pn532_packetbuffer[2] = NTAG424_COM_CLA;
-  pn532_packetbuffer[3] = NTAG424_CMD_GETFILESETTINGS;
-  pn532_packetbuffer[4] = 0x0;
-  pn532_packetbuffer[5] = 0x0;
-  pn532_packetbuffer[6] = 0x1;
-  pn532_packetbuffer[7] = 0x2;
-  pn532_packetbuffer[8] = 0x0;
-  /* Send the command */
-  if (!sendCommandCheckAck(pn532_packetbuffer, 9))
-  {
-#ifdef NTAG424DEBUG
-    PN532DEBUGPRINT.println(F("Failed to receive ACK for write command"));
-#endif
-    return 0;
-  }
-  readdata(pn532_packetbuffer, 26);
-#ifdef NTAG424DEBUG
-  Adafruit_PN532::PrintHexChar(pn532_packetbuffer, 26);
   PN532DEBUGPRINT.println(F("ISOReadFile"));
   PN532DEBUGPRINT.println(F("ISOSelectFile1"));
 #endif
@@ -3290,8 +4149,11 @@ uint8_t Adafruit_PN532::ntag424_ISOReadFile(uint8_t *buffer)
     PN532DEBUGPRINT.println(F("Error while selecting iso-file 2"));
     Adafruit_PN532::PrintHexChar(pn532_packetbuffer, 26);
 #endif
+    ntag424_AppSelected = false;
     return 0;
   }
+  // The NDEF file lies within the application
+  ntag424_AppSelected = true;
 #ifdef NTAG424DEBUG
   PN532DEBUGPRINT.println(F("ISOReadBinary1 to get the filesize"));
 #endif
@@ -3315,7 +4177,16 @@ uint8_t Adafruit_PN532::ntag424_ISOReadFile(uint8_t *buffer)
   }
   /* Read the response packet */
   readdata(pn532_packetbuffer, 26);
+  // NLEN minus the short record header, the payload starts at file offset 7
   int filesize = (int)pn532_packetbuffer[9] - 5;
+  if (pn532_packetbuffer[7] != 0x00 || pn532_packetbuffer[8] != 0x00 ||
+      filesize <= 0 || filesize > buffersize)
+  {
+#ifdef NTAG424DEBUG
+    PN532DEBUGPRINT.println(F("No NDEF record that fits the buffer"));
+#endif
+    return 0;
+  }
 
 #ifdef NTAG424DEBUG
   PN532DEBUGPRINT.print("filesize: ");
@@ -3324,7 +4195,7 @@ uint8_t Adafruit_PN532::ntag424_ISOReadFile(uint8_t *buffer)
 #endif
 
   uint8_t pagesize = 32;
-  uint8_t pages = (filesize / pagesize) + 1;
+  uint8_t pages = (filesize + pagesize - 1) / pagesize; // Le 0 would ask for 256 bytes
   uint8_t offset = 0;
 #ifdef NTAG424DEBUG
   PN532DEBUGPRINT.print("pages: ");
@@ -3673,7 +4544,13 @@ bool Adafruit_PN532::readack()
 /**************************************************************************/
 bool Adafruit_PN532::isready()
 {
-  if (spi_dev)
+  if (_irq != -1 && !ser_dev)
+  {
+    // IRQ is a plain GPIO read, no bus transaction required
+    uint8_t x = digitalRead(_irq);
+    return x == 0;
+  }
+  else if (spi_dev)
   {
     // SPI ready check via Status Request
     uint8_t cmd = PN532_SPI_STATREAD;
@@ -3685,6 +4562,7 @@ bool Adafruit_PN532::isready()
   {
     // I2C ready check via reading RDY byte
     uint8_t rdy[1];
+    I2CBusLock lock(I2C_DEVICE_NFC);
     i2c_dev->read(rdy, 1);
     return rdy[0] == PN532_I2C_READY;
   }
@@ -3693,11 +4571,6 @@ bool Adafruit_PN532::isready()
     // Serial ready check based on non-zero read buffer
     return (ser_dev->available() != 0);
   }
-  else if (_irq != -1)
-  {
-    uint8_t x = digitalRead(_irq);
-    return x == 0;
-  }
   return false;
 }
 
@@ -3710,21 +4583,20 @@ bool Adafruit_PN532::isready()
 /**************************************************************************/
 bool Adafruit_PN532::waitready(uint16_t timeout)
 {
-  uint16_t timer = 0;
+  // Poll with 1ms granularity instead of 10ms steps, the PN532 usually
+  // answers within a few milliseconds and delay() still yields to the
+  // other FreeRTOS tasks.
+  unsigned long started_at = millis();
   while (!isready())
   {
-    if (timeout != 0)
+    if (timeout != 0 && millis() - started_at > timeout)
     {
-      timer += 10;
-      if (timer > timeout)
-      {
 #ifdef PN532DEBUG
-        PN532DEBUGPRINT.println("TIMEOUT!");
+      PN532DEBUGPRINT.println("TIMEOUT!");
 #endif
-        return false;
-      }
+      return false;
     }
-    delay(10);
+    delay(1);
   }
   return true;
 }
@@ -3749,7 +4621,10 @@ void Adafruit_PN532::readdata(uint8_t *buff, uint8_t n)
   {
     // I2C read
     uint8_t rbuff[n + 1]; // +1 for leading RDY byte
-    i2c_dev->read(rbuff, n + 1);
+    {
+      I2CBusLock lock(I2C_DEVICE_NFC);
+      i2c_dev->read(rbuff, n + 1);
+    }
     for (uint8_t i = 0; i < n; i++)
     {
       buff[i] = rbuff[i + 1];
@@ -3875,6 +4750,31 @@ uint8_t Adafruit_PN532::setDataTarget(uint8_t *cmd, uint8_t cmdlen)
   return (pn532_packetbuffer[offset] == 0x15);
 }
 
+/**************************************************************************/
+/*!
+    @brief  Writes a raw ACK frame to the PN532, which aborts the command
+            currently being processed.
+*/
+/**************************************************************************/
+void Adafruit_PN532::writeack()
+{
+  if (spi_dev)
+  {
+    uint8_t packet[7] = {PN532_SPI_DATAWRITE};
+    memcpy(packet + 1, pn532ack, sizeof(pn532ack));
+    spi_dev->write(packet, sizeof(packet));
+  }
+  else if (i2c_dev)
+  {
+    I2CBusLock lock(I2C_DEVICE_NFC);
+    i2c_dev->write(pn532ack, sizeof(pn532ack));
+  }
+  else if (ser_dev)
+  {
+    ser_dev->write(pn532ack, sizeof(pn532ack));
+  }
+}
+
 /**************************************************************************/
 /*!
     @brief  Writes a command to the PN532, automatically inserting the
@@ -3973,6 +4873,7 @@ void Adafruit_PN532::writecommand(uint8_t *cmd, uint8_t cmdlen)
 
     if (i2c_dev)
     {
+      I2CBusLock lock(I2C_DEVICE_NFC);
       i2c_dev->write(packet, 8 + cmdlen);
     }
     else
@@ -65,6 +65,10 @@
 
 #define PN532_RESPONSE_INDATAEXCHANGE (0x41)      ///< Data exchange
 #define PN532_RESPONSE_INLISTPASSIVETARGET (0x4B) ///< List passive target
+#define PN532_RESPONSE_INAUTOPOLL (0x61)          ///< Auto poll
+#define PN532_RESPONSE_DIAGNOSE (0x01)            ///< Diagnose
+
+#define PN532_DIAGNOSE_ATTENTION_REQUEST (0x06) ///< Card presence test
 
 #define PN532_WAKEUP (0x55) ///< Wake
 
@@ -81,6 +85,37 @@
 
 #define PN532_MIFARE_ISO14443A (0x00) ///< MiFare
 
+// InAutoPoll target types (user manual 7.3.13)
+#define PN532_AUTOPOLL_GENERIC_106 (0x00)  ///< ISO14443-4A, Mifare, DEP 106 kbps
+#define PN532_AUTOPOLL_GENERIC_212 (0x01)  ///< FeliCa, DEP 212 kbps
+#define PN532_AUTOPOLL_GENERIC_424 (0x02)  ///< FeliCa, DEP 424 kbps
+#define PN532_AUTOPOLL_ISO14443B (0x03)    ///< ISO14443-4B 106 kbps
+#define PN532_AUTOPOLL_JEWEL (0x04)        ///< Innovision Jewel
+#define PN532_AUTOPOLL_MIFARE (0x10)       ///< Mifare card
+#define PN532_AUTOPOLL_FELICA_212 (0x11)   ///< FeliCa 212 kbps
+#define PN532_AUTOPOLL_FELICA_424 (0x12)   ///< FeliCa 424 kbps
+#define PN532_AUTOPOLL_ISO14443_4A (0x20)  ///< ISO14443-4A 106 kbps
+#define PN532_AUTOPOLL_ISO14443_4B (0x23)  ///< ISO14443-4B 106 kbps
+#define PN532_AUTOPOLL_MAX_TYPES (15)      ///< Types accepted per InAutoPoll
+#define PN532_AUTOPOLL_ENDLESS (0xFF)      ///< Poll until a target is found
+#define PN532_AUTOPOLL_PERIOD_150MS (0x01) ///< Period unit is 150 ms
+
+#define PN532_PRESENCE_ATTENTION (0x00) ///< Diagnose attention request, ISO-DEP only
+#define PN532_PRESENCE_READ (0x01)      ///< Type 2 READ of page 0, Ultralight/NTAG21x
+#define PN532_PRESENCE_RESELECT (0x02)  ///< InListPassiveTarget, e.g. Mifare Classic
+
+#define PN532_MAX_UID_LENGTH (10) ///< Triple size ISO14443A UID
+#define PN532_MAX_ATS_LENGTH (20) ///< ATS bytes kept, including TL
+
+// Asynchronous transport states
+#define PN532_TRANSPORT_IDLE (0)           ///< No command in flight
+#define PN532_TRANSPORT_WAIT_ACK (1)       ///< Command written, waiting for ACK
+#define PN532_TRANSPORT_WAIT_RESPONSE (2)  ///< ACK received, waiting for response
+#define PN532_TRANSPORT_RESPONSE_READY (3) ///< Response can be read
+#define PN532_TRANSPORT_ERROR (4)          ///< Missing ACK or timeout
+
+#define PN532_LATENCY_SLOTS (8) ///< Number of commands tracked for latency stats
+
 // NTAG242 Commands
 #define NTAG424_COMM_MODE_PLAIN (0x00)        ///< Commmode plain
 #define NTAG424_COMM_MODE_MAC (0x01)          ///< Commmode mac
@@ -105,6 +140,11 @@
 #define NTAG424_CMD_ISOREADBINARY (0xB0)   ///< ISOReadBinary
 #define NTAG424_CMD_ISOUPDATEBINARY (0xD6) ///< ISOUpdateBinary
 
+// ntag424_AuthenticateFirst() results
+#define NTAG424_AUTH_FAILED (0)   ///< Authentication failed after part 1
+#define NTAG424_AUTH_OK (1)       ///< Session established
+#define NTAG424_AUTH_REJECTED (2) ///< Selection or part 1 failed
+
 // Mifare Commands
 #define MIFARE_CMD_AUTH_A (0x60)           ///< Auth A
 #define MIFARE_CMD_AUTH_B (0x61)           ///< Auth B
@@ -162,6 +202,15 @@
 #define PN532_GPIO_P34 (4)              ///< GPIO 34
 #define PN532_GPIO_P35 (5)              ///< GPIO 35
 
+/// Activation data of a detected ISO14443A target
+struct PN532_TargetInfo
+{
+  uint16_t atqa;                     ///< SENS_RES
+  uint8_t sak;                       ///< SEL_RES
+  uint8_t ats[PN532_MAX_ATS_LENGTH]; ///< ATS starting with TL, ISO14443-4 only
+  uint8_t atsLength;                 ///< 0 if the target sent no ATS
+};
+
 /**
  * @brief Class for working with Adafruit PN532 NFC/RFID breakout boards.
  */
@@ -188,15 +237,38 @@ public:
   uint8_t readGPIO(void);
   bool setPassiveActivationRetries(uint8_t maxRetries);
 
+  // Asynchronous transport: submit a command and poll for its completion
+  // instead of blocking in waitready()
+  bool startCommand(uint8_t *cmd, uint8_t cmdlen, uint16_t timeout = 1000);
+  uint8_t pollCommand(void);
+  void readResponse(uint8_t *buff, uint8_t n);
+  void abortCommand(void);
+  uint8_t commandState(void) { return _cmdState; }
+  void printLatencyStats(void);
+
   // ISO14443A functions
   bool readPassiveTargetID(
       uint8_t cardbaudrate, uint8_t *uid, uint8_t *uidLength,
       uint16_t timeout = 0); // timeout 0 means no timeout - will block forever.
   bool startPassiveTargetIDDetection(uint8_t cardbaudrate);
-  bool readDetectedPassiveTargetID(uint8_t *uid, uint8_t *uidLength);
+  bool readDetectedPassiveTargetID(uint8_t *uid, uint8_t *uidLength,
+                                   PN532_TargetInfo *info = NULL);
   bool inDataExchange(uint8_t *send, uint8_t sendLength, uint8_t *response,
                       uint8_t *responseLength);
   bool inListPassiveTarget();
+
+  // Autonomous detection, the PN532 polls the field until a target shows up
+  bool startAutoPoll(const uint8_t *types, uint8_t numTypes,
+                     uint8_t pollNr = PN532_AUTOPOLL_ENDLESS,
+                     uint8_t period = PN532_AUTOPOLL_PERIOD_150MS);
+  bool readAutoPollTarget(uint8_t *type, uint8_t *uid, uint8_t *uidLength,
+                          PN532_TargetInfo *info = NULL);
+
+  // Presence check of the inlisted target, the method depends on the card
+  static uint8_t presenceMethod(uint8_t type, uint8_t sak);
+  bool startPresenceCheck(uint8_t method = PN532_PRESENCE_ATTENTION,
+                          uint16_t timeout = 100);
+  bool readPresenceCheck(const uint8_t *uid = NULL, uint8_t uidLength = 0);
   uint8_t AsTarget();
   uint8_t getDataTarget(uint8_t *cmd, uint8_t *cmdlen);
   uint8_t setDataTarget(uint8_t *cmd, uint8_t cmdlen);
@@ -247,9 +319,25 @@ public:
                       uint8_t cmddata_length, uint8_t *signature);
   void ntag424_random(uint8_t *output, uint8_t bytecount);
   void ntag424_derive_session_keys(uint8_t *key, uint8_t *RndA, uint8_t *RndB);
+
+  // Secure messaging with the key schedules of the current session
+  bool ntag424_session_crypto_init();
+  void ntag424_session_crypto_free();
+  uint8_t ntag424_session_iv(uint8_t label0, uint8_t label1, uint8_t *iv);
+  uint8_t ntag424_session_encrypt(uint8_t *iv, uint8_t length, uint8_t *input,
+                                  uint8_t *output);
+  uint8_t ntag424_session_decrypt(uint8_t *iv, uint8_t length, uint8_t *input,
+                                  uint8_t *output);
+  uint8_t ntag424_session_cmac_short(uint8_t *input, uint8_t length,
+                                     uint8_t *cmac);
+  void ntag424_crypto_benchmark(uint16_t iterations);
   uint8_t ntag424_rotl(uint8_t *input, uint8_t *output, uint8_t bufferlen,
                        uint8_t rotation);
   uint8_t ntag424_ReadData(uint8_t *buffer, int fileno, int offset, int size);
+  uint8_t ntag424_ReadFile(uint8_t fileno, uint16_t offset, uint8_t length,
+                           uint8_t *buffer, uint8_t comm_mode);
+  bool ntag424_WriteFile(uint8_t fileno, uint16_t offset, const uint8_t *data,
+                         uint8_t length, uint8_t comm_mode);
   uint8_t ntag424_WriteData(const uint8_t *data, int fileno, int offset, int size, uint8_t keyNo);
   uint8_t ntag424_Authenticate(uint8_t *key, uint8_t keyno, uint8_t cmd);
   uint8_t ntag424_ChangeKey(uint8_t *oldkey, uint8_t *newkey,
@@ -259,10 +347,10 @@ public:
   uint8_t ntag424_GetCardUID(uint8_t *buffer);
   uint8_t ntag424_GetFileSettings(uint8_t fileno, uint8_t *buffer,
                                   uint8_t comm_mode);
-  uint8_t ntag424_ChangeFileSettings(uint8_t fileno, uint8_t *filesettings,
-                                     uint8_t filesettings_length,
-                                     uint8_t comm_mode);
-  uint8_t ntag424_ISOReadFile(uint8_t *buffer);
+  bool ntag424_ChangeFileSettings(uint8_t fileno, uint8_t *filesettings,
+                                  uint8_t filesettings_length,
+                                  uint8_t comm_mode);
+  uint8_t ntag424_ISOReadFile(uint8_t *buffer, uint8_t buffersize = 255);
   bool ntag424_FormatNDEF();
   bool ntag424_ISOUpdateBinary(uint8_t *buffer, uint8_t length);
   bool ntag424_ISOSelectFileById(int fileid);
@@ -310,6 +398,21 @@ public:
   struct ntag424_SessionType
       ntag424_Session; ///< authentication session data are stored here
 
+  bool ntag424_AppSelected = false; ///< NTAG424 application selected in the
+                                    ///< current RF session, authentication
+                                    ///< skips ISOSelectFile
+
+  struct ntag424_SessionCryptoType
+  {
+    bool ready;                    ///< true = contexts below are keyed
+    mbedtls_aes_context aes_enc;   ///< SesAuthENCKey, encryption schedule
+    mbedtls_aes_context aes_dec;   ///< SesAuthENCKey, decryption schedule
+    mbedtls_cipher_context_t cmac; ///< CMAC keyed with SesAuthMACKey
+  }; ///< crypto state kept for the lifetime of an authentication session
+
+  struct ntag424_SessionCryptoType
+      ntag424_SessionCrypto = {}; ///< session crypto contexts
+
   struct ntag424_VersionInfoType
   {
     uint8_t VendorID;       ///< VendorID
@@ -366,15 +469,50 @@ public:
   static void PrintHexChar(const byte *pbtData, const uint32_t numBytes);
 
 private:
+  static void parseTargetInfo(const uint8_t *data, uint8_t length,
+                              PN532_TargetInfo *info);
+  uint8_t ntag424_AuthenticateFirst(uint8_t *key, uint8_t keyno, uint8_t cmd,
+                                    bool select);
+
   int8_t _irq = -1, _reset = -1, _cs = -1;
   int8_t _uid[7];      // ISO14443A uid
   int8_t _uidLen;      // uid len
   int8_t _key[6];      // Mifare Classic key
   int8_t _inListedTag; // Tg number of inlisted tag.
 
+  // Asynchronous transport state
+  uint8_t _cmdState = PN532_TRANSPORT_IDLE;
+  uint8_t _cmdCode = 0;
+  uint16_t _cmdTimeout = 0;
+  unsigned long _cmdStartedAt = 0;   // millis() when the command was written
+  unsigned long _cmdStartedAtUs = 0; // micros() when the command was written
+  volatile bool _irqFired = false;
+  uint8_t _presenceMethod = PN532_PRESENCE_ATTENTION;
+
+  struct PN532_LatencyStat
+  {
+    uint32_t count;    ///< completed commands
+    uint32_t total_us; ///< summed latency
+    uint32_t max_us;   ///< worst latency
+  };
+
+  struct PN532_LatencySlot
+  {
+    uint8_t command;            ///< PN532 command code
+    PN532_LatencyStat blocking; ///< sendCommandCheckAck() path
+    PN532_LatencyStat async;    ///< startCommand()/pollCommand() path
+  };
+
+  PN532_LatencySlot _latency[PN532_LATENCY_SLOTS];
+  uint8_t _latencyUsed = 0;
+  void recordLatency(uint8_t command, bool async, uint32_t us);
+
+  static void IRAM_ATTR handleIrq(void *arg);
+
   // Low level communication functions that handle both SPI and I2C.
   void readdata(uint8_t *buff, uint8_t n);
   void writecommand(uint8_t *cmd, uint8_t cmdlen);
+  void writeack();
   bool isready();
   bool waitready(uint16_t timeout);
   bool readack();
@@ -7,80 +7,43 @@ void API::setup(NFC *nfc)
 
     Serial.println("[API] Setting up...");
 
-    Serial.println("[API] Setup complete.");
-}
-
-bool API::isConfigured()
-{
-    String hostname = Persistence::getSettings().Config.api.hostname;
-    int port = Persistence::getSettings().Config.api.port;
+    this->websocket.setTimeout(API_READ_TIMEOUT_MS);
+    this->connection.setup();
 
-    // Check if hostname is set and not empty
-    if (hostname.length() == 0 || port == 0)
+    this->journal_segment.setup();
+    this->journal.begin();
+    if (this->journal.size() > 0)
     {
-        return false;
+        Serial.println("[API] " + String(this->journal.size()) + " offline events waiting for replay.");
     }
+    this->loadOfflineAuth();
 
-    return true;
+    // Card operations run in NFC::loop(), the responses are sent once they completed
+    this->nfc->setAuthCompleteCallback([this](bool success)
+                                       { this->sendAuthenticateResult(success); });
+    this->nfc->setChangeKeysCompleteCallback([this](bool success, const NFCKeyChange *changes, uint8_t count)
+                                             { this->sendChangeKeysResult(changes, count); });
+
+    Serial.println("[API] Setup complete.");
 }
 
-bool API::checkTCPConnection()
+void API::refreshConfig()
 {
-    String hostname = Persistence::getSettings().Config.api.hostname;
-    int port = Persistence::getSettings().Config.api.port;
-
-    // Only print once per connection attempt
-    if (!is_connecting)
+    if (!Persistence::changedSince(this->config_generation))
     {
-        Serial.println("[API] Checking TCP connection to " + hostname + ":" + String(port));
-        is_connecting = true;
+        return;
     }
 
-    int connectStatus = this->client.connect(
-        hostname.c_str(),
-        port);
+    const ApiConfig &config = Persistence::config().api;
 
-    if (connectStatus == 1)
-    {
-        is_connecting = false;
-        return true;
-    }
-
-    // Only print detailed error if this is a new failure, not repeated failures
-    if (millis() - last_connection_attempt >= connection_retry_interval)
-    {
-        Serial.print("[API] Failed to establish TCP connection. Status: ");
-        Serial.print(connectStatus);
-        Serial.print(" (");
-        switch (connectStatus)
-        {
-        case 0:
-            Serial.print("FAILED");
-            break;
-        case -1:
-            Serial.print("TIMED_OUT");
-            break;
-        case -2:
-            Serial.print("INVALID_SERVER");
-            break;
-        case -3:
-            Serial.print("TRUNCATED");
-            break;
-        case -4:
-            Serial.print("INVALID_RESPONSE");
-            break;
-        case -5:
-            Serial.print("DOMAIN_NOT_FOUND");
-            break;
-        default:
-            Serial.print("UNKNOWN_ERROR");
-            break;
-        }
-        Serial.println(")");
-    }
+    // Check if hostname is set and not empty
+    this->is_configured = config.hostname[0] != '\0' && config.port != 0;
+    this->server_address = String(config.hostname) + ":" + String(config.port) + API_WS_PATH;
+}
 
-    is_connecting = false;
-    return false;
+bool API::isConfigured()
+{
+    return this->is_configured;
 }
 
 bool API::isConnected()
@@ -99,18 +62,19 @@ bool API::isConnected()
         return false;
     }
 
-    this->is_connected = this->websocket.connected();
+    // Attempts run in the background, the backoff between them lives in the manager
+    this->is_connected = this->connection.poll(Persistence::config().api.hostname, Persistence::config().api.port);
 
     if (was_connected != this->is_connected)
     {
         if (!this->is_connected)
         {
-            Serial.println("[API] Socket not connected to server: " + String(Persistence::getSettings().Config.api.hostname) + ":" + String(Persistence::getSettings().Config.api.port) + API_WS_PATH);
+            Serial.println("[API] Socket not connected to server: " + this->server_address);
         }
 
         if (this->is_connected)
         {
-            Serial.println("[API] Socket connected to server: " + String(Persistence::getSettings().Config.api.hostname) + ":" + String(Persistence::getSettings().Config.api.port) + API_WS_PATH);
+            Serial.println("[API] Socket connected to server: " + this->server_address);
         }
     }
 
@@ -118,240 +82,236 @@ bool API::isConnected()
     {
         return true;
     }
-    else
-    {
-        this->display->set_api_connected(false);
-    }
 
+    this->display->set_api_connected(false);
     this->is_authenticated = false;
     this->authentication_sent_at = 0;
     this->registration_sent_at = 0;
+    this->use_msgpack = false;
 
-    // Rate limit connection attempts
-    unsigned long current_time = millis();
-    if (current_time - last_connection_attempt < connection_retry_interval)
-    {
-        return false;
-    }
-
-    last_connection_attempt = current_time;
-
-    bool tcp_connected = this->checkTCPConnection();
-
-    if (!tcp_connected)
+    // Queued messages belong to the lost session, the server would not accept them before
+    // the reader authenticated again
+    if (this->send_queue.size() > 0)
     {
-        this->display->set_api_connected(false);
-        return false;
+        Serial.println("[API] Discarding " + String(this->send_queue.size()) + " queued messages.");
+        this->send_queue.clear();
     }
+    this->send_failed = false;
 
-    Serial.println("[API] Connecting to WebSocket...");
-    this->websocket.protocol = "ws";
-    this->is_connected = this->websocket.connect(
-        Persistence::getSettings().Config.api.hostname,
-        Persistence::getSettings().Config.api.port);
+    this->journal_pending = 0;
+    this->journal_stalled = false;
 
-    if (this->is_connected)
-    {
-        Serial.println("[API] WS connection to " + String(Persistence::getSettings().Config.api.hostname) + ":" + String(Persistence::getSettings().Config.api.port) + " established");
-    }
+    // A job of the lost session must not run on a later tap
+    this->nfc->cancelJob();
 
-    if (!this->is_connected)
+    // Chunks applied so far are useless without the rest of the update
+    if (this->offline_auth.isUpdating())
     {
-        this->display->set_api_connected(false);
+        this->loadOfflineAuth();
     }
 
-    return this->is_connected;
+    return false;
 }
 
-void API::onRegistrationData(JsonObject data)
+void API::onRegistrationData(const RegistrationPayload &payload)
 {
     Serial.println("[API] Received registration response.");
 
-    // Extract and save registration info
-    if (data["payload"].is<JsonObject>())
-    {
-        auto payload = data["payload"].as<JsonObject>();
-        if (payload["id"].is<uint32_t>() && payload["token"].is<String>())
-        {
-            uint32_t readerId = payload["id"].as<uint32_t>();
-            String apiKey = payload["token"].as<String>();
-
-            // Save to persistence
-            PersistSettings<PersistenceData> settings = Persistence::getSettings();
-            settings.Config.api.readerId = readerId;
-            strncpy(settings.Config.api.apiKey, apiKey.c_str(), sizeof(settings.Config.api.apiKey) - 1);
-            settings.Config.api.apiKey[sizeof(settings.Config.api.apiKey) - 1] = '\0'; // Ensure null termination
-            settings.Config.api.has_auth = true;
-            Persistence::saveSettings(settings);
-
-            Serial.print("[API] Reader registered with ID: ");
-            Serial.print(readerId);
-            Serial.print(" and token: ");
-            Serial.println(apiKey);
-        }
-    }
+    // Save to persistence
+    PersistenceData settings = Persistence::getSettings();
+    settings.api.readerId = payload.id;
+    strncpy(settings.api.apiKey, payload.token, sizeof(settings.api.apiKey) - 1);
+    settings.api.apiKey[sizeof(settings.api.apiKey) - 1] = '\0'; // Ensure null termination
+    settings.api.has_auth = true;
+    Persistence::saveSettings(settings);
+
+    // Losing the token to a power cut would register the reader a second time
+    Persistence::flush();
+
+    Serial.print("[API] Reader registered with ID: ");
+    Serial.print(payload.id);
+    Serial.print(" and token: ");
+    Serial.println(payload.token);
 }
 
-void API::onUnauthorized(JsonObject data)
+void API::onUnauthorized(const MessagePayload &payload)
 {
-    String message = "Unknown error";
-    if (data["payload"].is<JsonObject>())
-    {
-        JsonObject payload = data["payload"].as<JsonObject>();
-        if (payload["message"].is<String>() && !payload["message"].isNull())
-        {
-            message = payload["message"].as<String>();
-        }
-    }
-
-    Serial.println("[API] UNAUTHORIZED: " + message);
+    Serial.println("[API] UNAUTHORIZED: " + String(payload.message[0] != '\0' ? payload.message : "Unknown error"));
     this->is_authenticated = false;
     this->authentication_sent_at = 0;
     this->registration_sent_at = 0;
-    PersistSettings<PersistenceData> settings = Persistence::getSettings();
-    settings.Config.api.has_auth = false;
+    PersistenceData settings = Persistence::getSettings();
+    settings.api.has_auth = false;
     Persistence::saveSettings(settings);
     this->display->set_api_connected(false);
+
+    // A reader the server does not know must not keep letting cards in. Repeated
+    // UNAUTHORIZED messages find the set empty and leave the flash alone.
+    if (this->offline_auth.version() != 0 || this->offline_auth.size() > 0)
+    {
+        this->offline_auth.clear();
+        this->offline_auth_file.remove();
+    }
+    this->setOfflineMode(false);
+}
+
+void API::onReaderAuthenticated(const ReaderAuthenticatedPayload &payload)
+{
+    this->is_authenticated = true;
+    this->display->set_api_connected(true);
+    this->display->set_device_name(payload.name);
+    this->use_msgpack = payload.msgpack;
+    Serial.println("[API] Authentication successful, using " + String(this->use_msgpack ? "MessagePack" : "JSON") + ".");
+
+    // Before the messages that follow, they set up card checking for the server
+    this->setOfflineMode(false);
 }
 
-void API::onEnableCardChecking(JsonObject data)
+void API::onEnableCardChecking(const EnableCardCheckingPayload &payload)
 {
-    Serial.println("[API] ENABLE_CARD_CHECKING");
-    this->nfc->enableCardChecking();
+    Serial.println("[API] ENABLE_CARD_CHECKING" + String(payload.sun ? " with SUN" : ""));
+    this->nfc->enableCardChecking(payload.sun);
     this->display->set_nfc_tap_enabled(true);
-    this->display->set_nfc_tap_text(data["payload"]["message"].as<String>());
+    this->display->set_nfc_tap_text(payload.message);
 }
 
-void API::onDisableCardChecking(JsonObject data)
+void API::onDisableCardChecking()
 {
     Serial.println("[API] DISABLE_CARD_CHECKING");
     this->nfc->disableCardChecking();
     this->display->set_nfc_tap_enabled(false);
 }
 
-void API::hexStringToBytes(const String &hexString, uint8_t *byteArray, size_t byteArrayLength)
+void API::onChangeKeys(const ChangeKeysPayload &payload)
 {
-    // Initialize array with zeros
-    memset(byteArray, 0, byteArrayLength);
+    Serial.println("[API] CHANGE_KEYS");
+
+    // The response is sent from the completion callback
+    if (payload.count > 0 && this->nfc->startChangeKeys(payload.authentication_key, payload.changes, payload.count))
+    {
+        return;
+    }
 
-    // Process the hex string - 2 characters per byte
-    for (size_t i = 0; i < byteArrayLength && i * 2 + 1 < hexString.length(); i++)
+    if (payload.count > 0)
     {
-        String byteHex = hexString.substring(i * 2, i * 2 + 2);
-        byteArray[i] = strtol(byteHex.c_str(), NULL, 16);
+        Serial.println("[API] NFC busy, could not start key change.");
     }
+    this->sendChangeKeysResult(payload.changes, payload.count);
 }
 
-void API::onChangeKeys(JsonObject data)
+void API::rejectChangeKeys(const ChangeKeysPayload &payload)
 {
-    Serial.println("[API] CHANGE_KEYS");
-
-    // Parse authentication key from hex string
-    uint8_t authKey[16];
-    String authKeyHex = data["payload"]["authenticationKey"].as<String>();
-    this->hexStringToBytes(authKeyHex, authKey, sizeof(authKey));
-
-    JsonObject response = JsonObject();
-    response["failedKeys"] = JsonArray();
-    response["successfulKeys"] = JsonArray();
-
-    StaticJsonDocument<256> doc;
-    JsonObject responsePayload = doc.to<JsonObject>();
-    responsePayload["failedKeys"] = JsonArray();
-    responsePayload["successfulKeys"] = JsonArray();
+    // Keys decoded before the invalid entry are reported as failed
+    this->sendChangeKeysResult(payload.changes, payload.count);
+}
 
-    // TODO: if change includes key 0, we need to change it first using provided auth key
-    // TODO: if more keys are provided, we need to change them afterwards using new key 0 as auth key
+void API::sendChangeKeysResult(const NFCKeyChange *changes, uint8_t count)
+{
+    JsonObject responsePayload = this->beginMessage(true, EventType::ChangeKeys);
+    JsonArray failedKeys = responsePayload["failedKeys"].to<JsonArray>();
+    JsonArray successfulKeys = responsePayload["successfulKeys"].to<JsonArray>();
 
-    bool doesChangeKey0 = false;
-    for (JsonPair key : data["payload"]["keys"].as<JsonObject>())
+    for (uint8_t i = 0; i < count; i++)
     {
-        uint8_t keyNumber = key.key().c_str()[0] - '0';
-        if (keyNumber == 0)
+        if (changes[i].success)
+        {
+            successfulKeys.add(changes[i].key_number);
+        }
+        else
         {
-            doesChangeKey0 = true;
+            failedKeys.add(changes[i].key_number);
+        }
+    }
 
-            uint8_t newKey[16];
-            String newKeyHex = key.value().as<String>();
-            this->hexStringToBytes(newKeyHex, newKey, sizeof(newKey));
+    this->queueMessage(OutboundPriority::Normal);
+}
 
-            Serial.println("Change KEy Call 1");
-            bool success = this->nfc->changeKey(0, authKey, newKey);
-            if (!success)
-            {
-                responsePayload["failedKeys"].add(0);
-                this->sendMessage(true, "CHANGE_KEYS", responsePayload);
-                return;
-            }
+void API::onRunJob(const RunJobPayload &payload)
+{
+    Serial.println("[API] RUN_JOB");
 
-            responsePayload["successfulKeys"].add(0);
+    if (!this->nfc->scheduleJob(payload.job))
+    {
+        this->sendJobError(payload.job.id, "Job rejected");
+    }
+}
 
-            // replace authkey with newkey for further operations
-            for (int i = 0; i < 16; i++)
-            {
-                authKey[i] = newKey[i];
-            }
+void API::rejectRunJob(const RunJobPayload &payload)
+{
+    this->sendJobError(payload.job.id, payload.error);
+}
 
-            break;
-        }
-    }
+void API::sendJobError(uint32_t jobId, const char *error)
+{
+    Serial.println("[API] RUN_JOB failed: " + String(error));
 
-    // for each key in "keys" object (key = key number as string, value = next key as hex string)
-    for (JsonPair key : data["payload"]["keys"].as<JsonObject>())
-    {
-        uint8_t keyNumber = key.key().c_str()[0] - '0';
+    JsonObject payload = this->beginMessage(true, EventType::RunJob);
+    payload["jobId"] = jobId;
+    payload["success"] = false;
+    payload["error"] = error;
+    this->queueMessage(OutboundPriority::Normal);
+}
 
-        if (keyNumber == 0)
-        {
-            continue;
-        }
+void API::sendJobResult(const NFCJob &job)
+{
+    JsonObject payload = this->beginMessage(true, EventType::RunJob);
+    payload["jobId"] = job.id;
+    Protocol::encodeBytes(payload["cardUID"], job.card_uid, job.card_uid_length, this->use_msgpack);
+    payload["success"] = job.success;
 
-        uint8_t newKey[16];
-        String newKeyHex = key.value().as<String>();
-        this->hexStringToBytes(newKeyHex, newKey, sizeof(newKey));
+    JsonArray steps = payload["steps"].to<JsonArray>();
+    for (uint8_t i = 0; i < job.step_count; i++)
+    {
+        const NFCJobStep &step = job.steps[i];
+        JsonObject result = steps.add<JsonObject>();
+        result["type"] = Protocol::jobStepName(step.type);
+        result["success"] = step.success;
 
-        Serial.print("[API] executing change key for key number ");
-        Serial.print(keyNumber);
-        Serial.print(" using current key xxxx");
-        for (int i = 10; i < 16; i++)
-        {
-            Serial.print(authKey[i]);
-        }
-        Serial.print(" to new key ");
-        for (int i = 10; i < 16; i++)
+        if (step.result_length > 0)
         {
-            Serial.print(newKey[i]);
+            Protocol::encodeBytes(result["data"], step.result, step.result_length, this->use_msgpack);
         }
-        Serial.println();
 
-        Serial.println("Change key call 3");
-        bool success = this->nfc->changeKey(keyNumber, authKey, newKey);
-        if (success)
+        if (step.type == NFC_JOB_STEP_CHANGE_KEYS)
         {
-            responsePayload["successfulKeys"].add(keyNumber);
-        }
-        else
-        {
-            responsePayload["failedKeys"].add(keyNumber);
-            this->sendMessage(true, "CHANGE_KEYS", responsePayload);
-            return;
+            JsonArray failedKeys = result["failedKeys"].to<JsonArray>();
+            JsonArray successfulKeys = result["successfulKeys"].to<JsonArray>();
+            for (uint8_t k = 0; k < job.key_change_count; k++)
+            {
+                if (job.key_changes[k].success)
+                {
+                    successfulKeys.add(job.key_changes[k].key_number);
+                }
+                else
+                {
+                    failedKeys.add(job.key_changes[k].key_number);
+                }
+            }
         }
     }
 
-    this->sendMessage(true, "CHANGE_KEYS", responsePayload);
+    this->queueMessage(OutboundPriority::Normal);
 }
 
-void API::onAuthenticate(JsonObject data)
+void API::onAuthenticate(const AuthenticatePayload &payload)
 {
     Serial.println("[API] AUTHENTICATE");
 
-    uint8_t authenticationKey[16];
-    String authKeyHex = data["payload"]["authenticationKey"].as<String>();
-    this->hexStringToBytes(authKeyHex, authenticationKey, sizeof(authenticationKey));
+    // The response is sent from the completion callback
+    if (!this->nfc->startAuthenticate(payload.key_number, payload.key))
+    {
+        Serial.println("[API] NFC busy, could not start authentication.");
+        this->sendAuthenticateResult(false);
+    }
+}
 
-    uint8_t keyNumber = data["payload"]["keyNumber"].as<uint8_t>();
+void API::rejectAuthenticate(const AuthenticatePayload &payload)
+{
+    this->sendAuthenticateResult(false);
+}
 
-    bool success = this->nfc->authenticate(keyNumber, authenticationKey);
+void API::sendAuthenticateResult(bool success)
+{
     if (success)
     {
         Serial.println("[API] Authentication successful.");
@@ -361,13 +321,12 @@ void API::onAuthenticate(JsonObject data)
         Serial.println("[API] Authentication failed.");
     }
 
-    StaticJsonDocument<256> doc;
-    JsonObject payload = doc.to<JsonObject>();
+    JsonObject payload = this->beginMessage(true, EventType::Authenticate);
     payload["authenticationSuccessful"] = success;
-    this->sendMessage(true, "AUTHENTICATE", payload);
+    this->queueMessage(OutboundPriority::Normal);
 }
 
-void API::onReauthenticate(JsonObject data)
+void API::onReauthenticate()
 {
     Serial.println("[API] REAUTHENTICATE Api flow");
     this->display->show_success("Resetting...", 0);
@@ -375,191 +334,515 @@ void API::onReauthenticate(JsonObject data)
     this->is_authenticated = false;
 }
 
-void API::onShowText(JsonObject data)
+void API::onShowText(const ShowTextPayload &payload)
 {
     Serial.println("[API] SHOW_TEXT");
     this->display->show_text(true);
-    this->display->set_text(data["payload"]["lineOne"].as<String>(), data["payload"]["lineTwo"].as<String>());
+    this->display->set_text(payload.line_one, payload.line_two);
+}
+
+void API::onDisplaySuccess(const DisplayMessagePayload &payload)
+{
+    this->display->show_success(payload.message, payload.duration);
+}
+
+void API::onDisplayError(const DisplayMessagePayload &payload)
+{
+    this->display->show_error(payload.message, payload.duration);
 }
 
 void API::processData()
 {
-    if (!this->websocket.available())
+    // Every frame holds one document, parse them straight from the stream
+    for (uint8_t frames = 0; frames < API_MAX_FRAMES_PER_LOOP && this->websocket.available(); frames++)
     {
-        return;
+        this->inbound_doc.clear();
+        this->inbound_arena.reset();
+
+        // JSON messages are objects, a MessagePack map never starts with '{'
+        DeserializationError error = this->websocket.peek() == '{' ? deserializeJson(this->inbound_doc, this->websocket)
+                                                                   : deserializeMsgPack(this->inbound_doc, this->websocket);
+        if (error)
+        {
+            Serial.println("[API] Dropping message: " + String(error.c_str()) + " (arena peak " + String(this->inbound_arena.peakUsage()) + " bytes)");
+
+            // The parser can't resync in the middle of a frame, discard what was received
+            while (this->websocket.available())
+            {
+                this->websocket.read();
+            }
+            continue;
+        }
+
+#ifdef API_DEBUG_PAYLOADS
+        Serial.print("[API] Received ");
+        serializeJson(this->inbound_doc, Serial);
+        Serial.println();
+#endif
+
+        this->processEvent(this->inbound_doc["data"].as<JsonObjectConst>());
+    }
+}
+
+void API::processEvent(JsonObjectConst data)
+{
+    const char *name = data["type"].as<const char *>();
+    JsonObjectConst payload = data["payload"].as<JsonObjectConst>();
+
+    EventType type = Protocol::eventType(name);
+    Serial.println("[API] Received message of type " + String(name != nullptr ? name : "null"));
+
+    switch (type)
+    {
+    case EventType::Register:
+        this->dispatch(type, payload, &API::onRegistrationData);
+        break;
+    case EventType::Unauthorized:
+        this->dispatch(type, payload, &API::onUnauthorized);
+        break;
+    case EventType::ReaderAuthenticated:
+        this->dispatch(type, payload, &API::onReaderAuthenticated);
+        break;
+    case EventType::EnableCardChecking:
+        this->dispatch(type, payload, &API::onEnableCardChecking);
+        break;
+    case EventType::DisableCardChecking:
+        this->onDisableCardChecking();
+        break;
+    case EventType::ChangeKeys:
+        this->dispatch(type, payload, &API::onChangeKeys, &API::rejectChangeKeys);
+        break;
+    case EventType::Authenticate:
+        this->dispatch(type, payload, &API::onAuthenticate, &API::rejectAuthenticate);
+        break;
+    case EventType::DisplaySuccess:
+        this->dispatch(type, payload, &API::onDisplaySuccess);
+        break;
+    case EventType::DisplayError:
+        this->dispatch(type, payload, &API::onDisplayError);
+        break;
+    case EventType::Reauthenticate:
+        this->onReauthenticate();
+        break;
+    case EventType::ShowText:
+        this->dispatch(type, payload, &API::onShowText);
+        break;
+    case EventType::HideText:
+        this->display->show_text(false);
+        break;
+    case EventType::RunJob:
+        this->dispatch(type, payload, &API::onRunJob, &API::rejectRunJob);
+        break;
+    case EventType::JournalReplay:
+        this->dispatch(type, payload, &API::onJournalAck);
+        break;
+    case EventType::OfflineAuthUpdate:
+        this->dispatch(type, payload, &API::onOfflineAuthUpdate, &API::rejectOfflineAuthUpdate);
+        break;
+    default:
+        Serial.println("[API] Unknown event type: " + String(name != nullptr ? name : "null"));
+        break;
     }
+}
 
-    uint8_t buffer[1024];
-    const auto bytes_read = this->websocket.read(buffer, 1024);
+bool API::isRegistered()
+{
+    return (Persistence::config().api.has_auth);
+}
 
-    // parse json
-    JsonDocument doc;
-    deserializeJson(doc, buffer, bytes_read);
+JsonObject API::beginMessage(bool is_response, EventType type)
+{
+    this->outbound_doc.clear();
+    this->outbound_arena.reset();
 
-    auto data = doc["data"].as<JsonObject>();
-    auto eventType = data["type"].as<String>();
-    auto payload = data["payload"].as<JsonObject>();
+    this->outbound_doc["event"] = is_response ? "RESPONSE" : "EVENT";
+    this->outbound_doc["data"]["type"] = Protocol::eventName(type);
+    return this->outbound_doc["data"]["payload"].to<JsonObject>();
+}
 
-    String payloadString;
-    serializeJson(payload, payloadString);
+bool API::queueMessage(OutboundPriority priority, uint8_t kind)
+{
+    const char *event = this->outbound_doc["event"] | "";
+    const char *type = this->outbound_doc["data"]["type"] | "";
 
-    Serial.println("[API] Received message of type " + eventType + " with payload " + payloadString);
+    // Measured first, a message that does not fit must not replace a queued one
+    size_t length = this->use_msgpack ? measureMsgPack(this->outbound_doc) : measureJson(this->outbound_doc);
+    if (this->outbound_doc.overflowed() || length >= API_SEND_BUFFER_SIZE)
+    {
+        Serial.println("[API] " + String(event) + " " + String(type) + " of " + String(length) + " bytes exceeds the send buffer, dropped.");
+        return false;
+    }
 
-    if (eventType == "REGISTER")
+    auto *message = this->send_queue.reserve(priority, kind);
+    if (message == nullptr)
     {
-        this->onRegistrationData(data);
+        Serial.println("[API] Send queue full, dropped " + String(event) + " " + String(type) + ".");
+        return false;
     }
-    else if (eventType == "UNAUTHORIZED")
+
+    // Heartbeats are not logged
+    if (kind != API_HEARTBEAT_KIND)
     {
-        this->onUnauthorized(data);
+        Serial.print("[API] Queueing " + String(event) + " " + String(type));
+#ifdef API_DEBUG_PAYLOADS
+        Serial.print(" with payload ");
+        serializeJson(this->outbound_doc["data"]["payload"], Serial);
+#endif
+        Serial.println();
     }
-    else if (eventType == "READER_AUTHENTICATED")
+
+    if (this->use_msgpack)
     {
-        this->is_authenticated = true;
-        this->display->set_api_connected(true);
-        this->display->set_device_name(payload["name"].as<String>());
-        Serial.println("[API] Authentication successful.");
+        length = serializeMsgPack(this->outbound_doc, message->data, sizeof(message->data));
     }
-    else if (eventType == "ENABLE_CARD_CHECKING")
+    else
     {
-        this->onEnableCardChecking(data);
+        length = serializeJson(this->outbound_doc, (char *)message->data, sizeof(message->data));
     }
-    else if (eventType == "DISABLE_CARD_CHECKING")
+    this->send_queue.commit(message, length);
+    return true;
+}
+
+void API::sendQueuedMessages()
+{
+    for (uint8_t sent = 0; sent < API_MAX_SENDS_PER_LOOP; sent++)
     {
-        this->onDisableCardChecking(data);
+        const auto *message = this->send_queue.peek();
+        if (message == nullptr)
+        {
+            break;
+        }
+
+        // The message stays queued until it was written completely
+        size_t written = this->websocket.write(message->data, message->length);
+        int error = this->websocket.getWriteError();
+        if (written > 0 && written != message->length)
+        {
+            // Part of the message is in the websocket frame already, writing it again would
+            // corrupt it. The session ends, the queue is discarded with it.
+            Serial.println("[API] Partial write of " + String(written) + " of " + String(message->length) + " bytes, reconnecting.");
+            this->websocket.clearWriteError();
+            this->connection.disconnect();
+            break;
+        }
+        if (written != message->length || error != 0)
+        {
+            if (!this->send_failed)
+            {
+                Serial.println("[API] Write failed (" + String(error) + "), " + String(this->send_queue.size()) + " messages stay queued.");
+                this->send_failed = true;
+            }
+            this->websocket.clearWriteError();
+            break;
+        }
+
+        // The flush ends the websocket message, every document needs its own
+        this->websocket.flush();
+
+        this->send_queue.pop();
+        this->send_failed = false;
     }
-    else if (eventType == "CHANGE_KEYS")
+}
+
+void API::sendRegistrationRequest()
+{
+    // only send registration once per minute
+    if (this->registration_sent_at != 0 && millis() - this->registration_sent_at < (1000 * 10))
     {
-        this->onChangeKeys(data);
+        return;
     }
-    else if (eventType == "AUTHENTICATE")
+
+    Serial.println("[API] Registering reader...");
+
+    // A registration request still waiting in the queue is replaced
+    this->beginMessage(false, EventType::Register);
+    this->queueMessage(OutboundPriority::Normal, (uint8_t)EventType::Register);
+
+    this->registration_sent_at = millis();
+}
+
+void API::sendAuthenticationRequest()
+{
+    // only send authentication once per minute
+    if (this->authentication_sent_at != 0 && millis() - this->authentication_sent_at < (1000 * 10))
     {
-        this->onAuthenticate(data);
+        return;
     }
-    else if (eventType == "DISPLAY_SUCCESS")
+
+    JsonObject payload = this->beginMessage(false, EventType::Authenticate);
+    payload["id"] = Persistence::config().api.readerId;
+    payload["token"] = Persistence::config().api.apiKey;
+#ifdef API_MSGPACK
+    payload["encodings"].add("msgpack");
+#endif
+    // The server sends the offline set if this one is outdated
+    payload["offlineAuthVersion"] = this->offline_auth.version();
+    this->queueMessage(OutboundPriority::Normal, (uint8_t)EventType::Authenticate);
+
+    this->authentication_sent_at = millis();
+}
+
+void API::sendNFCTapped(uint8_t *uid, uint8_t uidLength, const NFCCardInfo &card, const SunMessage *sun)
+{
+    if (!this->is_authenticated)
     {
-        this->display->show_success(data["payload"]["message"].as<String>(), data["payload"]["duration"].as<unsigned long>());
+        uint8_t flags = this->is_offline_mode ? this->decideOffline(uid, uidLength) : 0;
+        this->recordOffline(EventType::NfcTap, uid, uidLength, flags);
+        return;
     }
-    else if (eventType == "DISPLAY_ERROR")
+
+    JsonObject payload = this->beginMessage(false, EventType::NfcTap);
+    Protocol::encodeBytes(payload["cardUID"], uid, uidLength, this->use_msgpack);
+
+    // Lets the server skip NTAG424 crypto on cards that can't do it
+    payload["cardFamily"] = Protocol::cardFamilyName(card.family);
+    if (card.is_iso14443a)
     {
-        this->display->show_error(data["payload"]["message"].as<String>(), data["payload"]["duration"].as<unsigned long>());
+        payload["atqa"] = card.atqa;
+        payload["sak"] = card.sak;
     }
-    else if (eventType == "REAUTHENTICATE")
+    if (card.ats_length > 0)
     {
-        this->onReauthenticate(data);
+        Protocol::encodeBytes(payload["ats"], card.ats, card.ats_length, this->use_msgpack);
     }
-    else if (eventType == "SHOW_TEXT")
+
+    // Lets the server decide without authenticating, the UID matched cardUID
+    if (sun != nullptr)
     {
-        this->onShowText(data);
+        payload["sunCounter"] = sun->counter;
+        Protocol::encodeBytes(payload["sunMAC"], sun->mac, SUN_MAC_LENGTH, this->use_msgpack);
     }
-    else if (eventType == "HIDE_TEXT")
+    this->queueMessage(OutboundPriority::High);
+}
+
+void API::sendCardRemoved(uint8_t *uid, uint8_t uidLength)
+{
+    // Only the current session cares about a removal, it is not journaled
+    if (!this->is_authenticated)
     {
-        this->display->show_text(false);
+        return;
     }
-    else
+
+    JsonObject payload = this->beginMessage(false, EventType::CardRemoved);
+    Protocol::encodeBytes(payload["cardUID"], uid, uidLength, this->use_msgpack);
+    this->queueMessage(OutboundPriority::High);
+}
+
+void API::sendKeyPressed(char key)
+{
+    if (!this->is_authenticated)
     {
-        Serial.println("[API] Unknown event type: " + eventType);
-        Serial.write(buffer, bytes_read);
-        Serial.println();
+        this->recordOffline(EventType::KeyPressed, (const uint8_t *)&key, 1);
+        return;
     }
+
+    JsonObject payload = this->beginMessage(false, EventType::KeyPressed);
+    payload["key"] = String(key);
+    this->queueMessage(OutboundPriority::High);
 }
 
-bool API::isRegistered()
+void API::recordOffline(EventType type, const uint8_t *data, uint8_t length, uint8_t flags)
 {
-    return (Persistence::getSettings().Config.api.has_auth);
+    if (!this->journal.record((uint8_t)type, data, length, millis(), flags))
+    {
+        Serial.println("[API] Journal full, dropped offline " + String(Protocol::eventName(type)) + " (" + String(this->journal.droppedCount()) + " dropped).");
+        return;
+    }
+
+    Serial.println("[API] Offline, journaled " + String(Protocol::eventName(type)) + " (" + String(this->journal.size()) + " waiting).");
 }
 
-void API::sendMessage(bool is_response, const char *type, JsonObject payload)
+void API::replayJournal()
 {
-    JsonDocument event;
-    if (is_response)
+    if (!this->is_authenticated || this->journal_stalled || this->journal.size() == 0)
     {
-        event["event"] = "RESPONSE";
+        return;
     }
-    else
+
+    // One batch at a time, the next one follows the acknowledgement
+    if (this->journal_pending != 0)
     {
-        event["event"] = "EVENT";
+        if (millis() - this->journal_sent_at >= API_JOURNAL_ACK_TIMEOUT_MS)
+        {
+            Serial.println("[API] Journal replay was not acknowledged, retrying after the next connect.");
+            this->journal_pending = 0;
+            this->journal_stalled = true;
+        }
+        return;
     }
-    event["data"]["type"] = type;
 
-    // Create a copy of the payload in the destination document
-    JsonObject eventPayload = event["data"]["payload"].to<JsonObject>();
-    for (JsonPair p : payload)
+    JournalRecord records[API_JOURNAL_BATCH];
+    uint8_t count = this->journal.peek(records, API_JOURNAL_BATCH);
+    if (count == 0)
     {
-        eventPayload[p.key()] = p.value();
+        return;
     }
 
-    String payloadString = event["data"]["payload"].as<String>();
+    JsonObject payload = this->beginMessage(false, EventType::JournalReplay);
+    JsonArray events = payload["events"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const JournalRecord &record = records[i];
+        JsonObject event = events.add<JsonObject>();
+        event["sequence"] = record.sequence;
+        event["type"] = Protocol::eventName((EventType)record.type);
 
-    Serial.println("[API] Sending " + String(is_response ? "response" : "event") + " of type " + String(type) + " with payload " + payloadString);
+        // millis() of an earlier boot says nothing about when the event happened
+        if ((record.flags & JOURNAL_FLAG_PREVIOUS_BOOT) == 0)
+        {
+            event["age"] = millis() - record.timestamp;
+        }
 
-    String json;
-    serializeJson(event, json);
-    this->websocket.write((uint8_t *)json.c_str(), json.length());
-    this->websocket.flush();
-}
+        if (record.flags & JOURNAL_FLAG_GRANTED_OFFLINE)
+        {
+            event["offlineDecision"] = "granted";
+        }
+        else if (record.flags & JOURNAL_FLAG_DENIED_OFFLINE)
+        {
+            event["offlineDecision"] = "denied";
+        }
 
-void API::sendRegistrationRequest()
-{
-    // only send registration once per minute
-    if (this->registration_sent_at != 0 && millis() - this->registration_sent_at < (1000 * 10))
+        if ((EventType)record.type == EventType::KeyPressed)
+        {
+            event["key"] = String((char)record.data[0]);
+        }
+        else
+        {
+            Protocol::encodeBytes(event["cardUID"], record.data, record.length, this->use_msgpack);
+        }
+    }
+    // Not queued, the batch is built again on the next loop
+    if (!this->queueMessage(OutboundPriority::Normal))
     {
         return;
     }
 
-    Serial.println("[API] Registering reader...");
+    this->journal_pending = records[count - 1].sequence;
+    this->journal_sent_at = millis();
+}
 
-    this->sendMessage(false, "REGISTER", JsonObject());
+void API::onJournalAck(const JournalAckPayload &payload)
+{
+    this->journal.acknowledge(payload.acknowledged);
+    this->journal_pending = 0;
+    Serial.println("[API] Server recorded offline events up to #" + String(payload.acknowledged) + ", " + String(this->journal.size()) + " left.");
+}
 
-    this->registration_sent_at = millis();
+void API::loadOfflineAuth()
+{
+    if (this->offline_auth_file.load(this->offline_auth))
+    {
+        Serial.println("[API] Offline set version " + String(this->offline_auth.version()) + " with " + String(this->offline_auth.size()) + " cards.");
+    }
+}
 
-    // check write error / status
-    auto writeStatus = this->websocket.getWriteError();
-    if (writeStatus != 0)
+void API::updateOfflineMode()
+{
+    if (this->is_authenticated)
     {
-        Serial.print("[API] Failed to send registration request. Error: ");
-        Serial.println(writeStatus);
+        this->authenticated_at = millis();
         return;
     }
 
-    Serial.println("[API] Registration request sent.");
+    // Leaving offline mode is up to onReaderAuthenticated()
+    unsigned long offline_after = Persistence::config().api.offlineAfter * 1000UL;
+    if (!this->is_offline_mode && offline_after != 0 && this->offline_auth.version() != 0 &&
+        millis() - this->authenticated_at >= offline_after)
+    {
+        this->setOfflineMode(true);
+    }
 }
 
-void API::sendAuthenticationRequest()
+void API::setOfflineMode(bool offline)
 {
-    // only send authentication once per minute
-    if (this->authentication_sent_at != 0 && millis() - this->authentication_sent_at < (1000 * 10))
+    if (offline == this->is_offline_mode)
     {
         return;
     }
 
-    StaticJsonDocument<256> doc;
-    JsonObject payload = doc.to<JsonObject>();
-    payload["id"] = Persistence::getSettings().Config.api.readerId;
-    payload["token"] = Persistence::getSettings().Config.api.apiKey;
-    this->sendMessage(false, "AUTHENTICATE", payload);
+    this->is_offline_mode = offline;
+    this->display->set_offline_mode(offline);
 
-    this->authentication_sent_at = millis();
+    if (offline)
+    {
+        Serial.println("[API] Server unreachable, deciding taps with offline set version " + String(this->offline_auth.version()) + ".");
+        this->display->set_nfc_tap_text("Offline mode");
+        this->nfc->enableCardChecking();
+    }
+    else
+    {
+        Serial.println("[API] Leaving offline mode.");
+        this->nfc->disableCardChecking();
+    }
 }
 
-void API::sendNFCTapped(uint8_t *uid, uint8_t uidLength)
+uint8_t API::decideOffline(const uint8_t *uid, uint8_t uidLength)
 {
-    StaticJsonDocument<256> doc;
-    JsonObject payload = doc.to<JsonObject>();
+    unsigned long started = micros();
+    bool granted = this->offline_auth.contains(uid, uidLength);
+    unsigned long elapsed = micros() - started;
+
+    Serial.println("[API] Offline decision: " + String(granted ? "granted" : "denied") + " in " + String(elapsed) + " us.");
 
-    // Convert UID to hex string
-    String uidHex = "";
-    for (uint8_t i = 0; i < uidLength; i++)
+    if (granted)
     {
-        if (uid[i] < 0x10)
+        this->display->show_success("Granted offline", 3000);
+        return JOURNAL_FLAG_GRANTED_OFFLINE;
+    }
+
+    this->display->show_error("Unknown card", 3000);
+    return JOURNAL_FLAG_DENIED_OFFLINE;
+}
+
+void API::onOfflineAuthUpdate(const OfflineAuthUpdatePayload &payload)
+{
+    // A new update replaces one that was cut off, it starts from the stored set
+    if (payload.chunk == 0 && this->offline_auth.isUpdating())
+    {
+        this->loadOfflineAuth();
+    }
+
+    uint32_t previous_version = this->offline_auth.version();
+    OfflineAuthChunk result = this->offline_auth.applyChunk(payload.base_version, payload.version, payload.chunk, payload.final,
+                                                            payload.added, payload.added_count, payload.removed, payload.removed_count);
+
+    switch (result)
+    {
+    case OfflineAuthChunk::Pending:
+    case OfflineAuthChunk::Ignored:
+        return;
+    case OfflineAuthChunk::Complete:
+        Serial.println("[API] Offline set updated to version " + String(this->offline_auth.version()) + " with " + String(this->offline_auth.size()) + " cards.");
+        if (!this->offline_auth_file.save(this->offline_auth))
         {
-            uidHex += "0";
+            Serial.println("[API] Could not store the offline set, it is lost on reboot.");
         }
-        uidHex += String(uid[i], HEX);
+        break;
+    case OfflineAuthChunk::Rejected:
+        Serial.println("[API] Offline set update from version " + String(payload.base_version) + " does not apply to version " + String(previous_version) + ".");
+        this->loadOfflineAuth();
+        break;
     }
 
-    payload["cardUID"] = uidHex;
-    this->sendMessage(false, "NFC_TAP", payload);
+    this->sendOfflineAuthVersion();
+}
+
+void API::rejectOfflineAuthUpdate(const OfflineAuthUpdatePayload &payload)
+{
+    if (this->offline_auth.isUpdating())
+    {
+        this->loadOfflineAuth();
+    }
+    this->sendOfflineAuthVersion();
+}
+
+void API::sendOfflineAuthVersion()
+{
+    // The server compares this with what it sent and falls back to a full update
+    JsonObject payload = this->beginMessage(true, EventType::OfflineAuthUpdate);
+    payload["version"] = this->offline_auth.version();
+    payload["count"] = this->offline_auth.size();
+    this->queueMessage(OutboundPriority::Normal);
 }
 
 void API::sendHeartbeat()
@@ -570,19 +853,19 @@ void API::sendHeartbeat()
         return;
     }
 
-    StaticJsonDocument<512> event;
-    event["event"] = "HEARTBEAT";
-
-    String json;
-    serializeJson(event, json);
-    this->websocket.write((uint8_t *)json.c_str(), json.length());
-    this->websocket.flush();
+    // Only one heartbeat is queued at a time, a newer one replaces it
+    this->outbound_doc.clear();
+    this->outbound_arena.reset();
+    this->outbound_doc["event"] = "HEARTBEAT";
+    this->queueMessage(OutboundPriority::Low, API_HEARTBEAT_KIND);
 
     this->heartbeat_sent_at = millis();
 }
 
 void API::loop()
 {
+    this->refreshConfig();
+
     // First check if API is configured
     if (!isConfigured())
     {
@@ -591,7 +874,20 @@ void API::loop()
     }
 
     // Then check if we're connected
-    if (!isConnected())
+    bool connected = isConnected();
+    this->updateOfflineMode();
+
+    // Keys are read while offline as well, they are journaled then
+    KeypadEvent event;
+    while (this->keypad->nextEvent(event))
+    {
+        if (event.pressed)
+        {
+            this->sendKeyPressed(event.key);
+        }
+    }
+
+    if (!connected)
     {
         return;
     }
@@ -607,12 +903,6 @@ void API::loop()
 
     this->sendHeartbeat();
     this->processData();
-    char key = this->keypad->readKey();
-    if (key != '\0')
-    {
-        StaticJsonDocument<256> doc;
-        JsonObject payload = doc.to<JsonObject>();
-        payload["key"] = String(key);
-        this->sendMessage(false, "KEY_PRESSED", payload);
-    }
+    this->replayJournal();
+    this->sendQueuedMessages();
 }
\ No newline at end of file
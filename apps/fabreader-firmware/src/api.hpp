@@ -6,43 +6,109 @@
 #include <ArduinoJson.h>
 #include "display.hpp"
 #include "keypad.hpp"
+#include "json_arena.hpp"
+#include "protocol.hpp"
+#include "outbound_queue.hpp"
+#include "connection_manager.hpp"
+#include "network_interface.hpp"
+#include "event_journal.hpp"
+#include "event_journal_file.hpp"
+#include "offline_auth.hpp"
+#include "offline_auth_file.hpp"
+#include "sun_message.hpp"
 class NFC; // Forward declaration instead of #include "nfc.hpp"
 
 #define API_WS_PATH "/api/fabreader/websocket"
 
+// Inbound messages are parsed into a fixed arena, larger messages are dropped
+#define API_JSON_ARENA_SIZE 4096
+#define API_MAX_FRAMES_PER_LOOP 8 // Bounds the time spent in processData()
+#define API_READ_TIMEOUT_MS 50    // Wait for the rest of a partially received frame
+
+// Offer the MessagePack wire format when authenticating, the server picks the encoding
+#define API_MSGPACK
+
+// Outgoing messages are serialized into a fixed queue and written from loop()
+#define API_SEND_BUFFER_SIZE 1024    // Largest serialized outgoing message
+#define API_SEND_QUEUE_SLOTS 8       // Messages waiting to be written
+#define API_MAX_SENDS_PER_LOOP 4     // Bounds the time spent in sendQueuedMessages()
+#define API_OUTBOUND_ARENA_SIZE 3072 // Document of the message being built
+#define API_HEARTBEAT_KIND 0xFF      // Coalescing kind of heartbeats, events use their EventType
+
+// Taps and key presses while offline are journaled and replayed after authenticating
+#define API_JOURNAL_BATCH 8              // Records per JOURNAL_REPLAY message
+#define API_JOURNAL_ACK_TIMEOUT_MS 10000 // Without an answer, replay waits for the next connection
+
+// Uncomment to log the payload of every sent and received message
+// #define API_DEBUG_PAYLOADS
+
 class API
 {
 public:
-    API(Client &client, Display *display, Keypad *keypad) : websocket(client, API_WS_PATH), client(client), display(display), keypad(keypad) {}
+    API(NetworkInterface &network, Display *display, Keypad *keypad) : tcp(network.getClient()), websocket(tcp, API_WS_PATH), connection(websocket, tcp, network), display(display), keypad(keypad), inbound_doc(&inbound_arena), outbound_doc(&outbound_arena), journal(journal_segment) {}
     ~API() {}
 
     void setup(NFC *nfc);
     void loop();
 
-    void sendNFCTapped(uint8_t *uid, uint8_t uidLength);
+    // sun is the card's SUN message if card checking asked for it and the card had a fresh one
+    void sendNFCTapped(uint8_t *uid, uint8_t uidLength, const NFCCardInfo &card, const SunMessage *sun = nullptr);
+    void sendCardRemoved(uint8_t *uid, uint8_t uidLength);
+    void sendJobResult(const NFCJob &job);
+    void sendJobError(uint32_t jobId, const char *error);
 
-    // Check if the API is connected to the server
+    // Check if the API is connected to the server, connects if not. Main loop only.
     bool isConnected();
 
+    // Connection state as of the last loop(), for other tasks
+    bool isOnline() const { return this->is_connected; }
+
     // Check if API is properly configured
     bool isConfigured();
 
 private:
+    PinnedClient tcp;
     PicoWebsocket::Client websocket;
-    Client &client;
+    ConnectionManager connection;
     NFC *nfc;
     Display *display;
     Keypad *keypad;
 
+    // Reused for every inbound message
+    JsonArena<API_JSON_ARENA_SIZE> inbound_arena;
+    JsonDocument inbound_doc;
+
     void processData();
-    bool checkTCPConnection();
+    void processEvent(JsonObjectConst data);
+
+    // Decodes the payload and calls the handler. Invalid payloads are logged and handed
+    // to rejected, if set, so requests the server waits for still get a response.
+    template <typename T>
+    void dispatch(EventType type, JsonObjectConst payload, void (API::*handler)(const T &), void (API::*rejected)(const T &) = nullptr)
+    {
+        T decoded;
+        if (Protocol::decode(payload, decoded))
+        {
+            (this->*handler)(decoded);
+            return;
+        }
+
+        Serial.println("[API] Invalid " + String(Protocol::eventName(type)) + " payload");
+        if (rejected != nullptr)
+        {
+            (this->*rejected)(decoded);
+        }
+    }
 
     bool is_connected = false;
     bool is_authenticated = false;
-    bool is_connecting = false;
 
-    unsigned long last_connection_attempt = 0;
-    unsigned long connection_retry_interval = 5000; // 5 seconds between connection attempts
+    // Derived from Persistence::config(), rebuilt when the settings change
+    uint32_t config_generation = 0;
+    bool is_configured = false;
+    String server_address; // hostname:port/path, for log messages
+    void refreshConfig();
+
     unsigned long registration_sent_at = 0;
     unsigned long authentication_sent_at = 0;
     unsigned long heartbeat_sent_at = 0;
@@ -53,18 +119,67 @@ private:
     bool isRegistered();
     bool isAuthenticated();
 
-    void sendMessage(bool is_response, const char *type, JsonObject payload);
+    // Outgoing wire format, negotiated in READER_AUTHENTICATED
+    bool use_msgpack = false;
+
+    // Reused for every outgoing message
+    JsonArena<API_OUTBOUND_ARENA_SIZE> outbound_arena;
+    JsonDocument outbound_doc;
+    OutboundQueue<API_SEND_QUEUE_SLOTS, API_SEND_BUFFER_SIZE> send_queue;
+    bool send_failed = false;
+
+    // Clears outbound_doc, writes the envelope and returns the payload object to fill in
+    JsonObject beginMessage(bool is_response, EventType type);
+    // Serializes outbound_doc into the send queue. A queued message of the same kind
+    // (0: none) is replaced instead of queueing another one. False if it was dropped.
+    bool queueMessage(OutboundPriority priority, uint8_t kind = 0);
+    void sendQueuedMessages();
     void sendHeartbeat();
-
-    void onRegistrationData(JsonObject data);
-    void onDisplayText(JsonObject data);
-    void onUnauthorized(JsonObject data);
-    void onEnableCardChecking(JsonObject data);
-    void onDisableCardChecking(JsonObject data);
-    void onChangeKeys(JsonObject data);
-    void onAuthenticate(JsonObject data);
-    void onReauthenticate(JsonObject data);
-    void onShowText(JsonObject data);
-
-    void hexStringToBytes(const String &hexString, uint8_t *byteArray, size_t byteArrayLength);
+    void sendKeyPressed(char key);
+
+    FileJournalSegment journal_segment;
+    EventJournal journal;
+    uint32_t journal_pending = 0; // Last sequence of the replay waiting for an answer
+    unsigned long journal_sent_at = 0;
+    bool journal_stalled = false;
+
+    void recordOffline(EventType type, const uint8_t *data, uint8_t length, uint8_t flags = 0);
+    void replayJournal();
+    void onJournalAck(const JournalAckPayload &payload);
+
+    // Cards the reader accepts by itself once the server was unreachable for
+    // ApiConfig::offlineAfter seconds
+    OfflineAuthSet offline_auth;
+    OfflineAuthFile offline_auth_file;
+    bool is_offline_mode = false;
+    unsigned long authenticated_at = 0; // Last loop() with an authenticated connection
+
+    void loadOfflineAuth();
+    void updateOfflineMode();
+    void setOfflineMode(bool offline);
+    // Shows the decision and returns the JOURNAL_FLAG_* to record with the tap
+    uint8_t decideOffline(const uint8_t *uid, uint8_t uidLength);
+    void onOfflineAuthUpdate(const OfflineAuthUpdatePayload &payload);
+    void rejectOfflineAuthUpdate(const OfflineAuthUpdatePayload &payload);
+    void sendOfflineAuthVersion();
+
+    void onRegistrationData(const RegistrationPayload &payload);
+    void onUnauthorized(const MessagePayload &payload);
+    void onReaderAuthenticated(const ReaderAuthenticatedPayload &payload);
+    void onEnableCardChecking(const EnableCardCheckingPayload &payload);
+    void onDisableCardChecking();
+    void onChangeKeys(const ChangeKeysPayload &payload);
+    void onAuthenticate(const AuthenticatePayload &payload);
+    void onReauthenticate();
+    void onShowText(const ShowTextPayload &payload);
+    void onDisplaySuccess(const DisplayMessagePayload &payload);
+    void onDisplayError(const DisplayMessagePayload &payload);
+    void onRunJob(const RunJobPayload &payload);
+
+    void rejectChangeKeys(const ChangeKeysPayload &payload);
+    void rejectAuthenticate(const AuthenticatePayload &payload);
+    void rejectRunJob(const RunJobPayload &payload);
+
+    void sendChangeKeysResult(const NFCKeyChange *changes, uint8_t count);
+    void sendAuthenticateResult(bool success);
 };
\ No newline at end of file
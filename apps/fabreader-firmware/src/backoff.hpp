@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+// Exponential backoff with jitter. The delay ceiling doubles with every failed attempt
+// up to max_ms, the delay itself is picked at random between half the ceiling and the
+// ceiling so readers that lost the server at the same time spread their reconnects.
+class Backoff
+{
+public:
+    Backoff(uint32_t base_ms, uint32_t max_ms) : base_ms(base_ms), max_ms(max_ms) {}
+
+    // Delay before the next attempt, random supplies the jitter
+    uint32_t next(uint32_t random)
+    {
+        uint32_t ceiling = this->ceiling();
+        if (this->failures < 255)
+        {
+            this->failures++;
+        }
+
+        uint32_t half = ceiling / 2;
+        return half + random % (ceiling - half + 1);
+    }
+
+    // Call once a connection proved stable
+    void reset()
+    {
+        this->failures = 0;
+    }
+
+    uint8_t failureCount() const
+    {
+        return this->failures;
+    }
+
+private:
+    uint32_t base_ms;
+    uint32_t max_ms;
+    uint8_t failures = 0;
+
+    uint32_t ceiling() const
+    {
+        uint32_t ceiling = this->base_ms;
+        for (uint8_t i = 0; i < this->failures && ceiling < this->max_ms; i++)
+        {
+            ceiling *= 2;
+        }
+        return ceiling < this->max_ms ? ceiling : this->max_ms;
+    }
+};
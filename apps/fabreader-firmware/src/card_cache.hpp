@@ -0,0 +1,180 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "nfc_types.hpp"
+
+#define CARD_CACHE_ENTRIES 8
+#define CARD_CACHE_TTL_MS 600000         // Another reader may change the card in the meantime
+#define CARD_CACHE_VERSION_SIZE 30       // Size of ntag424_VersionInfoType
+#define CARD_CACHE_FILES 3               // NTAG424 standard files 1..3
+#define CARD_CACHE_FILE_SETTINGS_SIZE 34 // Largest GetFileSettings answer, a file with all SDM options
+
+enum class CardType : uint8_t
+{
+    Unknown,
+    NTAG424,
+    Other, // Answered GetVersion with another hardware type, NTAG424 commands will fail
+};
+
+struct CardInfo
+{
+    uint8_t uid[NFC_MAX_UID_LENGTH];
+    uint8_t uid_length;
+    CardType type;
+
+    bool has_version;
+    uint8_t version[CARD_CACHE_VERSION_SIZE];
+
+    // 0 until known, without status bytes and response MAC
+    uint8_t file_settings_length[CARD_CACHE_FILES];
+    uint8_t file_settings[CARD_CACHE_FILES][CARD_CACHE_FILE_SETTINGS_SIZE];
+
+    // The NTAG424 application is selected in the current RF session, authentication can skip
+    // ISOSelectFile. Cleared when the card leaves the field or is activated again.
+    bool app_selected;
+
+    // SUN messages of this card, see SunMessage
+    bool no_sun;          // The NDEF file held none, it isn't read again
+    bool has_sun_counter;
+    uint32_t sun_counter; // Highest counter passed on to the server
+
+    uint32_t learned_at; // The entry is dropped CARD_CACHE_TTL_MS after it was created
+    uint32_t used;       // Replacement order
+};
+
+// What recently tapped cards answered to commands whose answer doesn't change, keyed by UID.
+// Repeat taps and multi step jobs use it to skip those APDUs. Cards with random UIDs simply
+// never hit. Times are millis().
+class CardCache
+{
+public:
+    // Entry of the card or nullptr, an expired entry comes back emptied
+    CardInfo *find(const uint8_t *uid, uint8_t length, uint32_t now)
+    {
+        CardInfo *card = this->lookup(uid, length);
+        if (card == nullptr)
+        {
+            return nullptr;
+        }
+        if ((int32_t)(now - card->learned_at) >= CARD_CACHE_TTL_MS)
+        {
+            this->reset(*card, uid, length, now);
+        }
+
+        card->used = ++this->uses;
+        return card;
+    }
+
+    // Entry of the card, a new one replaces the least recently used card
+    CardInfo &touch(const uint8_t *uid, uint8_t length, uint32_t now)
+    {
+        CardInfo *card = this->find(uid, length, now);
+        if (card != nullptr)
+        {
+            return *card;
+        }
+
+        card = &this->entries[0];
+        for (uint8_t i = 1; i < CARD_CACHE_ENTRIES; i++)
+        {
+            if (this->entries[i].used < card->used)
+            {
+                card = &this->entries[i];
+            }
+        }
+        this->reset(*card, uid, length, now);
+        card->used = ++this->uses;
+        return *card;
+    }
+
+    // The card left the field, the next activation starts without a selected application
+    void endSession(const uint8_t *uid, uint8_t length)
+    {
+        CardInfo *card = this->lookup(uid, length);
+        if (card != nullptr)
+        {
+            card->app_selected = false;
+        }
+    }
+
+    void clear()
+    {
+        memset(this->entries, 0, sizeof(this->entries));
+        this->uses = 0;
+    }
+
+    static const uint8_t *fileSettings(const CardInfo &card, uint8_t fileNumber, uint8_t &length)
+    {
+        if (fileNumber < 1 || fileNumber > CARD_CACHE_FILES || card.file_settings_length[fileNumber - 1] == 0)
+        {
+            length = 0;
+            return nullptr;
+        }
+
+        length = card.file_settings_length[fileNumber - 1];
+        return card.file_settings[fileNumber - 1];
+    }
+
+    // Files outside 1..CARD_CACHE_FILES and oversized answers are not cached
+    static void storeFileSettings(CardInfo &card, uint8_t fileNumber, const uint8_t *settings, uint8_t length)
+    {
+        if (fileNumber < 1 || fileNumber > CARD_CACHE_FILES || length == 0 || length > CARD_CACHE_FILE_SETTINGS_SIZE)
+        {
+            return;
+        }
+
+        memcpy(card.file_settings[fileNumber - 1], settings, length);
+        card.file_settings_length[fileNumber - 1] = length;
+    }
+
+    // After ChangeFileSettings, the file may also have started or stopped mirroring SUN messages
+    static void forgetFileSettings(CardInfo &card, uint8_t fileNumber)
+    {
+        if (fileNumber >= 1 && fileNumber <= CARD_CACHE_FILES)
+        {
+            card.file_settings_length[fileNumber - 1] = 0;
+        }
+        card.no_sun = false;
+    }
+
+    // False for a counter the card already sent, a replayed SUN message. The server keeps the
+    // authoritative counter, this only saves it the round trip for replays at this reader.
+    static bool acceptSunCounter(CardInfo &card, uint32_t counter)
+    {
+        if (card.has_sun_counter && counter <= card.sun_counter)
+        {
+            return false;
+        }
+
+        card.sun_counter = counter;
+        card.has_sun_counter = true;
+        return true;
+    }
+
+private:
+    CardInfo entries[CARD_CACHE_ENTRIES] = {};
+    uint32_t uses = 0;
+
+    CardInfo *lookup(const uint8_t *uid, uint8_t length)
+    {
+        for (uint8_t i = 0; i < CARD_CACHE_ENTRIES; i++)
+        {
+            CardInfo &card = this->entries[i];
+            if (card.uid_length != 0 && card.uid_length == length && memcmp(card.uid, uid, length) == 0)
+            {
+                return &card;
+            }
+        }
+        return nullptr;
+    }
+
+    static void reset(CardInfo &card, const uint8_t *uid, uint8_t length, uint32_t now)
+    {
+        memset(&card, 0, sizeof(CardInfo));
+        length = length > NFC_MAX_UID_LENGTH ? NFC_MAX_UID_LENGTH : length;
+        memcpy(card.uid, uid, length);
+        card.uid_length = length;
+        card.learned_at = now;
+    }
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "nfc_types.hpp"
+
+// Tells card families apart by their ISO14443A activation data, following NXP AN10833.
+// Detection already has ATQA, SAK and ATS, so this costs no exchange with the card.
+namespace CardClassifier
+{
+    // ATS of an NTAG 424 DNA: TL, T0, TA(1), TB(1), TC(1) and one historical byte
+    static const uint8_t NTAG424_ATS[] = {0x06, 0x77, 0x77, 0x71, 0x02, 0x80};
+
+    inline NFCCardFamily classify(uint16_t atqa, uint8_t sak, const uint8_t *ats, uint8_t atsLength)
+    {
+        // ISO14443-4 compliant, also set on SmartMX cards that emulate MIFARE Classic
+        if (sak & 0x20)
+        {
+            if (atsLength == sizeof(NTAG424_ATS) && memcmp(ats, NTAG424_ATS, sizeof(NTAG424_ATS)) == 0)
+            {
+                return NFCCardFamily::Ntag424;
+            }
+            return NFCCardFamily::IsoDep;
+        }
+
+        // Type 2 tags answer with a double size UID
+        if (sak == 0x00 && atqa == 0x0044)
+        {
+            return NFCCardFamily::MifareUltralight;
+        }
+
+        // Mini (0x09), 1K (0x08, 0x88) and 4K (0x18)
+        if (sak & 0x08)
+        {
+            return NFCCardFamily::MifareClassic;
+        }
+
+        // MIFARE Plus in security level 2 and anything else
+        return NFCCardFamily::Unknown;
+    }
+
+    // False for families that can't run NTAG424 commands, crypto attempts on them only fail.
+    // Unknown cards get the benefit of the doubt.
+    inline bool supportsNtag424(NFCCardFamily family)
+    {
+        return family == NFCCardFamily::Unknown || family == NFCCardFamily::IsoDep || family == NFCCardFamily::Ntag424;
+    }
+}
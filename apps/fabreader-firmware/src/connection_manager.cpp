@@ -0,0 +1,207 @@
+#include "connection_manager.hpp"
+
+static const char *connectStatusName(int status)
+{
+    switch (status)
+    {
+    case 0:
+        return "FAILED";
+    case -1:
+        return "TIMED_OUT";
+    case -2:
+        return "INVALID_SERVER";
+    case -3:
+        return "TRUNCATED";
+    case -4:
+        return "INVALID_RESPONSE";
+    case -5:
+        return "DOMAIN_NOT_FOUND";
+    default:
+        return "UNKNOWN_ERROR";
+    }
+}
+
+void ConnectionManager::task(void *parameter)
+{
+    ConnectionManager *manager = (ConnectionManager *)parameter;
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        manager->connect();
+    }
+}
+
+void ConnectionManager::setup()
+{
+    xTaskCreate(
+        task,
+        "connection",
+        CONNECTION_TASK_STACK_SIZE,
+        this,
+        1,
+        &this->taskHandle);
+}
+
+bool ConnectionManager::resolve(IPAddress &address)
+{
+    // Literal addresses need no lookup
+    if (address.fromString(this->hostname))
+    {
+        return true;
+    }
+
+    uint32_t cached = 0;
+    DnsCacheResult result = this->dns_cache.lookup(this->hostname, millis(), cached);
+    if (result == DnsCacheResult::Hit)
+    {
+        address = IPAddress(cached);
+        return true;
+    }
+
+    if (result == DnsCacheResult::Miss)
+    {
+        unsigned long started_at = millis();
+        this->dns_lookups++;
+        if (this->network.resolve(this->hostname, address))
+        {
+            this->dns_cache.store(this->hostname, (uint32_t)address, millis());
+            Serial.println("[Connection] Resolved " + String(this->hostname) + " to " + address.toString() + " in " + String(millis() - started_at) + " ms.");
+            return true;
+        }
+
+        Serial.println("[Connection] Could not resolve " + String(this->hostname) + ".");
+        this->dns_cache.storeFailure(this->hostname, millis());
+    }
+
+    // DNS is down, the server most likely did not move
+    if (this->dns_cache.lastKnownGood(this->hostname, cached))
+    {
+        address = IPAddress(cached);
+        Serial.println("[Connection] Using last known address " + address.toString() + ".");
+        return true;
+    }
+
+    return false;
+}
+
+void ConnectionManager::connect()
+{
+    IPAddress address;
+    if (!this->resolve(address))
+    {
+        this->connect_status = -5; // DOMAIN_NOT_FOUND
+        this->state = ConnectionState::Failed;
+        return;
+    }
+
+    // A single TCP connect and handshake. Connecting by hostname keeps it as the Host of
+    // the handshake, the pinned client opens the TCP connection to the resolved address.
+    this->tcp.pin(address);
+    this->websocket.protocol = "ws";
+    this->connect_status = this->websocket.connect(this->hostname, this->port);
+    this->tcp.unpin();
+
+    if (this->connect_status != 1)
+    {
+        // The server may have moved, look it up again next time
+        this->dns_cache.invalidate(this->hostname, millis());
+        this->websocket.stop();
+        this->state = ConnectionState::Failed;
+        return;
+    }
+
+    this->state = ConnectionState::Succeeded;
+}
+
+void ConnectionManager::startAttempt(const char *hostname, uint16_t port)
+{
+    strncpy(this->hostname, hostname, sizeof(this->hostname) - 1);
+    this->hostname[sizeof(this->hostname) - 1] = '\0';
+    this->port = port;
+
+    this->attempts++;
+    this->attempt_started_at = millis();
+    Serial.println("[Connection] Connecting to " + String(this->hostname) + ":" + String(this->port) + " (attempt " + String(this->backoff.failureCount() + 1) + ")...");
+
+    this->state = ConnectionState::Connecting;
+    xTaskNotifyGive(this->taskHandle);
+}
+
+void ConnectionManager::scheduleRetry()
+{
+    unsigned long delay_ms = this->backoff.next(esp_random());
+    this->retry_at = millis() + delay_ms;
+    this->state = ConnectionState::Waiting;
+    Serial.println("[Connection] Retrying in " + String(delay_ms) + " ms.");
+}
+
+bool ConnectionManager::poll(const char *hostname, uint16_t port)
+{
+    switch (this->state.load())
+    {
+    case ConnectionState::Connected:
+        if (this->websocket.connected())
+        {
+            return true;
+        }
+
+        Serial.println("[Connection] Connection lost after " + String((millis() - this->connected_at) / 1000) + " s.");
+        this->disconnect();
+        return false;
+
+    case ConnectionState::Succeeded:
+    {
+        unsigned long latency = millis() - this->attempt_started_at;
+        this->last_latency = latency;
+        this->max_latency = max(this->max_latency, latency);
+        this->connected_at = millis();
+        this->state = ConnectionState::Connected;
+        Serial.println("[Connection] Connected in " + String(latency) + " ms (" + String(this->attempts) + " attempts, " + String(this->failures) + " failed, max " + String(this->max_latency) + " ms).");
+        return true;
+    }
+
+    case ConnectionState::Failed:
+        this->failures++;
+        Serial.println("[Connection] Failed after " + String(millis() - this->attempt_started_at) + " ms: " + String(connectStatusName(this->connect_status)) + " (" + String(this->connect_status) + ").");
+        this->scheduleRetry();
+        return false;
+
+    case ConnectionState::Waiting:
+        if ((long)(millis() - this->retry_at) < 0)
+        {
+            return false;
+        }
+        this->startAttempt(hostname, port);
+        return false;
+
+    case ConnectionState::Idle:
+        this->startAttempt(hostname, port);
+        return false;
+
+    case ConnectionState::Connecting:
+    default:
+        return false;
+    }
+}
+
+void ConnectionManager::disconnect()
+{
+    if (this->state == ConnectionState::Connecting)
+    {
+        return;
+    }
+
+    if (this->state == ConnectionState::Connected)
+    {
+        // Only a connection that held resets the backoff, a server that accepts and
+        // closes right away is retried like a failed attempt
+        if (millis() - this->connected_at >= CONNECTION_STABLE_MS)
+        {
+            this->backoff.reset();
+        }
+        this->websocket.stop();
+    }
+
+    this->scheduleRetry();
+}
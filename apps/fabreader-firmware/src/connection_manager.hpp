@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <PicoWebsocket.h>
+#include "backoff.hpp"
+#include "dns_cache.hpp"
+#include "network_interface.hpp"
+#include "pinned_client.hpp"
+
+#define CONNECTION_BACKOFF_BASE_MS 1000 // First retry after 0.5 - 1 s
+#define CONNECTION_BACKOFF_MAX_MS 60000
+#define CONNECTION_STABLE_MS 30000 // Connections that lasted this long reset the backoff
+#define CONNECTION_TASK_STACK_SIZE 4096
+
+enum class ConnectionState : uint8_t
+{
+    Idle,       // Not connected, no attempt scheduled
+    Waiting,    // Backing off until retry_at
+    Connecting, // Connect task is running an attempt
+    Failed,     // Attempt finished without a connection
+    Succeeded,  // Attempt finished with a connection
+    Connected,
+};
+
+// Opens the websocket connection from a separate task so DNS, the TCP connect and the
+// handshake never block the main loop and NFC scanning. Resolved addresses are cached,
+// reconnects within DNS_CACHE_TTL_MS skip DNS. The TCP connection goes to the cached
+// address while the handshake uses the hostname. poll() is called from the
+// main loop; the websocket is only touched by the task while Connecting and only by
+// the main loop otherwise.
+class ConnectionManager
+{
+public:
+    ConnectionManager(PicoWebsocket::Client &websocket, PinnedClient &tcp, NetworkInterface &network) : websocket(websocket), tcp(tcp), network(network), backoff(CONNECTION_BACKOFF_BASE_MS, CONNECTION_BACKOFF_MAX_MS) {}
+
+    void setup();
+
+    // Returns true while connected, otherwise starts an attempt once the backoff passed
+    bool poll(const char *hostname, uint16_t port);
+
+    uint32_t attemptCount() const { return this->attempts; }
+    uint32_t failureCount() const { return this->failures; }
+    unsigned long lastLatency() const { return this->last_latency; } // ms, last successful attempt
+    unsigned long maxLatency() const { return this->max_latency; }
+    uint32_t dnsLookupCount() const { return this->dns_lookups; }
+
+    // Closes the connection and retries after the backoff
+    void disconnect();
+
+private:
+    PicoWebsocket::Client &websocket;
+    PinnedClient &tcp; // Underlying client of websocket
+    NetworkInterface &network;
+    Backoff backoff;
+    DnsCache dns_cache; // Only used by the connect task
+    TaskHandle_t taskHandle = NULL;
+    std::atomic<ConnectionState> state{ConnectionState::Idle};
+
+    // Target of the running attempt, copied because the settings may change meanwhile
+    char hostname[32];
+    uint16_t port = 0;
+    int connect_status = 0;
+
+    unsigned long attempt_started_at = 0;
+    unsigned long connected_at = 0;
+    unsigned long retry_at = 0;
+
+    uint32_t attempts = 0;
+    uint32_t failures = 0;
+    unsigned long last_latency = 0;
+    unsigned long max_latency = 0;
+    uint32_t dns_lookups = 0;
+
+    static void task(void *parameter);
+    void connect();
+    bool resolve(IPAddress &address);
+    void startAttempt(const char *hostname, uint16_t port);
+    void scheduleRetry();
+};
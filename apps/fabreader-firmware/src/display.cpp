@@ -12,7 +12,10 @@ void Display::setup()
     uint8_t display_init_cmd = SSD1306_SWITCHCAPVCC;
 #endif
 
-    display.begin(display_init_cmd, 0x3C);
+    {
+        I2CBusLock lock(I2C_DEVICE_DISPLAY);
+        screen.begin(display_init_cmd, SCREEN_I2C_ADDRESS);
+    }
 
     display.clearDisplay();
 
@@ -21,84 +24,224 @@ void Display::setup()
     uint8_t x = (display.width() - boot_logo_width) / 2;
     uint8_t y = (display.height() - boot_logo_height) / 2;
     display.drawBitmap(x, y, icon_boot_logo, boot_logo_width, boot_logo_height, WHITE);
-    display.display();
+    this->flush(true);
 
     Serial.println("[Display] SSD1306 initialized");
 }
 
 void Display::loop()
 {
+    unsigned long now = millis();
     unsigned long boot_end_time = this->boot_time + 2000;
 
-    if (millis() < boot_end_time)
+    if (now < boot_end_time)
+    {
+        return;
+    }
+
+    // Redraw only when the state changed or a message ran out
+    uint32_t version = this->published.version();
+    if (version == this->rendered_version && (this->redraw_at == 0 || now < this->redraw_at))
+    {
+        return;
+    }
+
+    // A setter is publishing, take the new state next frame
+    if (!this->published.read(this->frame, version))
     {
         return;
     }
 
+    this->rendered_version = version;
+    this->redraw_at = 0;
+    if (this->frame.error_end_at > now)
+    {
+        this->redraw_at = this->frame.error_end_at;
+    }
+    if (this->frame.success_end_at > now && (this->redraw_at == 0 || this->frame.success_end_at < this->redraw_at))
+    {
+        this->redraw_at = this->frame.success_end_at;
+    }
+
     draw_main_elements();
 
-    if (this->error_end_at > millis())
+    if (this->frame.error_end_at > now)
     {
         this->leds->setBlinking(CRGB::Red, 1000);
         this->draw_error_ui();
     }
-    else if (this->success_end_at > millis())
+    else if (this->frame.success_end_at > now)
     {
         this->leds->setBlinking(CRGB::Green, 1000);
         this->draw_success_ui();
     }
-    else if (!this->is_network_connected)
+    else if (!this->frame.is_network_connected)
     {
         this->leds->setBlinking(CRGB::Yellow, 500);
         this->draw_network_connecting_ui();
     }
-    else if (!this->is_api_connected)
+    else if (!this->frame.is_api_connected && this->frame.is_offline_mode)
+    {
+        this->leds->setBreathing(CRGB::Orange, 500);
+        this->draw_nfc_tap_ui();
+    }
+    else if (!this->frame.is_api_connected)
     {
         this->leds->setBlinking(CRGB::Blue, 500);
         this->draw_api_connecting_ui();
     }
-    else if (this->is_nfc_tap_enabled)
+    else if (this->frame.is_nfc_tap_enabled)
     {
         this->leds->setBreathing(CRGB::White, 500);
         this->draw_nfc_tap_ui();
     }
-    else if (this->is_displaying_text)
+    else if (this->frame.is_displaying_text)
     {
         this->leds->setOn(CRGB::Blue);
         this->draw_text_ui();
     }
 
-    display.display();
+    this->flush();
+}
+
+// Sends the pages that differ from what the controller shows, all of them if full
+void Display::flush(bool full)
+{
+#ifdef SCREEN_DRIVER_SH1106
+    for (uint8_t page = 0; page < SCREEN_PAGES; page++)
+    {
+        const uint8_t *current = display.getPage(page);
+        uint8_t *sent = this->sent_frame + page * SCREEN_WIDTH;
+        uint8_t from = 0;
+        uint8_t to = SCREEN_WIDTH;
+        if (!full && !PageDiff::find(current, sent, SCREEN_WIDTH, from, to))
+        {
+            continue;
+        }
+
+        this->send_page(page, from, to);
+        PageDiff::commit(current, sent, from, to);
+    }
+#elif SCREEN_DRIVER_SSD1306
+    if (!full && memcmp(this->sent_frame, display.getBuffer(), sizeof(this->sent_frame)) == 0)
+    {
+        return;
+    }
+
+    // The SSD1306 driver sends its whole buffer at once
+    I2CBusLock lock(I2C_DEVICE_DISPLAY);
+    memcpy(screen.getBuffer(), display.getBuffer(), sizeof(this->sent_frame));
+    screen.display();
+    memcpy(this->sent_frame, display.getBuffer(), sizeof(this->sent_frame));
+#endif
 }
 
+#ifdef SCREEN_DRIVER_SH1106
+// Every transaction takes the bus on its own, so a PN532 frame waits for at most one chunk
+void Display::send_page(uint8_t page, uint8_t from, uint8_t to)
+{
+    const uint8_t *data = display.getPage(page);
+    uint8_t column = from + SH1106_COLUMN_OFFSET;
+
+    {
+        I2CBusLock lock(I2C_DEVICE_DISPLAY);
+        Wire.beginTransmission(SCREEN_I2C_ADDRESS);
+        Wire.write(0x00); // Command stream
+        Wire.write(0xB0 | page);
+        Wire.write(column & 0x0F);
+        Wire.write(0x10 | (column >> 4));
+        Wire.endTransmission();
+    }
+
+    for (uint8_t x = from; x < to; x += SCREEN_CHUNK_SIZE)
+    {
+        uint8_t length = min(to - x, SCREEN_CHUNK_SIZE);
+
+        I2CBusLock lock(I2C_DEVICE_DISPLAY);
+        Wire.beginTransmission(SCREEN_I2C_ADDRESS);
+        Wire.write(0x40); // Data stream
+        Wire.write(data + x, length);
+        Wire.endTransmission();
+    }
+}
+#endif
+
 void Display::set_nfc_tap_enabled(bool enabled)
 {
-    this->is_nfc_tap_enabled = enabled;
+    if (this->update(this->state.is_nfc_tap_enabled, enabled))
+    {
+        this->publish();
+    }
 }
 
-void Display::set_nfc_tap_text(String text)
+void Display::set_nfc_tap_text(const char *text)
 {
-    this->nfc_tap_text = text;
+    if (this->update_text(this->state.nfc_tap_text, text))
+    {
+        this->publish();
+    }
 }
 
 void Display::set_network_connected(bool connected)
 {
-    this->is_network_connected = connected;
+    if (this->update(this->state.is_network_connected, connected))
+    {
+        this->publish();
+    }
 }
 
 void Display::set_api_connected(bool connected)
 {
-    this->is_api_connected = connected;
+    if (this->update(this->state.is_api_connected, connected))
+    {
+        this->publish();
+    }
+}
+
+void Display::set_offline_mode(bool offline)
+{
+    if (this->update(this->state.is_offline_mode, offline))
+    {
+        this->publish();
+    }
 }
 
 void Display::set_ip_address(IPAddress ip)
 {
-    this->ip_address = ip;
+    bool changed = false;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        changed |= this->update(this->state.ip_address[i], ip[i]);
+    }
+
+    if (changed)
+    {
+        this->publish();
+    }
+}
+
+void Display::set_device_name(const char *name)
+{
+    if (this->update_text(this->state.device_name, name))
+    {
+        this->publish();
+    }
+}
+
+bool Display::update_text(char *field, const char *value)
+{
+    if (strncmp(field, value, UI_TEXT_LENGTH - 1) == 0)
+    {
+        return false;
+    }
+    strncpy(field, value, UI_TEXT_LENGTH - 1);
+    field[UI_TEXT_LENGTH - 1] = '\0';
+    return true;
 }
 
-void Display::set_device_name(String name)
+void Display::publish()
 {
-    this->device_name = name;
+    this->published.write(this->state);
 }
 
 void Display::draw_nfc_tap_ui()
@@ -110,7 +253,7 @@ void Display::draw_nfc_tap_ui()
     // calculate width and height of text
     int16_t x1, y1;
     uint16_t w, h;
-    display.getTextBounds(this->nfc_tap_text, 0, 0, &x1, &y1, &w, &h);
+    display.getTextBounds(this->frame.nfc_tap_text, 0, 0, &x1, &y1, &w, &h);
 
     uint8_t center_x = SCREEN_WIDTH / 2;
     uint8_t center_y = SCREEN_HEIGHT / 2;
@@ -120,7 +263,7 @@ void Display::draw_nfc_tap_ui()
 
     // text below the icon
     display.setCursor(center_x - (w / 2), center_y + (icon_height / 2) - h + 5);
-    display.print(this->nfc_tap_text);
+    display.print(this->frame.nfc_tap_text);
 }
 
 void Display::draw_main_elements()
@@ -130,7 +273,7 @@ void Display::draw_main_elements()
     display.setTextColor(WHITE);
 
     // network status, top left
-    if (this->is_network_connected)
+    if (this->frame.is_network_connected)
     {
         display.drawBitmap(1, 0, icon_wifi_on, 16, 16, WHITE);
     }
@@ -140,7 +283,7 @@ void Display::draw_main_elements()
     }
 
     // api status, next to network status
-    if (this->is_api_connected)
+    if (this->frame.is_api_connected)
     {
         display.drawBitmap(17, 0, icon_api_connected, 16, 16, WHITE);
     }
@@ -152,9 +295,9 @@ void Display::draw_main_elements()
     // device name, bottom left
     int16_t x1, y1;
     uint16_t w, h;
-    display.getTextBounds(this->device_name, 0, 0, &x1, &y1, &w, &h);
+    display.getTextBounds(this->frame.device_name, 0, 0, &x1, &y1, &w, &h);
     display.setCursor(1, SCREEN_HEIGHT - h - 1);
-    display.print(this->device_name);
+    display.print(this->frame.device_name);
 }
 
 void Display::draw_network_connecting_ui()
@@ -164,20 +307,23 @@ void Display::draw_network_connecting_ui()
 
 void Display::draw_api_connecting_ui()
 {
-    this->draw_two_line_message("wait for API...", this->ip_address.toString());
+    const uint8_t *ip = this->frame.ip_address;
+    char address[16];
+    snprintf(address, sizeof(address), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    this->draw_two_line_message("wait for API...", address);
 }
 
 void Display::draw_error_ui()
 {
-    this->draw_two_line_message("Error", this->error);
+    this->draw_two_line_message("Error", this->frame.error);
 }
 
 void Display::draw_success_ui()
 {
-    this->draw_two_line_message("Success", this->success);
+    this->draw_two_line_message("Success", this->frame.success);
 }
 
-void Display::draw_two_line_message(String line1, String line2)
+void Display::draw_two_line_message(const char *line1, const char *line2)
 {
     display.setTextSize(1);
     display.setTextColor(WHITE);
@@ -200,32 +346,43 @@ void Display::draw_two_line_message(String line1, String line2)
     display.print(line2);
 }
 
-void Display::show_error(String error, unsigned long duration)
+void Display::show_error(const char *error, unsigned long duration)
 {
-    this->error = error;
+    this->update_text(this->state.error, error);
 
-    this->error_end_at = millis() + duration;
+    this->state.error_end_at = millis() + duration;
+    this->publish();
 }
 
-void Display::show_success(String success, unsigned long duration)
+void Display::show_success(const char *success, unsigned long duration)
 {
-    this->success = success;
+    this->update_text(this->state.success, success);
 
-    this->success_end_at = millis() + duration;
+    this->state.success_end_at = millis() + duration;
+    this->publish();
 }
 
 void Display::show_text(bool show)
 {
-    this->is_displaying_text = show;
+    if (this->update(this->state.is_displaying_text, show))
+    {
+        this->publish();
+    }
 }
 
-void Display::set_text(String lineOne, String lineTwo)
+void Display::set_text(const char *lineOne, const char *lineTwo)
 {
-    this->text_line_one = lineOne;
-    this->text_line_two = lineTwo;
+    // Both lines in one snapshot
+    bool changed = this->update_text(this->state.text_line_one, lineOne);
+    changed |= this->update_text(this->state.text_line_two, lineTwo);
+
+    if (changed)
+    {
+        this->publish();
+    }
 }
 
 void Display::draw_text_ui()
 {
-    this->draw_two_line_message(this->text_line_one, this->text_line_two);
+    this->draw_two_line_message(this->frame.text_line_one, this->frame.text_line_two);
 }
\ No newline at end of file
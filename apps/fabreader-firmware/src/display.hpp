@@ -13,14 +13,44 @@
 #error "No display driver defined"
 #endif
 #include "configuration.hpp"
+#include "frame_buffer.hpp"
+#include "i2c_bus.hpp"
+#include "page_diff.hpp"
+#include "seqlock.hpp"
+
+#define SCREEN_I2C_ADDRESS 0x3C
+#define SCREEN_CHUNK_SIZE 16    // Data bytes per bus transaction of a flush
+#define SH1106_COLUMN_OFFSET 2  // The 128 visible columns are centered in the 132 column RAM
+
+#define UI_TEXT_LENGTH 64 // PROTOCOL_TEXT_LENGTH, longer texts are cut off
+
+// Everything a frame is drawn from. Plain data without heap storage, so the display task
+// gets a consistent copy from SeqLock while the main loop publishes changes.
+struct UIState
+{
+    bool is_network_connected = false;
+    bool is_api_connected = false;
+    bool is_offline_mode = false;
+    bool is_nfc_tap_enabled = false;
+    char nfc_tap_text[UI_TEXT_LENGTH] = "-- no text --";
+    uint8_t ip_address[4] = {0, 0, 0, 0};
+    char device_name[UI_TEXT_LENGTH] = "-";
+    char error[UI_TEXT_LENGTH] = "";
+    char success[UI_TEXT_LENGTH] = "";
+    uint32_t error_end_at = 0;
+    uint32_t success_end_at = 0;
+    bool is_displaying_text = false;
+    char text_line_one[UI_TEXT_LENGTH] = "";
+    char text_line_two[UI_TEXT_LENGTH] = "";
+};
 
 class Display
 {
 public:
 #ifdef SCREEN_DRIVER_SH1106
-    Display(Leds *leds) : display(SCREEN_RESET), leds(leds) {}
+    Display(Leds *leds) : screen(SCREEN_RESET), leds(leds) {}
 #elif SCREEN_DRIVER_SSD1306
-    Display(Leds *leds) : display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, SCREEN_RESET), leds(leds) {}
+    Display(Leds *leds) : screen(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, SCREEN_RESET), leds(leds) {}
 #endif
 
     ~Display() {}
@@ -28,40 +58,43 @@ public:
     void setup();
     void loop();
 
+    // Called from the main loop only, the display task draws from published snapshots
     void set_nfc_tap_enabled(bool enabled);
-    void set_nfc_tap_text(String text);
+    void set_nfc_tap_text(const char *text);
     void set_network_connected(bool connected);
     void set_api_connected(bool connected);
+    // Taps are decided by the reader while the server is unreachable
+    void set_offline_mode(bool offline);
     void set_ip_address(IPAddress ip);
-    void set_device_name(String name);
-    void show_error(String error, unsigned long duration = 0);
-    void show_success(String success, unsigned long duration = 0);
+    void set_device_name(const char *name);
+    void show_error(const char *error, unsigned long duration = 0);
+    void show_success(const char *success, unsigned long duration = 0);
     void show_text(bool show);
-    void set_text(String lineOne, String lineTwo);
+    void set_text(const char *lineOne, const char *lineTwo);
 
 private:
+    // The driver only initializes the controller, frames are drawn into display and
+    // sent by flush()
 #ifdef SCREEN_DRIVER_SH1106
-    Adafruit_SH1106 display;
+    Adafruit_SH1106 screen;
 #elif SCREEN_DRIVER_SSD1306
-    Adafruit_SSD1306 display;
+    Adafruit_SSD1306 screen;
 #endif
+    FrameBuffer display;
 
     unsigned long boot_time = 0;
 
+    // Setters change state and publish it when a field changed. loop() only draws a frame
+    // when the published version moved on or a message times out at redraw_at, flush()
+    // then sends what differs from sent_frame.
+    UIState state;                      // Main loop
+    SeqLock<UIState> published;
+    UIState frame;                      // Display task, the snapshot being drawn
+    uint32_t rendered_version = UINT32_MAX; // Versions are even
+    unsigned long redraw_at = 0;
+    uint8_t sent_frame[SCREEN_WIDTH * SCREEN_PAGES];
+
     Leds *leds;
-    bool is_network_connected = false;
-    bool is_api_connected = false;
-    bool is_nfc_tap_enabled = false;
-    String nfc_tap_text = "-- no text --";
-    IPAddress ip_address;
-    String device_name = "-";
-    String error = "";
-    String success = "";
-    unsigned long error_end_at = 0;
-    unsigned long success_end_at = 0;
-    bool is_displaying_text = false;
-    String text_line_one = "";
-    String text_line_two = "";
 
     void draw_main_elements();
     void draw_nfc_tap_ui();
@@ -71,5 +104,24 @@ private:
     void draw_success_ui();
     void draw_text_ui();
 
-    void draw_two_line_message(String line1, String line2);
+    void draw_two_line_message(const char *line1, const char *line2);
+
+    // True if the field changed, publish() afterwards
+    template <typename T>
+    bool update(T &field, const T &value)
+    {
+        if (field == value)
+        {
+            return false;
+        }
+        field = value;
+        return true;
+    }
+    bool update_text(char *field, const char *value);
+    void publish();
+
+    void flush(bool full = false);
+#ifdef SCREEN_DRIVER_SH1106
+    void send_page(uint8_t page, uint8_t from, uint8_t to);
+#endif
 };
\ No newline at end of file
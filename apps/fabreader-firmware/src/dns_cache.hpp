@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define DNS_CACHE_ENTRIES 2
+#define DNS_CACHE_HOSTNAME_LENGTH 32 // Matches ApiConfig::hostname
+#define DNS_CACHE_TTL_MS 300000      // The Arduino resolvers don't report record TTLs
+#define DNS_CACHE_NEGATIVE_TTL_MS 30000
+
+enum class DnsCacheResult : uint8_t
+{
+    Miss,     // Resolve the hostname
+    Hit,      // Address is fresh
+    Negative, // Resolution failed recently, don't retry yet
+};
+
+// Remembers resolved IPv4 addresses so reconnects skip DNS. Failed lookups are cached as
+// well, and the last address that worked stays available as a fallback while the resolver
+// fails. Times are millis().
+class DnsCache
+{
+public:
+    DnsCacheResult lookup(const char *hostname, uint32_t now, uint32_t &address) const
+    {
+        const Entry *entry = this->find(hostname);
+        if (entry == nullptr || (int32_t)(now - entry->expires_at) >= 0)
+        {
+            return DnsCacheResult::Miss;
+        }
+        if (entry->negative)
+        {
+            return DnsCacheResult::Negative;
+        }
+
+        address = entry->address;
+        return DnsCacheResult::Hit;
+    }
+
+    void store(const char *hostname, uint32_t address, uint32_t now)
+    {
+        Entry &entry = this->entryFor(hostname);
+        entry.address = address;
+        entry.has_address = true;
+        entry.negative = false;
+        entry.expires_at = now + DNS_CACHE_TTL_MS;
+    }
+
+    // Keeps the last known good address for lastKnownGood()
+    void storeFailure(const char *hostname, uint32_t now)
+    {
+        Entry &entry = this->entryFor(hostname);
+        entry.negative = true;
+        entry.expires_at = now + DNS_CACHE_NEGATIVE_TTL_MS;
+    }
+
+    // The server was not reachable at the cached address, resolve again on the next lookup
+    void invalidate(const char *hostname, uint32_t now)
+    {
+        Entry *entry = this->find(hostname);
+        if (entry != nullptr && !entry->negative)
+        {
+            entry->expires_at = now;
+        }
+    }
+
+    bool lastKnownGood(const char *hostname, uint32_t &address) const
+    {
+        const Entry *entry = this->find(hostname);
+        if (entry == nullptr || !entry->has_address)
+        {
+            return false;
+        }
+
+        address = entry->address;
+        return true;
+    }
+
+private:
+    struct Entry
+    {
+        char hostname[DNS_CACHE_HOSTNAME_LENGTH + 1];
+        uint32_t address;
+        uint32_t expires_at;
+        uint32_t used; // Replacement order
+        bool has_address;
+        bool negative;
+    };
+
+    Entry entries[DNS_CACHE_ENTRIES] = {};
+    uint32_t uses = 0;
+
+    const Entry *find(const char *hostname) const
+    {
+        for (uint8_t i = 0; i < DNS_CACHE_ENTRIES; i++)
+        {
+            if (this->entries[i].hostname[0] != '\0' && strncmp(this->entries[i].hostname, hostname, DNS_CACHE_HOSTNAME_LENGTH) == 0)
+            {
+                return &this->entries[i];
+            }
+        }
+        return nullptr;
+    }
+
+    Entry *find(const char *hostname)
+    {
+        return const_cast<Entry *>(static_cast<const DnsCache *>(this)->find(hostname));
+    }
+
+    // Existing entry or the least recently stored one, cleared
+    Entry &entryFor(const char *hostname)
+    {
+        Entry *entry = this->find(hostname);
+        if (entry == nullptr)
+        {
+            entry = &this->entries[0];
+            for (uint8_t i = 1; i < DNS_CACHE_ENTRIES; i++)
+            {
+                if (this->entries[i].used < entry->used)
+                {
+                    entry = &this->entries[i];
+                }
+            }
+            memset(entry, 0, sizeof(Entry));
+            strncpy(entry->hostname, hostname, DNS_CACHE_HOSTNAME_LENGTH);
+        }
+        entry->used = ++this->uses;
+        return *entry;
+    }
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Events recorded while the reader is offline, replayed in order once it is connected
+// again. New records go into a RAM ring; when it is full the oldest record moves to a
+// flash segment, so records that were spilled survive a reboot. Sequence numbers only
+// grow, also across reboots, the server acknowledges a sequence and everything up to it
+// is removed. Storage is behind JournalSegment.
+
+#define JOURNAL_RAM_RECORDS 16
+#define JOURNAL_SEGMENT_RECORDS 256 // Bounds the flash usage to 6 KB
+#define JOURNAL_DATA_SIZE 10        // Fits NFC_MAX_UID_LENGTH
+#define JOURNAL_SEQUENCE_BLOCK 64   // Sequences reserved per write, a reboot skips the unused ones
+
+#define JOURNAL_FLAG_PREVIOUS_BOOT 0x01  // timestamp is from before the last reboot, set by peek()
+#define JOURNAL_FLAG_GRANTED_OFFLINE 0x02 // The reader decided a tap itself, see OfflineAuthSet
+#define JOURNAL_FLAG_DENIED_OFFLINE 0x04
+
+struct JournalRecord
+{
+    uint32_t sequence;
+    uint32_t timestamp; // millis() when recorded
+    uint8_t type;       // EventType
+    uint8_t flags;      // JOURNAL_FLAG_*
+    uint8_t length;
+    uint8_t data[JOURNAL_DATA_SIZE]; // Card UID or key
+};
+
+// Append only record storage
+class JournalSegment
+{
+public:
+    virtual ~JournalSegment() {}
+    virtual uint16_t count() = 0;
+    virtual bool read(uint16_t index, JournalRecord &record) = 0;
+    virtual bool append(const JournalRecord &record) = 0;
+    virtual void clear() = 0;
+
+    // First sequence not reserved yet, 0 if none was stored. Kept apart from the records,
+    // clear() does not reset it.
+    virtual uint32_t loadSequence() = 0;
+    virtual bool storeSequence(uint32_t sequence) = 0;
+};
+
+class EventJournal
+{
+public:
+    EventJournal(JournalSegment &segment) : segment(segment) {}
+
+    // Picks up the records a previous boot spilled to the segment. Sequences continue after
+    // the ones reserved before the reboot, even if the segment is empty by now.
+    void begin()
+    {
+        this->segment_count = this->segment.count();
+        this->segment_acknowledged = 0;
+        this->previous_boot = this->segment_count;
+
+        JournalRecord last;
+        if (this->segment_count > 0 && this->segment.read(this->segment_count - 1, last))
+        {
+            this->next_sequence = last.sequence + 1;
+        }
+
+        uint32_t reserved = this->segment.loadSequence();
+        if (reserved != 0 && after(reserved, this->next_sequence))
+        {
+            this->next_sequence = reserved;
+        }
+        this->reserved_until = this->next_sequence;
+    }
+
+    // Returns false and drops the event if RAM and segment are full
+    bool record(uint8_t type, const uint8_t *data, uint8_t length, uint32_t now, uint8_t flags = 0)
+    {
+        if (this->ram_count == JOURNAL_RAM_RECORDS && !this->spill())
+        {
+            this->dropped++;
+            return false;
+        }
+
+        // A failed write is retried with the next record, numbering goes on regardless
+        if (!after(this->reserved_until, this->next_sequence) &&
+            this->segment.storeSequence(this->next_sequence + JOURNAL_SEQUENCE_BLOCK))
+        {
+            this->reserved_until = this->next_sequence + JOURNAL_SEQUENCE_BLOCK;
+        }
+
+        JournalRecord &record = this->ram[(this->ram_head + this->ram_count) % JOURNAL_RAM_RECORDS];
+        record.sequence = this->next_sequence++;
+        record.timestamp = now;
+        record.type = type;
+        record.flags = flags & ~JOURNAL_FLAG_PREVIOUS_BOOT;
+        record.length = length < JOURNAL_DATA_SIZE ? length : JOURNAL_DATA_SIZE;
+        memset(record.data, 0, sizeof(record.data));
+        memcpy(record.data, data, record.length);
+        this->ram_count++;
+        return true;
+    }
+
+    // Copies up to max of the oldest unacknowledged records, returns the count
+    uint8_t peek(JournalRecord *out, uint8_t max)
+    {
+        uint8_t copied = 0;
+        for (uint16_t i = this->segment_acknowledged; i < this->segment_count && copied < max; i++)
+        {
+            if (!this->segment.read(i, out[copied]))
+            {
+                break;
+            }
+            if (i < this->previous_boot)
+            {
+                out[copied].flags |= JOURNAL_FLAG_PREVIOUS_BOOT;
+            }
+            copied++;
+        }
+
+        for (uint8_t i = 0; i < this->ram_count && copied < max; i++)
+        {
+            out[copied++] = this->ram[(this->ram_head + i) % JOURNAL_RAM_RECORDS];
+        }
+        return copied;
+    }
+
+    // Removes every record up to and including sequence
+    void acknowledge(uint32_t sequence)
+    {
+        JournalRecord record;
+        while (this->segment_acknowledged < this->segment_count &&
+               this->segment.read(this->segment_acknowledged, record) && !after(record.sequence, sequence))
+        {
+            this->segment_acknowledged++;
+        }
+
+        // The segment is append only, it is dropped once all of it was acknowledged
+        if (this->segment_count > 0 && this->segment_acknowledged == this->segment_count)
+        {
+            this->segment.clear();
+            this->segment_count = 0;
+            this->segment_acknowledged = 0;
+            this->previous_boot = 0;
+        }
+
+        while (this->ram_count > 0 && !after(this->ram[this->ram_head].sequence, sequence))
+        {
+            this->ram_head = (this->ram_head + 1) % JOURNAL_RAM_RECORDS;
+            this->ram_count--;
+        }
+    }
+
+    // Records waiting for an acknowledgement
+    uint32_t size() const
+    {
+        return (uint32_t)(this->segment_count - this->segment_acknowledged) + this->ram_count;
+    }
+
+    uint32_t droppedCount() const
+    {
+        return this->dropped;
+    }
+
+private:
+    JournalSegment &segment;
+
+    JournalRecord ram[JOURNAL_RAM_RECORDS];
+    uint8_t ram_head = 0;
+    uint8_t ram_count = 0;
+
+    uint16_t segment_count = 0;        // Records in the segment
+    uint16_t segment_acknowledged = 0; // Leading segment records the server already has
+    uint16_t previous_boot = 0;        // Leading segment records from before the reboot
+
+    uint32_t next_sequence = 1;
+    uint32_t reserved_until = 1; // Sequences below are stored as used
+    uint32_t dropped = 0;
+
+    static bool after(uint32_t a, uint32_t b)
+    {
+        return (int32_t)(a - b) > 0;
+    }
+
+    // Moves the oldest RAM record to the segment
+    bool spill()
+    {
+        if (this->segment_count >= JOURNAL_SEGMENT_RECORDS || !this->segment.append(this->ram[this->ram_head]))
+        {
+            return false;
+        }
+
+        this->segment_count++;
+        this->ram_head = (this->ram_head + 1) % JOURNAL_RAM_RECORDS;
+        this->ram_count--;
+        return true;
+    }
+};
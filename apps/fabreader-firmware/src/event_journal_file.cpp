@@ -0,0 +1,119 @@
+#include "event_journal_file.hpp"
+
+bool FileJournalSegment::setup()
+{
+    this->mounted = LittleFS.begin(true);
+    if (!this->mounted)
+    {
+        Serial.println("[Journal] Could not mount LittleFS, offline events are kept in RAM only.");
+    }
+    return this->mounted;
+}
+
+uint16_t FileJournalSegment::count()
+{
+    if (!this->mounted)
+    {
+        return 0;
+    }
+
+    if (this->cached_count < 0)
+    {
+        File file = LittleFS.open(JOURNAL_FILE_PATH, "r");
+        this->cached_count = file ? file.size() / sizeof(JournalRecord) : 0;
+        if (file)
+        {
+            file.close();
+        }
+    }
+    return this->cached_count;
+}
+
+bool FileJournalSegment::read(uint16_t index, JournalRecord &record)
+{
+    if (!this->mounted || index >= this->count())
+    {
+        return false;
+    }
+
+    File file = LittleFS.open(JOURNAL_FILE_PATH, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool ok = file.seek(index * sizeof(JournalRecord)) && file.read((uint8_t *)&record, sizeof(JournalRecord)) == sizeof(JournalRecord);
+    file.close();
+    return ok;
+}
+
+bool FileJournalSegment::append(const JournalRecord &record)
+{
+    if (!this->mounted)
+    {
+        return false;
+    }
+
+    // Written at the next whole record, which also overwrites what a failed write left
+    uint16_t count = this->count();
+    File file = LittleFS.open(JOURNAL_FILE_PATH, count > 0 ? "r+" : "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool ok = file.seek(count * sizeof(JournalRecord)) && file.write((const uint8_t *)&record, sizeof(JournalRecord)) == sizeof(JournalRecord);
+    file.close();
+
+    this->cached_count = ok ? count + 1 : -1;
+    return ok;
+}
+
+void FileJournalSegment::clear()
+{
+    if (this->mounted)
+    {
+        LittleFS.remove(JOURNAL_FILE_PATH);
+    }
+    this->cached_count = 0;
+}
+
+uint32_t FileJournalSegment::loadSequence()
+{
+    if (!this->mounted)
+    {
+        return 0;
+    }
+
+    File file = LittleFS.open(JOURNAL_SEQUENCE_PATH, "r");
+    if (!file)
+    {
+        return 0;
+    }
+
+    uint32_t sequence = 0;
+    if (file.read((uint8_t *)&sequence, sizeof(sequence)) != sizeof(sequence))
+    {
+        sequence = 0;
+    }
+    file.close();
+    return sequence;
+}
+
+bool FileJournalSegment::storeSequence(uint32_t sequence)
+{
+    if (!this->mounted)
+    {
+        return false;
+    }
+
+    File file = LittleFS.open(JOURNAL_SEQUENCE_PATH, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool ok = file.write((const uint8_t *)&sequence, sizeof(sequence)) == sizeof(sequence);
+    file.close();
+    return ok;
+}
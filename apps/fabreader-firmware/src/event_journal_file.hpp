@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "event_journal.hpp"
+
+#define JOURNAL_FILE_PATH "/journal.bin"
+#define JOURNAL_SEQUENCE_PATH "/journal.seq"
+
+// JournalSegment in a LittleFS file of raw records, the reserved sequence in a second file
+class FileJournalSegment : public JournalSegment
+{
+public:
+    // Mounts LittleFS, the web server mounts it as well
+    bool setup();
+
+    uint16_t count() override;
+    bool read(uint16_t index, JournalRecord &record) override;
+    bool append(const JournalRecord &record) override;
+    void clear() override;
+    uint32_t loadSequence() override;
+    bool storeSequence(uint32_t sequence) override;
+
+private:
+    bool mounted = false;
+    int32_t cached_count = -1;
+};
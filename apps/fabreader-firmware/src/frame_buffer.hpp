@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include "configuration.hpp"
+
+#define SCREEN_PAGES (SCREEN_HEIGHT / 8) // SH1106/SSD1306 RAM pages of 8 pixel rows
+
+// Monochrome frame buffer in the RAM layout of the SH1106 and SSD1306, one byte per column
+// of an 8 row page, LSB on top. Display draws here and pushes pages to the controller
+// itself, so a flush can be split into short bus transactions.
+class FrameBuffer : public Adafruit_GFX
+{
+public:
+    FrameBuffer() : Adafruit_GFX(SCREEN_WIDTH, SCREEN_HEIGHT) { clearDisplay(); }
+
+    // No rotation, the display is mounted upright
+    void drawPixel(int16_t x, int16_t y, uint16_t color)
+    {
+        if (x < 0 || x >= SCREEN_WIDTH || y < 0 || y >= SCREEN_HEIGHT)
+        {
+            return;
+        }
+
+        uint8_t &byte = this->buffer[(y / 8) * SCREEN_WIDTH + x];
+        uint8_t bit = 1 << (y & 7);
+        if (color)
+        {
+            byte |= bit;
+        }
+        else
+        {
+            byte &= ~bit;
+        }
+    }
+
+    void clearDisplay() { memset(this->buffer, 0, sizeof(this->buffer)); }
+
+    uint8_t *getBuffer() { return this->buffer; }
+    const uint8_t *getPage(uint8_t page) const { return this->buffer + page * SCREEN_WIDTH; }
+
+private:
+    uint8_t buffer[SCREEN_WIDTH * SCREEN_PAGES];
+};
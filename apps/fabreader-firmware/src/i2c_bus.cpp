@@ -0,0 +1,109 @@
+#include "i2c_bus.hpp"
+
+#include <atomic>
+
+static const char *DeviceNames[I2C_DEVICE_COUNT] = {"PN532", "Display", "Keypad"};
+
+// Recursive, a driver call that holds the bus may call another one that locks again
+static SemaphoreHandle_t Lock = NULL;
+static std::atomic<uint8_t> NFCWaiting{0};
+
+// Written only by the holder of Lock
+static I2CBusStats Stats[I2C_DEVICE_COUNT];
+static uint8_t Depth = 0;
+static uint32_t AcquiredAt = 0;
+
+#ifdef I2C_BUS_STATS
+static unsigned long StatsPrintedAt = 0;
+#endif
+
+void I2CBus::setup(int sda, int scl, uint32_t frequency)
+{
+    Lock = xSemaphoreCreateRecursiveMutex();
+    Wire.begin(sda, scl, frequency);
+}
+
+void I2CBus::loop()
+{
+#ifdef I2C_BUS_STATS
+    if (millis() - StatsPrintedAt >= I2C_BUS_STATS_INTERVAL_MS)
+    {
+        StatsPrintedAt = millis();
+        printStats();
+    }
+#endif
+}
+
+void I2CBus::acquire(uint8_t device)
+{
+    uint32_t started_at = micros();
+
+    if (device == I2C_DEVICE_NFC)
+    {
+        NFCWaiting.fetch_add(1);
+    }
+    else
+    {
+        // Let a waiting PN532 go first, the mutex alone would hand the bus to the display
+        // task, which runs at a higher priority than the main loop
+        while (NFCWaiting.load() > 0 && xSemaphoreGetMutexHolder(Lock) != xTaskGetCurrentTaskHandle())
+        {
+            vTaskDelay(1);
+        }
+    }
+
+    xSemaphoreTakeRecursive(Lock, portMAX_DELAY);
+
+    if (device == I2C_DEVICE_NFC)
+    {
+        NFCWaiting.fetch_sub(1);
+    }
+
+    if (Depth++ > 0)
+    {
+        return;
+    }
+
+    uint32_t now = micros();
+    uint32_t waited = now - started_at;
+    I2CBusStats &stats = Stats[device];
+    stats.transactions++;
+    stats.wait_us += waited;
+    if (waited > stats.max_wait_us)
+    {
+        stats.max_wait_us = waited;
+    }
+    AcquiredAt = now;
+}
+
+void I2CBus::release(uint8_t device)
+{
+    if (--Depth == 0)
+    {
+        Stats[device].busy_us += micros() - AcquiredAt;
+    }
+
+    xSemaphoreGiveRecursive(Lock);
+}
+
+bool I2CBus::isNFCWaiting()
+{
+    return NFCWaiting.load() > 0;
+}
+
+void I2CBus::printStats()
+{
+    I2CBusStats snapshot[I2C_DEVICE_COUNT];
+    xSemaphoreTakeRecursive(Lock, portMAX_DELAY);
+    memcpy(snapshot, Stats, sizeof(snapshot));
+    xSemaphoreGiveRecursive(Lock);
+
+    Serial.println("[I2C] bus time per device since boot:");
+    for (uint8_t i = 0; i < I2C_DEVICE_COUNT; i++)
+    {
+        const I2CBusStats &stats = snapshot[i];
+        Serial.printf("  %s: n=%u busy=%llums wait avg=%uus max=%uus\n", DeviceNames[i], stats.transactions,
+                      stats.busy_us / 1000, stats.transactions ? (uint32_t)(stats.wait_us / stats.transactions) : 0,
+                      stats.max_wait_us);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Devices on the shared Wire bus, in the order the statistics are printed
+#define I2C_DEVICE_NFC 0     // PN532, preferred over the others
+#define I2C_DEVICE_DISPLAY 1 // SH1106/SSD1306 flushes, one chunk per transaction
+#define I2C_DEVICE_KEYPAD 2  // I2CKeyPad scans
+#define I2C_DEVICE_COUNT 3
+
+// Uncomment to periodically print bus and wait time per device
+// #define I2C_BUS_STATS
+#define I2C_BUS_STATS_INTERVAL_MS 60000
+
+struct I2CBusStats
+{
+    uint32_t transactions = 0;
+    uint64_t busy_us = 0;  // Time the device held the bus
+    uint64_t wait_us = 0;  // Time the device waited for another one to finish
+    uint32_t max_wait_us = 0;
+};
+
+// Owns Wire, which the display task, the main loop (PN532 and keypad) share. Every
+// transaction of a driver runs under the bus lock, so a display flush never interleaves
+// with a PN532 frame. While the PN532 waits for the bus, the other devices hold back
+// their next transaction, which bounds its wait to a single display chunk.
+class I2CBus
+{
+public:
+    // Call instead of Wire.begin(), before any driver is set up
+    static void setup(int sda, int scl, uint32_t frequency);
+
+    // Prints the statistics every I2C_BUS_STATS_INTERVAL_MS if I2C_BUS_STATS is defined
+    static void loop();
+
+    static void acquire(uint8_t device);
+    static void release(uint8_t device);
+
+    // True while the PN532 waits for the bus, long transfers should release it in between
+    static bool isNFCWaiting();
+
+    static void printStats();
+};
+
+// Holds the bus for the lifetime of the object
+class I2CBusLock
+{
+public:
+    explicit I2CBusLock(uint8_t device) : device(device) { I2CBus::acquire(device); }
+    ~I2CBusLock() { I2CBus::release(device); }
+
+    I2CBusLock(const I2CBusLock &) = delete;
+    I2CBusLock &operator=(const I2CBusLock &) = delete;
+
+private:
+    uint8_t device;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Fixed size ArduinoJson allocator. Blocks are handed out from a static buffer so
+// a document never grows the heap; an allocation that does not fit fails and the
+// parser reports NoMemory. Only the most recent block is freed or resized in
+// place, which is what ArduinoJson does while parsing. Call reset() once the
+// document using the arena was cleared.
+template <size_t capacity>
+class JsonArena : public ArduinoJson::Allocator
+{
+public:
+    void *allocate(size_t size) override
+    {
+        size_t total = HEADER_SIZE + align(size);
+        if (total > capacity - this->offset)
+        {
+            return nullptr;
+        }
+
+        uint8_t *block = this->buffer + this->offset;
+        *(size_t *)block = size;
+        this->last_offset = this->offset;
+        this->offset += total;
+        this->peak = max(this->peak, this->offset);
+        return block + HEADER_SIZE;
+    }
+
+    void deallocate(void *ptr) override
+    {
+        if (ptr != nullptr && this->isLast(ptr))
+        {
+            this->offset = this->last_offset;
+        }
+    }
+
+    void *reallocate(void *ptr, size_t new_size) override
+    {
+        if (ptr == nullptr)
+        {
+            return this->allocate(new_size);
+        }
+
+        // The last block can grow or shrink in place
+        if (this->isLast(ptr))
+        {
+            size_t total = HEADER_SIZE + align(new_size);
+            if (total > capacity - this->last_offset)
+            {
+                return nullptr;
+            }
+            *(size_t *)(this->buffer + this->last_offset) = new_size;
+            this->offset = this->last_offset + total;
+            this->peak = max(this->peak, this->offset);
+            return ptr;
+        }
+
+        size_t old_size = *(size_t *)((uint8_t *)ptr - HEADER_SIZE);
+        if (new_size <= old_size)
+        {
+            return ptr;
+        }
+
+        void *moved = this->allocate(new_size);
+        if (moved != nullptr)
+        {
+            memcpy(moved, ptr, old_size);
+        }
+        return moved;
+    }
+
+    void reset()
+    {
+        this->offset = 0;
+        this->last_offset = 0;
+    }
+
+    // Highest number of bytes in use since boot, to size the arena
+    size_t peakUsage() const
+    {
+        return this->peak;
+    }
+
+private:
+    static const size_t HEADER_SIZE = 8; // Keeps blocks 8 byte aligned
+
+    alignas(8) uint8_t buffer[capacity];
+    size_t offset = 0;
+    size_t last_offset = 0;
+    size_t peak = 0;
+
+    static size_t align(size_t size)
+    {
+        return (size + 7) & ~(size_t)7;
+    }
+
+    bool isLast(void *ptr) const
+    {
+        return this->offset > this->last_offset && ptr == this->buffer + this->last_offset + HEADER_SIZE;
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+#define KEY_NONE 16 // I2C_KEYPAD_NOKEY, no key pressed
+#define KEY_FAIL 17 // I2C_KEYPAD_FAIL, scan failed or more than one key
+
+struct KeyEvent
+{
+    uint8_t key; // Key number 0-15 of the 4x4 matrix
+    bool pressed;
+};
+
+// Turns raw keypad scans into press and release events. A key counts once the scans
+// returned it for debounce_ms, failed scans are ignored. Changing directly from one key
+// to another releases the first one before the second is pressed.
+class KeyDebouncer
+{
+public:
+    explicit KeyDebouncer(uint16_t debounce_ms) : debounce_ms(debounce_ms) {}
+
+    // True and the event if the scan at now completed a press or release
+    bool update(uint8_t raw, uint32_t now, KeyEvent &event)
+    {
+        if (raw == KEY_FAIL)
+        {
+            return false;
+        }
+
+        if (raw != this->candidate)
+        {
+            this->candidate = raw;
+            this->candidate_since = now;
+        }
+
+        if (this->candidate == this->stable || now - this->candidate_since < this->debounce_ms)
+        {
+            return false;
+        }
+
+        if (this->stable != KEY_NONE)
+        {
+            event.key = this->stable;
+            event.pressed = false;
+            this->stable = KEY_NONE;
+            return true;
+        }
+
+        event.key = this->candidate;
+        event.pressed = true;
+        this->stable = this->candidate;
+        return true;
+    }
+
+    // A key is held or about to be, keep scanning
+    bool isActive() const { return this->stable != KEY_NONE || this->candidate != KEY_NONE; }
+
+private:
+    uint16_t debounce_ms;
+    uint8_t stable = KEY_NONE;
+    uint8_t candidate = KEY_NONE;
+    uint32_t candidate_since = 0;
+};
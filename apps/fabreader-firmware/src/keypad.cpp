@@ -1,8 +1,19 @@
 #include "keypad.hpp"
 
+static void keypadTask(void *parameter)
+{
+    ((Keypad *)parameter)->scan();
+}
+
 void Keypad::setup()
 {
-    if (this->keyPad.begin() == false)
+    bool connected;
+    {
+        I2CBusLock lock(I2C_DEVICE_KEYPAD);
+        connected = this->keyPad.begin();
+    }
+
+    if (connected == false)
     {
         Serial.println("\nERROR: cannot communicate to keypad.\nPlease reboot.\n");
         while (1)
@@ -10,28 +21,67 @@ void Keypad::setup()
             delay(1000);
         }
     }
+
+    this->events = xQueueCreate(KEYPAD_QUEUE_LENGTH, sizeof(KeypadEvent));
+
+    xTaskCreate(
+        keypadTask,
+        "keypad",
+        2048,
+        this,
+        2,
+        &this->taskHandle);
+
+#if PIN_KEYPAD_INT >= 0
+    // The expander pulls INT low when an input changes
+    pinMode(PIN_KEYPAD_INT, INPUT_PULLUP);
+    attachInterruptArg(digitalPinToInterrupt(PIN_KEYPAD_INT), handleInterrupt, this, FALLING);
+#endif
 }
 
-char Keypad::readKey()
+void IRAM_ATTR Keypad::handleInterrupt(void *arg)
 {
-    uint8_t pressedKeyNum = this->keyPad.getKey();
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(((Keypad *)arg)->taskHandle, &woken);
+    portYIELD_FROM_ISR(woken);
+}
 
-    if (pressedKeyNum == this->released_key_num)
+void Keypad::scan()
+{
+    for (;;)
     {
-        return '\0'; // Return null character instead of undefined 'null'
-    }
-
-    char key = this->keymap[pressedKeyNum];
+        KeyEvent scanned;
+        if (this->debouncer.update(this->getKey(), millis(), scanned))
+        {
+            KeypadEvent event = {this->keymap[scanned.key], scanned.pressed};
+            Serial.println("Key " + String(event.pressed ? "pressed" : "released") + " (" + String(event.key) + ")");
 
-    Serial.println("Pressed key number: " + String(pressedKeyNum));
-    Serial.println("Key pressed (" + String(key) + ")");
+            // Dropped if the main loop is stuck, a late key press is worse than a lost one
+            xQueueSend(this->events, &event, 0);
+        }
 
-    while (this->keyPad.getKey() != this->released_key_num)
-    {
-        delay(10);
+#if PIN_KEYPAD_INT >= 0
+        if (!this->debouncer.isActive())
+        {
+            // Scanning drives the expander pins, which raised INT as well. A press that
+            // lands in between is picked up by the idle scan.
+            ulTaskNotifyTake(pdTRUE, 0);
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(KEYPAD_IDLE_SCAN_MS));
+            continue;
+        }
+#endif
+        vTaskDelay(pdMS_TO_TICKS(KEYPAD_SCAN_INTERVAL_MS));
     }
+}
 
-    Serial.println("Key released (" + String(key) + ")");
+bool Keypad::nextEvent(KeypadEvent &event)
+{
+    return this->events != NULL && xQueueReceive(this->events, &event, 0) == pdTRUE;
+}
 
-    return key;
-}
\ No newline at end of file
+// A scan is a write and a read per row and column, one bus transaction for the I2C bus
+uint8_t Keypad::getKey()
+{
+    I2CBusLock lock(I2C_DEVICE_KEYPAD);
+    return this->keyPad.getKey();
+}
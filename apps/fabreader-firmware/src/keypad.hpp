@@ -3,17 +3,46 @@
 #include <Arduino.h>
 #include <I2CKeyPad.h>
 #include "configuration.hpp"
+#include "i2c_bus.hpp"
+#include "key_debouncer.hpp"
 
+#define KEYPAD_SCAN_INTERVAL_MS 20 // While a key is down, or all the time without an INT pin
+#define KEYPAD_IDLE_SCAN_MS 1000   // With an INT pin, in case an interrupt was missed
+#define KEYPAD_DEBOUNCE_MS 30
+#define KEYPAD_QUEUE_LENGTH 16
+
+static_assert(KEY_NONE == I2C_KEYPAD_NOKEY && KEY_FAIL == I2C_KEYPAD_FAIL, "The debouncer takes I2CKeyPad scans as is");
+
+struct KeypadEvent
+{
+    char key;
+    bool pressed; // false when released
+};
+
+// Scans the keypad on its own task, woken by the expander's INT line if it is wired, and
+// queues debounced press and release events for the main loop.
 class Keypad
 {
 public:
-    Keypad() : keyPad(I2C_KEYPAD_ADDRESS) {}
+    Keypad() : keyPad(I2C_KEYPAD_ADDRESS), debouncer(KEYPAD_DEBOUNCE_MS) {}
 
     void setup();
-    char readKey();
+
+    // Next queued event without waiting, false if there is none
+    bool nextEvent(KeypadEvent &event);
+
+    // Keypad task, scans until no key is down and then waits for the next interrupt
+    void scan();
 
 private:
     I2CKeyPad keyPad;
+    KeyDebouncer debouncer;
     char keymap[17] = "DCBA#9630852*741";
-    char released_key_num = 16;
-};
\ No newline at end of file
+
+    QueueHandle_t events = NULL;
+    TaskHandle_t taskHandle = NULL;
+
+    uint8_t getKey();
+
+    static void IRAM_ATTR handleInterrupt(void *arg);
+};
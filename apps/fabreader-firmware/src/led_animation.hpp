@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdint.h>
+
+enum LED_STATE
+{
+    LED_STATE_OFF,
+    LED_STATE_ON,
+    LED_STATE_BLINKING,
+    LED_STATE_BREATHING,
+};
+
+#define LED_ANIMATION_STATIC UINT32_MAX // render() result while nothing changes until the next pattern
+#define LED_ANIMATION_FRAME_MS 16       // Breathing isn't updated faster than 60 Hz
+
+// Gamma corrected (2.2) raised cosine, the rising half of a breath
+static const uint8_t LED_BREATHING_CURVE[128] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 2, 2, 2, 3, 3, 3,
+    4, 4, 5, 6, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 17, 18,
+    20, 21, 23, 25, 27, 29, 31, 33, 35, 38, 40, 43, 45, 48, 51, 54,
+    57, 60, 63, 67, 70, 73, 77, 81, 84, 88, 92, 96, 100, 104, 108, 112,
+    116, 120, 124, 128, 133, 137, 141, 145, 150, 154, 158, 162, 167, 171, 175, 179,
+    183, 187, 191, 195, 199, 202, 206, 209, 213, 216, 219, 223, 226, 228, 231, 234,
+    236, 239, 241, 243, 245, 247, 248, 250, 251, 252, 253, 254, 254, 255, 255, 255,
+};
+
+struct LedPattern
+{
+    LED_STATE state = LED_STATE_OFF;
+    uint8_t red = 0;
+    uint8_t green = 0;
+    uint8_t blue = 0;
+    uint16_t interval = 0; // Blinking: on and off time, breathing: fade in and fade out time
+
+    bool operator==(const LedPattern &other) const
+    {
+        return state == other.state && red == other.red && green == other.green && blue == other.blue &&
+               interval == other.interval;
+    }
+    bool operator!=(const LedPattern &other) const { return !(*this == other); }
+};
+
+// Color of the LEDs over time for a pattern, and when it next changes so the LED task can
+// sleep until then.
+class LedAnimation
+{
+public:
+    void start(const LedPattern &pattern, uint32_t now)
+    {
+        this->pattern = pattern;
+        this->started_at = now;
+    }
+
+    // Writes the color at now to rgb, returns the ms until it changes or LED_ANIMATION_STATIC
+    uint32_t render(uint32_t now, uint8_t rgb[3]) const
+    {
+        uint32_t elapsed = now - this->started_at;
+        uint16_t interval = this->pattern.interval;
+
+        switch (this->pattern.state)
+        {
+        case LED_STATE_ON:
+            this->scale(255, rgb);
+            return LED_ANIMATION_STATIC;
+
+        case LED_STATE_BLINKING:
+            if (interval == 0)
+            {
+                this->scale(255, rgb);
+                return LED_ANIMATION_STATIC;
+            }
+            this->scale((elapsed / interval) % 2 == 0 ? 255 : 0, rgb);
+            return interval - elapsed % interval;
+
+        case LED_STATE_BREATHING:
+        {
+            if (interval == 0)
+            {
+                this->scale(255, rgb);
+                return LED_ANIMATION_STATIC;
+            }
+
+            uint32_t period = 2 * (uint32_t)interval;
+            uint32_t position = elapsed % period;
+            uint8_t level = breathingLevel(position, period);
+            this->scale(level, rgb);
+
+            // Frames that wouldn't change the level are skipped
+            uint32_t wait = LED_ANIMATION_FRAME_MS;
+            while (wait < period && breathingLevel((position + wait) % period, period) == level)
+            {
+                wait += LED_ANIMATION_FRAME_MS;
+            }
+            return wait;
+        }
+
+        default:
+            this->scale(0, rgb);
+            return LED_ANIMATION_STATIC;
+        }
+    }
+
+    static uint8_t breathingLevel(uint32_t position, uint32_t period)
+    {
+        uint8_t phase = (uint8_t)(position * 256 / period);
+        return LED_BREATHING_CURVE[phase < 128 ? phase : 255 - phase];
+    }
+
+private:
+    LedPattern pattern;
+    uint32_t started_at = 0;
+
+    void scale(uint8_t level, uint8_t rgb[3]) const
+    {
+        rgb[0] = (uint8_t)((this->pattern.red * (level + 1)) >> 8);
+        rgb[1] = (uint8_t)((this->pattern.green * (level + 1)) >> 8);
+        rgb[2] = (uint8_t)((this->pattern.blue * (level + 1)) >> 8);
+    }
+};
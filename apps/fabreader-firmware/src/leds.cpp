@@ -2,16 +2,13 @@
 
 void ledTask(void *parameter)
 {
-    const int REFRESH_RATE_HZ = 60;
-    const int MS_PER_SECOND = 1000;
-    const int LOOP_DELAY_MS = (MS_PER_SECOND / REFRESH_RATE_HZ) / portTICK_PERIOD_MS;
-
     Leds *leds = (Leds *)parameter;
 
     for (;;)
     {
-        leds->loop();
-        vTaskDelay(LOOP_DELAY_MS);
+        // Sleep until the animation changes the pixels or a new pattern is set
+        uint32_t wait_ms = leds->loop();
+        ulTaskNotifyTake(pdTRUE, wait_ms == LED_ANIMATION_STATIC ? portMAX_DELAY : pdMS_TO_TICKS(wait_ms));
     }
 }
 
@@ -30,110 +27,81 @@ void Leds::setup()
         &this->taskHandle);
 }
 
-void Leds::loop()
+uint32_t Leds::loop()
 {
-    switch (this->currentState)
-    {
-    case LED_STATE_OFF:
-        this->updateAnimationOff();
-        break;
-    case LED_STATE_ON:
-        this->updateAnimationOn();
-        break;
-    case LED_STATE_BLINKING:
-        this->updateAnimationBlinking();
-        break;
-    case LED_STATE_BREATHING:
-        this->updateAnimationBreathing();
-        break;
-    }
-    FastLED.show();
-}
+    uint32_t now = millis();
 
-void Leds::setOff()
-{
-    for (int i = 0; i < LED_COUNT; i++)
+    if (this->published.version() != this->started_version)
     {
-        leds[i] = CRGB::Black;
+        LedPattern pattern;
+        uint32_t version;
+        if (!this->published.read(pattern, version))
+        {
+            // The display task is setting a pattern, pick it up next frame
+            return LED_ANIMATION_FRAME_MS;
+        }
+
+        this->animation.start(pattern, now);
+        this->started_version = version;
     }
-    this->currentState = LED_STATE_OFF;
 
-    FastLED.setBrightness(LED_MAX_BRIGHTNESS);
-}
+    uint8_t rgb[3];
+    uint32_t next_change = this->animation.render(now, rgb);
 
-void Leds::updateAnimationOff()
-{
-    return;
-}
-
-void Leds::setOn(CRGB color)
-{
-    for (int i = 0; i < LED_COUNT; i++)
+    if (!this->has_shown || memcmp(rgb, this->shown, sizeof(rgb)) != 0)
     {
-        leds[i] = color;
+        for (int i = 0; i < LED_COUNT; i++)
+        {
+            leds[i] = CRGB(rgb[0], rgb[1], rgb[2]);
+        }
+        FastLED.show();
+
+        memcpy(this->shown, rgb, sizeof(rgb));
+        this->has_shown = true;
     }
-    this->currentState = LED_STATE_ON;
 
-    FastLED.setBrightness(LED_MAX_BRIGHTNESS);
+    return next_change;
 }
 
-void Leds::updateAnimationOn()
+void Leds::setPattern(LED_STATE state, CRGB color, int interval)
 {
-    return;
-}
-
-void Leds::setBlinking(CRGB color, int interval)
-{
-    this->currentColor = color;
-    this->currentInterval = interval;
-    this->currentState = LED_STATE_BLINKING;
-
-    FastLED.setBrightness(LED_MAX_BRIGHTNESS);
-}
-
-void Leds::updateAnimationBlinking()
-{
-    unsigned long currentTime = millis();
-
-    // if interval not reached, return
-    if (currentTime - this->lastUpdate < this->currentInterval)
+    LedPattern pattern;
+    pattern.state = state;
+    pattern.red = color.r;
+    pattern.green = color.g;
+    pattern.blue = color.b;
+    pattern.interval = interval;
+
+    if (pattern == this->requested)
     {
         return;
     }
 
-    // update last update time
-    this->lastUpdate = currentTime;
+    this->requested = pattern;
+    this->published.write(pattern);
 
-    // toggle led state
-    this->ledsAreOn = !this->ledsAreOn;
-
-    // set led state
-    for (int i = 0; i < LED_COUNT; i++)
+    if (this->taskHandle != NULL)
     {
-        leds[i] = this->ledsAreOn ? this->currentColor : CRGB::Black;
+        xTaskNotifyGive(this->taskHandle);
     }
 }
 
-void Leds::setBreathing(CRGB color, int interval)
+void Leds::setOff()
 {
-    this->currentColor = color;
-    this->currentInterval = interval;
-    this->currentState = LED_STATE_BREATHING;
-
-    FastLED.setBrightness(0);
+    this->setPattern(LED_STATE_OFF, CRGB::Black, 0);
+}
 
-    for (int i = 0; i < LED_COUNT; i++)
-    {
-        leds[i] = CRGB(this->currentColor);
-    }
+void Leds::setOn(CRGB color)
+{
+    this->setPattern(LED_STATE_ON, color, 0);
 }
 
-void Leds::updateAnimationBreathing()
+void Leds::setBlinking(CRGB color, int interval)
 {
-    // breath the color from black to the current color and back, calculate the change amount by time and interval
-    unsigned long currentTime = millis();
-    int percentagePassed = (currentTime - this->lastUpdate) / this->currentInterval;
-    int brightness = map(percentagePassed, 0, 100, 0, LED_MAX_BRIGHTNESS);
+    this->setPattern(LED_STATE_BLINKING, color, interval);
+}
 
-    FastLED.setBrightness(brightness);
+void Leds::setBreathing(CRGB color, int interval)
+{
+    this->setPattern(LED_STATE_BREATHING, color, interval);
 }
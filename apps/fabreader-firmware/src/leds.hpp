@@ -4,14 +4,8 @@
 #include <FastLED.h>
 
 #include "configs/fabreader.h"
-
-enum LED_STATE
-{
-    LED_STATE_OFF,
-    LED_STATE_ON,
-    LED_STATE_BLINKING,
-    LED_STATE_BREATHING,
-};
+#include "led_animation.hpp"
+#include "seqlock.hpp"
 
 class Leds
 {
@@ -19,8 +13,13 @@ public:
     Leds() {}
 
     void setup();
-    void loop();
 
+    // Renders the current pattern and shows it if a pixel changed, returns the ms until the
+    // next change or LED_ANIMATION_STATIC
+    uint32_t loop();
+
+    // Called from the display task. Setting the running pattern again keeps its animation
+    // going, a new one wakes the LED task.
     void setOff();
     void setOn(CRGB color);
     void setBlinking(CRGB color, int interval);
@@ -28,15 +27,14 @@ public:
 
 private:
     CRGB leds[LED_COUNT];
-    CRGB currentColor;
-    int currentInterval;
-    LED_STATE currentState;
-    TaskHandle_t taskHandle;
-    unsigned long lastUpdate;
-    bool ledsAreOn;
-
-    void updateAnimationOff();
-    void updateAnimationOn();
-    void updateAnimationBlinking();
-    void updateAnimationBreathing();
-};
\ No newline at end of file
+    TaskHandle_t taskHandle = NULL;
+
+    LedPattern requested;          // Display task
+    SeqLock<LedPattern> published; // Read by the LED task
+    uint32_t started_version = UINT32_MAX;
+    LedAnimation animation;
+    uint8_t shown[3] = {0, 0, 0};
+    bool has_shown = false;
+
+    void setPattern(LED_STATE state, CRGB color, int interval);
+};
@@ -8,6 +8,7 @@
 #include "keypad.hpp"
 #include "leds.hpp"
 #include "web_server.hpp"
+#include "i2c_bus.hpp"
 
 #include <SPI.h>
 #include <Wire.h>
@@ -18,7 +19,7 @@ Leds leds;
 Display display(&leds);
 Network network(&display);
 Keypad keypad;
-API api(network.getInterface().getClient(), &display, &keypad);
+API api(network.getInterface(), &display, &keypad);
 NFC nfc(&api);
 ConfigWebServer webServer(&network.getInterface());
 
@@ -95,8 +96,8 @@ void setup()
   // Initialize SPI for other peripherals if needed
   SPI.begin(PIN_SPI_SCK, PIN_SPI_MISO, PIN_SPI_MOSI);
 
-  // Initialize I2C for NFC
-  Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL, I2C_FREQ);
+  // Initialize I2C shared by the display, NFC and the keypad
+  I2CBus::setup(PIN_I2C_SDA, PIN_I2C_SCL, I2C_FREQ);
 
   Persistence::setup();
   display.setup();
@@ -140,6 +141,8 @@ void setup()
 
 void loop()
 {
+  Persistence::loop();
+  I2CBus::loop();
   network.loop();
 
   if (network.isHealthy())
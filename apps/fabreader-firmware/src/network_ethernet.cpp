@@ -6,19 +6,22 @@ void NetworkEthernet::setup()
 
     uint8_t mac[6];
     esp_efuse_mac_get_default(mac);
-    Ethernet.init(PIN_SPI_CS_ETH);
+    {
+        EthernetLock guard(this->lock);
+        Ethernet.init(PIN_SPI_CS_ETH);
 
-    Serial.println("Checking Ethernet hardware...");
+        Serial.println("Checking Ethernet hardware...");
 
-    if (Ethernet.hardwareStatus() == EthernetNoHardware)
-    {
-        Serial.println("Ethernet hardware not found");
-        delay(5000);
-    }
+        if (Ethernet.hardwareStatus() == EthernetNoHardware)
+        {
+            Serial.println("Ethernet hardware not found");
+            delay(5000);
+        }
 
-    Serial.println("Ethernet Hardware connected");
+        Serial.println("Ethernet Hardware connected");
 
-    Ethernet.begin(mac);
+        Ethernet.begin(mac);
+    }
 
     int attempts = 0;
     while (!this->isHealthy() && attempts < 60)
@@ -35,18 +38,33 @@ void NetworkEthernet::setup()
     }
 }
 
-bool NetworkEthernet::isHealthy()
+bool NetworkEthernet::tryLock()
 {
-    Ethernet.maintain();
+    return xSemaphoreTakeRecursive(this->lock, 0) == pdTRUE;
+}
 
-    IPAddress currentIp = this->getCurrentIp();
+bool NetworkEthernet::isHealthy()
+{
+    if (this->tryLock())
+    {
+        Ethernet.maintain();
+        this->current_ip = Ethernet.localIP();
+        this->healthy = Ethernet.linkStatus() == LinkON;
+        xSemaphoreGiveRecursive(this->lock);
+    }
 
-    return Ethernet.linkStatus() == LinkON;
+    return this->healthy;
 }
 
 IPAddress NetworkEthernet::getCurrentIp()
 {
-    return Ethernet.localIP();
+    if (this->tryLock())
+    {
+        this->current_ip = Ethernet.localIP();
+        xSemaphoreGiveRecursive(this->lock);
+    }
+
+    return this->current_ip;
 }
 
 void NetworkEthernet::end()
@@ -55,10 +73,95 @@ void NetworkEthernet::end()
 
 void NetworkEthernet::loop()
 {
-    Ethernet.maintain();
+    // A DHCP renewal would race the connect task for the sockets
+    if (this->tryLock())
+    {
+        Ethernet.maintain();
+        xSemaphoreGiveRecursive(this->lock);
+    }
 }
 
-EthernetClient &NetworkEthernet::getClient()
+Client &NetworkEthernet::getClient()
 {
     return this->client;
-}
\ No newline at end of file
+}
+
+bool NetworkEthernet::resolve(const char *hostname, IPAddress &address)
+{
+    EthernetLock guard(this->lock);
+    DNSClient dns;
+    dns.begin(Ethernet.dnsServerIP());
+    return dns.getHostByName(hostname, address) == 1;
+}
+
+int LockedEthernetClient::connect(IPAddress ip, uint16_t port)
+{
+    EthernetLock guard(this->lock);
+    return this->client.connect(ip, port);
+}
+
+int LockedEthernetClient::connect(const char *host, uint16_t port)
+{
+    EthernetLock guard(this->lock);
+    return this->client.connect(host, port);
+}
+
+size_t LockedEthernetClient::write(uint8_t value)
+{
+    EthernetLock guard(this->lock);
+    return this->client.write(value);
+}
+
+size_t LockedEthernetClient::write(const uint8_t *buf, size_t size)
+{
+    EthernetLock guard(this->lock);
+    return this->client.write(buf, size);
+}
+
+int LockedEthernetClient::available()
+{
+    EthernetLock guard(this->lock);
+    return this->client.available();
+}
+
+int LockedEthernetClient::read()
+{
+    EthernetLock guard(this->lock);
+    return this->client.read();
+}
+
+int LockedEthernetClient::read(uint8_t *buf, size_t size)
+{
+    EthernetLock guard(this->lock);
+    return this->client.read(buf, size);
+}
+
+int LockedEthernetClient::peek()
+{
+    EthernetLock guard(this->lock);
+    return this->client.peek();
+}
+
+void LockedEthernetClient::flush()
+{
+    EthernetLock guard(this->lock);
+    this->client.flush();
+}
+
+void LockedEthernetClient::stop()
+{
+    EthernetLock guard(this->lock);
+    this->client.stop();
+}
+
+uint8_t LockedEthernetClient::connected()
+{
+    EthernetLock guard(this->lock);
+    return this->client.connected();
+}
+
+LockedEthernetClient::operator bool()
+{
+    EthernetLock guard(this->lock);
+    return (bool)this->client;
+}
@@ -3,18 +3,71 @@
 #include "network_interface.hpp"
 #include "configuration.hpp"
 #include <Ethernet.h>
+#include <Dns.h>
 
+// Holds the W5500 for the lifetime of the object, see NetworkEthernet
+class EthernetLock
+{
+public:
+    explicit EthernetLock(SemaphoreHandle_t lock) : lock(lock) { xSemaphoreTakeRecursive(lock, portMAX_DELAY); }
+    ~EthernetLock() { xSemaphoreGiveRecursive(lock); }
+
+    EthernetLock(const EthernetLock &) = delete;
+    EthernetLock &operator=(const EthernetLock &) = delete;
+
+private:
+    SemaphoreHandle_t lock;
+};
+
+// EthernetClient that holds the W5500 lock for every call
+class LockedEthernetClient : public Client
+{
+public:
+    explicit LockedEthernetClient(SemaphoreHandle_t &lock) : lock(lock) {}
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char *host, uint16_t port) override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override;
+
+private:
+    SemaphoreHandle_t &lock;
+    EthernetClient client;
+};
+
+// The Arduino Ethernet library is not task safe, but the connect task, the main loop and
+// the web server task all reach the W5500. Every access runs under a recursive lock. The
+// polled calls don't wait for it: while a connect holds the W5500 they report the last
+// known state and maintain() skips a turn.
 class NetworkEthernet : public NetworkInterface
 {
 public:
+    NetworkEthernet() : client(lock) { this->lock = xSemaphoreCreateRecursiveMutex(); }
+
     void setup() override;
     bool isHealthy() override;
     void loop() override;
     IPAddress getCurrentIp() override;
     void end() override;
 
-    EthernetClient &getClient() override;
+    Client &getClient() override;
+    bool resolve(const char *hostname, IPAddress &address) override;
 
 private:
-    EthernetClient client;
-};
\ No newline at end of file
+    SemaphoreHandle_t lock = NULL;
+    LockedEthernetClient client;
+
+    // Last state read while the lock was free
+    bool healthy = false;
+    IPAddress current_ip;
+
+    bool tryLock();
+};
@@ -12,4 +12,7 @@ public:
     virtual IPAddress getCurrentIp() = 0;
     virtual void end() = 0;
     virtual Client &getClient() = 0;
+
+    // Resolves a hostname through the network's DNS server, blocking
+    virtual bool resolve(const char *hostname, IPAddress &address) = 0;
 };
\ No newline at end of file
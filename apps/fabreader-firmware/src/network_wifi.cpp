@@ -29,17 +29,22 @@ WiFiClient &NetworkWifi::getClient()
     return this->client;
 }
 
+bool NetworkWifi::resolve(const char *hostname, IPAddress &address)
+{
+    return WiFi.hostByName(hostname, address) == 1;
+}
+
 void NetworkWifi::reconnect()
 {
     WiFi.disconnect();
 
     if (Persistence::isWiFiConfigured())
     {
-        const char *ssid = Persistence::getWiFiSSID();
-        const char *password = Persistence::getWiFiPassword();
+        // A copy, Improv may save new credentials meanwhile
+        WiFiConfig wifi = Persistence::getSettings().wifi;
 
-        Serial.printf("[WiFi] Connecting with stored credentials: %s\n", ssid);
-        WiFi.begin(ssid, password);
+        Serial.printf("[WiFi] Connecting with stored credentials: %s\n", wifi.ssid);
+        WiFi.begin(wifi.ssid, wifi.password);
         useConfigCredentials = true;
     }
 }
\ No newline at end of file
@@ -16,6 +16,7 @@ public:
     void end() override;
 
     WiFiClient &getClient() override;
+    bool resolve(const char *hostname, IPAddress &address) override;
 
     // Method to reconnect with new credentials
     void reconnect();
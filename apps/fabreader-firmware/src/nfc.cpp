@@ -9,18 +9,150 @@ void NFC::setup()
     this->last_state_time = millis();
 }
 
-void NFC::enableCardChecking()
+void NFC::enableCardChecking(bool readSun)
 {
     this->is_card_checking_enabled = true;
+    this->is_sun_enabled = readSun;
 }
 
 void NFC::disableCardChecking()
 {
     this->is_card_checking_enabled = false;
+
+    if (!this->is_job_pending)
+    {
+        this->releaseReader();
+    }
+}
+
+bool NFC::setAutoPollTypes(const uint8_t *types, uint8_t count)
+{
+    if (count == 0 || count > PN532_AUTOPOLL_MAX_TYPES)
+    {
+        return false;
+    }
+
+    memcpy(this->autopoll_types, types, count);
+    this->autopoll_type_count = count;
+
+    // Re-arm with the new types on the next loop
+    this->releaseReader();
+    return true;
+}
+
+bool NFC::isCardPresent()
+{
+    return this->present_uid_length > 0;
+}
+
+bool NFC::isIdle()
+{
+    return this->state == NFC_STATE_READY || this->state == NFC_STATE_PRESENT;
+}
+
+void NFC::releaseReader()
+{
+    if (this->state == NFC_STATE_SCANNING)
+    {
+        this->nfc.abortCommand();
+        this->state = NFC_STATE_READY;
+        this->last_state_time = millis();
+    }
+    else if (this->state == NFC_STATE_PRESENT)
+    {
+        // Drop a presence check in flight, the card stays tracked
+        this->nfc.abortCommand();
+    }
+}
+
+NFCCardInfo NFC::classifyCard(uint8_t type, const PN532_TargetInfo &target)
+{
+    NFCCardInfo info = {};
+
+    switch (type)
+    {
+    case PN532_AUTOPOLL_GENERIC_106:
+    case PN532_AUTOPOLL_MIFARE:
+    case PN532_AUTOPOLL_ISO14443_4A:
+        info.is_iso14443a = true;
+        info.atqa = target.atqa;
+        info.sak = target.sak;
+        info.ats_length = target.atsLength;
+        memcpy(info.ats, target.ats, target.atsLength);
+        info.family = CardClassifier::classify(info.atqa, info.sak, info.ats, info.ats_length);
+        break;
+    case PN532_AUTOPOLL_GENERIC_212:
+    case PN532_AUTOPOLL_GENERIC_424:
+    case PN532_AUTOPOLL_FELICA_212:
+    case PN532_AUTOPOLL_FELICA_424:
+        info.family = NFCCardFamily::Felica;
+        break;
+    case PN532_AUTOPOLL_ISO14443B:
+    case PN532_AUTOPOLL_ISO14443_4B:
+        info.family = NFCCardFamily::Iso14443B;
+        break;
+    case PN532_AUTOPOLL_JEWEL:
+        info.family = NFCCardFamily::Jewel;
+        break;
+    default:
+        info.family = NFCCardFamily::Unknown;
+        break;
+    }
+
+    return info;
+}
+
+CardInfo *NFC::presentCard()
+{
+    if (!this->isCardPresent())
+    {
+        return nullptr;
+    }
+    return this->card_cache.find(this->present_uid, this->present_uid_length, millis());
+}
+
+bool NFC::authenticate(uint8_t key[16], uint8_t keyNumber)
+{
+    CardInfo *card = this->presentCard();
+    if (card != nullptr && card->type == CardType::Other)
+    {
+        Serial.println("[NFC] Not an NTAG424, skipping authentication");
+        return false;
+    }
+
+    // Skips ISOSelectFile if this card already selected the application since it was activated
+    this->nfc.ntag424_AppSelected = card != nullptr && card->app_selected;
+    bool success = this->nfc.ntag424_Authenticate(key, keyNumber, this->AUTH_CMD);
+
+    if (card != nullptr)
+    {
+        card->app_selected = this->nfc.ntag424_AppSelected;
+        if (success)
+        {
+            card->type = CardType::NTAG424;
+        }
+    }
+    return success;
+}
+
+void NFC::finishOperation()
+{
+    // Keep tracking the card the operation ran on, otherwise go back to detection
+    this->state = this->isCardPresent() ? NFC_STATE_PRESENT : NFC_STATE_READY;
+    this->last_state_time = millis();
+    this->presence_checked_at = millis();
 }
 
 void NFC::loop()
 {
+#ifdef NFC_LATENCY_STATS
+    if (millis() - this->latency_stats_printed_at >= NFC_LATENCY_STATS_INTERVAL_MS)
+    {
+        this->latency_stats_printed_at = millis();
+        this->nfc.printLatencyStats();
+    }
+#endif
+
     switch (this->state)
     {
     case NFC_STATE_INIT:
@@ -32,6 +164,9 @@ void NFC::loop()
     case NFC_STATE_SCANNING:
         handleScanningState();
         break;
+    case NFC_STATE_PRESENT:
+        handlePresentState();
+        break;
     case NFC_STATE_AUTH_START:
     case NFC_STATE_AUTH_WAIT:
         handleAuthState();
@@ -44,6 +179,12 @@ void NFC::loop()
     case NFC_STATE_CHANGE_KEY_WAIT:
         handleChangeKeyState();
         break;
+    case NFC_STATE_CHANGE_KEYS_START:
+        handleChangeKeysState();
+        break;
+    case NFC_STATE_JOB_RUN:
+        handleJobState();
+        break;
     default:
         break;
     }
@@ -85,31 +226,165 @@ void NFC::handleInitState()
 
 void NFC::handleReadyState()
 {
-    if (this->is_card_checking_enabled)
+    // A pending job needs the next tap, even while the server doesn't want NFC_TAP events
+    if (!this->is_card_checking_enabled && !this->is_job_pending)
+    {
+        return;
+    }
+
+    if (millis() - this->last_state_time < NFC_SCAN_INTERVAL_MS)
+    {
+        return;
+    }
+
+    // Hand detection over to the PN532, it only answers once a card was activated
+    if (this->nfc.startAutoPoll(this->autopoll_types, this->autopoll_type_count))
+    {
+        this->state = NFC_STATE_SCANNING;
+        this->scan_start_time = millis();
+        this->autopoll_checked_at = millis();
+    }
+}
+
+void NFC::handleScanningState()
+{
+    // Without an IRQ line every check is an I2C status read, so don't check on every loop
+    if (PIN_PN532_IRQ == -1 && millis() - this->autopoll_checked_at < NFC_AUTOPOLL_CHECK_INTERVAL_MS)
+    {
+        return;
+    }
+    this->autopoll_checked_at = millis();
+
+    uint8_t transport_state = this->nfc.pollCommand();
+
+    if (transport_state == PN532_TRANSPORT_WAIT_ACK || transport_state == PN532_TRANSPORT_WAIT_RESPONSE)
+    {
+        if (millis() - this->scan_start_time >= NFC_AUTOPOLL_REARM_INTERVAL_MS)
+        {
+            this->releaseReader();
+        }
+        return;
+    }
+
+    if (transport_state == PN532_TRANSPORT_RESPONSE_READY)
     {
-        if (millis() - this->last_state_time >= 100)
+        uint8_t type;
+        uint8_t uid[PN532_MAX_UID_LENGTH];
+        uint8_t uidLength;
+        PN532_TargetInfo target;
+
+        if (this->nfc.readAutoPollTarget(&type, uid, &uidLength, &target))
         {
-            this->state = NFC_STATE_SCANNING;
-            this->scan_start_time = millis();
+            NFCCardInfo info = this->classifyCard(type, target);
+
+            // Remember the card, it is only reported again after it left the field
+            memcpy(this->present_uid, uid, uidLength);
+            this->present_uid_length = uidLength;
+            this->presence_method = Adafruit_PN532::presenceMethod(type, target.sak);
+            // A new activation, the application has to be selected again
+            CardInfo &card = this->card_cache.touch(uid, uidLength, millis());
+            card.app_selected = false;
+            if (!CardClassifier::supportsNtag424(info.family))
+            {
+                card.type = CardType::Other;
+            }
+            this->presence_failures = 0;
+            this->presence_checked_at = millis();
+            this->state = NFC_STATE_PRESENT;
+            this->last_state_time = millis();
+
+            if (this->is_job_pending && !this->isJobCardPresent(this->job))
+            {
+                this->failJob("Card of the job not in the field");
+                if (!this->is_card_checking_enabled)
+                {
+                    return;
+                }
+            }
+
+            if (this->is_job_pending)
+            {
+                // The job result carries the UID, no separate NFC_TAP
+                this->state = NFC_STATE_JOB_RUN;
+                return;
+            }
+
+            // One ISO read instead of the server's authentication round trip
+            SunMessage sun;
+            bool has_sun = this->is_sun_enabled && info.family == NFCCardFamily::Ntag424 && !card.no_sun &&
+                           this->readSunMessage(card, uid, uidLength, sun);
+            this->api->sendNFCTapped(uid, uidLength, info, has_sun ? &sun : nullptr);
+            return;
         }
     }
+    else
+    {
+        Serial.println("[NFC] Auto-poll failed, re-arming");
+        this->nfc.abortCommand();
+    }
+
+    this->state = NFC_STATE_READY;
+    this->last_state_time = millis();
 }
 
-void NFC::handleScanningState()
+void NFC::handlePresentState()
 {
-    // Start the card detection process
-    uint8_t uid[7];
-    uint8_t uidLength;
+    if (this->nfc.commandState() == PN532_TRANSPORT_IDLE)
+    {
+        // A job that arrived while another operation ran on this card
+        if (this->is_job_pending)
+        {
+            this->state = NFC_STATE_JOB_RUN;
+            this->last_state_time = millis();
+            return;
+        }
+
+        if (millis() - this->presence_checked_at < NFC_PRESENCE_CHECK_INTERVAL_MS)
+        {
+            return;
+        }
 
-    // Use a smaller timeout for each scan attempt (250ms)
-    bool foundCard = this->nfc.readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, 250);
+        this->presence_checked_at = millis();
+        this->nfc.startPresenceCheck(this->presence_method, NFC_PRESENCE_CHECK_TIMEOUT_MS);
+        return;
+    }
+
+    uint8_t transport_state = this->nfc.pollCommand();
+
+    if (transport_state == PN532_TRANSPORT_WAIT_ACK || transport_state == PN532_TRANSPORT_WAIT_RESPONSE)
+    {
+        return;
+    }
+
+    bool is_present = false;
+    if (transport_state == PN532_TRANSPORT_RESPONSE_READY)
+    {
+        is_present = this->nfc.readPresenceCheck(this->present_uid, this->present_uid_length);
+    }
+    else
+    {
+        this->nfc.abortCommand();
+    }
+
+    if (is_present)
+    {
+        this->presence_failures = 0;
+        return;
+    }
 
-    if (foundCard)
+    // A single missed check can be a collision or a card at the edge of the field
+    this->presence_failures++;
+    if (this->presence_failures < NFC_PRESENCE_MAX_FAILURES)
     {
-        this->api->sendNFCTapped(uid, uidLength);
+        return;
     }
 
-    // Always return to ready state after a scan attempt
+    Serial.println("[NFC] Card removed");
+    this->api->sendCardRemoved(this->present_uid, this->present_uid_length);
+    this->card_cache.endSession(this->present_uid, this->present_uid_length);
+
+    this->present_uid_length = 0;
+    this->presence_failures = 0;
     this->state = NFC_STATE_READY;
     this->last_state_time = millis();
 }
@@ -119,20 +394,25 @@ void NFC::handleAuthState()
     if (this->state == NFC_STATE_AUTH_START)
     {
         Serial.println("[NFC] Starting authentication for key " + String(this->auth_key_number));
-        this->operation_success = this->nfc.ntag424_Authenticate(this->auth_key, this->auth_key_number, this->AUTH_CMD);
+        this->operation_success = this->authenticate(this->auth_key, this->auth_key_number);
 
         // Authentication completes immediately, no wait state needed
         Serial.println(this->operation_success ? "[NFC] Authentication successful" : "[NFC] Authentication failed");
 
+#ifdef NFC_CRYPTO_BENCHMARK
+        if (this->operation_success)
+        {
+            this->nfc.ntag424_crypto_benchmark(NFC_CRYPTO_BENCHMARK_ITERATIONS);
+        }
+#endif
+
         // Notify callback if set
-        if (this->auth_complete_callback != nullptr)
+        if (this->auth_complete_callback)
         {
             this->auth_complete_callback(this->operation_success);
         }
 
-        // Return to ready state
-        this->state = NFC_STATE_READY;
-        this->last_state_time = millis();
+        this->finishOperation();
     }
 }
 
@@ -142,7 +422,7 @@ void NFC::handleWriteState()
     {
         // First authenticate
         Serial.println("[NFC] Starting authentication for write operation");
-        bool auth_success = this->nfc.ntag424_Authenticate(this->auth_key, this->auth_key_number, this->AUTH_CMD);
+        bool auth_success = this->authenticate(this->auth_key, this->auth_key_number);
 
         if (!auth_success)
         {
@@ -150,14 +430,12 @@ void NFC::handleWriteState()
             this->operation_success = false;
 
             // Notify callback if set
-            if (this->write_complete_callback != nullptr)
+            if (this->write_complete_callback)
             {
                 this->write_complete_callback(false);
             }
 
-            // Return to ready state
-            this->state = NFC_STATE_READY;
-            this->last_state_time = millis();
+            this->finishOperation();
             return;
         }
 
@@ -171,14 +449,12 @@ void NFC::handleWriteState()
         Serial.println(this->operation_success ? "[NFC] Write data successful" : "[NFC] Write data failed");
 
         // Notify callback if set
-        if (this->write_complete_callback != nullptr)
+        if (this->write_complete_callback)
         {
             this->write_complete_callback(this->operation_success);
         }
 
-        // Return to ready state
-        this->state = NFC_STATE_READY;
-        this->last_state_time = millis();
+        this->finishOperation();
     }
 }
 
@@ -202,7 +478,7 @@ void NFC::handleChangeKeyState()
 
         // First authenticate
         Serial.println("[NFC] Authenticating key " + String(this->auth_key_number));
-        bool auth_success = this->nfc.ntag424_Authenticate(this->auth_key, this->auth_key_number, this->AUTH_CMD);
+        bool auth_success = this->authenticate(this->auth_key, this->auth_key_number);
 
         if (!auth_success)
         {
@@ -210,14 +486,12 @@ void NFC::handleChangeKeyState()
             this->operation_success = false;
 
             // Notify callback if set
-            if (this->change_key_complete_callback != nullptr)
+            if (this->change_key_complete_callback)
             {
                 this->change_key_complete_callback(false);
             }
 
-            // Return to ready state
-            this->state = NFC_STATE_READY;
-            this->last_state_time = millis();
+            this->finishOperation();
             return;
         }
 
@@ -230,22 +504,297 @@ void NFC::handleChangeKeyState()
         Serial.println(this->operation_success ? "[NFC] Change key successful" : "[NFC] Change key failed");
 
         // Notify callback if set
-        if (this->change_key_complete_callback != nullptr)
+        if (this->change_key_complete_callback)
         {
             this->change_key_complete_callback(this->operation_success);
         }
 
-        // Return to ready state
-        this->state = NFC_STATE_READY;
-        this->last_state_time = millis();
+        this->finishOperation();
+    }
+}
+
+void NFC::handleChangeKeysState()
+{
+    this->operation_success = this->runKeyChanges(this->auth_key, this->key_changes, this->key_change_count);
+
+    if (this->change_keys_complete_callback)
+    {
+        this->change_keys_complete_callback(this->operation_success, this->key_changes, this->key_change_count);
+    }
+
+    this->finishOperation();
+}
+
+bool NFC::runKeyChanges(uint8_t authKey[16], NFCKeyChange *changes, uint8_t count)
+{
+    Serial.println("[NFC] Changing " + String(count) + " keys in one session");
+
+    // Everything below key 0 needs a key 0 session, so authenticate once up front
+    uint8_t master_key[16];
+    memcpy(master_key, authKey, 16);
+    bool session_ok = this->authenticate(master_key, 0);
+    if (!session_ok)
+    {
+        Serial.println("[NFC] Authentication with key 0 failed");
+    }
+
+    // Key 0 goes first, the other keys keep their requested order
+    uint8_t order[NFC_MAX_KEYS];
+    uint8_t ordered = 0;
+    for (uint8_t i = 0; i < count && ordered < NFC_MAX_KEYS; i++)
+    {
+        if (changes[i].key_number == 0)
+        {
+            order[ordered++] = i;
+        }
+    }
+    for (uint8_t i = 0; i < count && ordered < NFC_MAX_KEYS; i++)
+    {
+        if (changes[i].key_number != 0)
+        {
+            order[ordered++] = i;
+        }
+    }
+
+    for (uint8_t n = 0; n < ordered; n++)
+    {
+        NFCKeyChange &change = changes[order[n]];
+        change.success = false;
+
+        // Stop at the first failure, the remaining keys are reported as failed
+        if (!session_ok)
+        {
+            continue;
+        }
+
+        if (change.key_number == 0)
+        {
+            change.success = this->nfc.ntag424_ChangeKey(master_key, change.new_key, 0);
+            session_ok = change.success;
+            Serial.println("[NFC] Change key 0" + String(change.success ? " successful" : " failed"));
+
+            // Changing the authenticated key ends the session, open a new one if more keys follow.
+            // The card holds the new key 0 either way, a failure here only fails the keys after it.
+            if (change.success && n + 1 < ordered)
+            {
+                memcpy(master_key, change.new_key, 16);
+                session_ok = this->authenticate(master_key, 0);
+                if (!session_ok)
+                {
+                    Serial.println("[NFC] Authentication with the new key 0 failed");
+                }
+            }
+            continue;
+        }
+
+        change.success = this->nfc.ntag424_ChangeKey(change.old_key, change.new_key, change.key_number);
+        Serial.println("[NFC] Change key " + String(change.key_number) + (change.success ? " successful" : " failed"));
+        session_ok = change.success;
+    }
+
+    return session_ok;
+}
+
+void NFC::handleJobState()
+{
+    if (!this->isJobCardPresent(this->job))
+    {
+        this->failJob("Card of the job not in the field");
+        this->finishOperation();
+        return;
+    }
+
+    Serial.println("[NFC] Running job with " + String(this->job.step_count) + " steps");
+
+    memcpy(this->job.card_uid, this->present_uid, this->present_uid_length);
+    this->job.card_uid_length = this->present_uid_length;
+
+    // Steps share one card session, after a failure the rest is skipped and reported as failed
+    bool job_ok = true;
+    for (uint8_t i = 0; i < this->job.step_count; i++)
+    {
+        NFCJobStep &step = this->job.steps[i];
+        step.success = false;
+        step.result_length = 0;
+
+        if (!job_ok)
+        {
+            continue;
+        }
+
+        job_ok = this->runJobStep(step);
+        step.success = job_ok;
+        Serial.println("[NFC] Job step " + String(i) + (job_ok ? " successful" : " failed"));
+    }
+
+    this->job.success = job_ok;
+    this->is_job_pending = false;
+    this->api->sendJobResult(this->job);
+
+    this->finishOperation();
+}
+
+bool NFC::runJobStep(NFCJobStep &step)
+{
+    uint8_t buffer[80];
+    uint8_t length;
+
+    switch (step.type)
+    {
+    case NFC_JOB_STEP_AUTHENTICATE:
+        return this->authenticate(step.key, step.key_number);
+    case NFC_JOB_STEP_CHANGE_KEYS:
+        return this->runKeyChanges(step.key, this->job.key_changes, this->job.key_change_count);
+    case NFC_JOB_STEP_WRITE_FILE:
+        return this->nfc.ntag424_WriteFile(step.file_number, step.offset, step.data, step.length, step.comm_mode);
+    case NFC_JOB_STEP_READ_FILE:
+        length = this->nfc.ntag424_ReadFile(step.file_number, step.offset, step.length, step.result, step.comm_mode);
+        step.result_length = length;
+        return length == step.length;
+    case NFC_JOB_STEP_GET_UID:
+        length = this->nfc.ntag424_GetCardUID(buffer);
+        if (length == 0 || length > PN532_MAX_UID_LENGTH)
+        {
+            return false;
+        }
+        memcpy(step.result, buffer, length);
+        step.result_length = length;
+        return true;
+    case NFC_JOB_STEP_READ_SIGNATURE:
+        // Signature, response MAC and status
+        length = this->nfc.ntag424_ReadSig(buffer);
+        if (length < NFC_JOB_RESULT_SIZE + 10 || buffer[length - 2] != 0x91 || buffer[length - 1] != 0x00)
+        {
+            return false;
+        }
+        memcpy(step.result, buffer, NFC_JOB_RESULT_SIZE);
+        step.result_length = NFC_JOB_RESULT_SIZE;
+        return true;
+    case NFC_JOB_STEP_GET_VERSION:
+        return this->runGetVersion(step);
+    case NFC_JOB_STEP_GET_FILE_SETTINGS:
+        return this->runGetFileSettings(step);
+    case NFC_JOB_STEP_CHANGE_FILE_SETTINGS:
+        return this->runChangeFileSettings(step);
+    default:
+        return false;
+    }
+}
+
+bool NFC::runGetVersion(NFCJobStep &step)
+{
+    CardInfo *card = this->presentCard();
+    if (card == nullptr || !card->has_version)
+    {
+        memset(&this->nfc.ntag424_VersionInfo, 0, sizeof(this->nfc.ntag424_VersionInfo));
+        this->nfc.ntag424_GetVersion();
+
+        // The return value only tells NTAG424 apart, a card that answered has a vendor
+        if (this->nfc.ntag424_VersionInfo.VendorID == 0)
+        {
+            return false;
+        }
+        if (card == nullptr)
+        {
+            memcpy(step.result, &this->nfc.ntag424_VersionInfo, CARD_CACHE_VERSION_SIZE);
+            step.result_length = CARD_CACHE_VERSION_SIZE;
+            return true;
+        }
+
+        memcpy(card->version, &this->nfc.ntag424_VersionInfo, CARD_CACHE_VERSION_SIZE);
+        card->has_version = true;
+        card->type = this->nfc.ntag424_VersionInfo.HWType == NTAG424_RESPONE_GETVERSION_HWTYPE_NTAG424 ? CardType::NTAG424 : CardType::Other;
+    }
+
+    memcpy(step.result, card->version, CARD_CACHE_VERSION_SIZE);
+    step.result_length = CARD_CACHE_VERSION_SIZE;
+    return true;
+}
+
+bool NFC::runGetFileSettings(NFCJobStep &step)
+{
+    CardInfo *card = this->presentCard();
+    uint8_t length = 0;
+    const uint8_t *cached = card != nullptr ? CardCache::fileSettings(*card, step.file_number, length) : nullptr;
+    if (cached != nullptr)
+    {
+        memcpy(step.result, cached, length);
+        step.result_length = length;
+        return true;
+    }
+
+    // Settings, response MAC in MAC mode and status
+    uint8_t buffer[64];
+    length = this->nfc.ntag424_GetFileSettings(step.file_number, buffer, step.comm_mode);
+    uint8_t trailer = step.comm_mode == NFC_COMM_MODE_MAC ? 10 : 2;
+    if (length <= trailer || buffer[length - 2] != 0x91 || buffer[length - 1] != 0x00 || length - trailer > NFC_JOB_RESULT_SIZE)
+    {
+        return false;
+    }
+
+    length -= trailer;
+    memcpy(step.result, buffer, length);
+    step.result_length = length;
+    if (card != nullptr)
+    {
+        CardCache::storeFileSettings(*card, step.file_number, buffer, length);
     }
+    return true;
+}
+
+bool NFC::runChangeFileSettings(NFCJobStep &step)
+{
+    bool success = this->nfc.ntag424_ChangeFileSettings(step.file_number, step.data, step.length, NFC_COMM_MODE_FULL);
+
+    // A failed attempt may have gotten through before the answer was lost
+    CardInfo *card = this->presentCard();
+    if (card != nullptr)
+    {
+        CardCache::forgetFileSettings(*card, step.file_number);
+    }
+    return success;
+}
+
+bool NFC::readSunMessage(CardInfo &card, const uint8_t *uid, uint8_t uidLength, SunMessage &sun)
+{
+    uint8_t uri[SUN_MAX_URI_LENGTH];
+    uint8_t length = this->nfc.ntag424_ISOReadFile(uri, sizeof(uri));
+    card.app_selected = this->nfc.ntag424_AppSelected;
+    if (length == 0)
+    {
+        Serial.println("[NFC] Could not read the NDEF file");
+        return false;
+    }
+
+    if (!SunMessage::parse(uri, length, sun))
+    {
+        Serial.println("[NFC] No SUN message on the card");
+        card.no_sun = true;
+        return false;
+    }
+
+    if (uidLength != SUN_UID_LENGTH || memcmp(sun.uid, uid, SUN_UID_LENGTH) != 0)
+    {
+        Serial.println("[NFC] SUN message of another card");
+        return false;
+    }
+
+    if (!CardCache::acceptSunCounter(card, sun.counter))
+    {
+        Serial.println("[NFC] Replayed SUN counter " + String(sun.counter));
+        return false;
+    }
+    return true;
 }
 
 // Implement the non-blocking operation starters
-bool NFC::startAuthenticate(uint8_t keyNumber, uint8_t authKey[16])
+bool NFC::startAuthenticate(uint8_t keyNumber, const uint8_t authKey[16])
 {
-    // Only start if in ready state
-    if (this->state != NFC_STATE_READY)
+    // Card operations need the PN532, so end auto-poll or a presence check first
+    this->releaseReader();
+
+    // Only start if no other operation is running
+    if (!this->isIdle())
     {
         return false;
     }
@@ -262,8 +811,11 @@ bool NFC::startAuthenticate(uint8_t keyNumber, uint8_t authKey[16])
 
 bool NFC::startWriteData(uint8_t authKey[16], uint8_t keyNumber, uint8_t data[], size_t dataLength)
 {
-    // Only start if in ready state
-    if (this->state != NFC_STATE_READY)
+    // Card operations need the PN532, so end auto-poll or a presence check first
+    this->releaseReader();
+
+    // Only start if no other operation is running
+    if (!this->isIdle())
     {
         return false;
     }
@@ -288,8 +840,11 @@ bool NFC::startWriteData(uint8_t authKey[16], uint8_t keyNumber, uint8_t data[],
 
 bool NFC::startChangeKey(uint8_t keyNumber, uint8_t authKey[16], uint8_t newKey[16])
 {
-    // Only start if in ready state
-    if (this->state != NFC_STATE_READY)
+    // Card operations need the PN532, so end auto-poll or a presence check first
+    this->releaseReader();
+
+    // Only start if no other operation is running
+    if (!this->isIdle())
     {
         return false;
     }
@@ -305,98 +860,114 @@ bool NFC::startChangeKey(uint8_t keyNumber, uint8_t authKey[16], uint8_t newKey[
     return true;
 }
 
-// Implement the callback setters
-void NFC::setAuthCompleteCallback(void (*callback)(bool success))
-{
-    this->auth_complete_callback = callback;
-}
-
-void NFC::setWriteCompleteCallback(void (*callback)(bool success))
-{
-    this->write_complete_callback = callback;
-}
-
-void NFC::setChangeKeyCompleteCallback(void (*callback)(bool success))
+bool NFC::startChangeKeys(const uint8_t authKey[16], const NFCKeyChange *changes, uint8_t count)
 {
-    this->change_key_complete_callback = callback;
-}
+    // Card operations need the PN532, so end auto-poll or a presence check first
+    this->releaseReader();
 
-// Legacy blocking APIs - now implemented using the non-blocking state machine
-
-const uint8_t AUTH_CMD = 0x71;
-bool NFC::changeKey(uint8_t keyNumber, uint8_t authKey[16], uint8_t newKey[16])
-{
-    // Wait for any ongoing operation to complete
-    while (this->state != NFC_STATE_READY && this->state != NFC_STATE_INIT)
+    // Only start if no other operation is running
+    if (!this->isIdle())
     {
-        this->loop();
-        delay(10);
+        return false;
     }
 
-    // Start the non-blocking operation
-    if (!this->startChangeKey(keyNumber, authKey, newKey))
+    if (count == 0 || count > NFC_MAX_KEYS)
     {
         return false;
     }
 
-    // Wait for completion
-    while (this->state != NFC_STATE_READY)
-    {
-        this->loop();
-        delay(10);
-    }
+    memcpy(this->auth_key, authKey, 16);
+    memcpy(this->key_changes, changes, count * sizeof(NFCKeyChange));
+    this->key_change_count = count;
 
-    return this->operation_success;
+    this->state = NFC_STATE_CHANGE_KEYS_START;
+    this->last_state_time = millis();
+    return true;
 }
 
-bool NFC::writeData(uint8_t authKey[16], uint8_t keyNumber, uint8_t data[], size_t dataLength)
+bool NFC::scheduleJob(const NFCJob &job)
 {
-    // Wait for any ongoing operation to complete
-    while (this->state != NFC_STATE_READY && this->state != NFC_STATE_INIT)
+    if (job.step_count == 0 || job.step_count > NFC_JOB_MAX_STEPS || job.key_change_count > NFC_MAX_KEYS)
     {
-        this->loop();
-        delay(10);
+        return false;
     }
 
-    // Start the non-blocking operation
-    if (!this->startWriteData(authKey, keyNumber, data, dataLength))
+    // Don't replace a job that is already running
+    if (this->state == NFC_STATE_JOB_RUN)
     {
         return false;
     }
 
-    // Wait for completion
-    while (this->state != NFC_STATE_READY)
+    // Continues a session with this card, it must not run on the next card that is tapped
+    if (!this->isJobCardPresent(job))
     {
-        this->loop();
-        delay(10);
+        Serial.println("[NFC] The card of the job is not in the field");
+        return false;
     }
 
-    return this->operation_success;
-}
+    this->job = job;
+    this->is_job_pending = true;
 
-bool NFC::authenticate(uint8_t keyNumber, uint8_t authKey[16])
-{
-    // Wait for any ongoing operation to complete
-    while (this->state != NFC_STATE_READY && this->state != NFC_STATE_INIT)
+    // A card that is already in the field runs the job right away
+    this->releaseReader();
+    if (this->state == NFC_STATE_PRESENT)
     {
-        this->loop();
-        delay(10);
+        this->state = NFC_STATE_JOB_RUN;
+        this->last_state_time = millis();
     }
+    return true;
+}
 
-    // Start the non-blocking operation
-    if (!this->startAuthenticate(keyNumber, authKey))
+void NFC::cancelJob()
+{
+    if (!this->is_job_pending)
     {
-        return false;
+        return;
     }
 
-    // Wait for completion
-    while (this->state != NFC_STATE_READY)
+    Serial.println("[NFC] Job " + String(this->job.id) + " cancelled");
+    this->is_job_pending = false;
+
+    if (!this->is_card_checking_enabled)
     {
-        this->loop();
-        delay(10);
+        this->releaseReader();
     }
+}
 
-    return this->operation_success;
+// A job restricted to a card only runs while that card is in the field
+bool NFC::isJobCardPresent(const NFCJob &job)
+{
+    return job.card_uid_length == 0 ||
+           (job.card_uid_length == this->present_uid_length &&
+            memcmp(job.card_uid, this->present_uid, job.card_uid_length) == 0);
+}
+
+void NFC::failJob(const char *error)
+{
+    Serial.println("[NFC] Job " + String(this->job.id) + " failed: " + String(error));
+    this->is_job_pending = false;
+    this->api->sendJobError(this->job.id, error);
+}
+
+// Implement the callback setters
+void NFC::setAuthCompleteCallback(NFCCompleteCallback callback)
+{
+    this->auth_complete_callback = callback;
+}
+
+void NFC::setWriteCompleteCallback(NFCCompleteCallback callback)
+{
+    this->write_complete_callback = callback;
+}
+
+void NFC::setChangeKeyCompleteCallback(NFCCompleteCallback callback)
+{
+    this->change_key_complete_callback = callback;
+}
+
+void NFC::setChangeKeysCompleteCallback(NFCChangeKeysCompleteCallback callback)
+{
+    this->change_keys_complete_callback = callback;
 }
 
 void NFC::waitForCardRemoval()
@@ -3,7 +3,12 @@
 #include <Arduino.h>
 #include <Adafruit_PN532_NTAG424.h>
 #include <Wire.h>
+#include <functional>
+#include "card_cache.hpp"
+#include "card_classifier.hpp"
 #include "configuration.hpp"
+#include "nfc_types.hpp"
+#include "sun_message.hpp"
 
 // NFC state machine states
 #define NFC_STATE_INIT 0
@@ -15,10 +20,41 @@
 #define NFC_STATE_WRITE_WAIT 6
 #define NFC_STATE_CHANGE_KEY_START 7
 #define NFC_STATE_CHANGE_KEY_WAIT 8
+#define NFC_STATE_PRESENT 9
+#define NFC_STATE_CHANGE_KEYS_START 10
+#define NFC_STATE_JOB_RUN 11
+
+// Card detection timing
+#define NFC_SCAN_INTERVAL_MS 100            // Pause before auto-poll is re-armed after a detection
+#define NFC_AUTOPOLL_CHECK_INTERVAL_MS 20   // Status polling interval without an IRQ pin
+#define NFC_AUTOPOLL_REARM_INTERVAL_MS 60000 // Re-arm auto-poll in case the PN532 lost it
+
+// Card presence tracking
+#define NFC_PRESENCE_CHECK_INTERVAL_MS 250
+#define NFC_PRESENCE_CHECK_TIMEOUT_MS 100
+#define NFC_PRESENCE_MAX_FAILURES 2 // Missed checks in a row until the card counts as removed
+
+// Uncomment to periodically print the PN532 command latency table
+// #define NFC_LATENCY_STATS
+#define NFC_LATENCY_STATS_INTERVAL_MS 60000
+
+// Uncomment to print the NTAG424 secure messaging cost after each authentication
+// #define NFC_CRYPTO_BENCHMARK
+#define NFC_CRYPTO_BENCHMARK_ITERATIONS 100
 
 // Forward declare API instead of including the header
 class API; // Forward declaration instead of #include "api.hpp"
 
+static_assert(NFC_MAX_UID_LENGTH == PN532_MAX_UID_LENGTH, "UID buffers must match the PN532");
+static_assert(NFC_MAX_ATS_LENGTH == PN532_MAX_ATS_LENGTH, "ATS buffers must match the PN532");
+static_assert(sizeof(Adafruit_PN532::ntag424_VersionInfoType) == CARD_CACHE_VERSION_SIZE, "The card cache keeps the version info as is");
+static_assert(NFC_COMM_MODE_PLAIN == NTAG424_COMM_MODE_PLAIN && NFC_COMM_MODE_MAC == NTAG424_COMM_MODE_MAC && NFC_COMM_MODE_FULL == NTAG424_COMM_MODE_FULL,
+              "Job comm modes are passed to the NTAG424 driver unchanged");
+
+// Completion hooks, called from NFC::loop() once an operation finished
+typedef std::function<void(bool success)> NFCCompleteCallback;
+typedef std::function<void(bool success, const NFCKeyChange *changes, uint8_t count)> NFCChangeKeysCompleteCallback;
+
 class NFC
 {
 public:
@@ -29,26 +65,37 @@ public:
     void setup();
     void loop();
 
-    void enableCardChecking();
+    // With readSun, NTAG424 taps carry the card's SUN message if it has a fresh one
+    void enableCardChecking(bool readSun = false);
     void disableCardChecking();
 
-    // These operations start the non-blocking operations
-    // Returns true if operation was started successfully
+    // Card types the PN532 auto-polls for (PN532_AUTOPOLL_*), defaults to ISO14443A
+    bool setAutoPollTypes(const uint8_t *types, uint8_t count);
+
+    // True while a detected card is still in the field
+    bool isCardPresent();
+
+    // These operations start the non-blocking operations, the result is delivered
+    // through the completion callbacks. Returns true if operation was started successfully
     bool startChangeKey(uint8_t keyNumber, uint8_t authKey[16], uint8_t newKey[16]);
     bool startWriteData(uint8_t authKey[16], uint8_t keyNumber, uint8_t data[], size_t dataLength);
-    bool startAuthenticate(uint8_t keyNumber, uint8_t authKey[16]);
+    bool startAuthenticate(uint8_t keyNumber, const uint8_t authKey[16]);
+    // Changes all keys within one key 0 session, key 0 is always changed first
+    bool startChangeKeys(const uint8_t authKey[16], const NFCKeyChange *changes, uint8_t count);
 
-    // Legacy blocking API - deprecated but kept for backwards compatibility
-    bool changeKey(uint8_t keyNumber, uint8_t authKey[16], uint8_t newKey[16]);
-    bool writeData(uint8_t authKey[16], uint8_t keyNumber, uint8_t data[], size_t dataLength);
-    bool authenticate(uint8_t keyNumber, uint8_t authKey[16]);
+    // Runs the job on the card in the field, or on the next tap. The result is
+    // reported through API::sendJobResult() instead of an NFC_TAP.
+    bool scheduleJob(const NFCJob &job);
+    // Drops a job that hasn't started, e.g. when the server session ended
+    void cancelJob();
 
     void waitForCardRemoval();
 
     // Callbacks for operation completion
-    void setAuthCompleteCallback(void (*callback)(bool success));
-    void setWriteCompleteCallback(void (*callback)(bool success));
-    void setChangeKeyCompleteCallback(void (*callback)(bool success));
+    void setAuthCompleteCallback(NFCCompleteCallback callback);
+    void setWriteCompleteCallback(NFCCompleteCallback callback);
+    void setChangeKeyCompleteCallback(NFCCompleteCallback callback);
+    void setChangeKeysCompleteCallback(NFCChangeKeysCompleteCallback callback);
 
 private:
     Adafruit_PN532 nfc;
@@ -58,6 +105,20 @@ private:
     uint8_t state = NFC_STATE_INIT;
     unsigned long last_state_time = 0;
     unsigned long scan_start_time = 0;
+    unsigned long autopoll_checked_at = 0;
+    uint8_t autopoll_types[PN532_AUTOPOLL_MAX_TYPES] = {PN532_AUTOPOLL_GENERIC_106};
+    uint8_t autopoll_type_count = 1;
+
+    // Card currently in the field, only reported once per arrival
+    uint8_t present_uid[PN532_MAX_UID_LENGTH];
+    uint8_t present_uid_length = 0;
+    uint8_t presence_method = PN532_PRESENCE_ATTENTION; // Depends on the card type
+    uint8_t presence_failures = 0;
+    unsigned long presence_checked_at = 0;
+    unsigned long latency_stats_printed_at = 0;
+
+    // What recently tapped cards answered, keyed by UID
+    CardCache card_cache;
 
     // Async operation variables
     uint8_t auth_key_number;
@@ -65,12 +126,17 @@ private:
     uint8_t new_key[16];
     uint8_t write_data[64]; // Buffer for data to write
     size_t write_data_length;
+    NFCKeyChange key_changes[NFC_MAX_KEYS];
+    uint8_t key_change_count = 0;
+    NFCJob job;
+    bool is_job_pending = false;
     bool operation_success = false;
 
     // Callback functions
-    void (*auth_complete_callback)(bool success) = nullptr;
-    void (*write_complete_callback)(bool success) = nullptr;
-    void (*change_key_complete_callback)(bool success) = nullptr;
+    NFCCompleteCallback auth_complete_callback;
+    NFCCompleteCallback write_complete_callback;
+    NFCCompleteCallback change_key_complete_callback;
+    NFCChangeKeysCompleteCallback change_keys_complete_callback;
 
     // State handlers
     void handleInitState();
@@ -79,8 +145,28 @@ private:
     void handleAuthState();
     void handleWriteState();
     void handleChangeKeyState();
+    void handleChangeKeysState();
+    void handleJobState();
+
+    NFCCardInfo classifyCard(uint8_t type, const PN532_TargetInfo &target);
+    CardInfo *presentCard();
+    bool authenticate(uint8_t key[16], uint8_t keyNumber);
+    bool runKeyChanges(uint8_t authKey[16], NFCKeyChange *changes, uint8_t count);
+    bool runJobStep(NFCJobStep &step);
+    bool runGetVersion(NFCJobStep &step);
+    bool runGetFileSettings(NFCJobStep &step);
+    bool runChangeFileSettings(NFCJobStep &step);
+    bool readSunMessage(CardInfo &card, const uint8_t *uid, uint8_t uidLength, SunMessage &sun);
+    void handlePresentState();
+
+    bool isIdle();
+    void releaseReader();
+    void finishOperation();
+    bool isJobCardPresent(const NFCJob &job);
+    void failJob(const char *error);
 
     bool is_card_checking_enabled = false;
+    bool is_sun_enabled = false;
 
     // Helper constant
     const uint8_t AUTH_CMD = 0x71;
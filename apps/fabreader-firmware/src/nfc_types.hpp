@@ -0,0 +1,98 @@
+#pragma once
+
+// Card operation types shared by the NFC state machine and the message codec.
+// Kept free of Arduino and PN532 headers so the codec builds on the host.
+
+#include <stdint.h>
+
+// NTAG424 application keys 0..4, key 0 is the application master key
+#define NFC_MAX_KEYS 5
+
+#define NFC_MAX_UID_LENGTH 10 // Triple size ISO14443A UID
+#define NFC_MAX_ATS_LENGTH 20 // ATS including its length byte, longer ones are cut
+
+// File communication modes, same values as NTAG424_COMM_MODE_*
+#define NFC_COMM_MODE_PLAIN 0x00
+#define NFC_COMM_MODE_MAC 0x01
+#define NFC_COMM_MODE_FULL 0x02
+
+// Card jobs, a list of steps run in one card session
+#define NFC_JOB_MAX_STEPS 8
+#define NFC_JOB_MAX_DATA 24    // File bytes per WRITE_FILE/READ_FILE step
+#define NFC_JOB_RESULT_SIZE 56 // Fits the originality signature
+
+#define NFC_JOB_STEP_AUTHENTICATE 0
+#define NFC_JOB_STEP_CHANGE_KEYS 1
+#define NFC_JOB_STEP_WRITE_FILE 2
+#define NFC_JOB_STEP_READ_FILE 3
+#define NFC_JOB_STEP_GET_UID 4
+#define NFC_JOB_STEP_READ_SIGNATURE 5
+#define NFC_JOB_STEP_GET_VERSION 6          // Answered from the card cache after the first time
+#define NFC_JOB_STEP_GET_FILE_SETTINGS 7    // Same, without status bytes and response MAC
+#define NFC_JOB_STEP_CHANGE_FILE_SETTINGS 8 // Always FULL, e.g. to enable SDM on the NDEF file
+
+// Card family, classified from the activation data of a detected card
+enum class NFCCardFamily : uint8_t
+{
+    Unknown,
+    MifareClassic,
+    MifareUltralight, // NFC Forum Type 2, including NTAG21x
+    IsoDep,           // ISO14443-4A, e.g. DESFire
+    Ntag424,          // ISO14443-4A with the ATS of an NTAG 424 DNA
+    Felica,
+    Iso14443B,
+    Jewel,
+};
+
+// Activation data reported with NFC_TAP
+struct NFCCardInfo
+{
+    NFCCardFamily family;
+    bool is_iso14443a; // ATQA and SAK are only set for ISO14443A cards
+    uint16_t atqa;     // SENS_RES
+    uint8_t sak;       // SEL_RES
+    uint8_t ats[NFC_MAX_ATS_LENGTH];
+    uint8_t ats_length; // 0 unless the card speaks ISO14443-4A
+};
+
+// One entry of a batched key change
+struct NFCKeyChange
+{
+    uint8_t key_number;
+    uint8_t old_key[16]; // current value, only used for keys other than 0
+    uint8_t new_key[16];
+    bool success;
+};
+
+struct NFCJobStep
+{
+    uint8_t type;
+    uint8_t key_number;  // AUTHENTICATE
+    uint8_t key[16];     // AUTHENTICATE key, CHANGE_KEYS current key 0
+    uint8_t file_number; // WRITE_FILE, READ_FILE, GET_FILE_SETTINGS, CHANGE_FILE_SETTINGS
+    uint16_t offset;
+    uint8_t length;
+    uint8_t comm_mode; // NFC_COMM_MODE_*
+    uint8_t data[NFC_JOB_MAX_DATA]; // WRITE_FILE data, CHANGE_FILE_SETTINGS settings
+
+    bool success;
+    uint8_t result[NFC_JOB_RESULT_SIZE];
+    uint8_t result_length;
+};
+
+struct NFCJob
+{
+    uint32_t id; // Echoed in the result
+    NFCJobStep steps[NFC_JOB_MAX_STEPS];
+    uint8_t step_count;
+
+    // Keys of the CHANGE_KEYS step, a job changes keys at most once
+    NFCKeyChange key_changes[NFC_MAX_KEYS];
+    uint8_t key_change_count;
+
+    // Card the job ran on. If set when scheduling, the job only runs on this card and only
+    // if it is in the field already.
+    uint8_t card_uid[NFC_MAX_UID_LENGTH];
+    uint8_t card_uid_length;
+    bool success;
+};
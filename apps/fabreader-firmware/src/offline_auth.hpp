@@ -0,0 +1,293 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Cards that may use this reader while the server is unreachable. The server pushes a
+// versioned set of 64 bit UID hashes, in full or as a delta against the version the reader
+// already has. The hashes are kept sorted for an exact binary search, and a Bloom filter
+// derived from them turns most unknown cards away without touching the list.
+//
+// Hashing only makes the entries fixed size, it does not hide anything: UIDs travel in the
+// clear on every tap, and offline decisions are by UID alone.
+
+#define OFFLINE_AUTH_MAX_ENTRIES 1024 // 8 KB of hashes
+#define OFFLINE_AUTH_FILTER_BITS 8192 // 1 KB, about 2% false positives when full
+#define OFFLINE_AUTH_FILTER_HASHES 4
+#define OFFLINE_AUTH_HASH_SIZE 8 // Bytes per hash on the wire, big endian
+
+static_assert((OFFLINE_AUTH_FILTER_BITS & (OFFLINE_AUTH_FILTER_BITS - 1)) == 0, "Filter bits must be a power of two");
+
+namespace OfflineAuth
+{
+    // FNV-1a 64 of the UID, finished with the splitmix64 mixer so the filter bits are spread
+    // evenly. The server computes the same hash, see offline-auth.ts.
+    inline uint64_t hashUid(const uint8_t *uid, uint8_t length)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (uint8_t i = 0; i < length; i++)
+        {
+            hash = (hash ^ uid[i]) * 0x100000001b3ull;
+        }
+
+        hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+        hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+        return hash ^ (hash >> 31);
+    }
+
+    inline uint64_t readHash(const uint8_t *bytes)
+    {
+        uint64_t hash = 0;
+        for (uint8_t i = 0; i < OFFLINE_AUTH_HASH_SIZE; i++)
+        {
+            hash = (hash << 8) | bytes[i];
+        }
+        return hash;
+    }
+}
+
+enum class OfflineAuthChunk : uint8_t
+{
+    Pending,  // Applied, more chunks follow
+    Complete, // Last chunk applied, the set has the new version
+    Ignored,  // Belongs to an update that was already rejected
+    Rejected, // Does not apply, the set may be half updated and has to be reloaded
+};
+
+class OfflineAuthSet
+{
+public:
+    // 0 until the server sent a set
+    uint32_t version() const
+    {
+        return this->set_version;
+    }
+
+    uint16_t size() const
+    {
+        return this->count;
+    }
+
+    // Sorted, for storing the set
+    const uint64_t *entries() const
+    {
+        return this->hashes;
+    }
+
+    bool contains(const uint8_t *uid, uint8_t length) const
+    {
+        return this->containsHash(OfflineAuth::hashUid(uid, length));
+    }
+
+    bool containsHash(uint64_t hash) const
+    {
+        // After removals the filter still has the bits of the removed hashes, until finish()
+        if (!this->filter_stale && !this->filterMayContain(hash))
+        {
+            return false;
+        }
+
+        uint16_t index = this->lowerBound(hash);
+        return index < this->count && this->hashes[index] == hash;
+    }
+
+    void clear()
+    {
+        this->count = 0;
+        this->set_version = 0;
+        this->updating = false;
+        this->filter_stale = false;
+        memset(this->filter, 0, sizeof(this->filter));
+    }
+
+    // Replaces the set, e.g. with the copy stored in flash. False if there are too many hashes.
+    bool assign(uint32_t version, const uint64_t *hashes, uint16_t count)
+    {
+        this->clear();
+        for (uint16_t i = 0; i < count; i++)
+        {
+            if (!this->add(hashes[i]))
+            {
+                this->clear();
+                return false;
+            }
+        }
+        this->finish(version);
+        return true;
+    }
+
+    // Adding a hash that is there or removing one that is not is no error
+    bool add(uint64_t hash)
+    {
+        uint16_t index = this->lowerBound(hash);
+        if (index < this->count && this->hashes[index] == hash)
+        {
+            return true;
+        }
+        if (this->count >= OFFLINE_AUTH_MAX_ENTRIES)
+        {
+            return false;
+        }
+
+        memmove(&this->hashes[index + 1], &this->hashes[index], (this->count - index) * sizeof(uint64_t));
+        this->hashes[index] = hash;
+        this->count++;
+        this->setFilterBits(hash);
+        return true;
+    }
+
+    void remove(uint64_t hash)
+    {
+        uint16_t index = this->lowerBound(hash);
+        if (index >= this->count || this->hashes[index] != hash)
+        {
+            return;
+        }
+
+        memmove(&this->hashes[index], &this->hashes[index + 1], (this->count - index - 1) * sizeof(uint64_t));
+        this->count--;
+        this->filter_stale = true;
+    }
+
+    // Sets the version once all changes were applied
+    void finish(uint32_t version)
+    {
+        if (this->filter_stale)
+        {
+            memset(this->filter, 0, sizeof(this->filter));
+            for (uint16_t i = 0; i < this->count; i++)
+            {
+                this->setFilterBits(this->hashes[i]);
+            }
+            this->filter_stale = false;
+        }
+        this->set_version = version;
+    }
+
+    // Applies chunk index of the update from base to version, chunks arrive in order. A base
+    // of 0 replaces the whole set. Hashes are OFFLINE_AUTH_HASH_SIZE bytes each.
+    OfflineAuthChunk applyChunk(uint32_t base, uint32_t version, uint16_t index, bool final,
+                                const uint8_t *added, uint16_t addedCount, const uint8_t *removed, uint16_t removedCount)
+    {
+        if (index == 0)
+        {
+            // Starting over needs the set as it was before the interrupted update
+            if (this->updating || (base != 0 && base != this->set_version))
+            {
+                this->updating = false;
+                return OfflineAuthChunk::Rejected;
+            }
+
+            if (base == 0)
+            {
+                uint32_t current = this->set_version;
+                this->clear();
+                this->set_version = current;
+            }
+            this->updating = true;
+            this->update_version = version;
+            this->next_chunk = 0;
+        }
+        else if (!this->updating)
+        {
+            return OfflineAuthChunk::Ignored;
+        }
+
+        if (index != this->next_chunk || version != this->update_version)
+        {
+            this->updating = false;
+            return OfflineAuthChunk::Rejected;
+        }
+
+        for (uint16_t i = 0; i < removedCount; i++)
+        {
+            this->remove(OfflineAuth::readHash(&removed[i * OFFLINE_AUTH_HASH_SIZE]));
+        }
+        for (uint16_t i = 0; i < addedCount; i++)
+        {
+            if (!this->add(OfflineAuth::readHash(&added[i * OFFLINE_AUTH_HASH_SIZE])))
+            {
+                this->updating = false;
+                return OfflineAuthChunk::Rejected;
+            }
+        }
+
+        if (!final)
+        {
+            this->next_chunk++;
+            return OfflineAuthChunk::Pending;
+        }
+
+        this->updating = false;
+        this->finish(version);
+        return OfflineAuthChunk::Complete;
+    }
+
+    // True between the first and the last chunk of an update
+    bool isUpdating() const
+    {
+        return this->updating;
+    }
+
+private:
+    uint64_t hashes[OFFLINE_AUTH_MAX_ENTRIES];
+    uint16_t count = 0;
+    uint32_t set_version = 0;
+
+    uint8_t filter[OFFLINE_AUTH_FILTER_BITS / 8] = {};
+    bool filter_stale = false;
+
+    bool updating = false;
+    uint32_t update_version = 0;
+    uint16_t next_chunk = 0;
+
+    // Double hashing, both halves of the hash give the probe positions
+    static uint32_t filterBit(uint64_t hash, uint8_t probe)
+    {
+        uint32_t h1 = (uint32_t)hash;
+        uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+        return (h1 + probe * h2) & (OFFLINE_AUTH_FILTER_BITS - 1);
+    }
+
+    void setFilterBits(uint64_t hash)
+    {
+        for (uint8_t i = 0; i < OFFLINE_AUTH_FILTER_HASHES; i++)
+        {
+            uint32_t bit = filterBit(hash, i);
+            this->filter[bit >> 3] |= 1 << (bit & 7);
+        }
+    }
+
+    bool filterMayContain(uint64_t hash) const
+    {
+        for (uint8_t i = 0; i < OFFLINE_AUTH_FILTER_HASHES; i++)
+        {
+            uint32_t bit = filterBit(hash, i);
+            if ((this->filter[bit >> 3] & (1 << (bit & 7))) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint16_t lowerBound(uint64_t hash) const
+    {
+        uint16_t low = 0;
+        uint16_t high = this->count;
+        while (low < high)
+        {
+            uint16_t middle = (low + high) / 2;
+            if (this->hashes[middle] < hash)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        return low;
+    }
+};
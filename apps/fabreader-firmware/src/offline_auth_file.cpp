@@ -0,0 +1,67 @@
+#include "offline_auth_file.hpp"
+
+bool OfflineAuthFile::load(OfflineAuthSet &set)
+{
+    set.clear();
+
+    File file = LittleFS.open(OFFLINE_AUTH_FILE_PATH, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    Header header;
+    bool ok = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == OFFLINE_AUTH_FILE_MAGIC && header.count <= OFFLINE_AUTH_MAX_ENTRIES &&
+              file.size() == sizeof(header) + header.count * sizeof(uint64_t);
+
+    uint64_t batch[LOAD_BATCH];
+    for (uint16_t loaded = 0; ok && loaded < header.count;)
+    {
+        uint16_t length = min((uint16_t)LOAD_BATCH, (uint16_t)(header.count - loaded));
+        ok = file.read((uint8_t *)batch, length * sizeof(uint64_t)) == length * sizeof(uint64_t);
+        for (uint16_t i = 0; ok && i < length; i++)
+        {
+            ok = set.add(batch[i]);
+        }
+        loaded += length;
+    }
+    file.close();
+
+    if (!ok)
+    {
+        Serial.println("[OfflineAuth] Stored set is invalid, ignoring it.");
+        set.clear();
+        return false;
+    }
+
+    set.finish(header.version);
+    return true;
+}
+
+bool OfflineAuthFile::save(const OfflineAuthSet &set)
+{
+    File file = LittleFS.open(OFFLINE_AUTH_FILE_TEMP_PATH, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    Header header = {OFFLINE_AUTH_FILE_MAGIC, set.version(), set.size(), 0};
+    size_t length = set.size() * sizeof(uint64_t);
+    bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+              file.write((const uint8_t *)set.entries(), length) == length;
+    file.close();
+
+    if (!ok || !LittleFS.rename(OFFLINE_AUTH_FILE_TEMP_PATH, OFFLINE_AUTH_FILE_PATH))
+    {
+        LittleFS.remove(OFFLINE_AUTH_FILE_TEMP_PATH);
+        return false;
+    }
+    return true;
+}
+
+bool OfflineAuthFile::remove()
+{
+    return !LittleFS.exists(OFFLINE_AUTH_FILE_PATH) || LittleFS.remove(OFFLINE_AUTH_FILE_PATH);
+}
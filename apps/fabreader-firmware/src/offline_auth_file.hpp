@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "offline_auth.hpp"
+
+#define OFFLINE_AUTH_FILE_PATH "/offline_auth.bin"
+#define OFFLINE_AUTH_FILE_TEMP_PATH "/offline_auth.tmp"
+#define OFFLINE_AUTH_FILE_MAGIC 0x4841464f // "OFAH"
+
+// OfflineAuthSet in a LittleFS file, a header followed by the sorted hashes. Expects
+// LittleFS to be mounted, see FileJournalSegment::setup().
+class OfflineAuthFile
+{
+public:
+    // Leaves an empty set if there is no valid file
+    bool load(OfflineAuthSet &set);
+
+    // Written to a temporary file first, a power cut keeps the previous set
+    bool save(const OfflineAuthSet &set);
+
+    // Deletes the stored set, load() then leaves an empty set
+    bool remove();
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint16_t count;
+        uint16_t reserved;
+    };
+
+    // Read in slices, the set has no room for a second copy
+    static const uint8_t LOAD_BATCH = 32;
+};
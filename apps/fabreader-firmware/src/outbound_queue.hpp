@@ -0,0 +1,207 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed size queue of serialized outgoing messages. Messages are written straight into
+// a slot, sent highest priority first and in order within a priority. A slot is only
+// released once the message was written, so a failed write is retried on the next
+// drain.
+
+enum class OutboundPriority : uint8_t
+{
+    Low,    // Heartbeats
+    Normal, // Registration, authentication and responses to the server
+    High,   // Card taps, card removal and key presses
+};
+
+template <size_t slot_size>
+struct OutboundMessage
+{
+    OutboundPriority priority;
+    uint8_t kind;      // Coalescing key, 0 never coalesces
+    uint32_t sequence; // Order of queueing within a priority
+    size_t length;
+    uint8_t data[slot_size];
+};
+
+template <uint8_t slots, size_t slot_size>
+class OutboundQueue
+{
+public:
+    typedef OutboundMessage<slot_size> Message;
+
+    // Returns a slot to serialize a message into, followed by commit(). A queued message
+    // of the same kind is overwritten in place, keeping its position. When the queue is
+    // full the oldest message of the lowest priority below this one is evicted, nullptr
+    // if there is none.
+    Message *reserve(OutboundPriority priority, uint8_t kind = 0)
+    {
+        if (kind != 0)
+        {
+            for (uint8_t i = 0; i < slots; i++)
+            {
+                if (this->state[i] == SLOT_QUEUED && this->messages[i].kind == kind)
+                {
+                    this->state[i] = SLOT_RESERVED;
+                    this->messages[i].priority = priority;
+                    this->coalesced++;
+                    return &this->messages[i];
+                }
+            }
+        }
+
+        int8_t slot = this->findFree();
+        if (slot < 0)
+        {
+            slot = this->findVictim(priority);
+            if (slot < 0)
+            {
+                this->dropped++;
+                return nullptr;
+            }
+            this->count--;
+            this->dropped++;
+        }
+
+        Message &message = this->messages[slot];
+        this->state[slot] = SLOT_RESERVED;
+        message.priority = priority;
+        message.kind = kind;
+        message.sequence = this->next_sequence++;
+        message.length = 0;
+        return &message;
+    }
+
+    // Queues a reserved slot, a length of 0 (serialization failed) releases it
+    void commit(Message *message, size_t length)
+    {
+        uint8_t slot = message - this->messages;
+        if (length == 0 || length > slot_size)
+        {
+            this->state[slot] = SLOT_FREE;
+            // Overwritten in place, the previous message of this kind is gone as well
+            if (message->length != 0)
+            {
+                this->count--;
+                this->dropped++;
+            }
+            return;
+        }
+
+        if (message->length == 0)
+        {
+            this->count++;
+        }
+        message->length = length;
+        this->state[slot] = SLOT_QUEUED;
+    }
+
+    // Next message to send, nullptr if the queue is empty
+    const Message *peek() const
+    {
+        const Message *next = nullptr;
+        for (uint8_t i = 0; i < slots; i++)
+        {
+            if (this->state[i] == SLOT_QUEUED && (next == nullptr || before(this->messages[i], *next)))
+            {
+                next = &this->messages[i];
+            }
+        }
+        return next;
+    }
+
+    // Releases the message returned by peek() once it was written
+    void pop()
+    {
+        const Message *next = this->peek();
+        if (next != nullptr)
+        {
+            this->state[next - this->messages] = SLOT_FREE;
+            this->messages[next - this->messages].length = 0;
+            this->count--;
+        }
+    }
+
+    void clear()
+    {
+        for (uint8_t i = 0; i < slots; i++)
+        {
+            this->state[i] = SLOT_FREE;
+            this->messages[i].length = 0;
+        }
+        this->count = 0;
+    }
+
+    uint8_t size() const
+    {
+        return this->count;
+    }
+
+    // Messages lost to a full queue or a failed serialization since boot
+    uint32_t droppedCount() const
+    {
+        return this->dropped;
+    }
+
+    // Messages replaced by a newer one of the same kind since boot
+    uint32_t coalescedCount() const
+    {
+        return this->coalesced;
+    }
+
+private:
+    static const uint8_t SLOT_FREE = 0;
+    static const uint8_t SLOT_RESERVED = 1;
+    static const uint8_t SLOT_QUEUED = 2;
+
+    Message messages[slots] = {};
+    uint8_t state[slots] = {};
+    uint8_t count = 0;
+    uint32_t next_sequence = 0;
+    uint32_t dropped = 0;
+    uint32_t coalesced = 0;
+
+    static bool before(const Message &a, const Message &b)
+    {
+        if (a.priority != b.priority)
+        {
+            return a.priority > b.priority;
+        }
+        // Wrap safe comparison of the sequence numbers
+        return (int32_t)(a.sequence - b.sequence) < 0;
+    }
+
+    int8_t findFree() const
+    {
+        for (uint8_t i = 0; i < slots; i++)
+        {
+            if (this->state[i] == SLOT_FREE)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    int8_t findVictim(OutboundPriority priority) const
+    {
+        int8_t victim = -1;
+        for (uint8_t i = 0; i < slots; i++)
+        {
+            if (this->state[i] != SLOT_QUEUED || this->messages[i].priority >= priority)
+            {
+                continue;
+            }
+            // Among lower priorities, evict the lowest and then the oldest
+            const Message &candidate = this->messages[i];
+            if (victim < 0 || candidate.priority < this->messages[victim].priority ||
+                (candidate.priority == this->messages[victim].priority &&
+                 (int32_t)(candidate.sequence - this->messages[victim].sequence) < 0))
+            {
+                victim = i;
+            }
+        }
+        return victim;
+    }
+};
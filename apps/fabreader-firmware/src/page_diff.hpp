@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Finds what changed in a display page since it was sent, so a flush only transfers those
+// columns.
+struct PageDiff
+{
+    // Columns [from, to) of a page that differ from the sent one, false if none. Unchanged
+    // columns in between are sent along, a second range would cost another address command.
+    static bool find(const uint8_t *current, const uint8_t *sent, uint8_t width, uint8_t &from, uint8_t &to)
+    {
+        uint8_t first = 0;
+        while (first < width && current[first] == sent[first])
+        {
+            first++;
+        }
+        if (first == width)
+        {
+            return false;
+        }
+
+        uint8_t last = width;
+        while (current[last - 1] == sent[last - 1])
+        {
+            last--;
+        }
+
+        from = first;
+        to = last;
+        return true;
+    }
+
+    // Marks the columns as sent
+    static void commit(const uint8_t *current, uint8_t *sent, uint8_t from, uint8_t to)
+    {
+        memcpy(sent + from, current + from, to - from);
+    }
+};
@@ -1,79 +1,398 @@
 #include "persistence.hpp"
+#include <Preferences.h>
+#include <PersistSettings.h>
+#include <stddef.h>
 
-PersistSettings<PersistenceData> Settings(PersistenceData::version);
+// Every setting is its own NVS key, so a change rewrites only that entry
+enum FieldType : uint8_t
+{
+    FIELD_STRING,
+    FIELD_BOOL,
+    FIELD_UINT16,
+    FIELD_UINT32,
+};
+
+struct Field
+{
+    const char *key; // NVS keys have at most 15 characters
+    size_t offset;
+    size_t size;
+    FieldType type;
+};
+
+#define PERSISTENCE_FIELD(key, member, type) {key, offsetof(PersistenceData, member), sizeof(((PersistenceData *)nullptr)->member), type}
+
+static const Field Fields[] = {
+    PERSISTENCE_FIELD("api_host", api.hostname, FIELD_STRING),
+    PERSISTENCE_FIELD("api_port", api.port, FIELD_UINT16),
+    PERSISTENCE_FIELD("api_has_auth", api.has_auth, FIELD_BOOL),
+    PERSISTENCE_FIELD("api_reader_id", api.readerId, FIELD_UINT32),
+    PERSISTENCE_FIELD("api_key", api.apiKey, FIELD_STRING),
+    PERSISTENCE_FIELD("api_offline_s", api.offlineAfter, FIELD_UINT16),
+    PERSISTENCE_FIELD("wifi_ssid", wifi.ssid, FIELD_STRING),
+    PERSISTENCE_FIELD("wifi_password", wifi.password, FIELD_STRING),
+    PERSISTENCE_FIELD("wifi_configured", wifi.configured, FIELD_BOOL),
+    PERSISTENCE_FIELD("admin_password", web.admin_password, FIELD_STRING),
+};
+
+static const uint8_t FIELD_COUNT = sizeof(Fields) / sizeof(Fields[0]);
+static_assert(FIELD_COUNT <= 16, "Dirty mask holds 16 fields");
+
+// Layout of the PersistSettings blob of version PERSISTENCE_LEGACY_VERSION. Frozen, the
+// blob is read back byte for byte, so it must not follow changes to PersistenceData.
+struct LegacyPersistenceDataV4
+{
+    struct
+    {
+        char hostname[32];
+        uint16_t port;
+        bool has_auth = false;
+        uint32_t readerId = 0;
+        char apiKey[17] = "0000000000000000";
+    } api;
+
+    struct
+    {
+        char ssid[33] = "";
+        char password[65] = "";
+        bool configured = false;
+    } wifi;
+
+    struct
+    {
+        char admin_password[33] = "fabaccess";
+    } web;
+};
+
+static Preferences Storage;
+
+// Current settings, fields that differ from flash are marked in Dirty. Guarded by Lock,
+// saves come from the main loop, the web server and the Improv task.
+static PersistenceData Settings;
+static SemaphoreHandle_t Lock = NULL;
+static uint16_t Dirty = 0;
+static unsigned long DirtySince = 0;
+
+static uint32_t FieldWrites = 0;
+static uint32_t Commits = 0;
+
+// Read only copies of Settings handed out by config(). Saves fill the inactive one and
+// switch over, so a reference shows a complete struct until the second save after it was
+// taken overwrites its slot. Readers that might be preempted that long copy instead.
+static PersistenceData Snapshots[2];
+static std::atomic<uint8_t> ActiveSnapshot{0};
+static std::atomic<uint32_t> Generation{0};
+
+static void publish()
+{
+    uint8_t next = ActiveSnapshot.load() ^ 1;
+    Snapshots[next] = Settings;
+    ActiveSnapshot.store(next);
+    Generation.fetch_add(1);
+}
+
+static void readField(const Field &field, PersistenceData &data)
+{
+    // Keys written by an older firmware may be missing, the default stays
+    if (!Storage.isKey(field.key))
+    {
+        return;
+    }
+
+    uint8_t *value = (uint8_t *)&data + field.offset;
+    switch (field.type)
+    {
+    case FIELD_STRING:
+        Storage.getString(field.key, (char *)value, field.size);
+        value[field.size - 1] = '\0';
+        break;
+    case FIELD_BOOL:
+        *(bool *)value = Storage.getBool(field.key);
+        break;
+    case FIELD_UINT16:
+        *(uint16_t *)value = Storage.getUShort(field.key);
+        break;
+    case FIELD_UINT32:
+        *(uint32_t *)value = Storage.getUInt(field.key);
+        break;
+    }
+}
+
+static bool writeField(const Field &field, const PersistenceData &data)
+{
+    const uint8_t *value = (const uint8_t *)&data + field.offset;
+    FieldWrites++;
+
+    switch (field.type)
+    {
+    case FIELD_STRING:
+        // putString() returns the length written, 0 for an empty string as well
+        return Storage.putString(field.key, (const char *)value) > 0 || value[0] == '\0';
+    case FIELD_BOOL:
+        return Storage.putBool(field.key, *(const bool *)value) > 0;
+    case FIELD_UINT16:
+        return Storage.putUShort(field.key, *(const uint16_t *)value) > 0;
+    case FIELD_UINT32:
+        return Storage.putUInt(field.key, *(const uint32_t *)value) > 0;
+    }
+    return false;
+}
+
+// Takes over the fields of next that changed. Caller holds Lock.
+static void update(const PersistenceData &next)
+{
+    for (uint8_t i = 0; i < FIELD_COUNT; i++)
+    {
+        const Field &field = Fields[i];
+        const uint8_t *from = (const uint8_t *)&next + field.offset;
+        uint8_t *to = (uint8_t *)&Settings + field.offset;
+
+        bool same = field.type == FIELD_STRING ? strncmp((const char *)from, (const char *)to, field.size) == 0
+                                               : memcmp(from, to, field.size) == 0;
+        if (same)
+        {
+            continue;
+        }
+
+        memcpy(to, from, field.size);
+        if (Dirty == 0)
+        {
+            DirtySince = millis();
+        }
+        Dirty |= 1 << i;
+    }
+
+    publish();
+}
+
+// Writes the dirty fields. Caller holds Lock.
+static void commit()
+{
+    uint8_t written = 0;
+    for (uint8_t i = 0; i < FIELD_COUNT; i++)
+    {
+        if ((Dirty & (1 << i)) == 0)
+        {
+            continue;
+        }
+
+        if (writeField(Fields[i], Settings))
+        {
+            Dirty &= ~(1 << i);
+            written++;
+        }
+        else
+        {
+            Serial.println("[Persistence] Failed to write " + String(Fields[i].key) + ", retrying later.");
+        }
+    }
+
+    // Failed fields wait for another delay instead of being retried every loop
+    DirtySince = millis();
+    Commits++;
+
+    Serial.println("[Persistence] Wrote " + String(written) + " fields to flash (" + String(FieldWrites) + " field writes, " + String(Commits) + " commits since boot).");
+}
 
 void Persistence::setup()
 {
-    Settings.Begin();
+    Lock = xSemaphoreCreateMutex();
+    Storage.begin(PERSISTENCE_NAMESPACE, false);
 
-    if (!Settings.Valid())
+    for (uint8_t i = 0; i < FIELD_COUNT; i++)
     {
-        Serial.println("[Persistence] Settings are invalid, resetting to default.");
-        Settings.ResetToDefault();
+        readField(Fields[i], Settings);
     }
-    else
+
+    uint8_t schema = Storage.getUChar("schema", 0);
+    if (schema != PersistenceData::version)
     {
-        Serial.println("[Persistence] Settings loaded successfully.");
-        Serial.print("[Persistence] API hostname: ");
-        Serial.println(Settings.Config.api.hostname);
-        Serial.print("[Persistence] API port: ");
-        Serial.println(Settings.Config.api.port);
+        migrate(schema);
     }
+
+    Serial.println("[Persistence] Settings loaded successfully.");
+    Serial.print("[Persistence] API hostname: ");
+    Serial.println(Settings.api.hostname);
+    Serial.print("[Persistence] API port: ");
+    Serial.println(Settings.api.port);
+
+    publish();
+}
+
+void Persistence::migrate(uint8_t from)
+{
+    Serial.println("[Persistence] Migrating settings from version " + String(from) + " to " + String(PersistenceData::version) + ".");
+
+    // Nothing in NVS yet, take over the settings blob of older firmwares
+    if (from == 0)
+    {
+        PersistSettings<LegacyPersistenceDataV4> legacy(PERSISTENCE_LEGACY_VERSION);
+        legacy.Begin();
+
+        if (legacy.Valid())
+        {
+            Serial.println("[Persistence] Importing settings of the previous firmware.");
+            const LegacyPersistenceDataV4 &old = legacy.Config;
+            PersistenceData imported = Settings;
+
+            strncpy(imported.api.hostname, old.api.hostname, sizeof(imported.api.hostname) - 1);
+            imported.api.hostname[sizeof(imported.api.hostname) - 1] = '\0';
+            imported.api.port = old.api.port;
+            imported.api.has_auth = old.api.has_auth;
+            imported.api.readerId = old.api.readerId;
+            strncpy(imported.api.apiKey, old.api.apiKey, sizeof(imported.api.apiKey) - 1);
+            imported.api.apiKey[sizeof(imported.api.apiKey) - 1] = '\0';
+
+            strncpy(imported.wifi.ssid, old.wifi.ssid, sizeof(imported.wifi.ssid) - 1);
+            imported.wifi.ssid[sizeof(imported.wifi.ssid) - 1] = '\0';
+            strncpy(imported.wifi.password, old.wifi.password, sizeof(imported.wifi.password) - 1);
+            imported.wifi.password[sizeof(imported.wifi.password) - 1] = '\0';
+            imported.wifi.configured = old.wifi.configured;
+
+            strncpy(imported.web.admin_password, old.web.admin_password, sizeof(imported.web.admin_password) - 1);
+            imported.web.admin_password[sizeof(imported.web.admin_password) - 1] = '\0';
+
+            update(imported);
+            commit();
+        }
+        else
+        {
+            Serial.println("[Persistence] No previous settings found, using defaults.");
+        }
+    }
+
+    // Later schema changes convert the affected fields here, e.g. if (from < 6) { ... }
+
+    Storage.putUChar("schema", PersistenceData::version);
+}
+
+void Persistence::loop()
+{
+    if (Dirty == 0 || millis() - DirtySince < PERSISTENCE_COMMIT_DELAY_MS)
+    {
+        return;
+    }
+
+    flush();
+}
+
+void Persistence::flush()
+{
+    xSemaphoreTake(Lock, portMAX_DELAY);
+    if (Dirty != 0)
+    {
+        commit();
+    }
+    xSemaphoreGive(Lock);
 }
 
-PersistSettings<PersistenceData> Persistence::getSettings()
+PersistenceData Persistence::getSettings()
 {
-    return Settings;
+    xSemaphoreTake(Lock, portMAX_DELAY);
+    PersistenceData settings = Settings;
+    xSemaphoreGive(Lock);
+    return settings;
 }
 
-void Persistence::saveSettings(PersistSettings<PersistenceData> settings)
+const PersistenceData &Persistence::config()
 {
-    Serial.println("[Persistence] Saving settings to flash...");
-    Settings = settings;
-    Settings.Write();
+    return Snapshots[ActiveSnapshot.load()];
+}
+
+uint32_t Persistence::generation()
+{
+    return Generation.load();
+}
 
-    Serial.println("[Persistence] Settings saved to flash");
+bool Persistence::changedSince(uint32_t &generation)
+{
+    uint32_t current = Generation.load();
+    if (current == generation)
+    {
+        return false;
+    }
+
+    generation = current;
+    return true;
+}
+
+void Persistence::saveSettings(const PersistenceData &settings)
+{
+    xSemaphoreTake(Lock, portMAX_DELAY);
+    update(settings);
+    xSemaphoreGive(Lock);
+
+    Serial.println("[Persistence] Settings updated");
     Serial.print("[Persistence] API hostname: ");
-    Serial.println(Settings.Config.api.hostname);
+    Serial.println(settings.api.hostname);
     Serial.print("[Persistence] API port: ");
-    Serial.println(Settings.Config.api.port);
+    Serial.println(settings.api.port);
 }
 
 bool Persistence::isWiFiConfigured()
 {
-    return Settings.Config.wifi.configured;
+    return config().wifi.configured;
 }
 
 void Persistence::saveWiFiCredentials(const char *ssid, const char *password)
 {
-    strncpy(Settings.Config.wifi.ssid, ssid, sizeof(Settings.Config.wifi.ssid) - 1);
-    Settings.Config.wifi.ssid[sizeof(Settings.Config.wifi.ssid) - 1] = '\0';
+    PersistenceData settings = getSettings();
+
+    strncpy(settings.wifi.ssid, ssid, sizeof(settings.wifi.ssid) - 1);
+    settings.wifi.ssid[sizeof(settings.wifi.ssid) - 1] = '\0';
 
-    strncpy(Settings.Config.wifi.password, password, sizeof(Settings.Config.wifi.password) - 1);
-    Settings.Config.wifi.password[sizeof(Settings.Config.wifi.password) - 1] = '\0';
+    strncpy(settings.wifi.password, password, sizeof(settings.wifi.password) - 1);
+    settings.wifi.password[sizeof(settings.wifi.password) - 1] = '\0';
 
-    Settings.Config.wifi.configured = true;
-    Settings.Write();
+    settings.wifi.configured = true;
+
+    // Credentials are saved right before the device reconnects or restarts, write them now
+    xSemaphoreTake(Lock, portMAX_DELAY);
+    update(settings);
+    if (Dirty != 0)
+    {
+        commit();
+    }
+    xSemaphoreGive(Lock);
 }
 
 const char *Persistence::getWiFiSSID()
 {
-    return Settings.Config.wifi.ssid;
+    return config().wifi.ssid;
 }
 
 const char *Persistence::getWiFiPassword()
 {
-    return Settings.Config.wifi.password;
+    return config().wifi.password;
 }
 
 const char *Persistence::getAdminPassword()
 {
-    return Settings.Config.web.admin_password;
+    return config().web.admin_password;
 }
 
 void Persistence::saveAdminPassword(const char *password)
 {
-    strncpy(Settings.Config.web.admin_password, password, sizeof(Settings.Config.web.admin_password) - 1);
-    Settings.Config.web.admin_password[sizeof(Settings.Config.web.admin_password) - 1] = '\0';
-    Settings.Write();
+    PersistenceData settings = getSettings();
+
+    strncpy(settings.web.admin_password, password, sizeof(settings.web.admin_password) - 1);
+    settings.web.admin_password[sizeof(settings.web.admin_password) - 1] = '\0';
+
+    xSemaphoreTake(Lock, portMAX_DELAY);
+    update(settings);
+    if (Dirty != 0)
+    {
+        commit();
+    }
+    xSemaphoreGive(Lock);
+}
+
+uint32_t Persistence::fieldWriteCount()
+{
+    return FieldWrites;
+}
+
+uint32_t Persistence::commitCount()
+{
+    return Commits;
 }
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
-#include <PersistSettings.h>
+#include <atomic>
 
 #include "configuration.hpp"
 
@@ -16,6 +16,9 @@ struct ApiConfig
 
     // api key
     char apiKey[17] = "0000000000000000";
+
+    // Seconds without the server until taps are decided by the offline set, 0 disables
+    uint16_t offlineAfter = 0;
 };
 
 struct WiFiConfig
@@ -32,8 +35,9 @@ struct WebConfig
 
 struct PersistenceData
 {
-    // version
-    static const uint8_t version = 4; // Increased version due to new admin password
+    // Schema of the NVS fields, bump and add a step to Persistence::migrate() when a
+    // field changes meaning. Added fields need no bump, missing keys keep their default.
+    static const uint8_t version = 5; // 5: per field NVS storage
 
     // api server
     ApiConfig api = ApiConfig();
@@ -45,22 +49,54 @@ struct PersistenceData
     WebConfig web = WebConfig();
 };
 
+// Version of the single PersistSettings blob used before the NVS storage, imported once
+#define PERSISTENCE_LEGACY_VERSION 4
+
+#define PERSISTENCE_NAMESPACE "fabreader"
+#define PERSISTENCE_COMMIT_DELAY_MS 5000 // Changes within this window are written together
+
 class Persistence
 {
 public:
     static void setup();
 
-    static PersistSettings<PersistenceData> getSettings();
+    // Writes changed fields once they settled for PERSISTENCE_COMMIT_DELAY_MS
+    static void loop();
+
+    // Writes changed fields now, call before restarting
+    static void flush();
+
+    // Copy to modify and pass to saveSettings(), use config() to read
+    static PersistenceData getSettings();
 
-    static void saveSettings(PersistSettings<PersistenceData> settings);
+    // Only fields that differ from the current settings are marked for writing
+    static void saveSettings(const PersistenceData &settings);
 
-    // Helper methods for WiFi
+    // Current settings without a copy. A save publishes a new snapshot, the reference
+    // stays valid until the save after that: the slot is rewritten by the second save. Read
+    // it right away and don't keep it; tasks that may wait in between use getSettings().
+    // The same holds for the pointers of the helpers below.
+    static const PersistenceData &config();
+
+    // Increments with every save. Returns true once per change, so consumers can cache
+    // values derived from config() and rebuild them only when the settings changed.
+    static uint32_t generation();
+    static bool changedSince(uint32_t &generation);
+
+    // Helper methods for WiFi, saving writes to flash immediately
     static bool isWiFiConfigured();
     static void saveWiFiCredentials(const char *ssid, const char *password);
     static const char *getWiFiSSID();
     static const char *getWiFiPassword();
 
-    // Helper methods for Admin Password
+    // Helper methods for Admin Password, saving writes to flash immediately
     static const char *getAdminPassword();
     static void saveAdminPassword(const char *password);
+
+    // Flash usage since boot
+    static uint32_t fieldWriteCount();
+    static uint32_t commitCount();
+
+private:
+    static void migrate(uint8_t from);
 };
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Wraps the network client so connecting by hostname opens the TCP connection to an
+// address resolved beforehand. The websocket is still connected by hostname, so its
+// handshake sends the configured hostname as Host, which name based proxies require.
+class PinnedClient : public Client
+{
+public:
+    explicit PinnedClient(Client &client) : client(client) {}
+
+    // The next connect() by hostname goes to address instead of resolving
+    void pin(const IPAddress &address)
+    {
+        this->address = address;
+        this->pinned = true;
+    }
+
+    void unpin() { this->pinned = false; }
+
+    int connect(IPAddress ip, uint16_t port) override { return this->client.connect(ip, port); }
+    int connect(const char *host, uint16_t port) override
+    {
+        if (this->pinned)
+        {
+            return this->client.connect(this->address, port);
+        }
+        return this->client.connect(host, port);
+    }
+
+    size_t write(uint8_t value) override { return this->client.write(value); }
+    size_t write(const uint8_t *buf, size_t size) override { return this->client.write(buf, size); }
+    int available() override { return this->client.available(); }
+    int read() override { return this->client.read(); }
+    int read(uint8_t *buf, size_t size) override { return this->client.read(buf, size); }
+    int peek() override { return this->client.peek(); }
+    void flush() override { this->client.flush(); }
+    void stop() override { this->client.stop(); }
+    uint8_t connected() override { return this->client.connected(); }
+    operator bool() override { return (bool)this->client; }
+
+private:
+    Client &client;
+    IPAddress address;
+    bool pinned = false;
+};
@@ -0,0 +1,495 @@
+#include "protocol.hpp"
+
+#include <string.h>
+
+#define PROTOCOL_EVENT_NAME(id, name) name,
+
+static const char *const EVENT_NAMES[] = {"UNKNOWN", PROTOCOL_EVENT_TYPES(PROTOCOL_EVENT_NAME)};
+
+#undef PROTOCOL_EVENT_NAME
+
+// Indexed by NFC_JOB_STEP_*
+static const char *const JOB_STEP_NAMES[] = {"AUTHENTICATE", "CHANGE_KEYS", "WRITE_FILE", "READ_FILE", "GET_UID", "READ_SIGNATURE", "GET_VERSION", "GET_FILE_SETTINGS", "CHANGE_FILE_SETTINGS"};
+
+// Indexed by NFCCardFamily
+static const char *const CARD_FAMILY_NAMES[] = {"UNKNOWN", "MIFARE_CLASSIC", "MIFARE_ULTRALIGHT", "ISO_DEP", "NTAG424", "FELICA", "ISO14443B", "JEWEL"};
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+EventType Protocol::eventType(const char *name)
+{
+    if (name == nullptr)
+    {
+        return EventType::Unknown;
+    }
+
+    // Two names with the same hash would be duplicate case labels and fail to compile
+    EventType type;
+    switch (Protocol::hash(name))
+    {
+#define PROTOCOL_EVENT_CASE(id, name) \
+    case Protocol::hash(name):        \
+        type = EventType::id;         \
+        break;
+
+        PROTOCOL_EVENT_TYPES(PROTOCOL_EVENT_CASE)
+
+#undef PROTOCOL_EVENT_CASE
+    default:
+        return EventType::Unknown;
+    }
+
+    // Unknown names can still hit a known hash
+    return strcmp(name, Protocol::eventName(type)) == 0 ? type : EventType::Unknown;
+}
+
+const char *Protocol::eventName(EventType type)
+{
+    uint8_t index = (uint8_t)type;
+    if (index >= sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]))
+    {
+        index = 0;
+    }
+    return EVENT_NAMES[index];
+}
+
+const char *Protocol::jobStepName(uint8_t type)
+{
+    if (type >= sizeof(JOB_STEP_NAMES) / sizeof(JOB_STEP_NAMES[0]))
+    {
+        return "UNKNOWN";
+    }
+    return JOB_STEP_NAMES[type];
+}
+
+const char *Protocol::cardFamilyName(NFCCardFamily family)
+{
+    uint8_t index = (uint8_t)family;
+    if (index >= sizeof(CARD_FAMILY_NAMES) / sizeof(CARD_FAMILY_NAMES[0]))
+    {
+        index = 0;
+    }
+    return CARD_FAMILY_NAMES[index];
+}
+
+static int8_t hexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+size_t Protocol::hexEncode(const uint8_t *bytes, size_t length, char *out, size_t outSize)
+{
+    if (outSize < length * 2 + 1)
+    {
+        if (outSize > 0)
+        {
+            out[0] = '\0';
+        }
+        return 0;
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        out[i * 2] = HEX_DIGITS[bytes[i] >> 4];
+        out[i * 2 + 1] = HEX_DIGITS[bytes[i] & 0x0F];
+    }
+    out[length * 2] = '\0';
+    return length * 2;
+}
+
+int Protocol::hexDecodeVariable(const char *hex, uint8_t *out, size_t maxLength)
+{
+    if (hex == nullptr)
+    {
+        return -1;
+    }
+
+    size_t length = 0;
+    while (hex[length * 2] != '\0')
+    {
+        if (length >= maxLength)
+        {
+            return -1;
+        }
+
+        int8_t high = hexDigit(hex[length * 2]);
+        int8_t low = high < 0 ? -1 : hexDigit(hex[length * 2 + 1]);
+        if (low < 0)
+        {
+            return -1;
+        }
+
+        out[length++] = (high << 4) | low;
+    }
+    return length;
+}
+
+bool Protocol::hexDecode(const char *hex, uint8_t *out, size_t length)
+{
+    return hex != nullptr && strlen(hex) == length * 2 && Protocol::hexDecodeVariable(hex, out, length) == (int)length;
+}
+
+int Protocol::decodeBytesVariable(JsonVariantConst value, uint8_t *out, size_t maxLength)
+{
+    if (value.is<MsgPackBinary>())
+    {
+        MsgPackBinary binary = value.as<MsgPackBinary>();
+        if (binary.size() > maxLength)
+        {
+            return -1;
+        }
+        memcpy(out, binary.data(), binary.size());
+        return binary.size();
+    }
+    return Protocol::hexDecodeVariable(value.as<const char *>(), out, maxLength);
+}
+
+bool Protocol::decodeBytes(JsonVariantConst value, uint8_t *out, size_t length)
+{
+    if (value.is<MsgPackBinary>())
+    {
+        return Protocol::decodeBytesVariable(value, out, length) == (int)length;
+    }
+    return Protocol::hexDecode(value.as<const char *>(), out, length);
+}
+
+void Protocol::encodeBytes(JsonVariant field, const uint8_t *bytes, size_t length, bool binary)
+{
+    if (binary)
+    {
+        field.set(MsgPackBinary(bytes, length));
+        return;
+    }
+
+    char hex[PROTOCOL_MAX_BYTES * 2 + 1];
+    Protocol::hexEncode(bytes, length, hex, sizeof(hex));
+    field.set(hex);
+}
+
+static void copyText(JsonVariantConst value, char *out, size_t size)
+{
+    const char *text = value.as<const char *>();
+    strncpy(out, text != nullptr ? text : "", size - 1);
+    out[size - 1] = '\0';
+}
+
+bool Protocol::decode(JsonObjectConst payload, RegistrationPayload &out)
+{
+    const char *token = payload["token"].as<const char *>();
+    if (!payload["id"].is<uint32_t>() || token == nullptr || strlen(token) == 0 || strlen(token) > PROTOCOL_TOKEN_LENGTH)
+    {
+        return false;
+    }
+
+    out.id = payload["id"].as<uint32_t>();
+    strcpy(out.token, token);
+    return true;
+}
+
+bool Protocol::decode(JsonObjectConst payload, MessagePayload &out)
+{
+    copyText(payload["message"], out.message, sizeof(out.message));
+    return true;
+}
+
+bool Protocol::decode(JsonObjectConst payload, EnableCardCheckingPayload &out)
+{
+    copyText(payload["message"], out.message, sizeof(out.message));
+    out.sun = payload["sun"] | false;
+    return true;
+}
+
+bool Protocol::decode(JsonObjectConst payload, ReaderAuthenticatedPayload &out)
+{
+    copyText(payload["name"], out.name, sizeof(out.name));
+
+    // Wire format for everything after this message, JSON unless the server accepted MessagePack
+    const char *encoding = payload["encoding"] | "json";
+    out.msgpack = strcmp(encoding, "msgpack") == 0;
+    return true;
+}
+
+bool Protocol::decode(JsonObjectConst payload, DisplayMessagePayload &out)
+{
+    copyText(payload["message"], out.message, sizeof(out.message));
+    out.duration = payload["duration"] | 0UL;
+    return true;
+}
+
+bool Protocol::decode(JsonObjectConst payload, ShowTextPayload &out)
+{
+    copyText(payload["lineOne"], out.line_one, sizeof(out.line_one));
+    copyText(payload["lineTwo"], out.line_two, sizeof(out.line_two));
+    return true;
+}
+
+bool Protocol::decode(JsonObjectConst payload, AuthenticatePayload &out)
+{
+    if (!payload["keyNumber"].is<uint8_t>() || payload["keyNumber"].as<uint8_t>() >= NFC_MAX_KEYS)
+    {
+        return false;
+    }
+
+    out.key_number = payload["keyNumber"].as<uint8_t>();
+    return Protocol::decodeBytes(payload["authenticationKey"], out.key, sizeof(out.key));
+}
+
+// "keys" maps key number to the new key, the optional "oldKeys" maps key number to the
+// current key. Keys other than 0 without an old key are assumed to still equal the
+// authentication key, which holds for factory cards.
+static bool decodeKeyChanges(JsonObjectConst payload, const uint8_t authKey[16], NFCKeyChange *changes, uint8_t &count)
+{
+    JsonObjectConst keys = payload["keys"].as<JsonObjectConst>();
+    JsonObjectConst oldKeys = payload["oldKeys"].as<JsonObjectConst>();
+    if (keys.isNull())
+    {
+        return false;
+    }
+
+    count = 0;
+    uint8_t seen = 0;
+    for (JsonPairConst key : keys)
+    {
+        const char *name = key.key().c_str();
+        if (name[0] < '0' || name[0] >= '0' + NFC_MAX_KEYS || name[1] != '\0')
+        {
+            return false;
+        }
+
+        uint8_t keyNumber = name[0] - '0';
+        if (seen & (1 << keyNumber))
+        {
+            return false;
+        }
+        seen |= 1 << keyNumber;
+
+        NFCKeyChange &change = changes[count++];
+        change.key_number = keyNumber;
+        change.success = false;
+        if (!Protocol::decodeBytes(key.value(), change.new_key, sizeof(change.new_key)))
+        {
+            return false;
+        }
+
+        JsonVariantConst oldKey = oldKeys[key.key()];
+        if (oldKey.isNull())
+        {
+            memcpy(change.old_key, authKey, sizeof(change.old_key));
+        }
+        else if (!Protocol::decodeBytes(oldKey, change.old_key, sizeof(change.old_key)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Protocol::decode(JsonObjectConst payload, ChangeKeysPayload &out)
+{
+    out.count = 0;
+    return Protocol::decodeBytes(payload["authenticationKey"], out.authentication_key, sizeof(out.authentication_key)) &&
+           decodeKeyChanges(payload, out.authentication_key, out.changes, out.count);
+}
+
+static bool decodeCommMode(JsonVariantConst value, uint8_t &commMode)
+{
+    const char *name = value | "PLAIN";
+    if (strcmp(name, "PLAIN") == 0)
+    {
+        commMode = NFC_COMM_MODE_PLAIN;
+    }
+    else if (strcmp(name, "MAC") == 0)
+    {
+        commMode = NFC_COMM_MODE_MAC;
+    }
+    else if (strcmp(name, "FULL") == 0)
+    {
+        commMode = NFC_COMM_MODE_FULL;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+static const char *decodeJobStep(JsonObjectConst data, NFCJob &job, NFCJobStep &step)
+{
+    step.type = 0xFF;
+    const char *type = data["type"].as<const char *>();
+    for (uint8_t i = 0; type != nullptr && i < sizeof(JOB_STEP_NAMES) / sizeof(JOB_STEP_NAMES[0]); i++)
+    {
+        if (strcmp(type, JOB_STEP_NAMES[i]) == 0)
+        {
+            step.type = i;
+        }
+    }
+
+    if (!decodeCommMode(data["commMode"], step.comm_mode))
+    {
+        return "Unknown comm mode";
+    }
+    step.key_number = data["keyNumber"] | 0;
+    step.file_number = data["fileNumber"] | 0;
+    step.offset = data["offset"] | 0;
+
+    switch (step.type)
+    {
+    case NFC_JOB_STEP_AUTHENTICATE:
+        if (step.key_number >= NFC_MAX_KEYS || !Protocol::decodeBytes(data["authenticationKey"], step.key, sizeof(step.key)))
+        {
+            return "Invalid AUTHENTICATE key";
+        }
+        return nullptr;
+    case NFC_JOB_STEP_CHANGE_KEYS:
+        if (job.key_change_count > 0)
+        {
+            return "Only one CHANGE_KEYS step per job";
+        }
+        if (!Protocol::decodeBytes(data["authenticationKey"], step.key, sizeof(step.key)) ||
+            !decodeKeyChanges(data, step.key, job.key_changes, job.key_change_count) || job.key_change_count == 0)
+        {
+            return "Invalid CHANGE_KEYS keys";
+        }
+        return nullptr;
+    case NFC_JOB_STEP_WRITE_FILE:
+    {
+        int length = Protocol::decodeBytesVariable(data["data"], step.data, sizeof(step.data));
+        if (length <= 0)
+        {
+            return "WRITE_FILE data invalid or too long";
+        }
+        step.length = length;
+        return nullptr;
+    }
+    case NFC_JOB_STEP_READ_FILE:
+        step.length = data["length"] | 0;
+        if (step.length == 0 || step.length > NFC_JOB_MAX_DATA)
+        {
+            return "READ_FILE length out of range";
+        }
+        return nullptr;
+    case NFC_JOB_STEP_GET_FILE_SETTINGS:
+        // The driver doesn't decrypt the answer
+        if (step.comm_mode == NFC_COMM_MODE_FULL)
+        {
+            return "GET_FILE_SETTINGS needs PLAIN or MAC";
+        }
+        return nullptr;
+    case NFC_JOB_STEP_CHANGE_FILE_SETTINGS:
+    {
+        int length = Protocol::decodeBytesVariable(data["data"], step.data, sizeof(step.data));
+        if (length <= 0)
+        {
+            return "CHANGE_FILE_SETTINGS data invalid or too long";
+        }
+        step.length = length;
+        // The card only accepts it encrypted
+        step.comm_mode = NFC_COMM_MODE_FULL;
+        return nullptr;
+    }
+    case NFC_JOB_STEP_GET_UID:
+    case NFC_JOB_STEP_READ_SIGNATURE:
+    case NFC_JOB_STEP_GET_VERSION:
+        return nullptr;
+    default:
+        return "Unknown step type";
+    }
+}
+
+bool Protocol::decode(JsonObjectConst payload, RunJobPayload &out)
+{
+    memset(&out.job, 0, sizeof(out.job));
+    out.job.id = payload["jobId"] | 0UL;
+    out.error = nullptr;
+
+    JsonArrayConst steps = payload["steps"].as<JsonArrayConst>();
+    if (steps.size() == 0)
+    {
+        out.error = "No steps";
+        return false;
+    }
+
+    // Optional, a job for a specific card only runs while that card is in the field
+    JsonVariantConst cardUid = payload["cardUID"];
+    if (!cardUid.isNull())
+    {
+        int length = Protocol::decodeBytesVariable(cardUid, out.job.card_uid, sizeof(out.job.card_uid));
+        if (length <= 0)
+        {
+            out.error = "Invalid cardUID";
+            return false;
+        }
+        out.job.card_uid_length = length;
+    }
+
+    for (JsonVariantConst step : steps)
+    {
+        if (out.job.step_count >= NFC_JOB_MAX_STEPS)
+        {
+            out.error = "Too many steps";
+            return false;
+        }
+
+        out.error = decodeJobStep(step.as<JsonObjectConst>(), out.job, out.job.steps[out.job.step_count++]);
+        if (out.error != nullptr)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Protocol::decode(JsonObjectConst payload, JournalAckPayload &out)
+{
+    if (!payload["acknowledged"].is<uint32_t>())
+    {
+        return false;
+    }
+
+    out.acknowledged = payload["acknowledged"].as<uint32_t>();
+    return true;
+}
+
+// Missing lists are empty, anything but whole hashes is invalid
+static bool decodeHashes(JsonVariantConst value, uint8_t *out, size_t size, uint16_t &count)
+{
+    int length = value.isNull() ? 0 : Protocol::decodeBytesVariable(value, out, size);
+    if (length < 0 || length % OFFLINE_AUTH_HASH_SIZE != 0)
+    {
+        return false;
+    }
+
+    count = length / OFFLINE_AUTH_HASH_SIZE;
+    return true;
+}
+
+bool Protocol::decode(JsonObjectConst payload, OfflineAuthUpdatePayload &out)
+{
+    if (!payload["baseVersion"].is<uint32_t>() || !payload["version"].is<uint32_t>() || !payload["chunk"].is<uint16_t>())
+    {
+        return false;
+    }
+
+    out.base_version = payload["baseVersion"].as<uint32_t>();
+    out.version = payload["version"].as<uint32_t>();
+    out.chunk = payload["chunk"].as<uint16_t>();
+    out.final = payload["final"] | false;
+
+    return decodeHashes(payload["added"], out.added, sizeof(out.added), out.added_count) &&
+           decodeHashes(payload["removed"], out.removed, sizeof(out.removed), out.removed_count);
+}
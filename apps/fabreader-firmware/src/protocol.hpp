@@ -0,0 +1,167 @@
+#pragma once
+
+// Websocket message codec. Event types are resolved through a compile time hash,
+// payloads are decoded into fixed size structs and validated before a handler sees
+// them. Nothing here depends on Arduino, the codec is unit tested on the host
+// (pio test -e native).
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+#include "nfc_types.hpp"
+#include "offline_auth.hpp"
+
+#define PROTOCOL_TEXT_LENGTH 64  // Display texts, longer texts are cut off
+#define PROTOCOL_TOKEN_LENGTH 16 // Matches ApiConfig::apiKey
+#define PROTOCOL_MAX_BYTES NFC_JOB_RESULT_SIZE // Longest byte field sent to the server
+#define PROTOCOL_OFFLINE_AUTH_CHUNK 64         // Hashes added and removed per OFFLINE_AUTH_UPDATE
+
+// FabreaderEventType on the server, X(enum value, wire name)
+#define PROTOCOL_EVENT_TYPES(X)                         \
+    X(Register, "REGISTER")                             \
+    X(Authenticate, "AUTHENTICATE")                     \
+    X(Unauthorized, "UNAUTHORIZED")                     \
+    X(ReaderAuthenticated, "READER_AUTHENTICATED")      \
+    X(ShowText, "SHOW_TEXT")                            \
+    X(HideText, "HIDE_TEXT")                            \
+    X(KeyPressed, "KEY_PRESSED")                        \
+    X(NfcTap, "NFC_TAP")                                \
+    X(CardRemoved, "CARD_REMOVED")                      \
+    X(ChangeKeys, "CHANGE_KEYS")                        \
+    X(EnableCardChecking, "ENABLE_CARD_CHECKING")       \
+    X(DisableCardChecking, "DISABLE_CARD_CHECKING")     \
+    X(DisplaySuccess, "DISPLAY_SUCCESS")                \
+    X(DisplayError, "DISPLAY_ERROR")                    \
+    X(Reauthenticate, "REAUTHENTICATE")                 \
+    X(RunJob, "RUN_JOB")                                \
+    X(JournalReplay, "JOURNAL_REPLAY")                  \
+    X(OfflineAuthUpdate, "OFFLINE_AUTH_UPDATE")
+
+#define PROTOCOL_EVENT_ENUM(id, name) id,
+
+enum class EventType : uint8_t
+{
+    Unknown,
+    PROTOCOL_EVENT_TYPES(PROTOCOL_EVENT_ENUM)
+};
+
+#undef PROTOCOL_EVENT_ENUM
+
+struct RegistrationPayload
+{
+    uint32_t id;
+    char token[PROTOCOL_TOKEN_LENGTH + 1];
+};
+
+// UNAUTHORIZED
+struct MessagePayload
+{
+    char message[PROTOCOL_TEXT_LENGTH];
+};
+
+struct EnableCardCheckingPayload
+{
+    char message[PROTOCOL_TEXT_LENGTH];
+    bool sun; // Read the SUN message of NTAG424 cards and send it with NFC_TAP
+};
+
+struct ReaderAuthenticatedPayload
+{
+    char name[PROTOCOL_TEXT_LENGTH];
+    bool msgpack; // Server accepted the MessagePack encoding
+};
+
+// DISPLAY_SUCCESS, DISPLAY_ERROR
+struct DisplayMessagePayload
+{
+    char message[PROTOCOL_TEXT_LENGTH];
+    unsigned long duration;
+};
+
+struct ShowTextPayload
+{
+    char line_one[PROTOCOL_TEXT_LENGTH];
+    char line_two[PROTOCOL_TEXT_LENGTH];
+};
+
+struct AuthenticatePayload
+{
+    uint8_t key_number;
+    uint8_t key[16];
+};
+
+struct ChangeKeysPayload
+{
+    uint8_t authentication_key[16]; // Current key 0
+    NFCKeyChange changes[NFC_MAX_KEYS];
+    uint8_t count;
+};
+
+// Response to JOURNAL_REPLAY
+struct JournalAckPayload
+{
+    uint32_t acknowledged; // Highest sequence the server recorded
+};
+
+// One chunk of an update of the OfflineAuthSet, hashes are OFFLINE_AUTH_HASH_SIZE bytes each
+struct OfflineAuthUpdatePayload
+{
+    uint32_t base_version; // Version the update applies to, 0 replaces the whole set
+    uint32_t version;      // Version once all chunks were applied
+    uint16_t chunk;
+    bool final;
+    uint8_t added[PROTOCOL_OFFLINE_AUTH_CHUNK * OFFLINE_AUTH_HASH_SIZE];
+    uint16_t added_count;
+    uint8_t removed[PROTOCOL_OFFLINE_AUTH_CHUNK * OFFLINE_AUTH_HASH_SIZE];
+    uint16_t removed_count;
+};
+
+struct RunJobPayload
+{
+    NFCJob job;
+    const char *error; // Why decoding failed, job.id is still set
+};
+
+namespace Protocol
+{
+    // FNV-1a, evaluated at compile time for the case labels of eventType()
+    constexpr uint32_t hash(const char *text, uint32_t value = 2166136261u)
+    {
+        return *text == '\0' ? value : hash(text + 1, (value ^ (uint8_t)*text) * 16777619u);
+    }
+
+    EventType eventType(const char *name);
+    const char *eventName(EventType type);
+
+    // Lowercase hex, writes length * 2 digits and a terminator. Returns the digit count,
+    // or 0 and an empty string if out is too small.
+    size_t hexEncode(const uint8_t *bytes, size_t length, char *out, size_t outSize);
+
+    // Decodes exactly length bytes, fails on any other digit count or non hex digits
+    bool hexDecode(const char *hex, uint8_t *out, size_t length);
+
+    // Decodes up to maxLength bytes, returns the byte count or -1 if invalid
+    int hexDecodeVariable(const char *hex, uint8_t *out, size_t maxLength);
+
+    // Byte fields (keys, UIDs, file data) are hex strings in JSON and bin in MessagePack,
+    // the decoders accept both
+    bool decodeBytes(JsonVariantConst value, uint8_t *out, size_t length);
+    int decodeBytesVariable(JsonVariantConst value, uint8_t *out, size_t maxLength);
+    void encodeBytes(JsonVariant field, const uint8_t *bytes, size_t length, bool binary);
+
+    // Payload decoders, false if a required field is missing or invalid
+    bool decode(JsonObjectConst payload, RegistrationPayload &out);
+    bool decode(JsonObjectConst payload, MessagePayload &out);
+    bool decode(JsonObjectConst payload, EnableCardCheckingPayload &out);
+    bool decode(JsonObjectConst payload, ReaderAuthenticatedPayload &out);
+    bool decode(JsonObjectConst payload, DisplayMessagePayload &out);
+    bool decode(JsonObjectConst payload, ShowTextPayload &out);
+    bool decode(JsonObjectConst payload, AuthenticatePayload &out);
+    bool decode(JsonObjectConst payload, ChangeKeysPayload &out);
+    bool decode(JsonObjectConst payload, RunJobPayload &out);
+    bool decode(JsonObjectConst payload, JournalAckPayload &out);
+    bool decode(JsonObjectConst payload, OfflineAuthUpdatePayload &out);
+
+    const char *jobStepName(uint8_t type);
+    const char *cardFamilyName(NFCCardFamily family);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// Hands a value from one writer task to reader tasks without a lock. The writer makes the
+// sequence odd while it copies, a reader retries if the sequence was odd or moved on while
+// it copied. Readers never wait for the writer: on the single core ESP32-C3 a higher
+// priority reader spinning on a preempted writer would never let it finish, so read()
+// gives up after a few attempts and the caller tries again later.
+template <typename T>
+class SeqLock
+{
+public:
+    // Only one task may write
+    void write(const T &value)
+    {
+        uint32_t sequence = this->sequence.load(std::memory_order_relaxed);
+        this->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&this->value, &value, sizeof(T));
+        this->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Copies the latest value, false if a write overlapped every attempt. version identifies
+    // the value, it changes with every write.
+    bool read(T &out, uint32_t &version, uint8_t attempts = 3) const
+    {
+        for (uint8_t i = 0; i < attempts; i++)
+        {
+            uint32_t before = this->sequence.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                continue;
+            }
+
+            memcpy(&out, &this->value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (this->sequence.load(std::memory_order_relaxed) == before)
+            {
+                version = before;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Version of the latest complete write, to skip a read when nothing changed
+    uint32_t version() const { return this->sequence.load(std::memory_order_acquire) & ~1u; }
+
+private:
+    T value = T();
+    std::atomic<uint32_t> sequence{0};
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define SUN_UID_LENGTH 7      // SDM mirrors the 7 byte UID of the NTAG424
+#define SUN_COUNTER_DIGITS 6  // SDMReadCtr, 3 bytes
+#define SUN_MAC_LENGTH 8      // SDMMAC, truncated CMAC
+#define SUN_MAX_URI_LENGTH 96 // ISOReadFile bytes the reader reads, the enrollment template has 61
+
+// SUN message the card mirrors into its NDEF file on every read. The MAC is keyed with a
+// session key derived from the card's key 0, which only the server knows, so the reader
+// only extracts the values and leaves verification to the server.
+struct SunMessage
+{
+    uint8_t uid[SUN_UID_LENGTH];
+    uint32_t counter; // Counts up on every read, mirrored MSB first
+    uint8_t mac[SUN_MAC_LENGTH];
+
+    // Reads the u=, c= and m= query parameters of the URI record payload returned by
+    // ntag424_ISOReadFile(). False if one is missing or isn't hex of the mirrored length.
+    static bool parse(const uint8_t *uri, uint8_t length, SunMessage &out)
+    {
+        const uint8_t *uid = findParameter(uri, length, 'u', SUN_UID_LENGTH * 2);
+        const uint8_t *counter = findParameter(uri, length, 'c', SUN_COUNTER_DIGITS);
+        const uint8_t *mac = findParameter(uri, length, 'm', SUN_MAC_LENGTH * 2);
+        if (uid == nullptr || counter == nullptr || mac == nullptr)
+        {
+            return false;
+        }
+
+        uint8_t counter_bytes[SUN_COUNTER_DIGITS / 2];
+        if (!decodeHex(uid, out.uid, SUN_UID_LENGTH) || !decodeHex(counter, counter_bytes, sizeof(counter_bytes)) ||
+            !decodeHex(mac, out.mac, SUN_MAC_LENGTH))
+        {
+            return false;
+        }
+
+        out.counter = ((uint32_t)counter_bytes[0] << 16) | ((uint32_t)counter_bytes[1] << 8) | counter_bytes[2];
+        return true;
+    }
+
+private:
+    // Value of "<name>=" after '?' or '&', only if exactly digits characters follow up to the
+    // next '&' or the end
+    static const uint8_t *findParameter(const uint8_t *uri, uint8_t length, char name, uint8_t digits)
+    {
+        for (uint8_t i = 1; i + 1 < length; i++)
+        {
+            if ((uri[i - 1] != '?' && uri[i - 1] != '&') || uri[i] != name || uri[i + 1] != '=')
+            {
+                continue;
+            }
+
+            uint8_t start = i + 2;
+            uint8_t end = start;
+            while (end < length && uri[end] != '&')
+            {
+                end++;
+            }
+            return end - start == digits ? uri + start : nullptr;
+        }
+        return nullptr;
+    }
+
+    // SDM mirrors uppercase hex
+    static bool decodeHex(const uint8_t *hex, uint8_t *out, uint8_t length)
+    {
+        for (uint8_t i = 0; i < length; i++)
+        {
+            int high = nibble(hex[2 * i]);
+            int low = nibble(hex[2 * i + 1]);
+            if (high < 0 || low < 0)
+            {
+                return false;
+            }
+            out[i] = (uint8_t)((high << 4) | low);
+        }
+        return true;
+    }
+
+    static int nibble(uint8_t c)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+        if (c >= 'A' && c <= 'F')
+        {
+            return c - 'A' + 10;
+        }
+        if (c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        return -1;
+    }
+};
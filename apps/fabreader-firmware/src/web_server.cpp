@@ -14,7 +14,7 @@ bool isApiConnected()
     {
         return false;
     }
-    return api.isConnected();
+    return api.isOnline();
 }
 
 ConfigWebServer::ConfigWebServer(NetworkInterface *network) : server(80), network(network)
@@ -222,7 +222,8 @@ void ConfigWebServer::handleApiAuthLogin()
 
     String password = requestDoc["password"].as<String>();
 
-    if (password == Persistence::getAdminPassword())
+    // Copies, the web server task may be preempted across saves of other tasks
+    if (password == Persistence::getSettings().web.admin_password)
     {
         authenticated = true;
         doc["success"] = true;
@@ -259,12 +260,13 @@ void ConfigWebServer::handleApiConfig()
         return;
     }
 
-    PersistSettings<PersistenceData> settings = Persistence::getSettings();
+    ApiConfig config = Persistence::getSettings().api;
 
     JsonDocument doc;
-    doc["apiHostname"] = settings.Config.api.hostname;
-    doc["apiPort"] = settings.Config.api.port;
-    doc["readerId"] = settings.Config.api.readerId;
+    doc["apiHostname"] = config.hostname;
+    doc["apiPort"] = config.port;
+    doc["readerId"] = config.readerId;
+    doc["offlineAfter"] = config.offlineAfter;
 
     String response;
     serializeJson(doc, response);
@@ -297,7 +299,7 @@ void ConfigWebServer::handleApiConfigSave()
         return;
     }
 
-    PersistSettings<PersistenceData> settings = Persistence::getSettings();
+    PersistenceData settings = Persistence::getSettings();
 
     // Update API configuration
     if (requestDoc.containsKey("apiHostname"))
@@ -305,8 +307,8 @@ void ConfigWebServer::handleApiConfigSave()
         String apiHostname = requestDoc["apiHostname"].as<String>();
         Serial.print("[WebServer] Updating API hostname to: ");
         Serial.println(apiHostname);
-        strncpy(settings.Config.api.hostname, apiHostname.c_str(), sizeof(settings.Config.api.hostname) - 1);
-        settings.Config.api.hostname[sizeof(settings.Config.api.hostname) - 1] = '\0';
+        strncpy(settings.api.hostname, apiHostname.c_str(), sizeof(settings.api.hostname) - 1);
+        settings.api.hostname[sizeof(settings.api.hostname) - 1] = '\0';
     }
 
     if (requestDoc.containsKey("apiPort"))
@@ -314,7 +316,7 @@ void ConfigWebServer::handleApiConfigSave()
         uint16_t apiPort = requestDoc["apiPort"].as<uint16_t>();
         Serial.print("[WebServer] Updating API port to: ");
         Serial.println(apiPort);
-        settings.Config.api.port = apiPort;
+        settings.api.port = apiPort;
     }
 
     if (requestDoc.containsKey("readerId"))
@@ -322,15 +324,23 @@ void ConfigWebServer::handleApiConfigSave()
         uint32_t readerId = requestDoc["readerId"].as<uint32_t>();
         Serial.print("[WebServer] Updating reader ID to: ");
         Serial.println(readerId);
-        settings.Config.api.readerId = readerId;
+        settings.api.readerId = readerId;
+    }
+
+    if (requestDoc.containsKey("offlineAfter"))
+    {
+        uint16_t offlineAfter = requestDoc["offlineAfter"].as<uint16_t>();
+        Serial.print("[WebServer] Updating offline mode delay to: ");
+        Serial.println(offlineAfter);
+        settings.api.offlineAfter = offlineAfter;
     }
 
     if (requestDoc.containsKey("apiKey"))
     {
         String apiKey = requestDoc["apiKey"].as<String>();
         Serial.println("[WebServer] Updating API key");
-        strncpy(settings.Config.api.apiKey, apiKey.c_str(), sizeof(settings.Config.api.apiKey) - 1);
-        settings.Config.api.apiKey[sizeof(settings.Config.api.apiKey) - 1] = '\0';
+        strncpy(settings.api.apiKey, apiKey.c_str(), sizeof(settings.api.apiKey) - 1);
+        settings.api.apiKey[sizeof(settings.api.apiKey) - 1] = '\0';
     }
 
     // Update admin password if provided and not empty
@@ -338,8 +348,8 @@ void ConfigWebServer::handleApiConfigSave()
     {
         String newPassword = requestDoc["configPagePassword"].as<String>();
         Serial.println("[WebServer] Updating admin password");
-        strncpy(settings.Config.web.admin_password, newPassword.c_str(), sizeof(settings.Config.web.admin_password) - 1);
-        settings.Config.web.admin_password[sizeof(settings.Config.web.admin_password) - 1] = '\0';
+        strncpy(settings.web.admin_password, newPassword.c_str(), sizeof(settings.web.admin_password) - 1);
+        settings.web.admin_password[sizeof(settings.web.admin_password) - 1] = '\0';
     }
 
     // Save all settings
@@ -356,6 +366,7 @@ void ConfigWebServer::handleApiConfigSave()
     server.send(200, "application/json", response);
 
     // Restart the device after a short delay to apply settings
+    Persistence::flush();
     delay(500);
     ESP.restart();
 }
@@ -372,8 +383,7 @@ void ConfigWebServer::handleApiStatus()
     doc["apiConnected"] = isApiConnected();
 
     // Add reader ID from persistence
-    PersistSettings<PersistenceData> settings = Persistence::getSettings();
-    doc["readerId"] = settings.Config.api.readerId;
+    doc["readerId"] = Persistence::getSettings().api.readerId;
 
     String response;
     serializeJson(doc, response);
@@ -0,0 +1,64 @@
+#include <unity.h>
+#include "backoff.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+void test_ceiling_doubles_up_to_max()
+{
+    Backoff backoff(1000, 8000);
+
+    // The largest random value hits the ceiling
+    TEST_ASSERT_EQUAL_UINT32(1000, backoff.next(500));
+    TEST_ASSERT_EQUAL_UINT32(2000, backoff.next(1000));
+    TEST_ASSERT_EQUAL_UINT32(4000, backoff.next(2000));
+    TEST_ASSERT_EQUAL_UINT32(8000, backoff.next(4000));
+    TEST_ASSERT_EQUAL_UINT32(8000, backoff.next(4000));
+    TEST_ASSERT_EQUAL(5, backoff.failureCount());
+}
+
+void test_jitter_stays_within_half_of_ceiling()
+{
+    for (uint32_t random = 0; random < 5000; random += 37)
+    {
+        Backoff backoff(1000, 60000);
+        backoff.next(0);
+        backoff.next(0);
+        uint32_t delay = backoff.next(random);
+        TEST_ASSERT_TRUE(delay >= 2000 && delay <= 4000);
+    }
+}
+
+void test_reset()
+{
+    Backoff backoff(1000, 60000);
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        backoff.next(0);
+    }
+    TEST_ASSERT_EQUAL_UINT32(30000, backoff.next(0));
+
+    backoff.reset();
+    TEST_ASSERT_EQUAL(0, backoff.failureCount());
+    TEST_ASSERT_EQUAL_UINT32(500, backoff.next(0));
+}
+
+void test_many_failures_do_not_overflow()
+{
+    Backoff backoff(1000, 60000);
+    for (uint16_t i = 0; i < 1000; i++)
+    {
+        TEST_ASSERT_TRUE(backoff.next(0xFFFFFFFF) <= 60000);
+    }
+    TEST_ASSERT_EQUAL(255, backoff.failureCount());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ceiling_doubles_up_to_max);
+    RUN_TEST(test_jitter_stays_within_half_of_ceiling);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_many_failures_do_not_overflow);
+    return UNITY_END();
+}
@@ -0,0 +1,137 @@
+#include <unity.h>
+#include "card_cache.hpp"
+
+static CardCache cache;
+
+static const uint8_t UID_A[] = {0x04, 0x5A, 0x3B, 0x11, 0x22, 0x33, 0x44};
+static const uint8_t UID_B[] = {0x04, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+
+void setUp()
+{
+    cache.clear();
+}
+
+void tearDown() {}
+
+void test_unknown_card_misses()
+{
+    TEST_ASSERT_NULL(cache.find(UID_A, sizeof(UID_A), 0));
+
+    CardInfo &card = cache.touch(UID_A, sizeof(UID_A), 0);
+    TEST_ASSERT_EQUAL((uint8_t)CardType::Unknown, (uint8_t)card.type);
+    TEST_ASSERT_FALSE(card.has_version);
+    TEST_ASSERT_EQUAL_PTR(&card, cache.find(UID_A, sizeof(UID_A), 0));
+
+    // Same prefix, other length
+    TEST_ASSERT_NULL(cache.find(UID_A, 4, 0));
+}
+
+void test_least_recently_used_is_replaced()
+{
+    uint8_t uid[4] = {};
+    for (uint8_t i = 0; i < CARD_CACHE_ENTRIES; i++)
+    {
+        uid[0] = i;
+        cache.touch(uid, sizeof(uid), 0).type = CardType::NTAG424;
+    }
+
+    // Card 0 is used again, card 1 is now the oldest
+    uid[0] = 0;
+    TEST_ASSERT_NOT_NULL(cache.find(uid, sizeof(uid), 0));
+    cache.touch(UID_A, sizeof(UID_A), 0);
+
+    TEST_ASSERT_NOT_NULL(cache.find(uid, sizeof(uid), 0));
+    uid[0] = 1;
+    TEST_ASSERT_NULL(cache.find(uid, sizeof(uid), 0));
+    uid[0] = 2;
+    TEST_ASSERT_NOT_NULL(cache.find(uid, sizeof(uid), 0));
+}
+
+void test_entries_expire()
+{
+    CardInfo &card = cache.touch(UID_A, sizeof(UID_A), 1000);
+    card.type = CardType::NTAG424;
+    card.has_version = true;
+
+    TEST_ASSERT_TRUE(cache.find(UID_A, sizeof(UID_A), 1000 + CARD_CACHE_TTL_MS - 1)->has_version);
+
+    CardInfo *expired = cache.find(UID_A, sizeof(UID_A), 1000 + CARD_CACHE_TTL_MS);
+    TEST_ASSERT_NOT_NULL(expired);
+    TEST_ASSERT_FALSE(expired->has_version);
+    TEST_ASSERT_EQUAL((uint8_t)CardType::Unknown, (uint8_t)expired->type);
+}
+
+void test_file_settings_per_file()
+{
+    CardInfo &card = cache.touch(UID_A, sizeof(UID_A), 0);
+    const uint8_t settings[] = {0x00, 0x00, 0xE0, 0xEE, 0x00, 0x01, 0x00};
+
+    uint8_t length;
+    TEST_ASSERT_NULL(CardCache::fileSettings(card, 2, length));
+
+    CardCache::storeFileSettings(card, 2, settings, sizeof(settings));
+    const uint8_t *cached = CardCache::fileSettings(card, 2, length);
+    TEST_ASSERT_NOT_NULL(cached);
+    TEST_ASSERT_EQUAL(sizeof(settings), length);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(settings, cached, sizeof(settings));
+    TEST_ASSERT_NULL(CardCache::fileSettings(card, 3, length));
+
+    // Only the standard files are cached
+    CardCache::storeFileSettings(card, 0, settings, sizeof(settings));
+    CardCache::storeFileSettings(card, CARD_CACHE_FILES + 1, settings, sizeof(settings));
+    TEST_ASSERT_NULL(CardCache::fileSettings(card, 0, length));
+    TEST_ASSERT_NULL(CardCache::fileSettings(card, CARD_CACHE_FILES + 1, length));
+}
+
+void test_session_ends_with_the_card()
+{
+    cache.touch(UID_A, sizeof(UID_A), 0).app_selected = true;
+    cache.touch(UID_B, sizeof(UID_B), 0).app_selected = true;
+
+    cache.endSession(UID_A, sizeof(UID_A));
+    TEST_ASSERT_FALSE(cache.find(UID_A, sizeof(UID_A), 0)->app_selected);
+    TEST_ASSERT_TRUE(cache.find(UID_B, sizeof(UID_B), 0)->app_selected);
+}
+
+void test_sun_counter_must_grow()
+{
+    CardInfo &card = cache.touch(UID_A, sizeof(UID_A), 0);
+
+    TEST_ASSERT_TRUE(CardCache::acceptSunCounter(card, 0));
+    TEST_ASSERT_FALSE(CardCache::acceptSunCounter(card, 0));
+    TEST_ASSERT_TRUE(CardCache::acceptSunCounter(card, 5));
+    TEST_ASSERT_FALSE(CardCache::acceptSunCounter(card, 4));
+    TEST_ASSERT_EQUAL_UINT32(5, card.sun_counter);
+
+    // Other cards count on their own
+    TEST_ASSERT_TRUE(CardCache::acceptSunCounter(cache.touch(UID_B, sizeof(UID_B), 0), 1));
+}
+
+void test_changed_file_settings_are_forgotten()
+{
+    CardInfo &card = cache.touch(UID_A, sizeof(UID_A), 0);
+    const uint8_t settings[] = {0x00, 0x00, 0xE0, 0xEE, 0x00, 0x01, 0x00};
+    CardCache::storeFileSettings(card, 2, settings, sizeof(settings));
+    CardCache::storeFileSettings(card, 3, settings, sizeof(settings));
+    card.no_sun = true;
+
+    CardCache::forgetFileSettings(card, 2);
+
+    uint8_t length;
+    TEST_ASSERT_NULL(CardCache::fileSettings(card, 2, length));
+    TEST_ASSERT_NOT_NULL(CardCache::fileSettings(card, 3, length));
+    TEST_ASSERT_FALSE(card.no_sun);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_unknown_card_misses);
+    RUN_TEST(test_least_recently_used_is_replaced);
+    RUN_TEST(test_entries_expire);
+    RUN_TEST(test_file_settings_per_file);
+    RUN_TEST(test_session_ends_with_the_card);
+    RUN_TEST(test_sun_counter_must_grow);
+    RUN_TEST(test_changed_file_settings_are_forgotten);
+    return UNITY_END();
+}
@@ -0,0 +1,53 @@
+#include <unity.h>
+#include "card_classifier.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+void test_ntag424_by_ats()
+{
+    const uint8_t ats[] = {0x06, 0x77, 0x77, 0x71, 0x02, 0x80};
+    TEST_ASSERT_EQUAL((uint8_t)NFCCardFamily::Ntag424, (uint8_t)CardClassifier::classify(0x0344, 0x20, ats, sizeof(ats)));
+}
+
+void test_other_iso_dep_cards()
+{
+    // DESFire EV2
+    const uint8_t ats[] = {0x06, 0x75, 0x77, 0x81, 0x02, 0x80};
+    TEST_ASSERT_EQUAL((uint8_t)NFCCardFamily::IsoDep, (uint8_t)CardClassifier::classify(0x0344, 0x20, ats, sizeof(ats)));
+
+    // SmartMX with MIFARE Classic emulation still speaks ISO14443-4
+    TEST_ASSERT_EQUAL((uint8_t)NFCCardFamily::IsoDep, (uint8_t)CardClassifier::classify(0x0004, 0x28, nullptr, 0));
+}
+
+void test_mifare_families()
+{
+    TEST_ASSERT_EQUAL((uint8_t)NFCCardFamily::MifareClassic, (uint8_t)CardClassifier::classify(0x0004, 0x08, nullptr, 0));
+    TEST_ASSERT_EQUAL((uint8_t)NFCCardFamily::MifareClassic, (uint8_t)CardClassifier::classify(0x0002, 0x18, nullptr, 0));
+    TEST_ASSERT_EQUAL((uint8_t)NFCCardFamily::MifareClassic, (uint8_t)CardClassifier::classify(0x0004, 0x09, nullptr, 0));
+    TEST_ASSERT_EQUAL((uint8_t)NFCCardFamily::MifareUltralight, (uint8_t)CardClassifier::classify(0x0044, 0x00, nullptr, 0));
+
+    // MIFARE Plus SL2 and unknown SAK/ATQA combinations
+    TEST_ASSERT_EQUAL((uint8_t)NFCCardFamily::Unknown, (uint8_t)CardClassifier::classify(0x0004, 0x10, nullptr, 0));
+    TEST_ASSERT_EQUAL((uint8_t)NFCCardFamily::Unknown, (uint8_t)CardClassifier::classify(0x0004, 0x00, nullptr, 0));
+}
+
+void test_ntag424_support()
+{
+    TEST_ASSERT_TRUE(CardClassifier::supportsNtag424(NFCCardFamily::Ntag424));
+    TEST_ASSERT_TRUE(CardClassifier::supportsNtag424(NFCCardFamily::IsoDep));
+    TEST_ASSERT_TRUE(CardClassifier::supportsNtag424(NFCCardFamily::Unknown));
+    TEST_ASSERT_FALSE(CardClassifier::supportsNtag424(NFCCardFamily::MifareClassic));
+    TEST_ASSERT_FALSE(CardClassifier::supportsNtag424(NFCCardFamily::MifareUltralight));
+    TEST_ASSERT_FALSE(CardClassifier::supportsNtag424(NFCCardFamily::Felica));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ntag424_by_ats);
+    RUN_TEST(test_other_iso_dep_cards);
+    RUN_TEST(test_mifare_families);
+    RUN_TEST(test_ntag424_support);
+    return UNITY_END();
+}
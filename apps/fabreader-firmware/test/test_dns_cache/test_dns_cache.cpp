@@ -0,0 +1,78 @@
+#include <unity.h>
+#include "dns_cache.hpp"
+
+static const uint32_t ADDRESS = 0x0A00000A;
+static const uint32_t OTHER_ADDRESS = 0x0B00000A;
+
+void setUp() {}
+void tearDown() {}
+
+void test_miss_then_hit_until_ttl()
+{
+    DnsCache cache;
+    uint32_t address = 0;
+    TEST_ASSERT_EQUAL((uint8_t)DnsCacheResult::Miss, (uint8_t)cache.lookup("fabaccess.local", 0, address));
+
+    cache.store("fabaccess.local", ADDRESS, 1000);
+    TEST_ASSERT_EQUAL((uint8_t)DnsCacheResult::Hit, (uint8_t)cache.lookup("fabaccess.local", 1000 + DNS_CACHE_TTL_MS - 1, address));
+    TEST_ASSERT_EQUAL_UINT32(ADDRESS, address);
+    TEST_ASSERT_EQUAL((uint8_t)DnsCacheResult::Miss, (uint8_t)cache.lookup("fabaccess.local", 1000 + DNS_CACHE_TTL_MS, address));
+}
+
+void test_negative_caching_keeps_last_known_good()
+{
+    DnsCache cache;
+    uint32_t address = 0;
+    TEST_ASSERT_FALSE(cache.lastKnownGood("fabaccess.local", address));
+
+    cache.store("fabaccess.local", ADDRESS, 0);
+    cache.storeFailure("fabaccess.local", DNS_CACHE_TTL_MS);
+    TEST_ASSERT_EQUAL((uint8_t)DnsCacheResult::Negative, (uint8_t)cache.lookup("fabaccess.local", DNS_CACHE_TTL_MS + 1, address));
+    TEST_ASSERT_EQUAL((uint8_t)DnsCacheResult::Miss, (uint8_t)cache.lookup("fabaccess.local", DNS_CACHE_TTL_MS + DNS_CACHE_NEGATIVE_TTL_MS, address));
+
+    TEST_ASSERT_TRUE(cache.lastKnownGood("fabaccess.local", address));
+    TEST_ASSERT_EQUAL_UINT32(ADDRESS, address);
+}
+
+void test_invalidate_forces_lookup()
+{
+    DnsCache cache;
+    uint32_t address = 0;
+    cache.store("fabaccess.local", ADDRESS, 0);
+    cache.invalidate("fabaccess.local", 10);
+    TEST_ASSERT_EQUAL((uint8_t)DnsCacheResult::Miss, (uint8_t)cache.lookup("fabaccess.local", 10, address));
+    TEST_ASSERT_TRUE(cache.lastKnownGood("fabaccess.local", address));
+}
+
+void test_ttl_across_millis_wrap()
+{
+    DnsCache cache;
+    uint32_t address = 0;
+    cache.store("fabaccess.local", ADDRESS, 0xFFFFFF00);
+    TEST_ASSERT_EQUAL((uint8_t)DnsCacheResult::Hit, (uint8_t)cache.lookup("fabaccess.local", 0x100, address));
+}
+
+void test_replaces_least_recently_stored()
+{
+    DnsCache cache;
+    uint32_t address = 0;
+    cache.store("one.local", ADDRESS, 0);
+    cache.store("two.local", OTHER_ADDRESS, 0);
+    cache.store("one.local", ADDRESS, 1);
+    cache.store("three.local", ADDRESS, 2);
+
+    TEST_ASSERT_TRUE(cache.lastKnownGood("one.local", address));
+    TEST_ASSERT_FALSE(cache.lastKnownGood("two.local", address));
+    TEST_ASSERT_TRUE(cache.lastKnownGood("three.local", address));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_miss_then_hit_until_ttl);
+    RUN_TEST(test_negative_caching_keeps_last_known_good);
+    RUN_TEST(test_invalidate_forces_lookup);
+    RUN_TEST(test_ttl_across_millis_wrap);
+    RUN_TEST(test_replaces_least_recently_stored);
+    return UNITY_END();
+}
@@ -0,0 +1,220 @@
+#include <unity.h>
+#include "event_journal.hpp"
+
+// In memory stand in for the LittleFS segment, survives "reboots" of the journal
+class MemorySegment : public JournalSegment
+{
+public:
+    JournalRecord records[JOURNAL_SEGMENT_RECORDS];
+    uint16_t stored = 0;
+    uint32_t sequence = 0;
+    bool fail_appends = false;
+
+    uint16_t count() override { return this->stored; }
+
+    bool read(uint16_t index, JournalRecord &record) override
+    {
+        if (index >= this->stored)
+        {
+            return false;
+        }
+        record = this->records[index];
+        return true;
+    }
+
+    bool append(const JournalRecord &record) override
+    {
+        if (this->fail_appends)
+        {
+            return false;
+        }
+        this->records[this->stored++] = record;
+        return true;
+    }
+
+    void clear() override { this->stored = 0; }
+
+    uint32_t loadSequence() override { return this->sequence; }
+
+    bool storeSequence(uint32_t sequence) override
+    {
+        this->sequence = sequence;
+        return true;
+    }
+};
+
+static const uint8_t UID[] = {0x04, 0x5A, 0x3B, 0x11};
+
+static void recordTaps(EventJournal &journal, uint32_t count, uint32_t now = 1000)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        journal.record(1, UID, sizeof(UID), now + i);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_records_in_order_with_sequences()
+{
+    MemorySegment segment;
+    EventJournal journal(segment);
+    journal.begin();
+
+    recordTaps(journal, 3);
+    TEST_ASSERT_EQUAL_UINT32(3, journal.size());
+
+    JournalRecord records[8];
+    TEST_ASSERT_EQUAL(3, journal.peek(records, 8));
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(i + 1, records[i].sequence);
+        TEST_ASSERT_EQUAL_UINT32(1000 + i, records[i].timestamp);
+        TEST_ASSERT_EQUAL(sizeof(UID), records[i].length);
+        TEST_ASSERT_EQUAL_MEMORY(UID, records[i].data, sizeof(UID));
+        TEST_ASSERT_EQUAL(0, records[i].flags);
+    }
+}
+
+void test_spills_oldest_to_segment()
+{
+    MemorySegment segment;
+    EventJournal journal(segment);
+    journal.begin();
+
+    recordTaps(journal, JOURNAL_RAM_RECORDS + 5);
+    TEST_ASSERT_EQUAL(5, segment.stored);
+    TEST_ASSERT_EQUAL_UINT32(1, segment.records[0].sequence);
+
+    // Segment records come first
+    JournalRecord records[JOURNAL_RAM_RECORDS + 5];
+    TEST_ASSERT_EQUAL(JOURNAL_RAM_RECORDS + 5, journal.peek(records, JOURNAL_RAM_RECORDS + 5));
+    for (uint8_t i = 0; i < JOURNAL_RAM_RECORDS + 5; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(i + 1, records[i].sequence);
+    }
+}
+
+void test_acknowledge_truncates()
+{
+    MemorySegment segment;
+    EventJournal journal(segment);
+    journal.begin();
+    recordTaps(journal, JOURNAL_RAM_RECORDS + 4);
+
+    journal.acknowledge(2);
+    TEST_ASSERT_EQUAL_UINT32(JOURNAL_RAM_RECORDS + 2, journal.size());
+    JournalRecord record;
+    TEST_ASSERT_EQUAL(1, journal.peek(&record, 1));
+    TEST_ASSERT_EQUAL_UINT32(3, record.sequence);
+
+    // Acknowledging past the segment drops it
+    journal.acknowledge(6);
+    TEST_ASSERT_EQUAL(0, segment.stored);
+    TEST_ASSERT_EQUAL_UINT32(JOURNAL_RAM_RECORDS - 2, journal.size());
+    TEST_ASSERT_EQUAL(1, journal.peek(&record, 1));
+    TEST_ASSERT_EQUAL_UINT32(7, record.sequence);
+
+    journal.acknowledge(JOURNAL_RAM_RECORDS + 4);
+    TEST_ASSERT_EQUAL_UINT32(0, journal.size());
+    TEST_ASSERT_EQUAL(0, journal.peek(&record, 1));
+}
+
+void test_segment_survives_reboot()
+{
+    MemorySegment segment;
+    {
+        EventJournal journal(segment);
+        journal.begin();
+        journal.record(1, UID, sizeof(UID), 0, JOURNAL_FLAG_GRANTED_OFFLINE);
+        recordTaps(journal, JOURNAL_RAM_RECORDS + 2);
+    }
+
+    // RAM records are lost, spilled ones come back marked as from the previous boot
+    EventJournal journal(segment);
+    journal.begin();
+    TEST_ASSERT_EQUAL_UINT32(3, journal.size());
+
+    journal.record(1, UID, sizeof(UID), 50);
+    JournalRecord records[4];
+    TEST_ASSERT_EQUAL(4, journal.peek(records, 4));
+    TEST_ASSERT_EQUAL(JOURNAL_FLAG_PREVIOUS_BOOT | JOURNAL_FLAG_GRANTED_OFFLINE, records[0].flags);
+    TEST_ASSERT_EQUAL(JOURNAL_FLAG_PREVIOUS_BOOT, records[2].flags);
+    TEST_ASSERT_EQUAL(0, records[3].flags);
+
+    // Sequences continue after the ones reserved before the reboot
+    TEST_ASSERT_EQUAL_UINT32(1 + JOURNAL_SEQUENCE_BLOCK, records[3].sequence);
+}
+
+void test_sequences_continue_after_reboot_with_empty_segment()
+{
+    MemorySegment segment;
+    {
+        EventJournal journal(segment);
+        journal.begin();
+        recordTaps(journal, JOURNAL_SEQUENCE_BLOCK + 3);
+        journal.acknowledge(JOURNAL_SEQUENCE_BLOCK + 3);
+        TEST_ASSERT_EQUAL(0, segment.stored);
+    }
+
+    // Nothing left in the segment, the server already has these sequences
+    EventJournal journal(segment);
+    journal.begin();
+    journal.record(1, UID, sizeof(UID), 0);
+    JournalRecord record;
+    TEST_ASSERT_EQUAL(1, journal.peek(&record, 1));
+    TEST_ASSERT_TRUE(record.sequence > JOURNAL_SEQUENCE_BLOCK + 3);
+}
+
+void test_bounded_when_full()
+{
+    MemorySegment segment;
+    EventJournal journal(segment);
+    journal.begin();
+
+    recordTaps(journal, JOURNAL_RAM_RECORDS + JOURNAL_SEGMENT_RECORDS);
+    TEST_ASSERT_EQUAL(0, journal.droppedCount());
+    TEST_ASSERT_FALSE(journal.record(1, UID, sizeof(UID), 0));
+    TEST_ASSERT_EQUAL(1, journal.droppedCount());
+    TEST_ASSERT_EQUAL_UINT32(JOURNAL_RAM_RECORDS + JOURNAL_SEGMENT_RECORDS, journal.size());
+}
+
+void test_failed_spill_keeps_ram()
+{
+    MemorySegment segment;
+    segment.fail_appends = true;
+    EventJournal journal(segment);
+    journal.begin();
+
+    recordTaps(journal, JOURNAL_RAM_RECORDS + 1);
+    TEST_ASSERT_EQUAL(1, journal.droppedCount());
+    TEST_ASSERT_EQUAL_UINT32(JOURNAL_RAM_RECORDS, journal.size());
+}
+
+void test_long_data_is_cut()
+{
+    MemorySegment segment;
+    EventJournal journal(segment);
+    journal.begin();
+
+    uint8_t data[JOURNAL_DATA_SIZE + 4] = {0};
+    journal.record(1, data, sizeof(data), 0);
+    JournalRecord record;
+    journal.peek(&record, 1);
+    TEST_ASSERT_EQUAL(JOURNAL_DATA_SIZE, record.length);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_records_in_order_with_sequences);
+    RUN_TEST(test_spills_oldest_to_segment);
+    RUN_TEST(test_acknowledge_truncates);
+    RUN_TEST(test_segment_survives_reboot);
+    RUN_TEST(test_sequences_continue_after_reboot_with_empty_segment);
+    RUN_TEST(test_bounded_when_full);
+    RUN_TEST(test_failed_spill_keeps_ram);
+    RUN_TEST(test_long_data_is_cut);
+    return UNITY_END();
+}
@@ -0,0 +1,77 @@
+#include <unity.h>
+#include "key_debouncer.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+void test_press_and_release_after_debounce()
+{
+    KeyDebouncer debouncer(30);
+    KeyEvent event;
+
+    TEST_ASSERT_FALSE(debouncer.update(KEY_NONE, 0, event));
+    TEST_ASSERT_FALSE(debouncer.isActive());
+
+    TEST_ASSERT_FALSE(debouncer.update(5, 100, event));
+    TEST_ASSERT_TRUE(debouncer.isActive());
+    TEST_ASSERT_FALSE(debouncer.update(5, 120, event));
+    TEST_ASSERT_TRUE(debouncer.update(5, 130, event));
+    TEST_ASSERT_EQUAL_UINT8(5, event.key);
+    TEST_ASSERT_TRUE(event.pressed);
+
+    // Held, no repeated events
+    TEST_ASSERT_FALSE(debouncer.update(5, 2000, event));
+
+    TEST_ASSERT_FALSE(debouncer.update(KEY_NONE, 2100, event));
+    TEST_ASSERT_TRUE(debouncer.update(KEY_NONE, 2140, event));
+    TEST_ASSERT_EQUAL_UINT8(5, event.key);
+    TEST_ASSERT_FALSE(event.pressed);
+    TEST_ASSERT_FALSE(debouncer.isActive());
+}
+
+void test_bounces_and_failed_scans_are_ignored()
+{
+    KeyDebouncer debouncer(30);
+    KeyEvent event;
+
+    // Contact bounce restarts the debounce time
+    TEST_ASSERT_FALSE(debouncer.update(3, 0, event));
+    TEST_ASSERT_FALSE(debouncer.update(KEY_NONE, 20, event));
+    TEST_ASSERT_FALSE(debouncer.update(3, 40, event));
+    TEST_ASSERT_FALSE(debouncer.update(3, 60, event));
+    TEST_ASSERT_FALSE(debouncer.update(KEY_FAIL, 70, event));
+    TEST_ASSERT_TRUE(debouncer.update(3, 70, event));
+    TEST_ASSERT_TRUE(event.pressed);
+
+    // A short dropout while held doesn't release the key
+    TEST_ASSERT_FALSE(debouncer.update(KEY_NONE, 100, event));
+    TEST_ASSERT_FALSE(debouncer.update(3, 110, event));
+    TEST_ASSERT_FALSE(debouncer.update(3, 200, event));
+}
+
+void test_switching_keys_releases_the_first()
+{
+    KeyDebouncer debouncer(30);
+    KeyEvent event;
+
+    debouncer.update(1, 0, event);
+    TEST_ASSERT_TRUE(debouncer.update(1, 30, event));
+
+    TEST_ASSERT_FALSE(debouncer.update(2, 100, event));
+    TEST_ASSERT_TRUE(debouncer.update(2, 130, event));
+    TEST_ASSERT_EQUAL_UINT8(1, event.key);
+    TEST_ASSERT_FALSE(event.pressed);
+
+    TEST_ASSERT_TRUE(debouncer.update(2, 150, event));
+    TEST_ASSERT_EQUAL_UINT8(2, event.key);
+    TEST_ASSERT_TRUE(event.pressed);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_press_and_release_after_debounce);
+    RUN_TEST(test_bounces_and_failed_scans_are_ignored);
+    RUN_TEST(test_switching_keys_releases_the_first);
+    return UNITY_END();
+}
@@ -0,0 +1,90 @@
+#include <unity.h>
+#include "led_animation.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+static LedPattern pattern(LED_STATE state, uint16_t interval)
+{
+    LedPattern pattern;
+    pattern.state = state;
+    pattern.red = 200;
+    pattern.green = 100;
+    pattern.blue = 0;
+    pattern.interval = interval;
+    return pattern;
+}
+
+void test_static_patterns_never_wake_up()
+{
+    LedAnimation animation;
+    uint8_t rgb[3];
+
+    animation.start(pattern(LED_STATE_ON, 0), 1000);
+    TEST_ASSERT_EQUAL_UINT32(LED_ANIMATION_STATIC, animation.render(5000, rgb));
+    TEST_ASSERT_EQUAL_UINT8(200, rgb[0]);
+    TEST_ASSERT_EQUAL_UINT8(100, rgb[1]);
+
+    animation.start(pattern(LED_STATE_OFF, 0), 1000);
+    TEST_ASSERT_EQUAL_UINT32(LED_ANIMATION_STATIC, animation.render(5000, rgb));
+    TEST_ASSERT_EQUAL_UINT8(0, rgb[0]);
+}
+
+void test_blinking_wakes_up_at_each_toggle()
+{
+    LedAnimation animation;
+    uint8_t rgb[3];
+    animation.start(pattern(LED_STATE_BLINKING, 500), 1000);
+
+    TEST_ASSERT_EQUAL_UINT32(500, animation.render(1000, rgb));
+    TEST_ASSERT_EQUAL_UINT8(200, rgb[0]);
+
+    TEST_ASSERT_EQUAL_UINT32(100, animation.render(1900, rgb));
+    TEST_ASSERT_EQUAL_UINT8(0, rgb[0]);
+
+    TEST_ASSERT_EQUAL_UINT32(500, animation.render(2000, rgb));
+    TEST_ASSERT_EQUAL_UINT8(200, rgb[0]);
+}
+
+void test_breathing_rises_and_falls()
+{
+    LedAnimation animation;
+    uint8_t rgb[3];
+    animation.start(pattern(LED_STATE_BREATHING, 1000), 0);
+
+    // Dark at the start, full color after the fade in, dark again after the fade out
+    animation.render(0, rgb);
+    TEST_ASSERT_EQUAL_UINT8(0, rgb[0]);
+    animation.render(1000, rgb);
+    TEST_ASSERT_EQUAL_UINT8(200, rgb[0]);
+    animation.render(1999, rgb);
+    TEST_ASSERT_EQUAL_UINT8(0, rgb[0]);
+
+    // Never truncated to zero in between
+    uint8_t quarter[3];
+    animation.render(500, quarter);
+    TEST_ASSERT_TRUE(quarter[0] > 0 && quarter[0] < 200);
+
+    // The wait skips the frames that wouldn't change anything
+    uint32_t wait = animation.render(0, rgb);
+    TEST_ASSERT_TRUE(wait > LED_ANIMATION_FRAME_MS);
+    TEST_ASSERT_TRUE(LedAnimation::breathingLevel(wait, 2000) > 0);
+    TEST_ASSERT_EQUAL_UINT32(LED_ANIMATION_FRAME_MS, animation.render(500, rgb));
+}
+
+void test_patterns_compare_by_value()
+{
+    TEST_ASSERT_TRUE(pattern(LED_STATE_BLINKING, 500) == pattern(LED_STATE_BLINKING, 500));
+    TEST_ASSERT_TRUE(pattern(LED_STATE_BLINKING, 500) != pattern(LED_STATE_BLINKING, 1000));
+    TEST_ASSERT_TRUE(pattern(LED_STATE_BLINKING, 500) != pattern(LED_STATE_BREATHING, 500));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_static_patterns_never_wake_up);
+    RUN_TEST(test_blinking_wakes_up_at_each_toggle);
+    RUN_TEST(test_breathing_rises_and_falls);
+    RUN_TEST(test_patterns_compare_by_value);
+    return UNITY_END();
+}
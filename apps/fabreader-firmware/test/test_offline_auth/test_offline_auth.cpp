@@ -0,0 +1,158 @@
+#include <unity.h>
+#include "offline_auth.hpp"
+
+static OfflineAuthSet set;
+
+static const uint8_t UID_A[] = {0x04, 0x5A, 0x3B, 0x11, 0x22, 0x33, 0x44};
+static const uint8_t UID_B[] = {0x04, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+static const uint8_t UID_C[] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+// Big endian, as the server sends them
+static void writeHash(uint64_t hash, uint8_t *out)
+{
+    for (int8_t i = OFFLINE_AUTH_HASH_SIZE - 1; i >= 0; i--)
+    {
+        out[i] = hash & 0xFF;
+        hash >>= 8;
+    }
+}
+
+static void writeUid(const uint8_t *uid, uint8_t length, uint8_t *out)
+{
+    writeHash(OfflineAuth::hashUid(uid, length), out);
+}
+
+void setUp()
+{
+    set.clear();
+}
+
+void tearDown() {}
+
+void test_hash_matches_server()
+{
+    // Same vector as offline-auth.spec.ts
+    TEST_ASSERT_EQUAL_HEX64(0x316fbe4040b9914dull, OfflineAuth::hashUid(UID_A, sizeof(UID_A)));
+
+    uint8_t bytes[OFFLINE_AUTH_HASH_SIZE];
+    writeHash(0x0102030405060708ull, bytes);
+    TEST_ASSERT_EQUAL_HEX64(0x0102030405060708ull, OfflineAuth::readHash(bytes));
+}
+
+void test_full_update_in_chunks()
+{
+    uint8_t first[2 * OFFLINE_AUTH_HASH_SIZE];
+    writeUid(UID_A, sizeof(UID_A), &first[0]);
+    writeUid(UID_B, sizeof(UID_B), &first[OFFLINE_AUTH_HASH_SIZE]);
+    uint8_t second[OFFLINE_AUTH_HASH_SIZE];
+    writeUid(UID_C, sizeof(UID_C), second);
+
+    TEST_ASSERT_EQUAL(OfflineAuthChunk::Pending, set.applyChunk(0, 7, 0, false, first, 2, nullptr, 0));
+    TEST_ASSERT_TRUE(set.isUpdating());
+    TEST_ASSERT_EQUAL_UINT32(0, set.version());
+    TEST_ASSERT_EQUAL(OfflineAuthChunk::Complete, set.applyChunk(0, 7, 1, true, second, 1, nullptr, 0));
+    TEST_ASSERT_FALSE(set.isUpdating());
+
+    TEST_ASSERT_EQUAL_UINT32(7, set.version());
+    TEST_ASSERT_EQUAL(3, set.size());
+    TEST_ASSERT_TRUE(set.contains(UID_A, sizeof(UID_A)));
+    TEST_ASSERT_TRUE(set.contains(UID_B, sizeof(UID_B)));
+    TEST_ASSERT_TRUE(set.contains(UID_C, sizeof(UID_C)));
+
+    const uint8_t unknown[] = {0x04, 0x5A, 0x3B, 0x11, 0x22, 0x33, 0x45};
+    TEST_ASSERT_FALSE(set.contains(unknown, sizeof(unknown)));
+}
+
+void test_delta_adds_and_removes()
+{
+    uint8_t hashes[2 * OFFLINE_AUTH_HASH_SIZE];
+    writeUid(UID_A, sizeof(UID_A), &hashes[0]);
+    writeUid(UID_B, sizeof(UID_B), &hashes[OFFLINE_AUTH_HASH_SIZE]);
+    set.applyChunk(0, 7, 0, true, hashes, 2, nullptr, 0);
+
+    uint8_t added[OFFLINE_AUTH_HASH_SIZE];
+    writeUid(UID_C, sizeof(UID_C), added);
+    TEST_ASSERT_EQUAL(OfflineAuthChunk::Complete, set.applyChunk(7, 8, 0, true, added, 1, &hashes[0], 1));
+
+    TEST_ASSERT_EQUAL_UINT32(8, set.version());
+    TEST_ASSERT_FALSE(set.contains(UID_A, sizeof(UID_A)));
+    TEST_ASSERT_TRUE(set.contains(UID_B, sizeof(UID_B)));
+    TEST_ASSERT_TRUE(set.contains(UID_C, sizeof(UID_C)));
+}
+
+void test_delta_against_other_version_is_rejected()
+{
+    uint8_t hash[OFFLINE_AUTH_HASH_SIZE];
+    writeUid(UID_A, sizeof(UID_A), hash);
+    set.applyChunk(0, 7, 0, true, hash, 1, nullptr, 0);
+
+    TEST_ASSERT_EQUAL(OfflineAuthChunk::Rejected, set.applyChunk(6, 8, 0, true, hash, 1, nullptr, 0));
+    TEST_ASSERT_EQUAL_UINT32(7, set.version());
+}
+
+void test_chunks_out_of_order()
+{
+    uint8_t hash[OFFLINE_AUTH_HASH_SIZE];
+    writeUid(UID_A, sizeof(UID_A), hash);
+
+    set.applyChunk(0, 7, 0, false, hash, 1, nullptr, 0);
+    TEST_ASSERT_EQUAL(OfflineAuthChunk::Rejected, set.applyChunk(0, 7, 2, true, hash, 1, nullptr, 0));
+    TEST_ASSERT_FALSE(set.isUpdating());
+
+    // The rest of the rejected update is ignored
+    TEST_ASSERT_EQUAL(OfflineAuthChunk::Ignored, set.applyChunk(0, 7, 3, true, hash, 1, nullptr, 0));
+}
+
+void test_overflow_is_rejected()
+{
+    for (uint16_t i = 0; i < OFFLINE_AUTH_MAX_ENTRIES; i++)
+    {
+        TEST_ASSERT_TRUE(set.add(i * 0x9E3779B97F4A7C15ull));
+    }
+    TEST_ASSERT_FALSE(set.add(1));
+
+    // Duplicates need no room
+    TEST_ASSERT_TRUE(set.add(0));
+    TEST_ASSERT_EQUAL(OFFLINE_AUTH_MAX_ENTRIES, set.size());
+}
+
+void test_entries_stay_sorted()
+{
+    const uint64_t hashes[] = {50, 10, 40, 10, 30};
+    TEST_ASSERT_TRUE(set.assign(3, hashes, 5));
+
+    TEST_ASSERT_EQUAL(4, set.size());
+    for (uint16_t i = 1; i < set.size(); i++)
+    {
+        TEST_ASSERT_TRUE(set.entries()[i - 1] < set.entries()[i]);
+    }
+    TEST_ASSERT_TRUE(set.containsHash(40));
+    TEST_ASSERT_FALSE(set.containsHash(20));
+}
+
+void test_removed_hash_is_gone_before_finish()
+{
+    const uint64_t hashes[] = {10, 20};
+    set.assign(1, hashes, 2);
+
+    // The filter still has the bits of 10 until finish() rebuilds it
+    set.remove(10);
+    TEST_ASSERT_FALSE(set.containsHash(10));
+    set.finish(2);
+    TEST_ASSERT_FALSE(set.containsHash(10));
+    TEST_ASSERT_TRUE(set.containsHash(20));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hash_matches_server);
+    RUN_TEST(test_full_update_in_chunks);
+    RUN_TEST(test_delta_adds_and_removes);
+    RUN_TEST(test_delta_against_other_version_is_rejected);
+    RUN_TEST(test_chunks_out_of_order);
+    RUN_TEST(test_overflow_is_rejected);
+    RUN_TEST(test_entries_stay_sorted);
+    RUN_TEST(test_removed_hash_is_gone_before_finish);
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+#include <unity.h>
+#include <string.h>
+#include "outbound_queue.hpp"
+
+typedef OutboundQueue<4, 16> Queue;
+
+static Queue queue;
+
+static bool push(OutboundPriority priority, const char *text, uint8_t kind = 0)
+{
+    Queue::Message *message = queue.reserve(priority, kind);
+    if (message == nullptr)
+    {
+        return false;
+    }
+    size_t length = strlen(text);
+    memcpy(message->data, text, length);
+    queue.commit(message, length);
+    return true;
+}
+
+static void assertNext(const char *text)
+{
+    const Queue::Message *message = queue.peek();
+    TEST_ASSERT_NOT_NULL(message);
+    TEST_ASSERT_EQUAL(strlen(text), message->length);
+    TEST_ASSERT_EQUAL_MEMORY(text, message->data, message->length);
+    queue.pop();
+}
+
+void setUp()
+{
+    queue.clear();
+}
+
+void tearDown() {}
+
+void test_priority_then_fifo()
+{
+    push(OutboundPriority::Low, "heartbeat");
+    push(OutboundPriority::Normal, "response 1");
+    push(OutboundPriority::High, "tap");
+    push(OutboundPriority::Normal, "response 2");
+
+    TEST_ASSERT_EQUAL(4, queue.size());
+    assertNext("tap");
+    assertNext("response 1");
+    assertNext("response 2");
+    assertNext("heartbeat");
+    TEST_ASSERT_NULL(queue.peek());
+    TEST_ASSERT_EQUAL(0, queue.size());
+}
+
+void test_failed_write_keeps_message()
+{
+    push(OutboundPriority::High, "tap");
+
+    // Without pop() the same message is offered again
+    const Queue::Message *first = queue.peek();
+    TEST_ASSERT_EQUAL_PTR(first, queue.peek());
+    TEST_ASSERT_EQUAL(1, queue.size());
+    assertNext("tap");
+}
+
+void test_coalesce_same_kind()
+{
+    push(OutboundPriority::Low, "beat 1", 0xFF);
+    push(OutboundPriority::High, "key");
+    push(OutboundPriority::Low, "beat 2", 0xFF);
+
+    TEST_ASSERT_EQUAL(2, queue.size());
+    TEST_ASSERT_EQUAL(1, queue.coalescedCount());
+    assertNext("key");
+    assertNext("beat 2");
+}
+
+void test_kind_zero_never_coalesces()
+{
+    push(OutboundPriority::High, "key 1");
+    push(OutboundPriority::High, "key 2");
+
+    TEST_ASSERT_EQUAL(2, queue.size());
+    assertNext("key 1");
+    assertNext("key 2");
+}
+
+void test_full_queue_evicts_lower_priority()
+{
+    push(OutboundPriority::Low, "beat");
+    push(OutboundPriority::Normal, "response 1");
+    push(OutboundPriority::Normal, "response 2");
+    push(OutboundPriority::Normal, "response 3");
+
+    uint32_t dropped = queue.droppedCount();
+    TEST_ASSERT_TRUE(push(OutboundPriority::High, "tap"));
+    TEST_ASSERT_EQUAL(dropped + 1, queue.droppedCount());
+
+    // Only lower priorities are evicted, the oldest first
+    TEST_ASSERT_TRUE(push(OutboundPriority::High, "key"));
+    TEST_ASSERT_FALSE(push(OutboundPriority::Normal, "response 4"));
+    TEST_ASSERT_EQUAL(dropped + 3, queue.droppedCount());
+
+    assertNext("tap");
+    assertNext("key");
+    assertNext("response 2");
+    assertNext("response 3");
+    TEST_ASSERT_NULL(queue.peek());
+}
+
+void test_commit_zero_releases_slot()
+{
+    Queue::Message *message = queue.reserve(OutboundPriority::Normal);
+    queue.commit(message, 0);
+    TEST_ASSERT_EQUAL(0, queue.size());
+    TEST_ASSERT_NULL(queue.peek());
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_TRUE(push(OutboundPriority::Normal, "x"));
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_priority_then_fifo);
+    RUN_TEST(test_failed_write_keeps_message);
+    RUN_TEST(test_coalesce_same_kind);
+    RUN_TEST(test_kind_zero_never_coalesces);
+    RUN_TEST(test_full_queue_evicts_lower_priority);
+    RUN_TEST(test_commit_zero_releases_slot);
+    return UNITY_END();
+}
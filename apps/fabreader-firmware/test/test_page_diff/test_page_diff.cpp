@@ -0,0 +1,68 @@
+#include <unity.h>
+#include <string.h>
+#include "page_diff.hpp"
+
+#define WIDTH 128
+
+static uint8_t current[WIDTH];
+static uint8_t sent[WIDTH];
+
+void setUp()
+{
+    memset(current, 0, sizeof(current));
+    memset(sent, 0, sizeof(sent));
+}
+
+void tearDown() {}
+
+void test_unchanged_page_is_skipped()
+{
+    uint8_t from = 0xFF, to = 0xFF;
+    TEST_ASSERT_FALSE(PageDiff::find(current, sent, WIDTH, from, to));
+    TEST_ASSERT_EQUAL_UINT8(0xFF, from);
+}
+
+void test_range_spans_first_to_last_change()
+{
+    current[10] = 0x01;
+    current[40] = 0x80;
+
+    uint8_t from, to;
+    TEST_ASSERT_TRUE(PageDiff::find(current, sent, WIDTH, from, to));
+    TEST_ASSERT_EQUAL_UINT8(10, from);
+    TEST_ASSERT_EQUAL_UINT8(41, to);
+
+    // Edges of the page
+    current[0] = 0xFF;
+    current[WIDTH - 1] = 0xFF;
+    TEST_ASSERT_TRUE(PageDiff::find(current, sent, WIDTH, from, to));
+    TEST_ASSERT_EQUAL_UINT8(0, from);
+    TEST_ASSERT_EQUAL_UINT8(WIDTH, to);
+}
+
+void test_commit_marks_columns_as_sent()
+{
+    current[5] = 0x0F;
+    current[6] = 0xF0;
+
+    uint8_t from, to;
+    TEST_ASSERT_TRUE(PageDiff::find(current, sent, WIDTH, from, to));
+    PageDiff::commit(current, sent, from, to);
+    TEST_ASSERT_FALSE(PageDiff::find(current, sent, WIDTH, from, to));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(current, sent, WIDTH);
+
+    // Clearing a pixel is a change as well
+    current[6] = 0x00;
+    TEST_ASSERT_TRUE(PageDiff::find(current, sent, WIDTH, from, to));
+    TEST_ASSERT_EQUAL_UINT8(6, from);
+    TEST_ASSERT_EQUAL_UINT8(7, to);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_unchanged_page_is_skipped);
+    RUN_TEST(test_range_spans_first_to_last_change);
+    RUN_TEST(test_commit_marks_columns_as_sent);
+    return UNITY_END();
+}
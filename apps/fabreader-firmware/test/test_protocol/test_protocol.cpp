@@ -0,0 +1,276 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "protocol.hpp"
+
+static JsonDocument doc;
+
+static JsonObjectConst parse(const char *json)
+{
+    TEST_ASSERT_FALSE(deserializeJson(doc, json));
+    return doc.as<JsonObjectConst>();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_event_type_round_trip()
+{
+    // eventName() returns UNKNOWN past the last type
+    uint8_t count = 0;
+    for (uint8_t i = 1; strcmp(Protocol::eventName((EventType)i), "UNKNOWN") != 0; i++, count++)
+    {
+        EventType type = (EventType)i;
+        TEST_ASSERT_EQUAL((uint8_t)type, (uint8_t)Protocol::eventType(Protocol::eventName(type)));
+    }
+    TEST_ASSERT_EQUAL(18, count);
+}
+
+void test_event_type_unknown()
+{
+    TEST_ASSERT_EQUAL((uint8_t)EventType::Unknown, (uint8_t)Protocol::eventType("NOT_AN_EVENT"));
+    TEST_ASSERT_EQUAL((uint8_t)EventType::Unknown, (uint8_t)Protocol::eventType("register"));
+    TEST_ASSERT_EQUAL((uint8_t)EventType::Unknown, (uint8_t)Protocol::eventType(""));
+    TEST_ASSERT_EQUAL((uint8_t)EventType::Unknown, (uint8_t)Protocol::eventType(nullptr));
+}
+
+void test_hex_encode()
+{
+    const uint8_t bytes[] = {0x04, 0xA1, 0xFF, 0x00};
+    char hex[9];
+    TEST_ASSERT_EQUAL(8, Protocol::hexEncode(bytes, sizeof(bytes), hex, sizeof(hex)));
+    TEST_ASSERT_EQUAL_STRING("04a1ff00", hex);
+
+    TEST_ASSERT_EQUAL(0, Protocol::hexEncode(bytes, sizeof(bytes), hex, 8));
+    TEST_ASSERT_EQUAL_STRING("", hex);
+}
+
+void test_hex_decode()
+{
+    uint8_t bytes[4];
+    const uint8_t expected[] = {0x04, 0xA1, 0xFF, 0x00};
+    TEST_ASSERT_TRUE(Protocol::hexDecode("04A1ff00", bytes, sizeof(bytes)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, bytes, sizeof(bytes));
+
+    TEST_ASSERT_FALSE(Protocol::hexDecode("04a1ff", bytes, sizeof(bytes)));
+    TEST_ASSERT_FALSE(Protocol::hexDecode("04a1ff0011", bytes, sizeof(bytes)));
+    TEST_ASSERT_FALSE(Protocol::hexDecode("04a1fg00", bytes, sizeof(bytes)));
+    TEST_ASSERT_FALSE(Protocol::hexDecode(nullptr, bytes, sizeof(bytes)));
+
+    TEST_ASSERT_EQUAL(2, Protocol::hexDecodeVariable("abcd", bytes, sizeof(bytes)));
+    TEST_ASSERT_EQUAL(-1, Protocol::hexDecodeVariable("abc", bytes, sizeof(bytes)));
+    TEST_ASSERT_EQUAL(-1, Protocol::hexDecodeVariable("0011223344", bytes, sizeof(bytes)));
+}
+
+void test_decode_authenticate()
+{
+    AuthenticatePayload payload;
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"keyNumber":2,"authenticationKey":"000102030405060708090a0b0c0d0e0f"})"), payload));
+    TEST_ASSERT_EQUAL(2, payload.key_number);
+    TEST_ASSERT_EQUAL_HEX8(0x0F, payload.key[15]);
+
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"keyNumber":2,"authenticationKey":"0001"})"), payload));
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"keyNumber":5,"authenticationKey":"000102030405060708090a0b0c0d0e0f"})"), payload));
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"authenticationKey":"000102030405060708090a0b0c0d0e0f"})"), payload));
+}
+
+void test_decode_change_keys()
+{
+    ChangeKeysPayload payload;
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({
+        "authenticationKey":"00000000000000000000000000000000",
+        "keys":{"1":"11111111111111111111111111111111","0":"ffffffffffffffffffffffffffffffff"},
+        "oldKeys":{"1":"22222222222222222222222222222222"}})"),
+                                      payload));
+    TEST_ASSERT_EQUAL(2, payload.count);
+    TEST_ASSERT_EQUAL(1, payload.changes[0].key_number);
+    TEST_ASSERT_EQUAL_HEX8(0x22, payload.changes[0].old_key[0]);
+    TEST_ASSERT_EQUAL(0, payload.changes[1].key_number);
+    TEST_ASSERT_EQUAL_HEX8(0x00, payload.changes[1].old_key[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, payload.changes[1].new_key[15]);
+}
+
+void test_decode_change_keys_rejects_invalid_keys()
+{
+    ChangeKeysPayload payload;
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"authenticationKey":"00000000000000000000000000000000","keys":{"5":"11111111111111111111111111111111"}})"), payload));
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"authenticationKey":"00000000000000000000000000000000","keys":{"12":"11111111111111111111111111111111"}})"), payload));
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"authenticationKey":"00000000000000000000000000000000","keys":{"1":"1111"}})"), payload));
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"keys":{"1":"11111111111111111111111111111111"}})"), payload));
+}
+
+void test_decode_msgpack_binary_keys()
+{
+    // {"authenticationKey": bin(16 x 0xAA), "keys": {"0": bin(16 x 0x01..0x10)}}
+    const uint8_t message[] = {0x82, 0xB1, 'a', 'u', 't', 'h', 'e', 'n', 't', 'i', 'c', 'a', 't', 'i', 'o', 'n', 'K', 'e', 'y',
+                               0xC4, 0x10, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA,
+                               0xA4, 'k', 'e', 'y', 's', 0x81, 0xA1, '0',
+                               0xC4, 0x10, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10};
+    TEST_ASSERT_FALSE(deserializeMsgPack(doc, message, sizeof(message)));
+
+    ChangeKeysPayload payload;
+    TEST_ASSERT_TRUE(Protocol::decode(doc.as<JsonObjectConst>(), payload));
+    TEST_ASSERT_EQUAL(1, payload.count);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, payload.authentication_key[15]);
+    TEST_ASSERT_EQUAL_HEX8(0x10, payload.changes[0].new_key[15]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, payload.changes[0].old_key[0]);
+
+    // Binary keys must still have the exact key length, {"keyNumber": 0, "authenticationKey": bin(15)}
+    const uint8_t shortKey[] = {0x82, 0xA9, 'k', 'e', 'y', 'N', 'u', 'm', 'b', 'e', 'r', 0x00,
+                                0xB1, 'a', 'u', 't', 'h', 'e', 'n', 't', 'i', 'c', 'a', 't', 'i', 'o', 'n', 'K', 'e', 'y',
+                                0xC4, 0x0F, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA};
+    TEST_ASSERT_FALSE(deserializeMsgPack(doc, shortKey, sizeof(shortKey)));
+
+    AuthenticatePayload authenticate;
+    TEST_ASSERT_FALSE(Protocol::decode(doc.as<JsonObjectConst>(), authenticate));
+}
+
+void test_encode_bytes()
+{
+    const uint8_t uid[] = {0x04, 0x5A, 0x3B};
+    JsonDocument out;
+
+    Protocol::encodeBytes(out["cardUID"], uid, sizeof(uid), false);
+    TEST_ASSERT_EQUAL_STRING("045a3b", out["cardUID"].as<const char *>());
+
+    Protocol::encodeBytes(out["cardUID"], uid, sizeof(uid), true);
+    TEST_ASSERT_TRUE(out["cardUID"].is<MsgPackBinary>());
+    TEST_ASSERT_EQUAL(3, out["cardUID"].as<MsgPackBinary>().size());
+}
+
+void test_decode_reader_authenticated_encoding()
+{
+    ReaderAuthenticatedPayload payload;
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"name":"Lathe"})"), payload));
+    TEST_ASSERT_FALSE(payload.msgpack);
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"name":"Lathe","encoding":"msgpack"})"), payload));
+    TEST_ASSERT_TRUE(payload.msgpack);
+}
+
+void test_decode_journal_ack()
+{
+    JournalAckPayload payload;
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"acknowledged":17})"), payload));
+    TEST_ASSERT_EQUAL_UINT32(17, payload.acknowledged);
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"acknowledged":-1})"), payload));
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({})"), payload));
+}
+
+void test_decode_offline_auth_update()
+{
+    OfflineAuthUpdatePayload payload;
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"baseVersion":0,"version":9,"chunk":0,"final":true,"added":"0102030405060708a1a2a3a4a5a6a7a8"})"), payload));
+    TEST_ASSERT_EQUAL_UINT32(9, payload.version);
+    TEST_ASSERT_TRUE(payload.final);
+    TEST_ASSERT_EQUAL(2, payload.added_count);
+    TEST_ASSERT_EQUAL(0, payload.removed_count);
+    TEST_ASSERT_EQUAL_HEX64(0xa1a2a3a4a5a6a7a8ull, OfflineAuth::readHash(&payload.added[OFFLINE_AUTH_HASH_SIZE]));
+
+    // Partial hashes and missing versions are invalid
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"baseVersion":0,"version":9,"chunk":0,"added":"01020304"})"), payload));
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"version":9,"chunk":0})"), payload));
+}
+
+void test_decode_registration()
+{
+    RegistrationPayload payload;
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"id":42,"token":"abcdefghijklmnop"})"), payload));
+    TEST_ASSERT_EQUAL_UINT32(42, payload.id);
+    TEST_ASSERT_EQUAL_STRING("abcdefghijklmnop", payload.token);
+
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"id":42,"token":"abcdefghijklmnopq"})"), payload));
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"token":"abcdefghijklmnop"})"), payload));
+}
+
+void test_decode_texts_are_cut_off()
+{
+    char json[200];
+    snprintf(json, sizeof(json), R"({"lineOne":"%0100d","lineTwo":"two"})", 0);
+
+    ShowTextPayload payload;
+    TEST_ASSERT_TRUE(Protocol::decode(parse(json), payload));
+    TEST_ASSERT_EQUAL(PROTOCOL_TEXT_LENGTH - 1, strlen(payload.line_one));
+    TEST_ASSERT_EQUAL_STRING("two", payload.line_two);
+}
+
+void test_decode_run_job()
+{
+    RunJobPayload payload;
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"jobId":7,"steps":[
+        {"type":"AUTHENTICATE","keyNumber":0,"authenticationKey":"00000000000000000000000000000000"},
+        {"type":"WRITE_FILE","fileNumber":3,"offset":4,"data":"cafe","commMode":"FULL"},
+        {"type":"READ_FILE","fileNumber":3,"length":2},
+        {"type":"GET_UID"}]})"),
+                                      payload));
+    TEST_ASSERT_EQUAL_UINT32(7, payload.job.id);
+    TEST_ASSERT_EQUAL(4, payload.job.step_count);
+    TEST_ASSERT_EQUAL(NFC_JOB_STEP_WRITE_FILE, payload.job.steps[1].type);
+    TEST_ASSERT_EQUAL(NFC_COMM_MODE_FULL, payload.job.steps[1].comm_mode);
+    TEST_ASSERT_EQUAL(2, payload.job.steps[1].length);
+    TEST_ASSERT_EQUAL(4, payload.job.steps[1].offset);
+    TEST_ASSERT_EQUAL(NFC_COMM_MODE_PLAIN, payload.job.steps[2].comm_mode);
+    TEST_ASSERT_EQUAL(NFC_JOB_STEP_GET_UID, payload.job.steps[3].type);
+}
+
+void test_decode_run_job_errors()
+{
+    RunJobPayload payload;
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"jobId":8,"steps":[{"type":"FORMAT"}]})"), payload));
+    TEST_ASSERT_EQUAL_UINT32(8, payload.job.id);
+    TEST_ASSERT_EQUAL_STRING("Unknown step type", payload.error);
+
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"steps":[{"type":"READ_FILE","length":25}]})"), payload));
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"steps":[{"type":"READ_FILE","length":2,"commMode":"SECRET"}]})"), payload));
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"steps":[]})"), payload));
+
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"steps":[{"type":"GET_FILE_SETTINGS","fileNumber":2,"commMode":"FULL"}]})"), payload));
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"steps":[{"type":"GET_VERSION"},{"type":"GET_FILE_SETTINGS","fileNumber":2,"commMode":"MAC"}]})"), payload));
+    TEST_ASSERT_EQUAL(NFC_JOB_STEP_GET_FILE_SETTINGS, payload.job.steps[1].type);
+    TEST_ASSERT_EQUAL(2, payload.job.steps[1].file_number);
+
+    // Always sent encrypted, whatever the server asked for
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"steps":[{"type":"CHANGE_FILE_SETTINGS","fileNumber":2}]})"), payload));
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"steps":[{"type":"CHANGE_FILE_SETTINGS","fileNumber":2,"data":"4000e0c1ffe0"}]})"), payload));
+    TEST_ASSERT_EQUAL(NFC_JOB_STEP_CHANGE_FILE_SETTINGS, payload.job.steps[0].type);
+    TEST_ASSERT_EQUAL(NFC_COMM_MODE_FULL, payload.job.steps[0].comm_mode);
+    TEST_ASSERT_EQUAL(6, payload.job.steps[0].length);
+
+    TEST_ASSERT_EQUAL(0, payload.job.card_uid_length);
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"cardUID":"04de5f1eacc040","steps":[{"type":"GET_UID"}]})"), payload));
+    TEST_ASSERT_EQUAL(7, payload.job.card_uid_length);
+    TEST_ASSERT_FALSE(Protocol::decode(parse(R"({"cardUID":"xyz","steps":[{"type":"GET_UID"}]})"), payload));
+}
+
+void test_decode_enable_card_checking()
+{
+    EnableCardCheckingPayload payload;
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"message":"Tap to start","sun":true})"), payload));
+    TEST_ASSERT_EQUAL_STRING("Tap to start", payload.message);
+    TEST_ASSERT_TRUE(payload.sun);
+
+    TEST_ASSERT_TRUE(Protocol::decode(parse(R"({"message":"Tap to enroll"})"), payload));
+    TEST_ASSERT_FALSE(payload.sun);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_event_type_round_trip);
+    RUN_TEST(test_event_type_unknown);
+    RUN_TEST(test_hex_encode);
+    RUN_TEST(test_hex_decode);
+    RUN_TEST(test_decode_authenticate);
+    RUN_TEST(test_decode_change_keys);
+    RUN_TEST(test_decode_change_keys_rejects_invalid_keys);
+    RUN_TEST(test_decode_msgpack_binary_keys);
+    RUN_TEST(test_encode_bytes);
+    RUN_TEST(test_decode_reader_authenticated_encoding);
+    RUN_TEST(test_decode_journal_ack);
+    RUN_TEST(test_decode_offline_auth_update);
+    RUN_TEST(test_decode_registration);
+    RUN_TEST(test_decode_texts_are_cut_off);
+    RUN_TEST(test_decode_run_job);
+    RUN_TEST(test_decode_run_job_errors);
+    RUN_TEST(test_decode_enable_card_checking);
+    return UNITY_END();
+}
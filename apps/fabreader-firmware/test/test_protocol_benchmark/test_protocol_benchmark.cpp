@@ -0,0 +1,81 @@
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include "protocol.hpp"
+
+// Decode throughput of the message codec on the host. Not a pass/fail test, the
+// numbers are printed to compare changes to the codec.
+
+#define BENCHMARK_ITERATIONS 100000
+
+static const char *CHANGE_KEYS_MESSAGE = R"({"event":"EVENT","data":{"type":"CHANGE_KEYS","payload":{
+    "authenticationKey":"00000000000000000000000000000000",
+    "keys":{"0":"000102030405060708090a0b0c0d0e0f","1":"101112131415161718191a1b1c1d1e1f","2":"202122232425262728292a2b2c2d2e2f",
+            "3":"303132333435363738393a3b3c3d3e3f","4":"404142434445464748494a4b4c4d4e4f"}}}})";
+
+static const char *EVENT_NAMES[] = {"REGISTER", "DISABLE_CARD_CHECKING", "HIDE_TEXT", "RUN_JOB", "NOT_AN_EVENT"};
+
+void setUp() {}
+void tearDown() {}
+
+template <typename F>
+static void benchmark(const char *name, F body)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+        body(i);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    char message[128];
+    snprintf(message, sizeof(message), "%s: %.1f ns/op, %.0f ops/s", name, (double)elapsed / BENCHMARK_ITERATIONS,
+             BENCHMARK_ITERATIONS * 1e9 / elapsed);
+    TEST_MESSAGE(message);
+}
+
+void test_benchmark_event_type()
+{
+    volatile uint8_t sink = 0;
+    benchmark("eventType", [&](uint32_t i)
+              { sink = sink + (uint8_t)Protocol::eventType(EVENT_NAMES[i % 5]); });
+}
+
+void test_benchmark_hex()
+{
+    uint8_t key[16] = {0};
+    char hex[33];
+    volatile uint8_t sink = 0;
+    benchmark("hexEncode + hexDecode 16 bytes", [&](uint32_t i)
+              {
+                  key[0] = i;
+                  Protocol::hexEncode(key, sizeof(key), hex, sizeof(hex));
+                  Protocol::hexDecode(hex, key, sizeof(key));
+                  sink = sink + key[0]; });
+}
+
+void test_benchmark_change_keys()
+{
+    JsonDocument doc;
+    ChangeKeysPayload payload;
+    volatile uint8_t sink = 0;
+    benchmark("parse + dispatch + decode CHANGE_KEYS", [&](uint32_t i)
+              {
+                  deserializeJson(doc, CHANGE_KEYS_MESSAGE);
+                  JsonObjectConst data = doc["data"].as<JsonObjectConst>();
+                  if (Protocol::eventType(data["type"].as<const char *>()) == EventType::ChangeKeys &&
+                      Protocol::decode(data["payload"].as<JsonObjectConst>(), payload))
+                  {
+                      sink = sink + payload.count;
+                  } });
+    TEST_ASSERT_EQUAL(5, payload.count);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_event_type);
+    RUN_TEST(test_benchmark_hex);
+    RUN_TEST(test_benchmark_change_keys);
+    return UNITY_END();
+}
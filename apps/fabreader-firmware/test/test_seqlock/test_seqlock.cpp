@@ -0,0 +1,61 @@
+#include <unity.h>
+#include <string.h>
+#include "seqlock.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+struct State
+{
+    bool connected;
+    char text[16];
+};
+
+void test_read_returns_latest_write()
+{
+    SeqLock<State> lock;
+    State state = {};
+    uint32_t version = 1;
+
+    // Nothing written yet, the default value
+    TEST_ASSERT_TRUE(lock.read(state, version));
+    TEST_ASSERT_EQUAL_UINT32(0, version);
+    TEST_ASSERT_FALSE(state.connected);
+
+    State written = {true, "first"};
+    lock.write(written);
+    strcpy(written.text, "second");
+    lock.write(written);
+
+    TEST_ASSERT_TRUE(lock.read(state, version));
+    TEST_ASSERT_TRUE(state.connected);
+    TEST_ASSERT_EQUAL_STRING("second", state.text);
+}
+
+void test_version_changes_with_every_write()
+{
+    SeqLock<State> lock;
+    State state = {};
+    uint32_t version = 0;
+
+    uint32_t initial = lock.version();
+    lock.write(state);
+    uint32_t after_first = lock.version();
+    lock.write(state);
+
+    TEST_ASSERT_TRUE(after_first != initial);
+    TEST_ASSERT_TRUE(lock.version() != after_first);
+
+    // read() reports the version of the copy, which version() matches while nobody writes
+    TEST_ASSERT_TRUE(lock.read(state, version));
+    TEST_ASSERT_EQUAL_UINT32(lock.version(), version);
+    TEST_ASSERT_EQUAL_UINT32(0, version & 1);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_read_returns_latest_write);
+    RUN_TEST(test_version_changes_with_every_write);
+    return UNITY_END();
+}
@@ -0,0 +1,69 @@
+#include <unity.h>
+#include <string.h>
+#include "sun_message.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+// Payload of the short URI record the enrollment writes, as mirrored by the card (AN12196)
+static const char URI[] = "\x00"
+                          "fabaccess://sun?u=04DE5F1EACC040&c=00003D&m=94EED9EE65337086";
+
+static bool parse(const char *uri, size_t length, SunMessage &sun)
+{
+    return SunMessage::parse((const uint8_t *)uri, (uint8_t)length, sun);
+}
+
+void test_parse_mirrored_values()
+{
+    SunMessage sun;
+    TEST_ASSERT_TRUE(parse(URI, sizeof(URI) - 1, sun));
+
+    const uint8_t uid[] = {0x04, 0xDE, 0x5F, 0x1E, 0xAC, 0xC0, 0x40};
+    const uint8_t mac[] = {0x94, 0xEE, 0xD9, 0xEE, 0x65, 0x33, 0x70, 0x86};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(uid, sun.uid, sizeof(uid));
+    TEST_ASSERT_EQUAL_UINT32(0x3D, sun.counter);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mac, sun.mac, sizeof(mac));
+}
+
+void test_parameter_order_and_case()
+{
+    const char uri[] = "https://example.org/t?m=94eed9ee65337086&c=01A2b3&x=1&u=04de5f1eacc040";
+    SunMessage sun;
+    TEST_ASSERT_TRUE(parse(uri, sizeof(uri) - 1, sun));
+    TEST_ASSERT_EQUAL_UINT32(0x01A2B3, sun.counter);
+    TEST_ASSERT_EQUAL_HEX8(0x04, sun.uid[0]);
+}
+
+void test_rejects_incomplete_messages()
+{
+    SunMessage sun;
+
+    // NDEF file of a card without SDM
+    const char plain[] = "\x04"
+                         "fabaccess.org";
+    TEST_ASSERT_FALSE(parse(plain, sizeof(plain) - 1, sun));
+
+    // Template before SDM mirrored into it
+    const char unmirrored[] = "fabaccess://sun?u=00000000000000&c=000000&m=";
+    TEST_ASSERT_FALSE(parse(unmirrored, sizeof(unmirrored) - 1, sun));
+
+    const char not_hex[] = "fabaccess://sun?u=04DE5F1EACC04G&c=00003D&m=94EED9EE65337086";
+    TEST_ASSERT_FALSE(parse(not_hex, sizeof(not_hex) - 1, sun));
+
+    // A parameter name inside another value doesn't count
+    const char nested[] = "fabaccess://sun?x=u=04DE5F1EACC040&c=00003D&m=94EED9EE65337086";
+    TEST_ASSERT_FALSE(parse(nested, sizeof(nested) - 1, sun));
+
+    // Cut off by a short read
+    TEST_ASSERT_FALSE(parse(URI, sizeof(URI) - 2, sun));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_mirrored_values);
+    RUN_TEST(test_parameter_order_and_case);
+    RUN_TEST(test_rejects_incomplete_messages);
+    return UNITY_END();
+}
@@ -37,6 +37,15 @@ export class NFCCard {
   @Exclude()
   keys!: NTag424Keys;
 
+  // Highest SUN counter accepted from the card, -1 until the first SUN tap. Null while the
+  // card doesn't mirror SUN messages.
+  @Column({
+    type: 'integer',
+    nullable: true,
+  })
+  @Exclude()
+  sunCounter?: number | null;
+
   @CreateDateColumn()
   @ApiProperty({ description: 'The date and time the NFC card was created' })
   createdAt!: Date;